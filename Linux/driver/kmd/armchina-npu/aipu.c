@@ -70,6 +70,7 @@ static long aipu_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 	struct aipu_dma_buf_request dmabuf_req;
 	struct aipu_dma_buf dmabuf_info;
 	struct aipu_group_id_desc group_id_desc;
+	struct aipu_job_batch job_batch;
 	int fd = 0;
 
 	u64 job_id;
@@ -245,6 +246,17 @@ static long aipu_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 		else
 			ret = -EINVAL;
 		break;
+	case AIPU_IOCTL_SCHEDULE_JOB_BATCH:
+		if (!copy_from_user(&job_batch, (struct aipu_job_batch __user *)arg,
+				    sizeof(job_batch))) {
+			ret = aipu_job_manager_scheduler_batch(manager, &job_batch, filp);
+			if (copy_to_user((struct aipu_job_batch __user *)arg, &job_batch,
+					 sizeof(job_batch)))
+				ret = -EINVAL;
+		} else {
+			ret = -EINVAL;
+		}
+		break;
 	default:
 		ret = -ENOTTY;
 		break;
@@ -504,13 +504,12 @@ static int schedule_v3_job_no_lock(struct aipu_job_manager *manager, struct aipu
 	return ret;
 }
 
-static int schedule_new_job(struct aipu_job_manager *manager, struct aipu_job_desc *user_job,
-			    struct file *filp, int do_trigger)
+static int prepare_new_job(struct aipu_job_manager *manager, struct aipu_job_desc *user_job,
+			   struct file *filp, struct aipu_job **job)
 {
 	int ret = 0;
 	struct aipu_job *kern_job = NULL;
 	struct aipu_thread_wait_queue *queue = NULL;
-	unsigned long flags;
 
 	mutex_lock(&manager->wq_lock);
 	if (user_job->enable_poll_opt)
@@ -536,7 +535,16 @@ static int schedule_new_job(struct aipu_job_manager *manager, struct aipu_job_de
 		}
 	}
 
-	spin_lock_irqsave(&manager->lock, flags);
+	*job = kern_job;
+	return 0;
+}
+
+static int queue_new_job_no_lock(struct aipu_job_manager *manager, struct aipu_job *kern_job,
+				 int do_trigger)
+{
+	int ret = 0;
+	struct aipu_job_desc *user_job = &kern_job->desc;
+
 	if (do_trigger) {
 		kern_job->state = AIPU_JOB_STATE_PENDING;
 		list_add_tail(&kern_job->node, &manager->scheduled_head->node);
@@ -566,7 +574,7 @@ static int schedule_new_job(struct aipu_job_manager *manager, struct aipu_job_de
 			 */
 			if (kern_job->desc.exec_flag & AIPU_JOB_EXEC_FLAG_SRAM_MUTEX) {
 				if (manager->exec_flag & AIPU_JOB_EXEC_FLAG_SRAM_MUTEX)
-					goto unlock;
+					return ret;
 				else
 					manager->exec_flag |= AIPU_JOB_EXEC_FLAG_SRAM_MUTEX;
 			}
@@ -580,8 +588,7 @@ static int schedule_new_job(struct aipu_job_manager *manager, struct aipu_job_de
 		     !manager->idle_bmap[user_job->core_id])) {
 			dev_err(manager->dev, "schedule new job (0x%llx) failed: invalid core ID %u",
 				kern_job->desc.job_id, user_job->core_id);
-			ret = -EINVAL;
-			goto unlock;
+			return -EINVAL;
 		}
 
 		kern_job->state = AIPU_JOB_STATE_DEFERRED;
@@ -591,7 +598,23 @@ static int schedule_new_job(struct aipu_job_manager *manager, struct aipu_job_de
 		if (user_job->aipu_version < AIPU_ISA_VERSION_ZHOUYI_V3)
 			reserve_core_for_job_no_lock(manager, kern_job, do_trigger);
 	}
-unlock:
+
+	return ret;
+}
+
+static int schedule_new_job(struct aipu_job_manager *manager, struct aipu_job_desc *user_job,
+			    struct file *filp, int do_trigger)
+{
+	int ret = 0;
+	struct aipu_job *kern_job = NULL;
+	unsigned long flags;
+
+	ret = prepare_new_job(manager, user_job, filp, &kern_job);
+	if (ret)
+		return ret;
+
+	spin_lock_irqsave(&manager->lock, flags);
+	ret = queue_new_job_no_lock(manager, kern_job, do_trigger);
 	spin_unlock_irqrestore(&manager->lock, flags);
 	return ret;
 }
@@ -793,6 +816,101 @@ int aipu_job_manager_scheduler(struct aipu_job_manager *manager, struct aipu_job
 	return ret;
 }
 
+/**
+ * @aipu_job_manager_scheduler_batch() - schedule a batch of jobs flushed from userland
+ * @manager: pointer to the struct job_manager initialized in init_aipu_job_manager()
+ * @batch:   pointer to the batch descriptor, scheduled_cnt is filled here
+ * @filp:    pointer to the device char file
+ *
+ * All the jobs are validated and prepared before any of them is queued, and then
+ * queued in order under one lock so that v3 jobs are chained into one command pool.
+ * Jobs following a failed one are never queued and freed here.
+ *
+ * Return: 0 on success and error code otherwise.
+ */
+int aipu_job_manager_scheduler_batch(struct aipu_job_manager *manager,
+				     struct aipu_job_batch *batch, struct file *filp)
+{
+	int ret = 0;
+	int queue_ret = 0;
+	u32 idx = 0;
+	u32 prepared = 0;
+	struct aipu_job_desc *user_jobs = NULL;
+	struct aipu_job **kern_jobs = NULL;
+	unsigned long flags;
+
+	if (unlikely(!manager || !batch || !filp))
+		return -EINVAL;
+
+	batch->scheduled_cnt = 0;
+	if (!batch->cnt || batch->cnt > AIPU_JOB_BATCH_MAX_CNT)
+		return -EINVAL;
+
+	if (atomic_read(&manager->is_suspend)) {
+		dev_err(manager->dev, "[scheduler] the NPU hw is not available now");
+		return -ENODEV;
+	}
+
+	user_jobs = kmalloc_array(batch->cnt, sizeof(*user_jobs), GFP_KERNEL);
+	kern_jobs = kcalloc(batch->cnt, sizeof(*kern_jobs), GFP_KERNEL);
+	if (!user_jobs || !kern_jobs) {
+		ret = -ENOMEM;
+		goto finish;
+	}
+
+	if (copy_from_user(user_jobs, u64_to_user_ptr(batch->jobs),
+			   batch->cnt * sizeof(*user_jobs))) {
+		ret = -EFAULT;
+		goto finish;
+	}
+
+	/* deferred jobs are reserved and triggered one by one, never batched */
+	for (idx = 0; idx < batch->cnt; idx++) {
+		if (unlikely(!is_user_job_valid(manager, &user_jobs[idx]) ||
+			     user_jobs[idx].is_defer_run)) {
+			dev_err(manager->dev, "[scheduler] invalid batched user job (0x%llx)",
+				user_jobs[idx].job_id);
+			ret = -EINVAL;
+			goto finish;
+		}
+	}
+
+	for (prepared = 0; prepared < batch->cnt; prepared++) {
+		ret = prepare_new_job(manager, &user_jobs[prepared], filp, &kern_jobs[prepared]);
+		if (ret)
+			break;
+	}
+
+	spin_lock_irqsave(&manager->lock, flags);
+	for (idx = 0; idx < prepared; idx++) {
+		queue_ret = queue_new_job_no_lock(manager, kern_jobs[idx], 1);
+
+		/* a job pending on a full v3_1 command pool is dispatched later */
+		if (queue_ret && queue_ret != ZHOUYI_V3_1_COMMAND_POOL_FULL) {
+			ret = queue_ret;
+			break;
+		}
+		batch->scheduled_cnt++;
+	}
+	spin_unlock_irqrestore(&manager->lock, flags);
+
+	/* the failed job is on the scheduled list, the ones after it were never queued */
+	for (idx = batch->scheduled_cnt + 1; idx < prepared; idx++) {
+		if (kern_jobs[idx]->desc.aipu_version == AIPU_ISA_VERSION_ZHOUYI_V3)
+			aipu_mm_unlink_tcb(manager->mm, kern_jobs[idx]->curr_hold_tcb, false);
+		destroy_aipu_job(manager, kern_jobs[idx]);
+	}
+
+	if (ret)
+		dev_err(manager->dev, "[scheduler] schedule job batch failed: scheduled %u of %u",
+			batch->scheduled_cnt, batch->cnt);
+
+finish:
+	kfree(kern_jobs);
+	kfree(user_jobs);
+	return ret;
+}
+
 static void aipu_job_manager_real_time_printk(struct aipu_job_manager *manager,
 					      struct aipu_partition *partition,
 					      struct job_irq_info *info)
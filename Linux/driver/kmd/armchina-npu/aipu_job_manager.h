@@ -211,6 +211,8 @@ void aipu_job_manager_set_partitions_info(struct aipu_job_manager *manager, int
 					  struct aipu_partition *partitions);
 int aipu_job_manager_scheduler(struct aipu_job_manager *manager, struct aipu_job_desc *user_job,
 			       struct file *filp);
+int aipu_job_manager_scheduler_batch(struct aipu_job_manager *manager,
+				     struct aipu_job_batch *batch, struct file *filp);
 void aipu_job_manager_irq_upper_half(struct aipu_partition *core, int exception_flag,
 				     struct job_irq_info *info);
 void aipu_job_manager_irq_bottom_half(struct aipu_partition *core);
@@ -444,6 +444,19 @@ struct aipu_group_id_desc {
 	__u16 first_id;
 };
 
+/**
+ * struct aipu_job_batch - A batch of jobs to be scheduled in order by one call.
+ * @cnt:           [must] Number of job descriptors, no more than AIPU_JOB_BATCH_MAX_CNT
+ * @scheduled_cnt: [kmd] Number of the leading jobs scheduled successfully
+ * @jobs:          [must] Address of an array (length is cnt) of struct aipu_job_desc
+ */
+#define AIPU_JOB_BATCH_MAX_CNT 64
+struct aipu_job_batch {
+	__u32 cnt;
+	__u32 scheduled_cnt;
+	__u64 jobs;
+};
+
 /*
  * AIPU IOCTL List
  */
@@ -673,5 +686,17 @@ struct aipu_group_id_desc {
  *   aipu_group_id_desc->first_id:   filled by UMD
  */
 #define AIPU_IOCTL_FREE_GROUP_ID _IOW(AIPU_IOCTL_MAGIC, 23, struct aipu_group_id_desc)
+/**
+ * DOC: AIPU_IOCTL_SCHEDULE_JOB_BATCH
+ *
+ * @Description
+ *
+ * ioctl to schedule a batch of user jobs by one call; all the jobs are validated and
+ * prepared before any of them is queued, and v3 jobs of a batch are chained into one
+ * command pool under one lock. jobs are scheduled in order and the first failure stops
+ * the batch.
+ *   aipu_job_batch->scheduled_cnt: filled by KMD
+ */
+#define AIPU_IOCTL_SCHEDULE_JOB_BATCH _IOWR(AIPU_IOCTL_MAGIC, 24, struct aipu_job_batch)
 
 #endif /* __UAPI_MISC_ARMCHINA_AIPU_H__ */
@@ -321,6 +321,92 @@ typedef struct aipu_driver_version
     char kmd_version[16]; /**< the buffer for storing KMD version string */
 } aipu_driver_version_t;
 
+/**
+ * @struct aipu_mem_stats
+ *
+ * @brief get allocator statistics of one device memory region
+ *
+ * @note fragmentation is in percent: 0 means all free pages are in one
+ *       extent, it grows as free space splits into smaller extents.
+ *       the latency fields cover all allocations of the memory module.
+ */
+typedef struct aipu_mem_stats
+{
+    uint32_t asid;               /**< ASID to be inquired: filled by USER */
+    uint32_t mem_type;           /**< memory region type, AIPU_MEM_REGION_*: filled by USER */
+    uint64_t total_bytes;        /**< region size: filled by UMD */
+    uint64_t free_bytes;         /**< free bytes in region: filled by UMD */
+    uint64_t largest_free_bytes; /**< the largest contiguous free bytes: filled by UMD */
+    uint32_t free_extent_cnt;    /**< number of free extents: filled by UMD */
+    uint32_t fragmentation;      /**< 100 - largest_free_bytes * 100 / free_bytes: filled by UMD */
+    uint64_t alloc_cnt;          /**< successful allocations: filled by UMD */
+    uint64_t alloc_fail_cnt;     /**< failed allocations: filled by UMD */
+    uint64_t alloc_avg_ns;       /**< average allocation latency: filled by UMD */
+    uint64_t alloc_max_ns;       /**< max allocation latency: filled by UMD */
+} aipu_mem_stats_t;
+
+/**
+ * @struct aipu_batch_stats
+ *
+ * @brief get statistics of the last batch queue run by aipu_finish_batch
+ *
+ * @note latency of one batch is counted from loading its inputs to
+ *       its outputs being copied out.
+ */
+typedef struct aipu_batch_stats
+{
+    uint32_t batch_cnt;      /**< number of finished batches */
+    uint32_t max_in_flight;  /**< pipeline depth, env UMD_MAX_BATCH (default 3) */
+    uint64_t elapsed_ns;     /**< time of the whole batch queue run */
+    uint64_t latency_avg_ns; /**< average latency of one batch */
+    uint64_t latency_min_ns; /**< min latency of one batch */
+    uint64_t latency_max_ns; /**< max latency of one batch */
+    float throughput;        /**< finished batches per second */
+} aipu_batch_stats_t;
+
+/**
+ * @struct aipu_load_stats
+ *
+ * @brief get the time spent in each phase of loading a graph
+ *
+ * @note the upload phase covers text, rodata and weights copied to device memory.
+ *       with env UMD_WT_SHARE=1, weights identical to those of a graph loaded before
+ *       (in any context of the process) are not uploaded again but shared.
+ */
+typedef struct aipu_load_stats
+{
+    uint64_t graph_id;       /**< the graph id to be searched */
+    uint32_t upload_threads; /**< threads used for uploading: filled by UMD */
+    uint64_t upload_bytes;   /**< bytes copied to device memory: filled by UMD */
+    uint64_t parse_ns;       /**< graph binary parsing: filled by UMD */
+    uint64_t verify_ns;      /**< target and version check: filled by UMD */
+    uint64_t alloc_ns;       /**< text/rodata/weight buffer allocation: filled by UMD */
+    uint64_t upload_ns;      /**< copying to device memory: filled by UMD */
+    uint64_t shared_bytes;   /**< weight bytes reused from graphs loaded before: filled by UMD */
+} aipu_load_stats_t;
+
+/**
+ * @struct aipu_job_cache_stats
+ *
+ * @brief get statistics of a graph's cache of cleaned jobs
+ *
+ * @note a cleaned job keeps its buffers and is handed out again by aipu_create_job
+ *       with an identical config, for a dynamic shape graph the configured input
+ *       shapes must be identical too. the cache is enabled by env UMD_JOB_POOL_SZ
+ *       (jobs, default 0: disabled), the least recently cleaned jobs are destroyed
+ *       when it exceeds that size or env UMD_JOB_POOL_BUDGET (MB of device memory,
+ *       default 256).
+ */
+typedef struct aipu_job_cache_stats
+{
+    uint64_t graph_id;     /**< the graph id to be searched */
+    uint64_t hits;         /**< jobs created from the cache: filled by UMD */
+    uint64_t misses;       /**< jobs created from scratch: filled by UMD */
+    uint64_t evictions;    /**< cached jobs destroyed for cache limits: filled by UMD */
+    uint32_t cached_jobs;  /**< jobs in the cache: filled by UMD */
+    uint64_t cached_bytes; /**< device memory held by cached jobs: filled by UMD */
+} aipu_job_cache_stats_t;
+
 /**
  * @struct aipu_bin_buildversion
  *
@@ -449,12 +535,19 @@ typedef enum {
  * @note wt_idxes
  *       the indexes of weight tensors, those tensor buffers firstly try to be allocated from
  *       region specified in 'wt_mem_region'.
+ *
+ * @note wt_upload_threads
+ *       the weights are copied to device memory in 4MB chunks spread over this many threads.
+ *       0 takes env UMD_WT_UPLOAD_THREADS if set, otherwise up to 8 threads (bounded by the
+ *       CPU count) are used for graphs with 64MB or more to upload, and 1 for smaller graphs.
+ *       it takes spare bits of 'misc', so the layout of this struct is unchanged.
  */
 typedef struct aipu_load_graph_cfg {
     union {
         uint32_t misc = 0;
         struct {
             uint8_t wt_mem_region:4; /**< default 0, weight buffer memory region */
+            uint32_t wt_upload_threads:8; /**< default 0, threads for weight uploading */
         };
     };
 
@@ -519,7 +612,13 @@ typedef enum {
     AIPU_IOCTL_READ_DMABUF,
     AIPU_IOCTL_ATTACH_DMABUF,
     AIPU_IOCTL_DETACH_DMABUF,
-    AIPU_IOCTL_GET_VERSION
+    AIPU_IOCTL_GET_VERSION,
+    AIPU_IOCTL_GET_MEM_STATS,
+    AIPU_IOCTL_TRIM_BUF_CACHE,
+    AIPU_IOCTL_GET_BATCH_STATS,
+    AIPU_IOCTL_GET_LOAD_STATS,
+    AIPU_IOCTL_GET_JOB_CACHE_STATS,
+    AIPU_IOCTL_START_COMPLETION_REACTOR
 } aipu_ioctl_cmd_t;
 
 /**
@@ -690,6 +789,9 @@ aipu_status_t aipu_config_global(const aipu_ctx_handle_t* ctx, uint64_t types, v
  * @retval AIPU_STATUS_ERROR_BUF_ALLOC_FAIL
  * @retval AIPU_STATUS_ERROR_RESERVE_SRAM_FAIL
  * @retval AIPU_STATUS_ERROR_INVALID_GM
+ *
+ * @note the graph file is mapped read-only and parsed in place, so it must not be
+ *       truncated or rewritten before the graph is unloaded.
  */
 aipu_status_t aipu_load_graph(const aipu_ctx_handle_t* ctx, const char* graph,
     uint64_t* id, aipu_load_graph_cfg_t *config = nullptr);
@@ -721,6 +823,21 @@ aipu_status_t aipu_load_graph(const aipu_ctx_handle_t* ctx, const char* graph,
 aipu_status_t aipu_load_graph_helper(const aipu_ctx_handle_t* ctx, const char* graph_buf,
     uint32_t graph_size, uint64_t* id, aipu_load_graph_cfg_t *config = nullptr);
 
+/**
+ * @brief This API is aipu_load_graph_helper for graph binaries of 4GB or more.
+ *
+ * @param[in]  ctx   Pointer to a context handle struct returned by aipu_init_context
+ * @param[in]  graph_buf The start address of buffer which stores graph binary data
+ * @param[in]  graph_size The byte size of graph binary data in 'graph_buf'
+ * @param[out] id    Pointer to a memory location allocated by application where UMD stores the
+ *                       graph ID
+ * @param[in]  config Pointer to specific configuration struct
+ *
+ * @retval the same as aipu_load_graph_helper
+ */
+aipu_status_t aipu_load_graph_helper_64(const aipu_ctx_handle_t* ctx, const char* graph_buf,
+    uint64_t graph_size, uint64_t* id, aipu_load_graph_cfg_t *config = nullptr);
+
 /**
  * @brief This API is used to unload a loaded graph
  *
@@ -797,6 +914,28 @@ aipu_status_t aipu_finish_job(const aipu_ctx_handle_t* ctx, uint64_t job, int32_
 aipu_status_t aipu_flush_job(const aipu_ctx_handle_t* ctx, uint64_t job,
     aipu_job_callback_func_t cb_func = nullptr);
 
+/**
+ * @brief This API is used to flush a batch of computation jobs onto AIPU (non-blocking)
+ *
+ * @param[in] ctx     Pointer to a context handle struct returned by aipu_init_context
+ * @param[in] jobs    Array of job IDs returned by aipu_create_job
+ * @param[in] cnt     Count of the job IDs
+ * @param[in] cb_func Callback function set for each of the jobs
+ *
+ * @retval AIPU_STATUS_SUCCESS
+ * @retval AIPU_STATUS_ERROR_NULL_PTR
+ * @retval AIPU_STATUS_ERROR_INVALID_CTX
+ * @retval AIPU_STATUS_ERROR_INVALID_SIZE
+ * @retval AIPU_STATUS_ERROR_INVALID_JOB_ID
+ * @retval AIPU_STATUS_ERROR_INVALID_OP
+ *
+ * @note The jobs are prepared first and then scheduled in order by one KMD call, jobs of
+ *       aipu v3 are chained into one command pool. The jobs are scheduled in order and the
+ *       first failure stops the batch, use aipu_get_job_status to tell the scheduled ones.
+ */
+aipu_status_t aipu_flush_jobs(const aipu_ctx_handle_t* ctx, const uint64_t* jobs, uint32_t cnt,
+    aipu_job_callback_func_t cb_func = nullptr);
+
 /**
  * @brief This API is used to get the execution status of a flushed job (non-blocking)
  *
@@ -822,6 +961,46 @@ aipu_status_t aipu_flush_job(const aipu_ctx_handle_t* ctx, uint64_t job,
 aipu_status_t aipu_get_job_status(const aipu_ctx_handle_t* ctx, uint64_t job,
     aipu_job_status_t* status, int32_t timeout = 0);
 
+/**
+ * @brief This API is used to get a pollable fd which turns readable when flushed jobs end,
+ *        so that job completions can be integrated into the application's epoll loop.
+ *
+ * @param[in]  ctx Pointer to a context handle struct returned by aipu_init_context
+ * @param[out] fd  Pointer to a memory location allocated by application where UMD stores
+ *                     the fd, which should be closed by the application
+ *
+ * @retval AIPU_STATUS_SUCCESS
+ * @retval AIPU_STATUS_ERROR_NULL_PTR
+ * @retval AIPU_STATUS_ERROR_INVALID_CTX
+ * @retval AIPU_STATUS_ERROR_INVALID_OP
+ *
+ * @note On hardware, the fd is a duplicate of /dev/aipu and no thread is created. The
+ *       application calls aipu_process_completions when it's readable, which fires the
+ *       callbacks in the calling thread.
+ * @note Under simulation or if AIPU_IOCTL_START_COMPLETION_REACTOR is issued before, it's an
+ *       eventfd signalled by the driver thread after the callbacks are fired.
+ * @note Call it before flushing the jobs to be notified. Jobs of other contexts sharing
+ *       the device in this process should not be scheduled meanwhile.
+ */
+aipu_status_t aipu_get_completion_fd(const aipu_ctx_handle_t* ctx, int* fd);
+
+/**
+ * @brief This API is used to deliver the ended jobs after the completion fd is readable
+ *        (non-blocking)
+ *
+ * @param[in]  ctx Pointer to a context handle struct returned by aipu_init_context
+ * @param[out] cnt Pointer to a memory location allocated by application where UMD stores
+ *                     the count of jobs delivered since the last call
+ *
+ * @retval AIPU_STATUS_SUCCESS
+ * @retval AIPU_STATUS_ERROR_NULL_PTR
+ * @retval AIPU_STATUS_ERROR_INVALID_CTX
+ * @retval AIPU_STATUS_ERROR_INVALID_OP
+ *
+ * @note The job status is then available by aipu_get_job_status with timeout 0.
+ */
+aipu_status_t aipu_process_completions(const aipu_ctx_handle_t* ctx, uint32_t* cnt);
+
 /**
  * @brief This API is used to clean a finished job object scheduled by aipu_finish_job/aipu_flush_job
  *
@@ -863,7 +1042,13 @@ aipu_status_t aipu_get_tensor_count(const aipu_ctx_handle_t* ctx, uint64_t id, a
  * @retval AIPU_STATUS_ERROR_NULL_PTR
  * @retval AIPU_STATUS_ERROR_INVALID_CTX
  * @retval AIPU_STATUS_ERROR_INVALID_GRAPH_ID
+ * @retval AIPU_STATUS_ERROR_INVALID_JOB_ID
  * @retval AIPU_STATUS_ERROR_INVALID_TENSOR_ID
+ *
+ * @note For a dynamic shape graph, pass the job ID to get the input sizes configured
+ *       for that job and, once it is done, its actual output sizes. With a graph ID the
+ *       sizes recorded in the graph binary are returned; they are never changed by jobs,
+ *       so jobs of one graph with different shapes may run concurrently.
  */
 aipu_status_t aipu_get_tensor_descriptor(const aipu_ctx_handle_t* ctx, uint64_t id, aipu_tensor_type_t type,
     uint32_t tensor, aipu_tensor_desc_t* desc);
@@ -1283,6 +1468,28 @@ aipu_status_t aipu_finish_batch(const aipu_ctx_handle_t *ctx, uint64_t graph_id,
  *       AIPU_IOCTL_GET_AIPUBIN_BUILDVERSION
  *           get model binary's build version.
  *           arg: { aipu_bin_buildversion_t* }
+ *       AIPU_IOCTL_GET_MEM_STATS
+ *           get allocator statistics of a memory region, simulation only.
+ *           arg: { aipu_mem_stats_t* }
+ *       AIPU_IOCTL_TRIM_BUF_CACHE
+ *           give freed buffers kept by UMD for reuse back to KMD.
+ *           the cache size is limited by env UMD_BUF_CACHE_SZ (MB, default 0: disable).
+ *           arg: { uint64_t* }
+ *           in: the bytes allowed to stay in cache, 0 releases all
+ *           out: the bytes still in cache
+ *       AIPU_IOCTL_GET_BATCH_STATS
+ *           get latency and throughput of the last batch queue run by aipu_finish_batch.
+ *           arg: { aipu_batch_stats_t* }
+ *       AIPU_IOCTL_GET_LOAD_STATS
+ *           get the per-phase load timings of a graph.
+ *           arg: { aipu_load_stats_t* }
+ *       AIPU_IOCTL_GET_JOB_CACHE_STATS
+ *           get the hit/miss counters of a graph's job cache.
+ *           arg: { aipu_job_cache_stats_t* }
+ *       AIPU_IOCTL_START_COMPLETION_REACTOR
+ *           start a driver thread which delivers the ended jobs of this context and
+ *           fires their aipu_flush_job callbacks, same as UMD_COMPLETION_REACTOR=1.
+ *           arg: { nullptr }
  */
 aipu_status_t aipu_ioctl(aipu_ctx_handle_t *ctx, uint32_t cmd, void *arg = nullptr);
 
@@ -0,0 +1,341 @@
+// Copyright (C) 2023-2024 Arm Technology (China) Co. Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+/**
+ * @file  completion_reactor.cpp
+ * @brief AIPU User Mode Driver (UMD) job completion reactor module implementation
+ */
+
+#include <algorithm>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include "completion_reactor.h"
+#include "context.h"
+#include "ctx_ref_map.h"
+#include "job_base.h"
+#include "utils/log.h"
+
+/* max ended jobs fetched by one status query */
+#define REACTOR_DRAIN_MAX_CNT 64
+
+/* ms, bounds the reaction to stop and the wait slices of fd mode */
+#define REACTOR_POLL_SLICE 10
+
+aipu_status_t aipudrv::CompletionReactor::start(bool threaded)
+{
+    m_dev = m_ctx.get_dev();
+
+    /* without a pollable device (simulation), completions are driven by a thread */
+    if ((m_dev == nullptr) || (m_dev->get_poll_fd() < 0))
+    {
+        m_dev = nullptr;
+        threaded = true;
+    }
+
+    m_threaded = threaded;
+    if (!m_threaded)
+        return AIPU_STATUS_SUCCESS;
+
+    m_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_event_fd < 0)
+    {
+        LOG(LOG_ERR, "create completion eventfd [fail]");
+        return AIPU_STATUS_ERROR_INVALID_OP;
+    }
+
+    m_stop = false;
+    m_thread = std::thread(&CompletionReactor::loop, this);
+    return AIPU_STATUS_SUCCESS;
+}
+
+void aipudrv::CompletionReactor::stop()
+{
+    if (m_thread.joinable())
+    {
+        m_stop = true;
+        m_track_cond.notify_all();
+        m_thread.join();
+    }
+
+    if (m_event_fd >= 0)
+    {
+        close(m_event_fd);
+        m_event_fd = -1;
+    }
+}
+
+void aipudrv::CompletionReactor::loop()
+{
+    while (!m_stop)
+    {
+        if (m_dev != nullptr)
+            drain_device(REACTOR_POLL_SLICE * 10);
+        else
+            drive_inflight(REACTOR_POLL_SLICE * 10);
+    }
+}
+
+bool aipudrv::CompletionReactor::is_ended(JobBase *job)
+{
+    return (job->get_job_status() == AIPU_JOB_STATUS_DONE) ||
+        (job->get_job_status() == AIPU_JOB_STATUS_EXCEPTION);
+}
+
+void aipudrv::CompletionReactor::notify()
+{
+    /* lock before notifying so that a waiter can't miss the status change */
+    m_lock.lock();
+    m_lock.unlock();
+    m_done_cond.notify_all();
+}
+
+/**
+ * @brief publish the end of a job and fire its callback. a waiter may clean
+ *        the job once its end is visible, so it isn't touched after that.
+ *        under simulation the poll has published it already.
+ */
+void aipudrv::CompletionReactor::deliver(JobBase *job, uint32_t state)
+{
+    aipu_job_callback_func_t job_callback_func = job->get_job_cb();
+    JOB_ID id = job->get_id();
+
+    if (job->get_job_status() != state)
+        job->update_job_status(state);
+
+    if (job_callback_func != nullptr)
+        job_callback_func(id, (aipu_job_status_t)state);
+
+    notify();
+}
+
+/**
+ * @brief poll /dev/aipu, fetch all ended jobs of this process by one status
+ *        query and deliver those of this context. the others are handed back
+ *        to the contexts which scheduled them. returns the delivered count.
+ */
+uint32_t aipudrv::CompletionReactor::drain_device(int32_t time_out)
+{
+    struct pollfd poll_list;
+    JobBase *job = nullptr;
+    aipu_job_callback_func_t job_callback_func = nullptr;
+    uint32_t cnt = 0;
+    uint64_t value = 0;
+
+    if (!m_drain_lock.try_lock_for(std::chrono::milliseconds(time_out)))
+        return 0;
+
+    poll_list.fd = m_dev->get_poll_fd();
+    poll_list.events = POLLIN | POLLPRI;
+    poll_list.revents = 0;
+    if ((poll(&poll_list, 1, time_out) <= 0) || ((poll_list.revents & POLLIN) != POLLIN))
+        goto unlock;
+
+    if (m_dev->drain_status(m_jobs_status, REACTOR_DRAIN_MAX_CNT) != AIPU_LL_STATUS_SUCCESS)
+        goto unlock;
+
+    for (auto &desc : m_jobs_status)
+    {
+        /* job IDs are unique in the process, a job not found here is of another context */
+        job = m_ctx.get_job_object(desc.job_id);
+        if (job == nullptr)
+        {
+            job_callback_func = nullptr;
+            if (CtxRefMap::get_ctx_map().hand_back_job(desc.job_id, desc.state, &m_ctx,
+                &job_callback_func))
+            {
+                if (job_callback_func != nullptr)
+                    job_callback_func(desc.job_id, (aipu_job_status_t)desc.state);
+            } else {
+                LOG(LOG_WARN, "ended job 0x%lx isn't of any context", (unsigned long)desc.job_id);
+            }
+            continue;
+        }
+
+        job->wait_scheduled();
+        deliver(job, desc.state);
+        cnt++;
+    }
+
+unlock:
+    m_drain_lock.unlock();
+
+    if ((cnt > 0) && (m_event_fd >= 0))
+    {
+        value = cnt;
+        if (write(m_event_fd, &value, sizeof(value)) != sizeof(value))
+            LOG(LOG_WARN, "signal completion eventfd [fail]");
+    }
+    return cnt;
+}
+
+/**
+ * @brief simulation only: whoever polls drives the simulator, so poll the
+ *        tracked jobs one by one and deliver the ended ones.
+ */
+uint32_t aipudrv::CompletionReactor::drive_inflight(int32_t time_out)
+{
+    std::list<JobBase *>::iterator iter;
+    JobBase *job = nullptr;
+    uint32_t cnt = 0, idx = 0;
+    uint64_t value = 0;
+
+    {
+        std::unique_lock<std::mutex> lock_(m_lock);
+        if (m_inflight.empty())
+            m_track_cond.wait_for(lock_, std::chrono::milliseconds(time_out),
+                [this] { return m_stop || !m_inflight.empty(); });
+        if (m_inflight.empty())
+            return 0;
+    }
+
+    m_drain_lock.lock();
+    while (!m_stop)
+    {
+        m_lock.lock();
+        if (idx >= m_inflight.size())
+        {
+            m_lock.unlock();
+            break;
+        }
+        iter = m_inflight.begin();
+        std::advance(iter, idx);
+        job = *iter;
+        m_lock.unlock();
+
+        if (!is_ended(job))
+            job->poll_device((idx == 0) ? REACTOR_POLL_SLICE : 0);
+
+        if (!is_ended(job))
+        {
+            idx++;
+            continue;
+        }
+
+        /* a callback may clean other tracked jobs, so rescan after each delivery */
+        m_lock.lock();
+        m_inflight.remove(job);
+        m_lock.unlock();
+        deliver(job, job->get_job_status());
+        cnt++;
+    }
+    m_drain_lock.unlock();
+
+    if (cnt > 0)
+    {
+        value = cnt;
+        if (write(m_event_fd, &value, sizeof(value)) != sizeof(value))
+            LOG(LOG_WARN, "signal completion eventfd [fail]");
+    }
+    return cnt;
+}
+
+/**
+ * @brief publish the end of a job of this context drained by the reactor of
+ *        another, which fires its callback
+ */
+void aipudrv::CompletionReactor::hand_back(JobBase *job, uint32_t state)
+{
+    uint64_t value = 1;
+
+    job->update_job_status(state);
+    notify();
+
+    if (m_event_fd >= 0)
+    {
+        if (write(m_event_fd, &value, sizeof(value)) != sizeof(value))
+            LOG(LOG_WARN, "signal completion eventfd [fail]");
+    }
+}
+
+void aipudrv::CompletionReactor::track(JobBase *job)
+{
+    if (m_dev != nullptr)
+        return;
+
+    std::lock_guard<std::mutex> lock_(m_lock);
+    for (auto iter : m_inflight)
+    {
+        if (iter == job)
+            return;
+    }
+    m_inflight.push_back(job);
+    m_track_cond.notify_one();
+}
+
+/**
+ * @brief forget a job before it's destroyed or recycled. waits for an
+ *        ongoing drive which may be polling the job.
+ */
+void aipudrv::CompletionReactor::untrack(JobBase *job)
+{
+    if (m_dev != nullptr)
+        return;
+
+    std::lock_guard<std::recursive_timed_mutex> drain_lock_(m_drain_lock);
+    std::lock_guard<std::mutex> lock_(m_lock);
+    m_inflight.remove(job);
+}
+
+aipu_status_t aipudrv::CompletionReactor::process(uint32_t *cnt)
+{
+    uint64_t value = 0;
+
+    if (!m_threaded)
+    {
+        *cnt = drain_device(0);
+        return AIPU_STATUS_SUCCESS;
+    }
+
+    /* the reactor thread already delivered them, only consume the notification */
+    if (read(m_event_fd, &value, sizeof(value)) != sizeof(value))
+        value = 0;
+    *cnt = (uint32_t)value;
+    return AIPU_STATUS_SUCCESS;
+}
+
+aipu_status_t aipudrv::CompletionReactor::wait_job(JobBase *job, int32_t time_out)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(time_out);
+    std::unique_lock<std::mutex> lock_(m_lock, std::defer_lock);
+    int32_t slice = REACTOR_POLL_SLICE;
+
+    track(job);
+    if (!m_threaded)
+        drain_device(0);
+
+    while (!is_ended(job))
+    {
+        if (time_out >= 0)
+        {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()).count();
+            if (left <= 0)
+                return AIPU_STATUS_ERROR_TIMEOUT;
+            slice = std::min((int32_t)left, REACTOR_POLL_SLICE);
+        }
+
+        if (m_threaded)
+        {
+            lock_.lock();
+            m_done_cond.wait_for(lock_, std::chrono::milliseconds(slice),
+                [this, job] { return is_ended(job); });
+            lock_.unlock();
+        } else {
+            /* fd mode: the waiters take turns to drain the device */
+            drain_device(slice);
+        }
+    }
+
+    return AIPU_STATUS_SUCCESS;
+}
+
+int aipudrv::CompletionReactor::get_fd()
+{
+    if (m_threaded)
+        return m_event_fd;
+
+    return m_dev->get_poll_fd();
+}
@@ -0,0 +1,91 @@
+// Copyright (C) 2023-2024 Arm Technology (China) Co. Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+/**
+ * @file  completion_reactor.h
+ * @brief AIPU User Mode Driver (UMD) job completion reactor module header
+ */
+
+#ifndef _COMPLETION_REACTOR_H_
+#define _COMPLETION_REACTOR_H_
+
+#include <list>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include "standard_api.h"
+#include "device_base.h"
+
+namespace aipudrv
+{
+class MainContext;
+class JobBase;
+
+/**
+ * delivers the end of the jobs scheduled by any thread of a context and
+ * fires their callbacks, either from a driver-owned thread or from the
+ * thread draining the completion fd.
+ *
+ * threaded: the thread polls /dev/aipu and drains all ended jobs with one
+ *           status query; under simulation it drives the tracked jobs. each
+ *           dispatch round signals an eventfd, which is the completion fd.
+ * fd mode:  hardware only, the completion fd is /dev/aipu itself and the
+ *           user drains it by aipu_process_completions.
+ */
+class CompletionReactor
+{
+private:
+    MainContext &m_ctx;
+    DeviceBase *m_dev = nullptr;
+    bool m_threaded = false;
+    int m_event_fd = -1;
+    std::thread m_thread;
+    std::atomic<bool> m_stop {false};
+
+    /* serializes draining, recursive as callbacks may clean jobs */
+    std::recursive_timed_mutex m_drain_lock;
+    std::vector<aipu_job_status_desc> m_jobs_status;
+
+    /* protects m_inflight, waiters are woken by m_done_cond */
+    std::mutex m_lock;
+    std::condition_variable m_done_cond;
+    std::condition_variable m_track_cond;
+    std::list<JobBase *> m_inflight;
+
+private:
+    void loop();
+    uint32_t drain_device(int32_t time_out);
+    uint32_t drive_inflight(int32_t time_out);
+    void notify();
+    void deliver(JobBase *job, uint32_t state);
+    bool is_ended(JobBase *job);
+
+public:
+    aipu_status_t start(bool threaded);
+    void stop();
+    void track(JobBase *job);
+    void untrack(JobBase *job);
+    void hand_back(JobBase *job, uint32_t state);
+    aipu_status_t process(uint32_t *cnt);
+    aipu_status_t wait_job(JobBase *job, int32_t time_out);
+    int get_fd();
+    bool is_threaded()
+    {
+        return m_threaded;
+    }
+
+public:
+    CompletionReactor(MainContext &ctx): m_ctx(ctx) {}
+    ~CompletionReactor()
+    {
+        stop();
+    }
+    CompletionReactor(const CompletionReactor& reactor) = delete;
+    CompletionReactor& operator=(const CompletionReactor& reactor) = delete;
+};
+}
+
+#endif /* _COMPLETION_REACTOR_H_ */
@@ -10,11 +10,15 @@
 
 #include <set>
 #include <queue>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
 #include <iomanip>
 #include <iostream>
 #include <unistd.h>
 #include <string.h>
 #include <sys/time.h>
+#include <sys/mman.h>
 #include "context.h"
 #include "type.h"
 #include "utils/log.h"
@@ -33,13 +37,16 @@
 #include "super_graph.h"
 #include "job_base.h"
 #include "parser_base.h"
+#include "ctx_ref_map.h"
 
 volatile int32_t UMD_LOG_LEVEL = LOG_WARN;
 volatile char UMD_LOG_TIMESTAMP = 'n';
-aipudrv::MainContext::MainContext()
+volatile bool UMD_LOG_ASYNC = false;
+aipudrv::MainContext::MainContext(): m_graphs(CtxRefMap::get_ctx_map().get_graph_table())
 {
     const char *umd_log_level_env = getenv("UMD_LOG_LEVEL");
     const char *umd_log_timestamp_env = getenv("UMD_LOG_TIMESTAMP");
+    const char *umd_log_async_env = getenv("UMD_LOG_ASYNC");
 
     m_dev = nullptr;
     m_dram = nullptr;
@@ -82,10 +89,17 @@ aipudrv::MainContext::MainContext()
     {
         UMD_LOG_TIMESTAMP = umd_log_timestamp_env[0];
     }
+
+    if (umd_log_async_env != nullptr)
+    {
+        if (umd_log_async_env[0] == 'y' || umd_log_async_env[0] == 'Y')
+            UMD_LOG_ASYNC = true;
+    }
 }
 
 aipudrv::MainContext::~MainContext()
 {
+    delete m_reactor.exchange(nullptr);
     pthread_rwlock_destroy(&m_glock);
     if (m_sim_cfg.simulator != nullptr)
     {
@@ -146,18 +160,36 @@ aipu_status_t aipudrv::MainContext::init()
 
     m_umd_version = MACRO_UMD_VERSION;
 
+    /* UMD_COMPLETION_REACTOR=1: deliver job completions from a driver thread */
+    if ((getenv("UMD_COMPLETION_REACTOR") != nullptr) &&
+        (getenv("UMD_COMPLETION_REACTOR")[0] == '1'))
+        ret = start_completion_reactor(true);
+
     return ret;
 }
 
 void aipudrv::MainContext::force_deinit()
 {
-    GraphTable::iterator iter;
+    CompletionReactor *reactor = nullptr;
 
+    /**
+     * stop delivering before the jobs go away. it's detached under the lock
+     * so no hand back from another context still uses it, and stopped out of
+     * it as its thread may be handing back to this context meanwhile.
+     */
     pthread_rwlock_wrlock(&m_glock);
-    for (iter = m_graphs.begin(); iter != m_graphs.end(); iter++)
-        iter->second->unload();
+    reactor = m_reactor.exchange(nullptr);
+    pthread_rwlock_unlock(&m_glock);
+    if (reactor != nullptr)
+        reactor->stop();
+    delete reactor;
 
-    m_graphs.clear();
+    pthread_rwlock_wrlock(&m_glock);
+    for (auto &item : get_graphs())
+    {
+        item.second->unload();
+        m_graphs.release(item.first);
+    }
 
     if (put_device(m_dev))
         m_dram = nullptr;
@@ -200,18 +232,16 @@ finish:
     return ret;
 }
 
-uint64_t aipudrv::MainContext::create_unique_graph_id_inner() const
+/**
+ * @brief pin a graph ID whose graph object is set later, 0 if no more
+ */
+uint64_t aipudrv::MainContext::create_unique_graph_id_inner()
 {
-    uint64_t id_candidate = (1UL << 32);
-
-    while (m_graphs.count(id_candidate) == 1)
-        id_candidate += (1UL << 32);
-
-    return id_candidate;
+    return (uint64_t)m_graphs.reserve() << 32;
 }
 
-aipu_status_t aipudrv::MainContext::create_graph_object(std::istream& gbin, uint32_t size,
-    uint64_t id, GraphBase** gobj, aipu_load_graph_cfg_t *config)
+aipu_status_t aipudrv::MainContext::create_graph_object(std::istream& gbin, uint64_t size,
+    uint64_t id, GraphBase** gobj, aipu_load_graph_cfg_t *config, const char** gbin_map)
 {
     static std::mutex mtex;
     aipu_status_t ret = AIPU_STATUS_SUCCESS;
@@ -250,6 +280,13 @@ aipu_status_t aipudrv::MainContext::create_graph_object(std::istream& gbin, uint
         goto finish;
     }
 
+    /* the graph owns the file mapping from now on and parses it in place */
+    if ((gbin_map != nullptr) && (*gbin_map != nullptr))
+    {
+        p_gobj->adopt_gbin_map(*gbin_map, size);
+        *gbin_map = nullptr;
+    }
+
     ret = p_gobj->load(gbin, size, m_do_vcheck, config);
     if (ret != AIPU_STATUS_SUCCESS)
     {
@@ -267,14 +304,31 @@ finish:
 aipudrv::GraphBase* aipudrv::MainContext::get_graph_object(GRAPH_ID id)
 {
     GraphBase* p_gobj = nullptr;
-    pthread_rwlock_rdlock(&m_glock);
-    if (m_graphs.count(id) != 0)
-        p_gobj = m_graphs[id];
-    pthread_rwlock_unlock(&m_glock);
+
+    if (get_low_32(id) != 0)
+        return nullptr;
+
+    /* the table is shared, a context only resolves its own graphs */
+    p_gobj = m_graphs.get(id >> 32);
+    if ((p_gobj == nullptr) || (p_gobj->get_ctx() != this))
+        return nullptr;
 
     return p_gobj;
 }
 
+/* keys and objects of the graphs of this context, in slot order */
+std::vector<std::pair<uint32_t, aipudrv::GraphBase*>> aipudrv::MainContext::get_graphs()
+{
+    std::vector<std::pair<uint32_t, GraphBase*>> graphs;
+
+    for (auto &item : m_graphs.snapshot())
+    {
+        if (item.second->get_ctx() == this)
+            graphs.push_back(item);
+    }
+    return graphs;
+}
+
 aipudrv::JobBase* aipudrv::MainContext::get_job_object(JOB_ID id)
 {
     GraphBase* p_gobj = get_graph_object(job_id2graph_id(id));
@@ -312,50 +366,54 @@ aipu_status_t aipudrv::MainContext::load_graph(const char* graph_file, GRAPH_ID*
     aipu_status_t ret = AIPU_STATUS_SUCCESS;
     GraphBase* gobj = nullptr;
     uint64_t id = 0;
-    std::ifstream gbin;
-    int fsize = 0;
+    const char* gbin_map = nullptr;
+    uint64_t fsize = 0;
 
     if ((graph_file == nullptr) || (_id == nullptr))
-    {
-        ret = AIPU_STATUS_ERROR_NULL_PTR;
-        goto finish;
-    }
+        return AIPU_STATUS_ERROR_NULL_PTR;
 
-    gbin.open(graph_file, std::ifstream::in | std::ifstream::binary);
-    if (!gbin.is_open())
-        return AIPU_STATUS_ERROR_OPEN_FILE_FAIL;
+    /**
+     * map the graph binary read-only instead of reading it into heap: the
+     * parser keeps pointers into the mapping and the weight sections are
+     * paged in from the file only while being copied to device memory.
+     */
+    ret = umd_mmap_file_helper(graph_file, (void **)&gbin_map, &fsize, true);
+    if (ret != AIPU_STATUS_SUCCESS)
+        return ret;
 
-    gbin.seekg(0, gbin.end);
-    fsize = gbin.tellg();
-    gbin.seekg(0, gbin.beg);
+    {
+        CustomMemBuf buf(const_cast<char*>(gbin_map), fsize);
+        std::istream gbin(&buf);
 
-    /* push nullptr into graphs to pin this graph ID */
-    pthread_rwlock_wrlock(&m_glock);
-    id = create_unique_graph_id_inner();
-    m_graphs[id] = nullptr;
-    pthread_rwlock_unlock(&m_glock);
+        /* reserve a slot to pin this graph ID */
+        id = create_unique_graph_id_inner();
+        if (id == 0)
+        {
+            munmap((void *)gbin_map, fsize);
+            return AIPU_STATUS_ERROR_BUF_ALLOC_FAIL;
+        }
+
+        ret = create_graph_object(gbin, fsize, id, &gobj, config, &gbin_map);
+    }
 
-    ret = create_graph_object(gbin, fsize, id, &gobj, config);
     if (ret != AIPU_STATUS_SUCCESS)
     {
-        pthread_rwlock_wrlock(&m_glock);
-        m_graphs.erase(id);
-        pthread_rwlock_unlock(&m_glock);
+        m_graphs.release(id >> 32);
         goto finish;
     }
 
     /* success: update graphs[id] */
-    pthread_rwlock_wrlock(&m_glock);
-    m_graphs[id] = gobj;
-    pthread_rwlock_unlock(&m_glock);
+    m_graphs.set(id >> 32, gobj);
     *_id = id;
 
 finish:
-    gbin.close();
+    /* not adopted by a graph object */
+    if (gbin_map != nullptr)
+        munmap((void *)gbin_map, fsize);
     return ret;
 }
 
-aipu_status_t aipudrv::MainContext::load_graph(const char* graph_buf, uint32_t graph_size,
+aipu_status_t aipudrv::MainContext::load_graph(const char* graph_buf, uint64_t graph_size,
     GRAPH_ID* _id, aipu_load_graph_cfg_t *config)
 {
     aipu_status_t ret = AIPU_STATUS_SUCCESS;
@@ -368,17 +426,16 @@ aipu_status_t aipudrv::MainContext::load_graph(const char* graph_buf, uint32_t g
         return ret;
     }
 
-    if ((graph_size <= 0) || (graph_size > UINT32_MAX))
+    if (graph_size == 0)
     {
         ret = AIPU_STATUS_ERROR_INVALID_SIZE;
         return ret;
     }
 
-    /* push nullptr into graphs to pin this graph ID */
-    pthread_rwlock_wrlock(&m_glock);
+    /* reserve a slot to pin this graph ID */
     id = create_unique_graph_id_inner();
-    m_graphs[id] = nullptr;
-    pthread_rwlock_unlock(&m_glock);
+    if (id == 0)
+        return AIPU_STATUS_ERROR_BUF_ALLOC_FAIL;
 
     CustomMemBuf buf(const_cast<char*>(graph_buf), graph_size);
     std::istream gbin(&buf);
@@ -391,16 +448,12 @@ aipu_status_t aipudrv::MainContext::load_graph(const char* graph_buf, uint32_t g
     ret = create_graph_object(gbin, graph_size, id, &gobj, config);
     if (ret != AIPU_STATUS_SUCCESS)
     {
-        pthread_rwlock_wrlock(&m_glock);
-        m_graphs.erase(id);
-        pthread_rwlock_unlock(&m_glock);
+        m_graphs.release(id >> 32);
         goto finish;
     }
 
     /* success: update graphs[id] */
-    pthread_rwlock_wrlock(&m_glock);
-    m_graphs[id] = gobj;
-    pthread_rwlock_unlock(&m_glock);
+    m_graphs.set(id >> 32, gobj);
     *_id = id;
 
 finish:
@@ -426,9 +479,7 @@ aipu_status_t aipudrv::MainContext::unload_graph(GRAPH_ID id)
     /* p_gobj becomes NULL after destroy */
 
     /* success */
-    pthread_rwlock_wrlock(&m_glock);
-    m_graphs.erase(id);
-    pthread_rwlock_unlock(&m_glock);
+    m_graphs.release(id >> 32);
 
 finish:
     return ret;
@@ -616,6 +667,10 @@ aipu_status_t aipudrv::MainContext::config_hw(uint64_t types, aipu_global_config
         return AIPU_STATUS_ERROR_NULL_PTR;
 
     m_hw_cfg = *config;
+
+    /* the reactor has to be woken by the jobs of all threads */
+    if (m_reactor != nullptr)
+        m_hw_cfg.poll_in_commit_thread = false;
     return ret;
 }
 
@@ -812,25 +867,82 @@ out:
     return ret;
 }
 
+aipu_status_t aipudrv::MainContext::setup_batch_job(GraphBase &graph, uint32_t queue_id,
+    aipu_create_job_cfg_t *config, JOB_ID *job_id)
+{
+    aipu_status_t ret = AIPU_STATUS_SUCCESS;
+    JobBase *job = nullptr;
+    uint32_t types = graph.get_batch_dump_type(queue_id);
+
+    ret = graph.create_job(job_id, &m_sim_cfg, &m_hw_cfg, config);
+    if (ret != AIPU_STATUS_SUCCESS)
+        return ret;
+
+    job = graph.get_job(*job_id);
+#ifdef SIMULATION
+    if (types & AIPU_CONFIG_TYPE_SIMULATION)
+    {
+        aipu_job_config_simulation_t sim_config = {0};
+
+        sim_config.data_dir = graph.get_batch_dump_path(queue_id);
+        ret = job->config_simulation(AIPU_CONFIG_TYPE_SIMULATION, &sim_config);
+        if (ret != AIPU_STATUS_SUCCESS)
+            goto fail;
+    }
+#endif
+
+    if (types & (~AIPU_CONFIG_TYPE_SIMULATION))
+    {
+        aipu_job_config_dump_t dump_config = {0};
+
+        dump_config.dump_dir = graph.get_batch_dump_path(queue_id);
+        ret = job->config_mem_dump(types, &dump_config);
+        if (ret != AIPU_STATUS_SUCCESS)
+            goto fail;
+    }
+
+    return ret;
+
+fail:
+    graph.destroy_job(*job_id);
+    return ret;
+}
+
+/**
+ * batch pipeline: a ring of at most UMD_MAX_BATCH jobs is kept for the whole
+ * queue. when the oldest in-flight job is done, it is handed to an output
+ * thread which fetches its outputs while the main thread waits for the next
+ * job; the slot then comes back, its job is reset and reloaded with the next
+ * batch. a job which can't be reset is destroyed and a new one is created.
+ */
 aipu_status_t aipudrv::MainContext::run_batch(GraphBase &graph, uint32_t queue_id,
     aipu_create_job_cfg_t *config)
 {
     aipu_status_t ret = AIPU_STATUS_SUCCESS, oldret = AIPU_STATUS_SUCCESS;
-    JOB_ID job_id = 0;
-    JobBase *job = nullptr;
     aipu_job_status_t status = AIPU_JOB_STATUS_NO_STATUS;
     typedef struct job_info {
         JOB_ID job_id;
         JobBase *job;
         batch_info_t *batch;
+        uint64_t start_ns;
     } job_info_t;
 
-    job_info_t job_info_item = {0};
-    std::queue<job_info_t> job_queue;
-    uint32_t types = 0;
+    std::vector<job_info_t> ring;
+    uint32_t ring_cnt = 0;
+    std::queue<uint32_t> free_slots;
+    std::queue<uint32_t> in_flight;
+    std::queue<uint32_t> copy_slots;
+    std::queue<uint32_t> copied_slots;
+    std::mutex copy_mtx;
+    std::condition_variable copy_cv;
+    std::thread copy_thread;
+    bool copy_stop = false;
+    aipu_status_t copy_ret = AIPU_STATUS_SUCCESS;
+    aipu_batch_stats_t stats = {0};
     uint32_t batch_num = 0;
     uint32_t max_in_flight = 3;
     uint32_t batch_queue_size = 0;
+    uint64_t run_start_ns = umd_monotonic_ns_helper();
     const char *umd_max_batch = getenv("UMD_MAX_BATCH");
 
     if (!graph.is_valid_batch_queue(queue_id))
@@ -839,146 +951,212 @@ aipu_status_t aipudrv::MainContext::run_batch(GraphBase &graph, uint32_t queue_i
     if (umd_max_batch != nullptr)
     {
         int max_batch = atoi(umd_max_batch);
-        max_in_flight = (max_batch != 0) ? max_batch : max_in_flight;
+        max_in_flight = (max_batch > 0) ? max_batch : max_in_flight;
     }
 
     batch_queue_size = graph.get_batch_queue_size(queue_id);
-    types = graph.get_batch_dump_type(queue_id);
-repeat:
-    for (; batch_num < batch_queue_size; batch_num++)
-    {
-        if (job_queue.size() >= max_in_flight)
-            break;
+    /* sized before the output thread starts, which indexes it concurrently */
+    ring.resize(max_in_flight, job_info_t());
+    stats.max_in_flight = max_in_flight;
 
-        batch_info_t &batch = graph.get_batch_queue_item(queue_id, batch_num);
-        ret = graph.create_job(&job_id, &m_sim_cfg, &m_hw_cfg, config);
-        if (ret == AIPU_STATUS_ERROR_BUF_ALLOC_FAIL)
-        {
-            break;
-        } else if (ret != AIPU_STATUS_SUCCESS) {
-            oldret = ret;
-            goto poll_job_sts;
-        }
+    copy_thread = std::thread([&]() {
+        std::unique_lock<std::mutex> lck(copy_mtx);
 
-        job = graph.get_job(job_id);
-#ifdef SIMULATION
-        if (types & AIPU_CONFIG_TYPE_SIMULATION)
+        while (true)
         {
-            aipu_job_config_simulation_t sim_config = {0};
+            copy_cv.wait(lck, [&]() { return copy_stop || !copy_slots.empty(); });
+            if (copy_slots.empty())
+                break;
 
-            sim_config.data_dir = graph.get_batch_dump_path(queue_id);
-            ret = job->config_simulation(AIPU_CONFIG_TYPE_SIMULATION, &sim_config);
-            if (ret != AIPU_STATUS_SUCCESS)
+            uint32_t slot = copy_slots.front();
+            job_info_t &item = ring[slot];
+            aipu_status_t cret = AIPU_STATUS_SUCCESS;
+            copy_slots.pop();
+            lck.unlock();
+
+            for (uint32_t out_idx = 0; out_idx < item.batch->outputs.size(); out_idx++)
             {
-                oldret = ret;
-                goto poll_job_sts;
+                cret = item.job->get_tensor(AIPU_TENSOR_TYPE_OUTPUT, out_idx,
+                    item.batch->outputs[out_idx]);
+                if (cret != AIPU_STATUS_SUCCESS)
+                    break;
             }
-        }
-#endif
-
-        if (types & (~AIPU_CONFIG_TYPE_SIMULATION)) {
-            aipu_job_config_dump_t dump_config = {0};
+            uint64_t latency_ns = umd_monotonic_ns_helper() - item.start_ns;
 
-            dump_config.dump_dir = graph.get_batch_dump_path(queue_id);
-            ret = job->config_mem_dump(types, &dump_config);
-            if (ret != AIPU_STATUS_SUCCESS)
+            lck.lock();
+            if (cret != AIPU_STATUS_SUCCESS)
             {
-                oldret = ret;
-                goto poll_job_sts;
+                copy_ret = cret;
+            } else {
+                if (stats.batch_cnt == 0 || latency_ns < stats.latency_min_ns)
+                    stats.latency_min_ns = latency_ns;
+                if (latency_ns > stats.latency_max_ns)
+                    stats.latency_max_ns = latency_ns;
+                stats.latency_avg_ns += latency_ns;
+                stats.batch_cnt++;
             }
+            copied_slots.push(slot);
+            copy_cv.notify_all();
         }
+    });
+
+    while (true)
+    {
+        uint32_t slot = 0;
+        bool wait_copied = false;
 
-        for (uint32_t in_idx = 0; in_idx < batch.inputs.size(); in_idx++)
         {
-            ret = job->load_tensor(in_idx, batch.inputs[in_idx]);
-            if (ret != AIPU_STATUS_SUCCESS)
+            std::lock_guard<std::mutex> lck(copy_mtx);
+            while (!copied_slots.empty())
             {
-                oldret = ret;
-                goto poll_job_sts;
+                free_slots.push(copied_slots.front());
+                copied_slots.pop();
             }
+
+            if (copy_ret != AIPU_STATUS_SUCCESS && oldret == AIPU_STATUS_SUCCESS)
+                oldret = copy_ret;
         }
 
-        ret = job->schedule();
-        if (ret != AIPU_STATUS_SUCCESS)
+        /* refill the pipeline while some jobs are still running */
+        while ((oldret == AIPU_STATUS_SUCCESS) && (batch_num < batch_queue_size))
         {
-            oldret = ret;
-            goto poll_job_sts;
-        }
+            job_info_t *item = nullptr;
 
-        job_info_item.job_id = job_id;
-        job_info_item.job = job;
-        job_info_item.batch = &batch;
-        job_queue.push(job_info_item);
-    }
+            if (!free_slots.empty())
+            {
+                slot = free_slots.front();
+                free_slots.pop();
+                item = &ring[slot];
 
-poll_job_sts:
-    while (job_queue.size() > 0)
-    {
-#ifdef SIMULATION
-        uint32_t min_in_flight = (job_queue.size() < max_in_flight) ?
-            job_queue.size() : max_in_flight;
-        for (uint32_t i = 0; i < min_in_flight; i++)
-        {
-            job_info_item = job_queue.front();
-            job_queue.pop();
+                if ((item->job != nullptr) && (item->job->reset() != AIPU_STATUS_SUCCESS))
+                {
+                    graph.destroy_job(item->job_id);
+                    item->job = nullptr;
+                }
+            } else if (ring_cnt < max_in_flight) {
+                slot = ring_cnt++;
+                item = &ring[slot];
+            } else {
+                break;
+            }
 
-            status = AIPU_JOB_STATUS_NO_STATUS;
-            ret = get_status(job_info_item.job, &status);
-            if (ret != AIPU_STATUS_SUCCESS)
-                goto out;
+            if (item->job == nullptr)
+            {
+                ret = setup_batch_job(graph, queue_id, config, &item->job_id);
+                if (ret != AIPU_STATUS_SUCCESS)
+                {
+                    /* return the slot, retry when some buffers are released */
+                    if (slot == ring_cnt - 1)
+                        ring_cnt--;
+                    else
+                        free_slots.push(slot);
+
+                    if ((ret == AIPU_STATUS_ERROR_BUF_ALLOC_FAIL) &&
+                        (ring_cnt - free_slots.size() > 0))
+                    {
+                        ret = AIPU_STATUS_SUCCESS;
+                        break;
+                    }
+                    oldret = ret;
+                    break;
+                }
+                item->job = graph.get_job(item->job_id);
+            }
 
-            for (uint32_t out_idx = 0; out_idx < job_info_item.batch->outputs.size(); out_idx++)
+            item->batch = &graph.get_batch_queue_item(queue_id, batch_num);
+            item->start_ns = umd_monotonic_ns_helper();
+            for (uint32_t in_idx = 0; in_idx < item->batch->inputs.size(); in_idx++)
             {
-                ret = job_info_item.job->get_tensor(AIPU_TENSOR_TYPE_OUTPUT, out_idx,
-                    job_info_item.batch->outputs[out_idx]);
+                ret = item->job->load_tensor(in_idx, item->batch->inputs[in_idx]);
                 if (ret != AIPU_STATUS_SUCCESS)
-                    goto out;
+                    break;
             }
 
-            ret = graph.destroy_job(job_info_item.job_id);
+            if (ret == AIPU_STATUS_SUCCESS)
+                ret = item->job->schedule();
+
             if (ret != AIPU_STATUS_SUCCESS)
-                goto out;
+            {
+                free_slots.push(slot);
+                oldret = ret;
+                break;
+            }
+
+            in_flight.push(slot);
+            batch_num++;
         }
-#else
-        job_info_t job_info_item = job_queue.front();
-        job_queue.pop();
-        status = AIPU_JOB_STATUS_NO_STATUS;
-        ret = get_status(job_info_item.job, &status);
-        if (ret != AIPU_STATUS_SUCCESS)
-            goto out;
 
-        if (status == AIPU_JOB_STATUS_EXCEPTION)
+        if (in_flight.empty())
         {
-            LOG(LOG_ERR, "job exception, check HW status\n");
-            goto out;
+            std::unique_lock<std::mutex> lck(copy_mtx);
+            if (copy_slots.empty() && copied_slots.empty() &&
+                (ring_cnt == free_slots.size()))
+                break;
+
+            /* every job is in the output thread, wait for one back */
+            copy_cv.wait(lck, [&]() { return !copied_slots.empty(); });
+            wait_copied = true;
         }
 
-        for (uint32_t out_idx = 0; out_idx < job_info_item.batch->outputs.size(); out_idx++)
+        if (wait_copied)
+            continue;
+
+        slot = in_flight.front();
+        in_flight.pop();
+        status = AIPU_JOB_STATUS_NO_STATUS;
+        ret = get_status(ring[slot].job, &status);
+        if ((ret == AIPU_STATUS_SUCCESS) && (status == AIPU_JOB_STATUS_EXCEPTION))
         {
-            ret = job_info_item.job->get_tensor(AIPU_TENSOR_TYPE_OUTPUT, out_idx,
-                job_info_item.batch->outputs[out_idx]);
-            if (ret != AIPU_STATUS_SUCCESS)
-                goto out;
+            LOG(LOG_ERR, "job exception, check HW status\n");
+            ret = AIPU_STATUS_ERROR_JOB_EXCEPTION;
         }
 
-        ret = graph.destroy_job(job_info_item.job_id);
         if (ret != AIPU_STATUS_SUCCESS)
-            goto out;
-#endif
+        {
+            if (oldret == AIPU_STATUS_SUCCESS)
+                oldret = ret;
+            free_slots.push(slot);
+            continue;
+        }
 
-        if ((oldret == AIPU_STATUS_SUCCESS) && (batch_num < graph.get_batch_queue_size(queue_id)) )
-            goto repeat;
+        {
+            std::lock_guard<std::mutex> lck(copy_mtx);
+            copy_slots.push(slot);
+        }
+        copy_cv.notify_all();
     }
 
-out:
-    for(uint32_t i = 0; i < job_queue.size(); i++)
     {
-        job_info_t job_info_item = job_queue.front();
-        job_queue.pop();
-        graph.destroy_job(job_info_item.job_id);
+        std::lock_guard<std::mutex> lck(copy_mtx);
+        copy_stop = true;
+        if (copy_ret != AIPU_STATUS_SUCCESS && oldret == AIPU_STATUS_SUCCESS)
+            oldret = copy_ret;
+    }
+    copy_cv.notify_all();
+    copy_thread.join();
+
+    for (uint32_t i = 0; i < ring_cnt; i++)
+    {
+        if (ring[i].job != nullptr)
+            graph.destroy_job(ring[i].job_id);
     }
     graph.clean_batches(queue_id);
 
+    stats.elapsed_ns = umd_monotonic_ns_helper() - run_start_ns;
+    if (stats.batch_cnt > 0)
+        stats.latency_avg_ns /= stats.batch_cnt;
+    if (stats.elapsed_ns > 0)
+        stats.throughput = (float)stats.batch_cnt * 1000000000 / stats.elapsed_ns;
+
+    LOG(LOG_INFO, "batch queue %u: %u batches in %lu us, latency avg/min/max %lu/%lu/%lu us, "
+        "%.2f batches/s\n", queue_id, stats.batch_cnt, stats.elapsed_ns / 1000,
+        stats.latency_avg_ns / 1000, stats.latency_min_ns / 1000, stats.latency_max_ns / 1000,
+        stats.throughput);
+
+    pthread_rwlock_wrlock(&m_glock);
+    m_batch_stats = stats;
+    pthread_rwlock_unlock(&m_glock);
+
     if (oldret != AIPU_STATUS_SUCCESS)
         return oldret;
     else
@@ -992,13 +1170,15 @@ aipu_status_t aipudrv::MainContext::ioctl_cmd(uint32_t cmd, void *arg)
 
     if (cmd != AIPU_IOCTL_ENABLE_TICK_COUNTER &&
         cmd != AIPU_IOCTL_DISABLE_TICK_COUNTER &&
-        cmd != AIPU_IOCTL_ABORT_CMD_POOL)
+        cmd != AIPU_IOCTL_ABORT_CMD_POOL &&
+        cmd != AIPU_IOCTL_START_COMPLETION_REACTOR)
     {
         if (arg == nullptr)
             return AIPU_STATUS_ERROR_NULL_PTR;
     }
 
-    if (cmd >= AIPU_IOCTL_SET_PROFILE && cmd <= AIPU_IOCTL_FREE_SHARE_BUF)
+    if ((cmd >= AIPU_IOCTL_SET_PROFILE && cmd <= AIPU_IOCTL_FREE_SHARE_BUF) ||
+        (cmd >= AIPU_IOCTL_GET_MEM_STATS && cmd <= AIPU_IOCTL_START_COMPLETION_REACTOR))
     {
         switch(cmd)
         {
@@ -1113,6 +1293,61 @@ aipu_status_t aipudrv::MainContext::ioctl_cmd(uint32_t cmd, void *arg)
                 }
                 break;
 
+            case AIPU_IOCTL_GET_MEM_STATS:
+                if (m_dram == nullptr)
+                    return AIPU_STATUS_ERROR_INVALID_OP;
+
+                ret = m_dram->get_mem_stats((aipu_mem_stats_t *)arg);
+                break;
+
+            case AIPU_IOCTL_TRIM_BUF_CACHE:
+                if (m_dram == nullptr)
+                    return AIPU_STATUS_ERROR_INVALID_OP;
+
+                ret = m_dram->trim_cache((uint64_t *)arg);
+                break;
+
+            case AIPU_IOCTL_GET_BATCH_STATS:
+                pthread_rwlock_rdlock(&m_glock);
+                *(aipu_batch_stats_t *)arg = m_batch_stats;
+                pthread_rwlock_unlock(&m_glock);
+                break;
+
+            case AIPU_IOCTL_GET_LOAD_STATS:
+                {
+                    aipu_load_stats_t *stats = (aipu_load_stats_t *)arg;
+                    uint64_t graph_id = stats->graph_id;
+
+                    if (!aipudrv::valid_graph_id(graph_id))
+                        return AIPU_STATUS_ERROR_INVALID_GRAPH_ID;
+
+                    p_gobj = get_graph_object(graph_id);
+                    if (p_gobj == nullptr)
+                        return AIPU_STATUS_ERROR_INVALID_GRAPH_ID;
+
+                    *stats = p_gobj->get_load_stats();
+                    stats->graph_id = graph_id;
+                }
+                break;
+
+            case AIPU_IOCTL_GET_JOB_CACHE_STATS:
+                {
+                    aipu_job_cache_stats_t *stats = (aipu_job_cache_stats_t *)arg;
+
+                    if (!aipudrv::valid_graph_id(stats->graph_id))
+                        return AIPU_STATUS_ERROR_INVALID_GRAPH_ID;
+
+                    p_gobj = get_graph_object(stats->graph_id);
+                    if (p_gobj == nullptr)
+                        return AIPU_STATUS_ERROR_INVALID_GRAPH_ID;
+
+                    p_gobj->get_job_cache_stats(stats);
+                }
+                break;
+
+            case AIPU_IOCTL_START_COMPLETION_REACTOR:
+                return start_completion_reactor(true);
+
             default:
                 LOG(LOG_ERR, "invalid command\n");
                 return AIPU_STATUS_ERROR_OP_NOT_SUPPORTED;
@@ -1138,3 +1373,192 @@ aipu_status_t aipudrv::MainContext::ioctl_cmd(uint32_t cmd, void *arg)
    return ret;
 }
 
+/**
+ * @brief threaded: a driver thread delivers completions and signals an eventfd.
+ *        otherwise the completion fd is /dev/aipu, drained by its user.
+ *        the first start decides the mode for the context's lifetime.
+ */
+aipu_status_t aipudrv::MainContext::start_completion_reactor(bool threaded)
+{
+    aipu_status_t ret = AIPU_STATUS_SUCCESS;
+    CompletionReactor *reactor = nullptr;
+
+    pthread_rwlock_wrlock(&m_glock);
+    if (m_reactor != nullptr)
+    {
+        if (threaded && !m_reactor.load()->is_threaded())
+            ret = AIPU_STATUS_ERROR_INVALID_OP;
+        goto unlock;
+    }
+
+    reactor = new CompletionReactor(*this);
+    ret = reactor->start(threaded);
+    if (ret != AIPU_STATUS_SUCCESS)
+    {
+        delete reactor;
+        goto unlock;
+    }
+
+    /* KMD wakes pollers of other threads only for jobs scheduled hereafter */
+    m_hw_cfg.poll_in_commit_thread = false;
+    m_reactor = reactor;
+
+unlock:
+    pthread_rwlock_unlock(&m_glock);
+    return ret;
+}
+
+/**
+ * @brief publish the end of a job of this context drained by another one.
+ *        returns its callback, the caller fires it once out of its locks.
+ */
+aipu_job_callback_func_t aipudrv::MainContext::hand_back(JobBase *job, uint32_t state)
+{
+    aipu_job_callback_func_t job_callback_func = job->get_job_cb();
+
+    pthread_rwlock_rdlock(&m_glock);
+    if (m_reactor != nullptr)
+        m_reactor.load()->hand_back(job, state);
+    else
+        job->update_job_status(state);
+    pthread_rwlock_unlock(&m_glock);
+
+    return job_callback_func;
+}
+
+aipu_status_t aipudrv::MainContext::get_completion_fd(int *fd)
+{
+    aipu_status_t ret = AIPU_STATUS_SUCCESS;
+
+    if (fd == nullptr)
+        return AIPU_STATUS_ERROR_NULL_PTR;
+
+    ret = start_completion_reactor(false);
+    if (ret != AIPU_STATUS_SUCCESS)
+        return ret;
+
+    *fd = dup(m_reactor.load()->get_fd());
+    if (*fd < 0)
+        return AIPU_STATUS_ERROR_INVALID_OP;
+
+    return ret;
+}
+
+aipu_status_t aipudrv::MainContext::process_completions(uint32_t *cnt)
+{
+    if (cnt == nullptr)
+        return AIPU_STATUS_ERROR_NULL_PTR;
+
+    if (m_reactor == nullptr)
+        return AIPU_STATUS_ERROR_INVALID_OP;
+
+    return m_reactor.load()->process(cnt);
+}
+
+/**
+ * @brief prepare all the jobs first and hand them to the device by one
+ *        schedule call. jobs without split scheduling (aipu v1/v2) are
+ *        scheduled one by one. stops at the first failure, the jobs after
+ *        it are left unscheduled. a job which has to wait for admission
+ *        gets the prepared ones submitted first, their ends admit it.
+ */
+aipu_status_t aipudrv::MainContext::flush_jobs(const JOB_ID *ids, uint32_t cnt,
+    aipu_job_callback_func_t cb_func)
+{
+    aipu_status_t ret = AIPU_STATUS_SUCCESS, sched_ret = AIPU_STATUS_SUCCESS;
+    CompletionReactor *reactor = m_reactor;
+    std::vector<JobBase *> jobs(cnt, nullptr);
+    std::vector<JobDesc> descs(cnt);
+    std::vector<JobDesc *> batch;
+    std::vector<JobBase *> batch_jobs;
+
+    auto submit = [&]() {
+        uint32_t scheduled_cnt = 0;
+        aipu_status_t sret = m_dev->schedule_batch(batch, &scheduled_cnt);
+
+        if ((sret == AIPU_STATUS_SUCCESS) && (scheduled_cnt < batch.size()))
+            sret = AIPU_STATUS_ERROR_INVALID_OP;
+
+        for (uint32_t i = 0; i < batch.size(); i++)
+        {
+            batch_jobs[i]->end_schedule(*batch[i],
+                (i < scheduled_cnt) ? AIPU_STATUS_SUCCESS : sret);
+            if ((i < scheduled_cnt) && (reactor != nullptr))
+                reactor->track(batch_jobs[i]);
+        }
+
+        batch.clear();
+        batch_jobs.clear();
+        return sret;
+    };
+
+    if ((ids == nullptr) || (cnt == 0))
+        return AIPU_STATUS_ERROR_INVALID_SIZE;
+
+    for (uint32_t i = 0; i < cnt; i++)
+    {
+        jobs[i] = get_job_object(ids[i]);
+        if (jobs[i] == nullptr)
+            return AIPU_STATUS_ERROR_INVALID_JOB_ID;
+    }
+
+    batch.reserve(cnt);
+    batch_jobs.reserve(cnt);
+    for (uint32_t i = 0; i < cnt; i++)
+    {
+        jobs[i]->set_job_cb(cb_func);
+
+        /* the prepared jobs may hold what this one waits for */
+        ret = jobs[i]->admit(batch.empty());
+        if (ret == AIPU_STATUS_ERROR_TIMEOUT)
+        {
+            sched_ret = submit();
+            if (sched_ret != AIPU_STATUS_SUCCESS)
+                return sched_ret;
+            ret = jobs[i]->admit(true);
+        }
+        if (ret != AIPU_STATUS_SUCCESS)
+            break;
+
+        if (!jobs[i]->batchable())
+        {
+            /* in order with the jobs prepared before it */
+            if (!batch.empty())
+            {
+                sched_ret = submit();
+                if (sched_ret != AIPU_STATUS_SUCCESS)
+                    return sched_ret;
+            }
+
+            ret = jobs[i]->schedule();
+            if (ret != AIPU_STATUS_SUCCESS)
+                break;
+
+            if (reactor != nullptr)
+                reactor->track(jobs[i]);
+            continue;
+        }
+
+        ret = jobs[i]->prepare_schedule(descs[i]);
+        if (ret != AIPU_STATUS_SUCCESS)
+            break;
+
+        if (descs[i].jobbase != nullptr)
+        {
+            batch.push_back(&descs[i]);
+            batch_jobs.push_back(jobs[i]);
+        } else if (reactor != nullptr) {
+            reactor->track(jobs[i]);
+        }
+    }
+
+    if (batch.empty())
+        return ret;
+
+    sched_ret = submit();
+
+    /* an earlier preparing failure is reported first */
+    if (ret == AIPU_STATUS_SUCCESS)
+        ret = sched_ret;
+    return ret;
+}
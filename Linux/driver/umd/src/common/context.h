@@ -19,18 +19,21 @@
 #include "graph_base.h"
 #include "device_base.h"
 #include "memory_base.h"
+#include "completion_reactor.h"
 
 namespace aipudrv
 {
 #define BUF_LEN 1204
-typedef std::map<GRAPH_ID, GraphBase*> GraphTable;
+/* high 32 bits of a graph ID is its key in the process-wide graph table */
+typedef SlotTable<GraphBase> GraphTable;
 
 class MainContext
 {
 private:
     DeviceBase* m_dev = nullptr;
     MemoryBase* m_dram = nullptr;
-    GraphTable  m_graphs;
+    /* shared by all contexts so graph and job IDs are unique in the process */
+    GraphTable  &m_graphs;
     pthread_rwlock_t m_glock;
     bool m_do_vcheck = true;
     std::map<void*, BufferDesc*> m_dbg_buffers;
@@ -48,10 +51,20 @@ private:
     std::string m_umd_version;
 
 private:
-    uint64_t create_unique_graph_id_inner() const;
-    aipu_status_t create_graph_object(std::istream& gbin, uint32_t size, uint64_t id,
-        GraphBase** gobj, aipu_load_graph_cfg_t *config = nullptr);
+    /* statistics of the last finished batch queue, protected by m_glock */
+    aipu_batch_stats_t m_batch_stats = {0};
+
+private:
+    /* set once under m_glock, lives until deinit */
+    std::atomic<CompletionReactor*> m_reactor {nullptr};
+
+private:
+    uint64_t create_unique_graph_id_inner();
+    aipu_status_t create_graph_object(std::istream& gbin, uint64_t size, uint64_t id,
+        GraphBase** gobj, aipu_load_graph_cfg_t *config = nullptr, const char** gbin_map = nullptr);
     aipu_status_t destroy_graph_object(GraphBase** gobj);
+    aipu_status_t setup_batch_job(GraphBase &graph, uint32_t queue_id,
+        aipu_create_job_cfg_t *config, JOB_ID *job_id);
 
 private:
     bool is_deinit_ok();
@@ -69,7 +82,7 @@ public:
     aipu_status_t get_status_msg(aipu_status_t status, const char** msg);
     aipu_status_t load_graph(const char* graph_file, GRAPH_ID* id,
         aipu_load_graph_cfg_t *config = nullptr);
-    aipu_status_t load_graph(const char* graph_buf, uint32_t graph_size,
+    aipu_status_t load_graph(const char* graph_buf, uint64_t graph_size,
         GRAPH_ID* id, aipu_load_graph_cfg_t *config = nullptr);
     aipu_status_t unload_graph(GRAPH_ID id);
     aipu_status_t get_simulation_instance(void** simulator, void** memory);
@@ -86,6 +99,11 @@ public:
     aipu_status_t run_batch(GraphBase &graph, uint32_t queue_id, aipu_create_job_cfg_t *config);
     aipu_status_t get_status(JobBase *job, aipu_job_status_t *status);
     aipu_status_t ioctl_cmd(uint32_t cmd, void *arg);
+    aipu_status_t start_completion_reactor(bool threaded);
+    aipu_status_t get_completion_fd(int *fd);
+    aipu_status_t process_completions(uint32_t *cnt);
+    aipu_status_t flush_jobs(const JOB_ID *ids, uint32_t cnt, aipu_job_callback_func_t cb_func);
+    aipu_job_callback_func_t hand_back(JobBase *job, uint32_t state);
 
     void disable_version_check()
     {
@@ -124,9 +142,11 @@ public:
         return m_dev;
     };
 
-    GraphTable &get_graphtable()
+    std::vector<std::pair<uint32_t, GraphBase*>> get_graphs();
+
+    CompletionReactor* get_completion_reactor()
     {
-        return m_graphs;
+        return m_reactor;
     }
 
 public:
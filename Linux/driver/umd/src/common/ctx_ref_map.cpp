@@ -9,6 +9,7 @@
  */
 
 #include "ctx_ref_map.h"
+#include "job_base.h"
 
 aipudrv::CtxRefMap::CtxRefMap()
 {
@@ -82,4 +83,34 @@ aipu_status_t aipudrv::CtxRefMap::destroy_ctx_ref(uint32_t handle)
     pthread_mutex_unlock(&lock);
 
     return ret;
-}
\ No newline at end of file
+}
+/**
+ * @brief hand a job ended on the device back to the context which scheduled
+ *        it, job IDs are unique in the process. the context can't go away
+ *        meanwhile. the job's callback is returned in cb, to be fired once
+ *        out of the lock.
+ */
+bool aipudrv::CtxRefMap::hand_back_job(JOB_ID id, uint32_t state, const MainContext *skip,
+    aipu_job_callback_func_t *cb)
+{
+    JobBase* job = nullptr;
+    bool found = false;
+
+    pthread_mutex_lock(&lock);
+    for (auto &iter : data)
+    {
+        if (iter.second == skip)
+            continue;
+
+        job = iter.second->get_job_object(id);
+        if ((job != nullptr) && (job->get_job_status() == AIPU_JOB_STATUS_SCHED))
+        {
+            *cb = iter.second->hand_back(job, state);
+            found = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+
+    return found;
+}
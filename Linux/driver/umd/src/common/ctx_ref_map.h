@@ -24,6 +24,9 @@ private:
     std::map<uint32_t, MainContext*> data;
     pthread_mutex_t lock;
 
+    /* the graphs of all contexts, it outlives the contexts deleted by the destructor */
+    GraphTable graphs;
+
 private:
     MainContext*  get_ctx_ref_inner(uint32_t handle);
 
@@ -31,6 +34,12 @@ public:
     uint32_t      create_ctx_ref();
     MainContext*  get_ctx_ref(uint32_t handle);
     aipu_status_t destroy_ctx_ref(uint32_t handle);
+    bool          hand_back_job(JOB_ID id, uint32_t state, const MainContext *skip,
+                                aipu_job_callback_func_t *cb);
+    GraphTable&   get_graph_table()
+    {
+        return graphs;
+    }
 
 public:
     static CtxRefMap& get_ctx_map()
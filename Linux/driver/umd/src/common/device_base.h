@@ -12,6 +12,10 @@
 #define _DEVICE_BASE_H_
 
 #include <atomic>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <linux/dma-buf.h>
 #include "kmd/armchina_aipu.h"
 #include "memory_base.h"
 #include "type.h"
@@ -113,6 +117,30 @@ struct JobDesc
     bool en_eval;
 };
 
+/**
+ * dma_buf known by UMD (allocated or attached via aipu_ioctl), it's mapped
+ * once when UMD starts tracking it and the mapping is kept until the dma_buf
+ * is freed or detached. va stays null if the exporter can't be mapped.
+ */
+struct DmaBufEntry
+{
+    struct aipu_dma_buf buf;
+    char *va = nullptr;
+    uint64_t ino = 0;   /**< identity of an fd UMD doesn't track, its number may be reused */
+};
+
+/**
+ * bracket CPU access to a dma_buf so that the exporter keeps caches coherent
+ */
+inline int dma_buf_sync(int fd, bool start, bool write)
+{
+    struct dma_buf_sync sync = {0};
+
+    sync.flags = (start ? DMA_BUF_SYNC_START : DMA_BUF_SYNC_END) |
+        (write ? DMA_BUF_SYNC_WRITE : DMA_BUF_SYNC_READ);
+    return ioctl(fd, DMA_BUF_IOCTL_SYNC, &sync);
+}
+
 enum DeviceType
 {
     DEV_TYPE_NONE             = 0,
@@ -132,7 +160,7 @@ protected:
     uint32_t m_cluster_cnt = 0;
     uint32_t m_core_cnt = 1;
     std::atomic_int m_ref_cnt{0};
-    std::map<int, struct aipu_dma_buf> m_dma_buf_map;
+    std::map<int, DmaBufEntry> m_dma_buf_map;
 
 public:
     virtual bool has_target(uint32_t arch, uint32_t version, uint32_t config, uint32_t rev) = 0;
@@ -140,6 +168,33 @@ public:
     {
         return AIPU_LL_STATUS_SUCCESS;
     };
+    /**
+     * @brief copy data from/to a dma_buf; this default one maps the
+     *        accessed range for each call.
+     */
+    virtual aipu_ll_status_t readwrite_dma_buf(int fd, uint64_t offset, void *data,
+        uint64_t size, bool write)
+    {
+        char *va = (char *)mmap(NULL, offset + size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+        if (va == MAP_FAILED)
+            return AIPU_LL_STATUS_ERROR_IOCTL_FAIL;
+
+        dma_buf_sync(fd, true, write);
+        if (write)
+            memcpy(va + offset, data, size);
+        else
+            memcpy(data, va + offset, size);
+        dma_buf_sync(fd, false, write);
+
+        munmap(va, offset + size);
+        return AIPU_LL_STATUS_SUCCESS;
+    }
+    /**
+     * @brief drop the mapping kept for a dma_buf which UMD doesn't track,
+     *        the job specifying it as IO buffer goes away.
+     */
+    virtual void release_dma_buf(int fd) {}
     virtual aipu_status_t get_cluster_id(uint32_t part_id, std::vector<uint32_t> &)
     {
         return AIPU_STATUS_ERROR_INVALID_PARTITION_ID;
@@ -152,6 +207,20 @@ public:
             return 0;
     }
     virtual aipu_status_t schedule(const JobDesc& job) = 0;
+    /* schedule jobs in order, scheduled_cnt is the count of the leading jobs scheduled */
+    virtual aipu_status_t schedule_batch(const std::vector<JobDesc*>& jobs,
+        uint32_t *scheduled_cnt)
+    {
+        aipu_status_t ret = AIPU_STATUS_SUCCESS;
+
+        for (*scheduled_cnt = 0; *scheduled_cnt < jobs.size(); (*scheduled_cnt)++)
+        {
+            ret = schedule(*jobs[*scheduled_cnt]);
+            if (ret != AIPU_STATUS_SUCCESS)
+                break;
+        }
+        return ret;
+    }
     virtual aipu_status_t get_simulation_instance(void** simulator, void** memory)
     {
         *simulator = nullptr;
@@ -182,6 +251,17 @@ public:
     {
         return AIPU_LL_STATUS_SUCCESS;
     }
+    /* non-blocking, fetch the ended jobs scheduled by any thread of this process */
+    virtual aipu_ll_status_t drain_status(std::vector<aipu_job_status_desc>& jobs_status,
+        uint32_t max_cnt)
+    {
+        return AIPU_LL_STATUS_ERROR_OPERATION_UNSUPPORTED;
+    }
+    /* fd readable when scheduled jobs end, -1 if the device has none */
+    virtual int get_poll_fd()
+    {
+        return -1;
+    }
     int dec_ref_cnt()
     {
         return --m_ref_cnt;
@@ -35,6 +35,7 @@ typedef enum {
 } aipu_ioctl_tickcounter_t;
 
 typedef enum {
+    D_AUTO   = 0x0,  /* follow data_type of the tensor descriptor */
     D_INT8   = 0x08,
     D_UINT8  = 0x108,
     D_INT16  = 0x10,
@@ -285,6 +286,7 @@ class NPU
      * @param[in]  load_cfg  Configuration in loading graph stage
      *             {
      *                 "wt_mem_region" : preferred weight allocation region (AIPU_MEM_REGION_SRAM)
+     *                 "wt_upload_threads" : threads for weight uploading
      *             }
      * @param[in]  wt_idxes  Weight buffer index indicating which buffer is allocated from
      *                       specified memory region
@@ -322,6 +324,9 @@ class NPU
             if (load_cfg.count("wt_mem_region") > 0)
                 load_grach_cfg.wt_mem_region = load_cfg["wt_mem_region"];
 
+            if (load_cfg.count("wt_upload_threads") > 0)
+                load_grach_cfg.wt_upload_threads = load_cfg["wt_upload_threads"];
+
             if (wt_idxes.size() > 0)
             {
                 load_grach_cfg.wt_idxes_cnt = wt_idxes.size();
@@ -359,6 +364,7 @@ class NPU
      * @param[in]  load_cfg  Configuration in loading graph stage
      *             {
      *                 "wt_mem_region" : preferred weight allocation region (AIPU_MEM_REGION_SRAM)
+     *                 "wt_upload_threads" : threads for weight uploading
      *             }
      * @param[in]  wt_idxes  Weight buffer index indicating which buffer is allocated from
      *                       specified memory region
@@ -384,7 +390,7 @@ class NPU
      * @retval AIPU_STATUS_ERROR_INVALID_GM
      */
     std::map<std::string, uint64_t> aipu_load_graph_helper_py(const char *graph_buffer,
-        uint32_t graph_size, std::map<std::string, int> load_cfg, std::vector<int> wt_idxes)
+        uint64_t graph_size, std::map<std::string, int> load_cfg, std::vector<int> wt_idxes)
     {
         aipu_status_t ret = AIPU_STATUS_SUCCESS;
         const char *status_msg = nullptr;
@@ -398,6 +404,9 @@ class NPU
             if (load_cfg.count("wt_mem_region") > 0)
                 load_grach_cfg.wt_mem_region = load_cfg["wt_mem_region"];
 
+            if (load_cfg.count("wt_upload_threads") > 0)
+                load_grach_cfg.wt_upload_threads = load_cfg["wt_upload_threads"];
+
             if (wt_idxes.size() > 0)
             {
                 load_grach_cfg.wt_idxes_cnt = wt_idxes.size();
@@ -408,7 +417,7 @@ class NPU
             }
         }
 
-        ret = aipu_load_graph_helper(m_ctx, graph_buffer, graph_size, &graph_id, &load_grach_cfg);
+        ret = aipu_load_graph_helper_64(m_ctx, graph_buffer, graph_size, &graph_id, &load_grach_cfg);
         if (ret != AIPU_STATUS_SUCCESS)
         {
             aipu_get_error_message(m_ctx, ret, &status_msg);
@@ -739,6 +748,32 @@ class NPU
         return ret;
     }
 
+    /**
+     * @brief This API is used to flush a batch of computation jobs onto AIPU (non-blocking)
+     *
+     * @param[in] job_ids     Job IDs returned by aipu_create_job
+     *
+     * @retval AIPU_STATUS_SUCCESS
+     * @retval AIPU_STATUS_ERROR_NULL_PTR
+     * @retval AIPU_STATUS_ERROR_INVALID_CTX
+     * @retval AIPU_STATUS_ERROR_INVALID_SIZE
+     * @retval AIPU_STATUS_ERROR_INVALID_JOB_ID
+     * @retval AIPU_STATUS_ERROR_INVALID_OP
+     *
+     */
+    aipu_status_t aipu_flush_jobs_py(std::vector<uint64_t> job_ids, aipu_job_callback_func_t py_cb)
+    {
+        aipu_status_t ret = AIPU_STATUS_SUCCESS;
+        const char *status_msg = nullptr;
+        ret = aipu_flush_jobs(m_ctx, job_ids.data(), job_ids.size(), py_cb);
+        if (ret != AIPU_STATUS_SUCCESS)
+        {
+            aipu_get_error_message(m_ctx, ret, &status_msg);
+            fprintf(stderr, "[PY UMD ERROR] aipu_flush_jobs: %s\n", status_msg);
+        }
+        return ret;
+    }
+
     /**
      * @brief This API is used to get the execution status of a flushed job (non-blocking)
      *
@@ -783,6 +818,54 @@ class NPU
         return retmap;
     }
 
+    /**
+     * @brief This API is used to get a pollable fd which turns readable when flushed jobs end
+     *
+     * @retval {"ret": status, "data": fd}, the fd should be closed by the caller
+     */
+    std::map<std::string, int> aipu_get_completion_fd_py()
+    {
+        aipu_status_t ret = AIPU_STATUS_SUCCESS;
+        std::map<std::string, int> retmap;
+        const char *status_msg = nullptr;
+        int fd = -1;
+
+        ret = aipu_get_completion_fd(m_ctx, &fd);
+        if (ret != AIPU_STATUS_SUCCESS)
+        {
+            aipu_get_error_message(m_ctx, ret, &status_msg);
+            fprintf(stderr, "[PY UMD ERROR] aipu_get_completion_fd: %s\n", status_msg);
+        }
+
+        retmap["ret"] = ret;
+        retmap["data"] = fd;
+        return retmap;
+    }
+
+    /**
+     * @brief This API is used to deliver the ended jobs after the completion fd is readable
+     *
+     * @retval {"ret": status, "data": count of delivered jobs}
+     */
+    std::map<std::string, int> aipu_process_completions_py()
+    {
+        aipu_status_t ret = AIPU_STATUS_SUCCESS;
+        std::map<std::string, int> retmap;
+        const char *status_msg = nullptr;
+        uint32_t cnt = 0;
+
+        ret = aipu_process_completions(m_ctx, &cnt);
+        if (ret != AIPU_STATUS_SUCCESS)
+        {
+            aipu_get_error_message(m_ctx, ret, &status_msg);
+            fprintf(stderr, "[PY UMD ERROR] aipu_process_completions: %s\n", status_msg);
+        }
+
+        retmap["ret"] = ret;
+        retmap["data"] = (int)cnt;
+        return retmap;
+    }
+
     /**
      * @brief This API is used to clean a finished job object
      *        scheduled by aipu_finish_job/aipu_flush_job
@@ -992,36 +1075,35 @@ class NPU
     }
 
     /**
-     * @brief This API is used to load input tensor data from numpy array
+     * @brief This API is used to load input tensor data from any C-contiguous
+     *        buffer object (numpy array, bytearray, memoryview...) without
+     *        converting its elements
      *
      * @param[in] job    Job ID returned by aipu_create_job
      * @param[in] tensor Input tensor ID
-     * @param[in] numpy_array   Numpy array
+     * @param[in] buffer Buffer object holding at least tensor size bytes
      *
      * @retval AIPU_STATUS_SUCCESS
      * @retval AIPU_STATUS_ERROR_NULL_PTR
      * @retval AIPU_STATUS_ERROR_INVALID_CTX
      * @retval AIPU_STATUS_ERROR_INVALID_JOB_ID
      * @retval AIPU_STATUS_ERROR_INVALID_TENSOR_ID
+     * @retval AIPU_STATUS_ERROR_INVALID_SIZE
      * @retval AIPU_STATUS_ERROR_INVALID_OP
      */
-    aipu_status_t aipu_load_tensor_numpyarray_py(uint64_t job_id, uint32_t tensor,
-        py::array_t<int> numpy_array, data_type_t data_size)
+    aipu_status_t aipu_load_tensor_buffer_py(uint64_t job_id, uint32_t tensor, py::buffer buffer)
     {
         aipu_status_t ret = AIPU_STATUS_SUCCESS;
         aipu_tensor_desc_t desc;
         const char *status_msg = nullptr;
-        uint8_t * in_data = nullptr;
+        py::buffer_info info = buffer.request();
 
-        constexpr int C_CONTIGUOUS = py::detail::npy_api::constants::NPY_ARRAY_C_CONTIGUOUS_;
-        if (C_CONTIGUOUS != (numpy_array.flags() & C_CONTIGUOUS))
+        if (!is_c_contiguous(info))
         {
-            auto np = py::module::import("numpy");
-            auto result = np.attr("ascontiguousarray")(numpy_array);
-            numpy_array = pybind11::array::ensure(result);
+            buffer = py::module::import("numpy").attr("ascontiguousarray")(buffer);
+            info = buffer.request();
         }
 
-        const int *data = numpy_array.data();
         ret = aipu_get_tensor_descriptor(m_ctx, job_id, AIPU_TENSOR_TYPE_INPUT, tensor, &desc);
         if (ret != AIPU_STATUS_SUCCESS)
         {
@@ -1030,47 +1112,60 @@ class NPU
             goto finish;
         }
 
-        if (data_size == D_INT32 || data_size == D_UINT32)
-        {
-            in_data = (uint8_t *)data;
-        }
-        else if (data_size == D_INT16  ||
-                 data_size == D_INT8   ||
-                 data_size == D_UINT16 ||
-                 data_size == D_UINT8)
-        {
-            int for_loop = desc.size / ((data_size & 0xFF) / D_INT8);
-            in_data = new uint8_t[desc.size];
-            for (int i = 0; i < for_loop; i++)
-            {
-                if (data_size == D_INT8 || data_size == D_UINT8)
-                    *(in_data + i) = *((uint8_t *)data + 4*i);
-
-                if (data_size == D_INT16 || data_size == D_UINT16)
-                    *((uint16_t *)in_data + i) = *((uint16_t *)data + 2*i);
-            }
-        }
-        else
+        if ((uint64_t)info.size * info.itemsize < desc.size)
         {
-            fprintf(stderr, "[PY UMD ERROR] aipu_load_tensor: data type error.\n");
+            fprintf(stderr, "[PY UMD ERROR] aipu_load_tensor: buffer (%ld bytes) < tensor (%u bytes)\n",
+                (long)(info.size * info.itemsize), desc.size);
+            ret = AIPU_STATUS_ERROR_INVALID_SIZE;
             goto finish;
         }
 
-        ret = aipu_load_tensor(m_ctx, job_id, tensor, in_data);
+        ret = aipu_load_tensor(m_ctx, job_id, tensor, info.ptr);
         if (ret != AIPU_STATUS_SUCCESS)
         {
             aipu_get_error_message(m_ctx, ret, &status_msg);
             fprintf(stderr, "[PY UMD ERROR] aipu_load_tensor: %s\n", status_msg);
         }
 
-        if (in_data && ((data_size & 0xFF) != D_INT32))
+    finish:
+        return ret;
+    }
+
+    /**
+     * @brief This API is used to load input tensor data from numpy array
+     *
+     * @param[in] job    Job ID returned by aipu_create_job
+     * @param[in] tensor Input tensor ID
+     * @param[in] numpy_array   Numpy array
+     * @param[in] data_size     Element type of the tensor, the array is cast to it if needed
+     *
+     * @retval AIPU_STATUS_SUCCESS
+     * @retval AIPU_STATUS_ERROR_NULL_PTR
+     * @retval AIPU_STATUS_ERROR_INVALID_CTX
+     * @retval AIPU_STATUS_ERROR_INVALID_JOB_ID
+     * @retval AIPU_STATUS_ERROR_INVALID_TENSOR_ID
+     * @retval AIPU_STATUS_ERROR_INVALID_SIZE
+     * @retval AIPU_STATUS_ERROR_INVALID_OP
+     */
+    aipu_status_t aipu_load_tensor_numpyarray_py(uint64_t job_id, uint32_t tensor,
+        py::array numpy_array, data_type_t data_size)
+    {
+        py::dtype dtype = numpy_array.dtype();
+
+        if (data_size == D_AUTO)
+            return aipu_load_tensor_buffer_py(job_id, tensor, numpy_array);
+
+        if (!data_size_to_dtype(data_size, dtype))
         {
-            delete[] in_data;
-            in_data = nullptr;
+            fprintf(stderr, "[PY UMD ERROR] aipu_load_tensor: data type error.\n");
+            return AIPU_STATUS_ERROR_INVALID_OP;
         }
 
-    finish:
-        return ret;
+        /* one vectorized cast, also makes the array C-contiguous */
+        if (!numpy_array.dtype().is(dtype))
+            numpy_array = numpy_array.attr("astype")(dtype, "C");
+
+        return aipu_load_tensor_buffer_py(job_id, tensor, numpy_array);
     }
 
     /**
@@ -1079,11 +1174,13 @@ class NPU
      * @param[in]  job    Job ID returned by aipu_create_job
      * @param[in]  type   Tensor type
      * @param[in]  tensor Input tensor ID
+     * @param[in]  data_size Element type of returned array, D_AUTO follows
+     *                       data_type of the tensor descriptor
      *
-     * @retval     return value map
+     * @retval     return value dict
      *             {
      *                 "ret": [retval]
-     *                 "data": [out data]
+     *                 "data": numpy array filled by one copy of tensor data
      *             }
      *
      * @retval AIPU_STATUS_SUCCESS
@@ -1093,87 +1190,59 @@ class NPU
      * @retval AIPU_STATUS_ERROR_INVALID_TENSOR_ID
      * @retval AIPU_STATUS_ERROR_INVALID_OP
      */
-    std::map<std::string, std::vector<int64_t> > aipu_get_tensor_py(uint64_t job_id,
+    py::dict aipu_get_tensor_py(uint64_t job_id,
         aipu_tensor_type_t type, uint32_t tensor, data_type_t data_size)
     {
         aipu_status_t ret = AIPU_STATUS_SUCCESS;
         const char *status_msg = nullptr;
-        std::map<std::string, std::vector<int64_t> > retmap;
-        unsigned char *out_data = nullptr;
+        py::dict retmap;
+        py::dtype dtype = py::dtype::of<uint8_t>();
+        py::array out_data;
+        uint32_t itemsize = 1;
         aipu_tensor_desc_t desc;
 
+        retmap["data"] = py::list();
         ret = aipu_get_tensor_descriptor(m_ctx, job_id, type, tensor, &desc);
         if (ret != AIPU_STATUS_SUCCESS)
         {
             aipu_get_error_message(m_ctx, ret, &status_msg);
             fprintf(stderr, "[PY UMD ERROR] aipu_get_tensor_descriptor: %s\n", status_msg);
-            retmap["ret"] = {ret};
-            retmap["data"] = {};
+            retmap["ret"] = std::vector<int64_t>{ret};
             goto finish;
         }
 
-        out_data = new unsigned char[desc.size];
-        ret = aipu_get_tensor(m_ctx, job_id, type, tensor, out_data);
-        if (ret != AIPU_STATUS_SUCCESS)
+        if (data_size == D_AUTO)
+            dtype = data_type_to_dtype(desc.data_type);
+        else if (!data_size_to_dtype(data_size, dtype))
         {
-            aipu_get_error_message(m_ctx, ret, &status_msg);
-            fprintf(stderr, "[PY UMD ERROR] aipu_get_tensor: %s\n", status_msg);
-            retmap["ret"] = {ret};
-            retmap["data"] = {};
+            fprintf(stderr, "[PY UMD ERROR] aipu_get_tensor: invalid data type.\n");
+            retmap["ret"] = std::vector<int64_t>{-66666};
             goto finish;
         }
 
-        retmap["ret"] = {ret};
-
-        if (data_size == D_UINT8)
-        {
-            for (uint32_t i = 0; i < desc.size; i++)
-                retmap["data"].push_back((int64_t)out_data[i]);
-        }
-        else if (data_size == D_INT8)
-        {
-            int8_t *p = (int8_t *)out_data;
-            for (uint32_t i = 0; i < desc.size; i++)
-                retmap["data"].push_back((int64_t)p[i]);
-        }
-        else if (data_size == D_INT16)
-        {
-            int16_t *p = (int16_t *)out_data;
-            for (uint32_t i = 0; i < (desc.size/2); i++)
-                retmap["data"].push_back((int64_t)p[i]);
-        }
-        else if (data_size == D_UINT16)
-        {
-            uint16_t *p = (uint16_t *)out_data;
-            for (uint32_t i = 0; i < (desc.size/2); i++)
-                retmap["data"].push_back((int64_t)p[i]);
-        }
-        else if (data_size == D_INT32)
-        {
-            int32_t *p = (int32_t *)out_data;
-            for (uint32_t i = 0; i < (desc.size/4); i++)
-                retmap["data"].push_back((int64_t)p[i]);
-        }
-        else if (data_size == D_UINT32)
-        {
-            uint32_t *p = (uint32_t *)out_data;
-            for (uint32_t i = 0; i < (desc.size/4); i++)
-                retmap["data"].push_back((int64_t)p[i]);
-        }
-        else
+        /* numpy 2 moved the descr fields, query itemsize through python */
+        itemsize = dtype.attr("itemsize").cast<uint32_t>();
+        out_data = py::array(dtype, std::vector<py::ssize_t>{(py::ssize_t)(desc.size / itemsize)});
+        if ((desc.size % itemsize) != 0)
         {
-            fprintf(stderr, "[PY UMD ERROR] aipu_get_tensor: invalid data type.\n");
-            retmap["data"] = {};
-            retmap["ret"] = {-66666};
+            /* the tail isn't a whole element, fetch raw bytes to keep all data */
+            dtype = py::dtype::of<uint8_t>();
+            out_data = py::array(dtype, std::vector<py::ssize_t>{(py::ssize_t)desc.size});
         }
 
-    finish:
-        if (out_data)
+        ret = aipu_get_tensor(m_ctx, job_id, type, tensor, out_data.mutable_data());
+        if (ret != AIPU_STATUS_SUCCESS)
         {
-            delete[] out_data;
-            out_data = nullptr;
+            aipu_get_error_message(m_ctx, ret, &status_msg);
+            fprintf(stderr, "[PY UMD ERROR] aipu_get_tensor: %s\n", status_msg);
+            retmap["ret"] = std::vector<int64_t>{ret};
+            goto finish;
         }
 
+        retmap["ret"] = std::vector<int64_t>{ret};
+        retmap["data"] = out_data;
+
+    finish:
         return retmap;
     }
 
@@ -1212,6 +1281,9 @@ class NPU
                 cmd = AIPU_IOCTL_DISABLE_TICK_COUNTER;
                 break;
 
+            case AIPU_IOCTL_START_COMPLETION_REACTOR:
+                break;
+
             case AIPU_IOCTL_FREE_SHARE_BUF:
                 {
                 std::string str_key[] = {"pa", "va", "size"};
@@ -1435,6 +1507,59 @@ class NPU
         return ret;
     }
 
+    private:
+    static bool is_c_contiguous(const py::buffer_info &info)
+    {
+        py::ssize_t stride = info.itemsize;
+
+        for (py::ssize_t i = info.ndim - 1; i >= 0; i--)
+        {
+            if (info.shape[i] > 1 && info.strides[i] != stride)
+                return false;
+            stride *= info.shape[i];
+        }
+
+        return true;
+    }
+
+    static bool data_size_to_dtype(data_type_t data_size, py::dtype &dtype)
+    {
+        switch (data_size)
+        {
+            case D_INT8:   dtype = py::dtype::of<int8_t>(); break;
+            case D_UINT8:  dtype = py::dtype::of<uint8_t>(); break;
+            case D_INT16:  dtype = py::dtype::of<int16_t>(); break;
+            case D_UINT16: dtype = py::dtype::of<uint16_t>(); break;
+            case D_INT32:  dtype = py::dtype::of<int32_t>(); break;
+            case D_UINT32: dtype = py::dtype::of<uint32_t>(); break;
+            default:       return false;
+        }
+
+        return true;
+    }
+
+    static py::dtype data_type_to_dtype(aipu_data_type_t data_type)
+    {
+        switch (data_type)
+        {
+            case AIPU_DATA_TYPE_BOOL: return py::dtype::of<bool>();
+            case AIPU_DATA_TYPE_S8:   return py::dtype::of<int8_t>();
+            case AIPU_DATA_TYPE_S16:  return py::dtype::of<int16_t>();
+            case AIPU_DATA_TYPE_U16:  return py::dtype::of<uint16_t>();
+            case AIPU_DATA_TYPE_S32:  return py::dtype::of<int32_t>();
+            case AIPU_DATA_TYPE_U32:  return py::dtype::of<uint32_t>();
+            case AIPU_DATA_TYPE_S64:  return py::dtype::of<int64_t>();
+            case AIPU_DATA_TYPE_U64:  return py::dtype::of<uint64_t>();
+            case AIPU_DATA_TYPE_F16:  return py::dtype("float16");
+            case AIPU_DATA_TYPE_F32:  return py::dtype::of<float>();
+            case AIPU_DATA_TYPE_F64:  return py::dtype::of<double>();
+            /* no numpy type for bf16, keep the raw 16 bits */
+            case AIPU_DATA_TYPE_BF16: return py::dtype::of<uint16_t>();
+            /* u8 and packed/aligned sub-byte types are returned as bytes */
+            default:                  return py::dtype::of<uint8_t>();
+        }
+    }
+
     public:
     NPU() {};
     NPU(const NPU& aipu) = delete;
@@ -1677,6 +1802,12 @@ PYBIND11_MODULE(libaipudrv, m) {
         .value("AIPU_IOCTL_ATTACH_DMABUF", aipu_ioctl_cmd_t::AIPU_IOCTL_ATTACH_DMABUF)
         .value("AIPU_IOCTL_DETACH_DMABUF", aipu_ioctl_cmd_t::AIPU_IOCTL_DETACH_DMABUF)
         .value("AIPU_IOCTL_GET_VERSION", aipu_ioctl_cmd_t::AIPU_IOCTL_GET_VERSION)
+        .value("AIPU_IOCTL_GET_MEM_STATS", aipu_ioctl_cmd_t::AIPU_IOCTL_GET_MEM_STATS)
+        .value("AIPU_IOCTL_TRIM_BUF_CACHE", aipu_ioctl_cmd_t::AIPU_IOCTL_TRIM_BUF_CACHE)
+        .value("AIPU_IOCTL_GET_BATCH_STATS", aipu_ioctl_cmd_t::AIPU_IOCTL_GET_BATCH_STATS)
+        .value("AIPU_IOCTL_GET_LOAD_STATS", aipu_ioctl_cmd_t::AIPU_IOCTL_GET_LOAD_STATS)
+        .value("AIPU_IOCTL_GET_JOB_CACHE_STATS", aipu_ioctl_cmd_t::AIPU_IOCTL_GET_JOB_CACHE_STATS)
+        .value("AIPU_IOCTL_START_COMPLETION_REACTOR", aipu_ioctl_cmd_t::AIPU_IOCTL_START_COMPLETION_REACTOR)
         .export_values();
 
     py::enum_<aipu_share_case_type_t>(m, "aipu_share_case_type_t")
@@ -1692,6 +1823,7 @@ PYBIND11_MODULE(libaipudrv, m) {
         .export_values();
 
     py::enum_<data_type_t>(m, "data_type_t")
+        .value("D_AUTO", data_type_t::D_AUTO)
         .value("D_INT8", data_type_t::D_INT8)
         .value("D_INT16", data_type_t::D_INT16)
         .value("D_INT32", data_type_t::D_INT32)
@@ -1822,10 +1954,18 @@ PYBIND11_MODULE(libaipudrv, m) {
             py::arg("job_id"),
             py::arg("py_cb") = nullptr)
 
+        .def("aipu_flush_jobs", &NPU::aipu_flush_jobs_py,
+            py::arg("job_ids"),
+            py::arg("py_cb") = nullptr)
+
         .def("aipu_get_job_status", &NPU::aipu_get_job_status_py,
             py::arg("job_id"),
             py::arg("timeout") = -1)
 
+        .def("aipu_get_completion_fd", &NPU::aipu_get_completion_fd_py)
+
+        .def("aipu_process_completions", &NPU::aipu_process_completions_py)
+
         .def("aipu_clean_job", &NPU::aipu_clean_job_py,
             py::arg("job_id"))
 
@@ -1861,12 +2001,16 @@ PYBIND11_MODULE(libaipudrv, m) {
             py::arg("numpy_array"),
             py::arg("data_size"))
 
+        .def("aipu_load_tensor", &NPU::aipu_load_tensor_buffer_py,
+            py::arg("job_id"),
+            py::arg("tensor"),
+            py::arg("buffer"))
+
         .def("aipu_get_tensor", &NPU::aipu_get_tensor_py,
             py::arg("job_id"),
             py::arg("type"),
             py::arg("tensor"),
-            py::arg("data_size"),
-            py::return_value_policy::copy)
+            py::arg("data_size") = D_AUTO)
 
         .def("aipu_ioctl", &NPU::aipu_ioctl_py,
             py::arg("cmd"),
@@ -9,8 +9,17 @@
  */
 
 #include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <sstream>
+#include <thread>
+#include <system_error>
+#include <sys/mman.h>
+#include <unistd.h>
 #include "graph.h"
 #include "parser_base.h"
+#include "weight_store.h"
 #include "utils/helper.h"
 #include "utils/log.h"
 
@@ -22,16 +31,260 @@ aipudrv::Graph::Graph(void* ctx, GRAPH_ID id, DeviceBase* dev): GraphBase(ctx, i
     m_bdesc.init(nullptr, 0);
     m_bdata.init(nullptr, 0);
     m_bweight.clear();
+    m_gbin.init(nullptr, 0);
 }
 
 aipudrv::Graph::~Graph()
 {
+    if (!m_gbin_mapped)
+        delete[] m_gbin.va;
+
+    for (auto &map : m_file_maps)
+        munmap((void *)map.va, map.size);
+    m_file_maps.clear();
+}
+
+void aipudrv::Graph::adopt_gbin_map(const char* va, uint64_t size)
+{
+    m_gbin.init(va, size);
+    m_gbin_mapped = true;
+    m_file_maps.push_back(m_gbin);
+}
+
+aipu_status_t aipudrv::Graph::read_gbin_image(std::istream& gbin, uint64_t size)
+{
+    char *image = nullptr;
+
+    if (m_gbin.va != nullptr)
+        return AIPU_STATUS_SUCCESS;
+
+    image = new (std::nothrow) char[size];
+    if (image == nullptr)
+        return AIPU_STATUS_ERROR_BUF_ALLOC_FAIL;
+
+    gbin.read(image, size);
+    if ((uint64_t)gbin.gcount() != size)
+    {
+        delete[] image;
+        return AIPU_STATUS_ERROR_INVALID_GBIN;
+    }
+
+    m_gbin.init(image, size);
+    m_gbin_mapped = false;
+    return AIPU_STATUS_SUCCESS;
+}
+
+bool aipudrv::Graph::is_file_mapped(const char* va) const
+{
+    for (auto &map : m_file_maps)
+    {
+        if ((va >= map.va) && (va < map.va + map.size))
+            return true;
+    }
+
+    return false;
+}
+
+void aipudrv::Graph::queue_upload(DEV_PA_64 pa, const char* src, uint64_t size)
+{
+    struct WeightUpload upload = {pa, src, size};
+
+    if (size != 0)
+        m_uploads.push_back(upload);
+}
+
+uint32_t aipudrv::Graph::get_upload_threads(uint64_t bytes) const
+{
+    const char *upload_threads = getenv("UMD_WT_UPLOAD_THREADS");
+    uint32_t threads = m_wt_upload_threads;
+
+    if ((threads == 0) && (upload_threads != nullptr) && (atoi(upload_threads) > 0))
+        threads = atoi(upload_threads);
+
+    if (threads == 0)
+    {
+        if (bytes < WT_UPLOAD_PARALLEL_MIN)
+            return 1;
+
+        threads = std::min(std::thread::hardware_concurrency(), (uint32_t)WT_UPLOAD_THREADS_MAX);
+    }
+
+    return (threads == 0) ? 1 : threads;
+}
+
+/**
+ * @brief copy one chunk to device memory. if the source is a file mapping,
+ *        the chunk is read ahead as a whole and its pages are dropped again
+ *        after the copy, which keeps the resident part of a multi-GB graph
+ *        binary at a few chunks per thread. the pages are clean and simply
+ *        fault in from the file if touched again.
+ */
+void aipudrv::Graph::upload_chunk(const struct WeightUpload &chunk)
+{
+    uintptr_t page_mask = ~((uintptr_t)sysconf(_SC_PAGESIZE) - 1);
+    uintptr_t start = (uintptr_t)chunk.src & page_mask;
+    uintptr_t end = (uintptr_t)(chunk.src + chunk.size);
+
+    if (is_file_mapped(chunk.src))
+        madvise((void *)start, end - start, MADV_WILLNEED);
+
+    m_mem->write(chunk.pa, chunk.src, chunk.size);
+    drop_source_pages(chunk.src, chunk.size);
 }
 
-aipu_status_t aipudrv::Graph::load(std::istream& gbin, uint32_t size,bool ver_check,
+void aipudrv::Graph::drop_source_pages(const char* src, uint64_t size)
+{
+    uintptr_t page_mask = ~((uintptr_t)sysconf(_SC_PAGESIZE) - 1);
+
+    /* only pages entirely inside the range, the neighbours may still be in use */
+    uintptr_t start = ((uintptr_t)src + ~page_mask) & page_mask;
+    uintptr_t end = (uintptr_t)(src + size) & page_mask;
+
+    if ((end > start) && is_file_mapped(src))
+        madvise((void *)start, end - start, MADV_DONTNEED);
+}
+
+/**
+ * @brief identify the weight buffers of one BSS by what decides their
+ *        layout: the memory they live in, their sizes and the sections.
+ *        the data is compared on a hit, so a cold load reads it only once
+ *        to upload it. env UMD_WT_SHARE=1 enables sharing.
+ */
+std::string aipudrv::Graph::get_weight_share_key(uint32_t bss_id,
+    std::vector<struct GraphSectionDesc> &static_sections, uint32_t asid, int pad_sz)
+{
+    const char *wt_share = getenv("UMD_WT_SHARE");
+    std::vector<uint32_t> layout;
+    std::ostringstream key;
+
+    if ((wt_share == nullptr) || (atoi(wt_share) <= 0))
+        return "";
+
+    for (auto &section : static_sections)
+    {
+        layout.push_back(section.type);
+        layout.push_back(section.relative_addr);
+        layout.push_back(section.offset_in_file);
+        layout.push_back(section.size);
+    }
+
+    key << std::hex << (void *)m_mem << ":" << asid << ":" << pad_sz << ":"
+        << get_const_size(bss_id) << ":" << get_zerocpy_const_size(bss_id) << ":"
+        << WeightStore::hash((const char *)layout.data(), layout.size() * sizeof(uint32_t), 0);
+
+    /* extra weight files carry a content hash in their name, it narrows the candidates */
+    if ((bss_id > 0) && (bss_id - 1 < m_extra_weight_info_vec.size()))
+        key << ":" << m_extra_weight_info_vec[bss_id - 1].extraWeight_hash;
+
+    return key.str();
+}
+
+/**
+ * @brief tell if shared weight buffers hold the weights of this graph's BSS
+ */
+bool aipudrv::Graph::match_weights(uint32_t bss_id, std::vector<struct GraphSectionDesc> &static_sections,
+    const BufferDesc *weight, const BufferDesc *zerocpy_const)
+{
+    std::vector<char> chunk;
+
+    for (auto &section : static_sections)
+    {
+        const BufferDesc *buf = (section.type == SECTION_TYPE_ZEROCPY_CONSTANT) ? zerocpy_const : weight;
+
+        if (buf == nullptr)
+            return false;
+
+        for (uint64_t off = 0; off < section.size; off += GBIN_STREAM_CHUNK_SIZE)
+        {
+            const char *src = m_bweight[bss_id].va + section.offset_in_file + off;
+            uint64_t len = std::min(GBIN_STREAM_CHUNK_SIZE, section.size - off);
+
+            chunk.resize(len);
+            if ((m_mem->read(buf->pa + section.relative_addr + off, chunk.data(), len) != (int64_t)len) ||
+                (memcmp(chunk.data(), src, len) != 0))
+                return false;
+
+            drop_source_pages(src, len);
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief hand the weight buffers uploaded by this graph to the WeightStore,
+ *        so that graphs loaded later with the same weights reuse them.
+ */
+void aipudrv::Graph::publish_weights()
+{
+    for (auto &info : m_weight_buffers_vec)
+    {
+        if (info.wb_share_key.empty() || info.wb_shared || (info.wb_weight == nullptr))
+            continue;
+
+        WeightStore::get_weight_store().publish(info.wb_share_key,
+            m_mem, info.wb_weight, info.wb_zerocpy_const);
+        info.wb_shared = true;
+    }
+}
+
+/**
+ * @brief run the copies queued while allocating. they are split into
+ *        GBIN_STREAM_CHUNK_SIZE chunks which a pool of threads takes in
+ *        order, so one large weight section or several BSSs are spread
+ *        evenly over the threads.
+ */
+void aipudrv::Graph::upload_weights()
+{
+    std::vector<struct WeightUpload> chunks;
+    std::vector<std::thread> pool;
+    std::atomic<size_t> next(0);
+    uint64_t bytes = 0, start = umd_monotonic_ns_helper();
+    uint32_t threads = 0;
+
+    for (auto &upload : m_uploads)
+    {
+        for (uint64_t off = 0; off < upload.size; off += GBIN_STREAM_CHUNK_SIZE)
+        {
+            struct WeightUpload chunk = {upload.pa + off, upload.src + off,
+                std::min(GBIN_STREAM_CHUNK_SIZE, upload.size - off)};
+            chunks.push_back(chunk);
+        }
+        bytes += upload.size;
+    }
+
+    threads = get_upload_threads(bytes);
+    if (threads > chunks.size())
+        threads = (chunks.size() > 0) ? chunks.size() : 1;
+
+    auto worker = [&]() {
+        for (size_t i = next++; i < chunks.size(); i = next++)
+            upload_chunk(chunks[i]);
+    };
+
+    for (uint32_t i = 1; i < threads; i++)
+    {
+        try {
+            pool.emplace_back(worker);
+        } catch (const std::system_error &e) {
+            LOG(LOG_WARN, "weight upload thread %u: %s\n", i, e.what());
+            break;
+        }
+    }
+    worker();
+    for (auto &thread : pool)
+        thread.join();
+
+    m_load_stats.upload_threads = pool.size() + 1;
+    m_load_stats.upload_bytes = bytes;
+    m_load_stats.upload_ns = umd_monotonic_ns_helper() - start;
+}
+
+aipu_status_t aipudrv::Graph::load(std::istream& gbin, uint64_t size, bool ver_check,
     aipu_load_graph_cfg_t *config)
 {
     aipu_status_t ret = AIPU_STATUS_SUCCESS;
+    uint64_t phase_start = umd_monotonic_ns_helper(), phase_end = 0;
 
     /**
     * decide weight allocation strategy
@@ -39,6 +292,7 @@ aipu_status_t aipudrv::Graph::load(std::istream& gbin, uint32_t size,bool ver_ch
     if (config != nullptr)
     {
         m_wt_mem_region = config->wt_mem_region;
+        m_wt_upload_threads = config->wt_upload_threads;
         if (config->wt_idxes)
         {
             for (int i = 0; i < config->wt_idxes_cnt; i++)
@@ -61,11 +315,18 @@ aipu_status_t aipudrv::Graph::load(std::istream& gbin, uint32_t size,bool ver_ch
     if (ret != AIPU_STATUS_SUCCESS)
         goto finish;
 
-    m_mem->dump_tracking_log_start();
+    phase_end = umd_monotonic_ns_helper();
+    m_load_stats.parse_ns = phase_end - phase_start;
+    phase_start = phase_end;
+
     m_do_vcheck = ver_check;
     if (ver_check && !m_dev->has_target(m_arch, m_hw_version, m_hw_config, m_hw_revision))
         return AIPU_STATUS_ERROR_TARGET_NOT_FOUND;
 
+    phase_end = umd_monotonic_ns_helper();
+    m_load_stats.verify_ns = phase_end - phase_start;
+    phase_start = phase_end;
+
     /* alloc and load text buffer */
     if (m_btext.size != 0)
     {
@@ -76,7 +337,7 @@ aipu_status_t aipudrv::Graph::load(std::istream& gbin, uint32_t size,bool ver_ch
         ret = m_mem->malloc(m_btext.size + 16, 0, &m_text, "text");
         if (ret != AIPU_STATUS_SUCCESS)
             goto finish;
-        m_mem->write(m_text->pa, m_btext.va, m_btext.size);
+        queue_upload(m_text->pa, m_btext.va, m_btext.size);
     }
 
     if (m_bcrodata.size != 0)
@@ -84,7 +345,7 @@ aipu_status_t aipudrv::Graph::load(std::istream& gbin, uint32_t size,bool ver_ch
         ret = m_mem->malloc(m_bcrodata.size, 0, &m_crodata, "crodata");
         if (ret != AIPU_STATUS_SUCCESS)
             goto finish;
-        m_mem->write(m_crodata->pa, m_bcrodata.va, m_bcrodata.size);
+        queue_upload(m_crodata->pa, m_bcrodata.va, m_bcrodata.size);
     }
 
     if (m_bweight.size() > 0)
@@ -102,7 +363,18 @@ aipu_status_t aipudrv::Graph::load(std::istream& gbin, uint32_t size,bool ver_ch
     //     m_mem->write(m_weight.pa, m_bweight.va, m_bweight.size);
     // }
 
+    m_load_stats.alloc_ns = umd_monotonic_ns_helper() - phase_start;
+    upload_weights();
+    publish_weights();
+
+    LOG(LOG_INFO, "graph 0x%lx load: parse %lu us, verify %lu us, alloc %lu us, "
+        "upload %lu us (%lu bytes, %u threads), shared %lu bytes", m_id,
+        m_load_stats.parse_ns / 1000, m_load_stats.verify_ns / 1000,
+        m_load_stats.alloc_ns / 1000, m_load_stats.upload_ns / 1000,
+        m_load_stats.upload_bytes, m_load_stats.upload_threads, m_load_stats.shared_bytes);
+
 finish:
+    m_uploads.clear();
     return ret;
 }
 
@@ -258,6 +530,22 @@ aipu_status_t aipudrv::Graph::alloc_weight_buffer(std::vector<struct GraphSectio
                     || m_hw_version == AIPU_ISA_VERSION_ZHOUYI_V3_1)
                     asid = 1;
 
+                /* reuse the buffers of a graph loaded before with the same weights */
+                weightBufferInfo.wb_share_key = get_weight_share_key(bss_id, static_sections, asid, pad_sz);
+                if (!weightBufferInfo.wb_share_key.empty())
+                    weightBufferInfo.wb_shared = WeightStore::get_weight_store().get(
+                        weightBufferInfo.wb_share_key,
+                        [&](const BufferDesc *weight, const BufferDesc *zerocpy_const) {
+                            return match_weights(bss_id, static_sections, weight, zerocpy_const);
+                        }, &weightBufferInfo.wb_weight, &weightBufferInfo.wb_zerocpy_const);
+            }
+
+            if (weightBufferInfo.wb_shared)
+            {
+                m_load_stats.shared_bytes += weightBufferInfo.wb_weight->size;
+                if (weightBufferInfo.wb_zerocpy_const != nullptr)
+                    m_load_stats.shared_bytes += weightBufferInfo.wb_zerocpy_const->size;
+            } else if (m_bweight.size() > 0 && m_bweight[bss_id].size != 0) {
                 /**
                 * allocate weight from ASID1 region defalut.if all ASIDs are configured
                 * with the same base addr, it's also equal to allocate from ASID0.
@@ -290,16 +578,18 @@ aipu_status_t aipudrv::Graph::alloc_weight_buffer(std::vector<struct GraphSectio
 
                 if (static_section->type == SECTION_TYPE_ZEROCPY_CONSTANT)
                 {
-                    m_mem->write(weightBufferInfo.wb_zerocpy_const->pa + static_section->relative_addr,
-                        m_bweight[bss_id].va + static_section->offset_in_file, static_section->size);
+                    if (!weightBufferInfo.wb_shared)
+                        queue_upload(weightBufferInfo.wb_zerocpy_const->pa + static_section->relative_addr,
+                            m_bweight[bss_id].va + static_section->offset_in_file, static_section->size);
                     buf->init(weightBufferInfo.wb_zerocpy_const->asid_base,
                         weightBufferInfo.wb_zerocpy_const->pa + static_section->relative_addr,
                         static_section->size, static_section->size);
                     LOG(LOG_INFO, "zerocpy %d, pa=%lx, a_b=%lx, asid_pa=%lx, relative_addr=%x\n", i,
                         buf->pa, buf->asid_base, buf->align_asid_pa, static_section->relative_addr);
                 } else {
-                    m_mem->write(weightBufferInfo.wb_weight->pa + static_section->relative_addr,
-                        m_bweight[bss_id].va + static_section->offset_in_file, static_section->size);
+                    if (!weightBufferInfo.wb_shared)
+                        queue_upload(weightBufferInfo.wb_weight->pa + static_section->relative_addr,
+                            m_bweight[bss_id].va + static_section->offset_in_file, static_section->size);
                     buf->init(weightBufferInfo.wb_weight->asid_base,
                         weightBufferInfo.wb_weight->pa + static_section->relative_addr,
                         static_section->size, static_section->size, 0, asid << 8);
@@ -348,7 +638,7 @@ aipu_status_t aipudrv::Graph::alloc_weight_buffer(std::vector<struct GraphSectio
                             goto finish;
                         }
 
-                        m_mem->write(buf->pa, (char *)static_section->load_src, static_section->size);
+                        queue_upload(buf->pa, (char *)static_section->load_src, static_section->size);
                         weightBufferInfo.wb_weights.push_back(buf);
                         if (bss_id != 0)
                             m_weight_buffers_vec[0].wb_weights.push_back(buf);
@@ -386,13 +676,25 @@ aipu_status_t aipudrv::Graph::unload()
         for (uint32_t bss_id = 0; bss_id < get_bss_cnt(); bss_id++)
         {
             struct WeightBufferInfo &weightBufferInfo = m_weight_buffers_vec[bss_id];
+            bool shared = weightBufferInfo.wb_shared;
+
+            /* shared buffers are freed by the store once the last graph releases them */
+            if (shared)
+            {
+                WeightStore::get_weight_store().release(weightBufferInfo.wb_share_key,
+                    weightBufferInfo.wb_weight);
+                weightBufferInfo.wb_shared = false;
+                weightBufferInfo.wb_zerocpy_const = nullptr;
+            }
 
             if (weightBufferInfo.wb_zerocpy_const != nullptr && weightBufferInfo.wb_zerocpy_const->size != 0)
                 m_mem->free(&weightBufferInfo.wb_zerocpy_const);
 
             if (weightBufferInfo.wb_weight != nullptr)
             {
-                if (weightBufferInfo.wb_weight->size != 0)
+                if (shared)
+                    weightBufferInfo.wb_weight = nullptr;
+                else if (weightBufferInfo.wb_weight->size != 0)
                     m_mem->free(&weightBufferInfo.wb_weight);
 
                 if (bss_id == 0)
@@ -415,7 +717,6 @@ aipu_status_t aipudrv::Graph::unload()
         }
     }
 
-    m_mem->dump_tracking_log_end();
     return ret;
 }
 
@@ -491,6 +792,7 @@ aipu_status_t aipudrv::Graph::set_graph_extra_weight(BinSection extra_weight)
             return ret;
         }
 
+        m_file_maps.push_back(ew_binsection);
         set_graph_weight(ew_binsection);
         m_extra_weight_info_vec.push_back(extraWeightInfo);
     }
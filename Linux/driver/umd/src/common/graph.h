@@ -15,6 +15,7 @@
 #include <vector>
 #include <deque>
 #include <mutex>
+#include <string>
 #include <pthread.h>
 #include "standard_api.h"
 #include "graph_base.h"
@@ -22,6 +23,20 @@
 
 namespace aipudrv
 {
+/**
+ * weight sections are copied from the graph image to device memory in
+ * chunks of this size, so that the already consumed source pages of a
+ * file mapping can be dropped while the copy is still in progress.
+ */
+#define GBIN_STREAM_CHUNK_SIZE ((uint64_t)4 << 20)
+
+/**
+ * without an explicit thread count, graphs uploading at least this much
+ * use up to WT_UPLOAD_THREADS_MAX threads, env UMD_WT_UPLOAD_THREADS
+ */
+#define WT_UPLOAD_PARALLEL_MIN ((uint64_t)64 << 20)
+#define WT_UPLOAD_THREADS_MAX  8
+
 enum GraphRemapLoadType
 {
     PARAM_MAP_LOAD_TYPE_REUSE,
@@ -117,6 +132,24 @@ protected:
     /* dynamic shape */
     struct BinSection m_bglobalparam;
 
+    /**
+     * graph binary image the sections above point into: either a read-only
+     * file mapping adopted from the context or a private copy of the stream
+     */
+    struct BinSection m_gbin;
+    bool m_gbin_mapped = false;
+
+    /* file mappings (graph binary, extra weights) released on destruction */
+    std::vector<struct BinSection> m_file_maps;
+
+    /* copies to device memory queued while allocating, run by upload_weights */
+    struct WeightUpload {
+        DEV_PA_64 pa;
+        const char *src;
+        uint64_t size;
+    };
+    std::vector<struct WeightUpload> m_uploads;
+
 public:
     /* entry: <min shape (N, H, W, C), max shape (N, H, W, C)> etc */
     std::map<int, std::vector<std::vector<uint32_t>>> m_input_shape_constraint;
@@ -141,6 +174,10 @@ protected:
 
         /* weight buffer ASID base address */
         DEV_PA_64 wb_asid_base = 0;
+
+        /* key in the process-wide WeightStore, wb_shared: buffers are held through it */
+        std::string wb_share_key;
+        bool wb_shared = false;
     };
 
     std::vector<struct WeightBufferInfo> m_weight_buffers_vec;
@@ -178,7 +215,7 @@ public:
 
 public:
     virtual void print_parse_info() = 0;
-    virtual aipu_status_t load(std::istream& gbin, uint32_t size, bool ver_check = true,
+    virtual aipu_status_t load(std::istream& gbin, uint64_t size, bool ver_check = true,
         aipu_load_graph_cfg_t *config = nullptr);
     virtual aipu_status_t unload();
     virtual aipu_status_t create_job(JOB_ID* id, const aipu_global_config_simulation_t* cfg,
@@ -190,6 +227,21 @@ public:
     virtual void add_zerocpy_const_section(uint32_t sg_id, struct GraphSectionDesc section) {};
     aipu_status_t alloc_weight_buffer(std::vector<struct GraphSectionDesc> &static_sections,
         aipu_load_graph_cfg_t *config = nullptr);
+    virtual void adopt_gbin_map(const char* va, uint64_t size);
+    aipu_status_t read_gbin_image(std::istream& gbin, uint64_t size);
+
+protected:
+    bool is_file_mapped(const char* va) const;
+    void queue_upload(DEV_PA_64 pa, const char* src, uint64_t size);
+    uint32_t get_upload_threads(uint64_t bytes) const;
+    void upload_chunk(const struct WeightUpload &chunk);
+    void upload_weights();
+    void drop_source_pages(const char* src, uint64_t size);
+    std::string get_weight_share_key(uint32_t bss_id,
+        std::vector<struct GraphSectionDesc> &static_sections, uint32_t asid, int pad_sz);
+    bool match_weights(uint32_t bss_id, std::vector<struct GraphSectionDesc> &static_sections,
+        const BufferDesc *weight, const BufferDesc *zerocpy_const);
+    void publish_weights();
 
 public:
     /* Set functions */
@@ -197,6 +249,10 @@ public:
     {
         m_parser = parser;
     }
+    const BinSection& get_gbin_image() const
+    {
+        return m_gbin;
+    }
     void set_graph_text(const char* data, uint64_t size)
     {
         m_btext.va = data;
@@ -9,13 +9,24 @@
  */
 #include "graph_base.h"
 #include "job_base.h"
+#include "utils/log.h"
 
 aipudrv::GraphBase::GraphBase(void* ctx, GRAPH_ID id, DeviceBase* dev):
     m_ctx(ctx),
     m_id(id),
     m_dev(dev)
 {
+    /**
+     * job pool size per graph, 0 (default): disable job reuse
+     */
+    const char *job_pool_sz = getenv("UMD_JOB_POOL_SZ");
+    const char *job_pool_budget = getenv("UMD_JOB_POOL_BUDGET");
+
     m_mem = m_dev->get_mem();
+    if (job_pool_sz != nullptr)
+        m_job_pool_max = atoi(job_pool_sz);
+    if (job_pool_budget != nullptr)
+        m_job_pool_budget = (uint64_t)strtoul(job_pool_budget, nullptr, 10) << 20;
     pthread_rwlock_init(&m_lock, NULL);
     pthread_rwlock_init(&m_batch_queue_lock, NULL);
 }
@@ -27,42 +38,154 @@ aipudrv::GraphBase::~GraphBase()
     pthread_rwlock_destroy(&m_batch_queue_lock);
 }
 
-aipudrv::JOB_ID aipudrv::GraphBase::create_job_id_inner()
+aipudrv::JOB_ID aipudrv::GraphBase::add_job(JobBase* job)
 {
-    uint64_t id_candidate = create_full_job_id(m_id, 1);
+    uint32_t key = 0;
 
-    while (m_jobs.count(id_candidate) == 1)
+    pthread_rwlock_wrlock(&m_lock);
+    key = m_jobs.reserve();
+    if (key != 0)
     {
-        id_candidate++;
+        job->set_id(create_full_job_id(m_id, key));
+        m_jobs.set(key, job);
+    } else {
+        LOG(LOG_ERR, "too many jobs of graph 0x%lx", (unsigned long)m_id);
+        job->set_id(0);
     }
-    return id_candidate;
+    pthread_rwlock_unlock(&m_lock);
+    return job->get_id();
 }
 
-aipudrv::JOB_ID aipudrv::GraphBase::add_job(JobBase* job)
+aipudrv::JobBase* aipudrv::GraphBase::get_pooled_job(const aipu_create_job_cfg_t *config)
 {
+    JobBase* job = nullptr;
+
     pthread_rwlock_wrlock(&m_lock);
-    job->set_id(create_job_id_inner());
-    m_jobs[job->get_id()] = job;
+    for (auto iter = m_job_pool.begin(); iter != m_job_pool.end(); iter++)
+    {
+        if (iter->job->match_config(config))
+        {
+            job = iter->job;
+            m_job_pool_bytes -= iter->bytes;
+            m_job_pool.erase(iter);
+            break;
+        }
+    }
+
+    if (job != nullptr)
+        m_job_pool_hits++;
+    else
+        m_job_pool_misses++;
+    pthread_rwlock_unlock(&m_lock);
+
+    return job;
+}
+
+/**
+ * @brief keep a cleaned job for reuse, evicting the least recently
+ *        cleaned ones to stay within the pool size and memory budget.
+ *        m_lock is held by the caller.
+ *
+ * @retval false the job is not pooled, the caller destroys it
+ */
+bool aipudrv::GraphBase::pool_job(JobBase* job)
+{
+    uint64_t bytes = job->get_buffer_bytes();
+
+    if ((m_job_pool_max == 0) || (bytes > m_job_pool_budget) ||
+        (job->reset() != AIPU_STATUS_SUCCESS))
+        return false;
+
+    while (!m_job_pool.empty() && ((m_job_pool.size() >= m_job_pool_max) ||
+        (m_job_pool_bytes + bytes > m_job_pool_budget)))
+    {
+        PooledJob &victim = m_job_pool.back();
+
+        if (victim.job->destroy() != AIPU_STATUS_SUCCESS)
+            return false;
+
+        delete victim.job;
+        m_job_pool_bytes -= victim.bytes;
+        m_job_pool_evictions++;
+        m_job_pool.pop_back();
+    }
+
+    m_job_pool.push_front({job, bytes});
+    m_job_pool_bytes += bytes;
+    return true;
+}
+
+/**
+ * @brief free all the cleaned jobs, so their memory serves a new job
+ *
+ * @retval false no job memory is freed
+ */
+bool aipudrv::GraphBase::drain_job_pool()
+{
+    bool drained = false;
+
+    pthread_rwlock_wrlock(&m_lock);
+    while (!m_job_pool.empty())
+    {
+        PooledJob &victim = m_job_pool.back();
+
+        if (victim.job->destroy() != AIPU_STATUS_SUCCESS)
+            break;
+
+        delete victim.job;
+        m_job_pool_bytes -= victim.bytes;
+        m_job_pool_evictions++;
+        m_job_pool.pop_back();
+        drained = true;
+    }
+    pthread_rwlock_unlock(&m_lock);
+
+    return drained;
+}
+
+void aipudrv::GraphBase::get_job_cache_stats(aipu_job_cache_stats_t *stats)
+{
+    pthread_rwlock_rdlock(&m_lock);
+    stats->hits = m_job_pool_hits;
+    stats->misses = m_job_pool_misses;
+    stats->evictions = m_job_pool_evictions;
+    stats->cached_jobs = m_job_pool.size();
+    stats->cached_bytes = m_job_pool_bytes;
     pthread_rwlock_unlock(&m_lock);
-    return job->get_id();
 }
 
 aipu_status_t aipudrv::GraphBase::destroy_jobs()
 {
     aipu_status_t ret = AIPU_STATUS_SUCCESS;
-    auto iter = m_jobs.begin();
+    CompletionReactor *reactor = nullptr;
+    JobBase *job = nullptr;
 
     pthread_rwlock_wrlock(&m_lock);
-    while(iter != m_jobs.end())
+    while (!m_job_pool.empty())
+    {
+        ret = m_job_pool.back().job->destroy();
+        if (ret != AIPU_STATUS_SUCCESS)
+            goto unlock;
+
+        delete m_job_pool.back().job;
+        m_job_pool_bytes -= m_job_pool.back().bytes;
+        m_job_pool.pop_back();
+    }
+
+    for (auto &item : m_jobs.snapshot())
     {
-        ret = iter->second->destroy();
+        job = item.second;
+        reactor = (job->get_ctx() != nullptr) ?
+            job->get_ctx()->get_completion_reactor() : nullptr;
+        if (reactor != nullptr)
+            reactor->untrack(job);
+
+        ret = job->destroy();
         if (ret != AIPU_STATUS_SUCCESS)
             goto unlock;
 
-        delete iter->second;
-        iter->second = nullptr;
-        m_jobs.erase(iter);
-        iter = m_jobs.begin();
+        m_jobs.release(item.first);
+        delete job;
     }
 
 unlock:
@@ -73,17 +196,32 @@ unlock:
 aipu_status_t aipudrv::GraphBase::destroy_job(JOB_ID id)
 {
     aipu_status_t ret = AIPU_STATUS_SUCCESS;
+    CompletionReactor *reactor = nullptr;
+    JobBase *job = nullptr;
 
     pthread_rwlock_wrlock(&m_lock);
-    if (m_jobs.count(id) != 0)
+    job = get_job(id);
+    if (job != nullptr)
     {
-        ret = m_jobs[id]->destroy();
+        /* the reactor may still track a job not waited for */
+        reactor = (job->get_ctx() != nullptr) ?
+            job->get_ctx()->get_completion_reactor() : nullptr;
+        if (reactor != nullptr)
+            reactor->untrack(job);
+
+        /* keep the job with its buffers for the next create_job if possible */
+        if (pool_job(job))
+        {
+            m_jobs.release(get_low_32(id));
+            goto unlock;
+        }
+
+        ret = job->destroy();
         if (ret != AIPU_STATUS_SUCCESS)
             goto unlock;
 
-        delete m_jobs[id];
-        m_jobs[id] = nullptr;
-        m_jobs.erase(id);
+        m_jobs.release(get_low_32(id));
+        delete job;
     }
 
 unlock:
@@ -12,12 +12,14 @@
 #define _GRAPH_BASE_H_
 
 #include <fstream>
+#include <list>
 #include <map>
 #include <set>
 #include <pthread.h>
 #include "standard_api.h"
 #include "device_base.h"
 #include "memory_base.h"
+#include "slot_table.h"
 #include "type.h"
 
 namespace aipudrv
@@ -65,6 +67,11 @@ typedef struct batch_info
     }
 } batch_info_t;
 
+/* default number of cleaned jobs kept per graph for reuse, env UMD_JOB_POOL_SZ, 0: disabled */
+#define JOB_POOL_DEFAULT_SZ 0
+/* default device memory held by a graph's cleaned jobs, env UMD_JOB_POOL_BUDGET (MB) */
+#define JOB_POOL_DEFAULT_BUDGET ((uint64_t)256 << 20)
+
 class JobBase;
 class GraphBase
 {
@@ -82,18 +89,42 @@ protected:
     uint32_t m_sram_flag = 0;
     uint32_t m_wt_mem_region = AIPU_MEM_REGION_DEFAULT;
     std::set<uint32_t> m_wt_idxes;
+    uint32_t m_wt_upload_threads = 0;
+
+    /* per-phase timings of loading this graph */
+    aipu_load_stats_t m_load_stats = {0};
 
 protected:
     DeviceBase* m_dev;
     MemoryBase* m_mem;
 
 protected:
-    std::map<JOB_ID, JobBase*> m_jobs;
+    /* low 32 bits of a job ID is its key here, resolved without m_lock */
+    SlotTable<JobBase> m_jobs;
     pthread_rwlock_t m_lock;
 
+    /**
+     * cleaned jobs which still hold their buffers and TCB chain,
+     * aipu_create_job with a matching config takes one from here.
+     * most recently cleaned first, evicted from the back.
+     */
+    struct PooledJob {
+        JobBase *job;
+        uint64_t bytes;
+    };
+    std::list<PooledJob> m_job_pool;
+    uint32_t m_job_pool_max = JOB_POOL_DEFAULT_SZ;
+    uint64_t m_job_pool_budget = JOB_POOL_DEFAULT_BUDGET;
+    uint64_t m_job_pool_bytes = 0;
+    uint64_t m_job_pool_hits = 0;
+    uint64_t m_job_pool_misses = 0;
+    uint64_t m_job_pool_evictions = 0;
+
 protected:
-    virtual JOB_ID create_job_id_inner();
     JOB_ID add_job(JobBase* job);
+    JobBase* get_pooled_job(const aipu_create_job_cfg_t *config);
+    bool pool_job(JobBase* job);
+    bool drain_job_pool();
     aipu_status_t destroy_jobs();
 
 public:
@@ -110,9 +141,10 @@ public:
 
 public:
     virtual void print_parse_info() = 0;
-    virtual aipu_status_t load(std::istream& gbin, uint32_t size, bool ver_check = true,
+    virtual aipu_status_t load(std::istream& gbin, uint64_t size, bool ver_check = true,
         aipu_load_graph_cfg_t *config = nullptr) = 0;
     virtual aipu_status_t unload() = 0;
+    virtual void adopt_gbin_map(const char* va, uint64_t size) = 0;
     virtual aipu_status_t create_job(JOB_ID* id, const aipu_global_config_simulation_t* cfg,
         aipu_global_config_hw_t* hw_cfg, aipu_create_job_cfg_t *config = nullptr) = 0;
     virtual aipu_status_t get_tensor_count(aipu_tensor_type_t type, uint32_t* cnt) = 0;
@@ -123,13 +155,16 @@ public:
     virtual int32_t get_dynamic_shape_dim_num(uint32_t idx, bool max_shape_dim) = 0;
     virtual bool get_dynamic_shape_data(uint32_t idx, bool max_shape_dim, uint32_t *data) = 0;
 
+    void* get_ctx()
+    {
+        return m_ctx;
+    }
+
     JobBase* get_job(JOB_ID id)
     {
-        JobBase* job = nullptr;
-        pthread_rwlock_rdlock(&m_lock);
-        job = (m_jobs.count(id) ? m_jobs[id]: nullptr);
-        pthread_rwlock_unlock(&m_lock);
-        return job;
+        if (job_id2graph_id(id) != m_id)
+            return nullptr;
+        return m_jobs.get(get_low_32(id));
     }
     aipu_status_t destroy_job(JOB_ID id);
 
@@ -202,6 +237,11 @@ public:
     {
         return m_aipubin_buildversion;
     }
+    const aipu_load_stats_t& get_load_stats() const
+    {
+        return m_load_stats;
+    }
+    void get_job_cache_stats(aipu_job_cache_stats_t *stats);
 
 public:
     GraphBase(void* ctx, GRAPH_ID id, DeviceBase* dev);
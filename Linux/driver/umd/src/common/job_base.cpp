@@ -10,7 +10,6 @@
 
 #include <cstring>
 #include <unistd.h>
-#include <sys/mman.h>
 #include "job_base.h"
 #include "utils/helper.h"
 
@@ -30,6 +29,18 @@ aipudrv::JobBase::JobBase(MainContext* ctx, GraphBase& graph, DeviceBase* dev):
 
 aipudrv::JobBase::~JobBase()
 {
+    for (auto &iobuf : m_inputs)
+    {
+        if (iobuf.dmabuf_fd >= 0)
+            m_dev->release_dma_buf(iobuf.dmabuf_fd);
+    }
+
+    for (auto &iobuf : m_outputs)
+    {
+        if (iobuf.dmabuf_fd >= 0)
+            m_dev->release_dma_buf(iobuf.dmabuf_fd);
+    }
+
 #if DUMP_RO_ENTRY
     m_ro_entry_dump.close();
 #endif
@@ -52,13 +63,14 @@ aipu_status_t aipudrv::JobBase::get_status(aipu_job_status_t* status)
     }
 
     if (jobs_status.size() != 0)
-        m_status = jobs_status[0].state;
+        update_job_status(jobs_status[0].state);
 
     if ((m_status == AIPU_JOB_STATUS_DONE) || (m_status == AIPU_JOB_STATUS_EXCEPTION))
     {
-        *status = (aipu_job_status_t)m_status;
+        *status = (aipu_job_status_t)get_job_status();
         dump_job_private_buffers_after_run(*m_rodata, m_descriptor);
         dump_job_shared_buffers_after_run();
+        release_run_resources();
     } else {
         *status = AIPU_JOB_STATUS_NO_STATUS;
     }
@@ -70,14 +82,21 @@ aipu_status_t aipudrv::JobBase::get_status_blocking(aipu_job_status_t* status, i
 {
     if (get_subgraph_cnt() == 0)
     {
-        m_status = AIPU_JOB_STATE_DONE;
+        update_job_status(AIPU_JOB_STATE_DONE);
         aipu_job_callback_func_t job_callback_func = get_job_cb();
 
         if (job_callback_func != nullptr)
-            job_callback_func(get_id(), (aipu_job_status_t)m_status);
+            job_callback_func(get_id(), (aipu_job_status_t)get_job_status());
     } else {
-        aipu_status_t ret = convert_ll_status(m_dev->poll_status(1, time_out,
-            m_hw_cfg->poll_in_commit_thread, this));
+        CompletionReactor *reactor = (m_ctx != nullptr) ? m_ctx->get_completion_reactor() : nullptr;
+        aipu_status_t ret = AIPU_STATUS_SUCCESS;
+
+        /* the reactor owns the device polling once started */
+        if (reactor != nullptr)
+            ret = reactor->wait_job(this, time_out);
+        else
+            ret = convert_ll_status(m_dev->poll_status(1, time_out,
+                m_hw_cfg->poll_in_commit_thread, this));
         if (ret != AIPU_STATUS_SUCCESS)
             return ret;
 
@@ -88,9 +107,10 @@ aipu_status_t aipudrv::JobBase::get_status_blocking(aipu_job_status_t* status, i
 
     if ((m_status == AIPU_JOB_STATUS_DONE) || (m_status == AIPU_JOB_STATUS_EXCEPTION))
     {
-        *status = (aipu_job_status_t)m_status;
+        *status = (aipu_job_status_t)get_job_status();
         dump_job_private_buffers_after_run(*m_rodata, m_descriptor);
         dump_job_shared_buffers_after_run();
+        release_run_resources();
         if (m_cfg->en_fast_perf)
         {
             m_dev->dump_profiling();
@@ -336,6 +356,25 @@ finish:
     return ret;
 }
 
+/**
+ * @brief the images were copied from the graph's template, which has the
+ *        weight entries in place: only write the reuse ones.
+ */
+aipu_status_t aipudrv::JobBase::setup_rodata(const RodataTemplate &tmpl,
+    const std::vector<BufferDesc*>& reuse_buf,
+    BufferDesc &rodata, BufferDesc *dcr,
+    std::set<uint32_t> *dma_buf_idx)
+{
+    char* ro_va = nullptr;
+    char* dcr_va = nullptr;
+
+    m_mem->pa_to_va(rodata.pa, rodata.size, &ro_va);
+    if (dcr != nullptr && dcr->size != 0)
+        m_mem->pa_to_va(dcr->pa, dcr->size, &dcr_va);
+
+    return tmpl.patch(ro_va, dcr_va, reuse_buf, dma_buf_idx);
+}
+
 aipudrv::DEV_PA_64 aipudrv::JobBase::get_base_pa(int sec_type, BufferDesc& rodata,
         BufferDesc* descriptor, bool align_asid)
 {
@@ -447,7 +486,7 @@ void aipudrv::JobBase::dump_single_buffer(DEV_PA_64 pa, uint32_t size, const cha
 void aipudrv::JobBase::dump_share_buffer(JobIOBuffer &iobuf, const char* name, bool keep_name)
 {
     char file_name[2048] = {0};
-    char *va = nullptr;
+    std::vector<char> data(iobuf.size);
 
     if (!keep_name)
         snprintf(file_name, 2048, "%s/Graph_0x%lx_Job_0x%lx_%s_Dump_in_DRAM_PA_0x%lx_Size_0x%x.bin",
@@ -455,36 +494,24 @@ void aipudrv::JobBase::dump_share_buffer(JobIOBuffer &iobuf, const char* name, b
     else
         snprintf(file_name, 2048, "%s", name);
 
-    va = (char *)mmap(NULL, iobuf.dmabuf_size, PROT_READ, MAP_SHARED, iobuf.dmabuf_fd, 0);
-    if (MAP_FAILED == va)
-        LOG(LOG_ERR, "%s: mmap dma_buf fail\n", __FUNCTION__);
+    if (readwrite_dma_buf(iobuf, data.data(), true) != 0)
+        return;
 
-    umd_dump_file_helper(file_name, va + iobuf.offset_in_dmabuf, iobuf.size);
-    munmap(va, iobuf.dmabuf_size);
+    umd_dump_file_helper(file_name, data.data(), iobuf.size);
 }
 
 int aipudrv::JobBase::readwrite_dma_buf(struct JobIOBuffer &iobuf, void *data, bool read)
 {
-    char *va = nullptr;
-    int ret = 0;
+    aipu_ll_status_t ret = m_dev->readwrite_dma_buf(iobuf.dmabuf_fd, iobuf.offset_in_dmabuf,
+        data, iobuf.size, !read);
 
-    va = (char *)mmap(NULL, iobuf.dmabuf_size, PROT_READ | PROT_WRITE, MAP_SHARED,
-        iobuf.dmabuf_fd, 0);
-    if (MAP_FAILED == va)
+    if (ret != AIPU_LL_STATUS_SUCCESS)
     {
-        ret = -1;
-        LOG(LOG_ERR, "%s: mmap dma_buf fail\n", __FUNCTION__);
-        goto out;
+        LOG(LOG_ERR, "%s: access dma_buf fd=%d fail\n", __FUNCTION__, iobuf.dmabuf_fd);
+        return -1;
     }
 
-    if (read)
-        memcpy(data, va + iobuf.offset_in_dmabuf, iobuf.size);
-    else
-        memcpy(va + iobuf.offset_in_dmabuf, data, iobuf.size);
-
-    munmap(va, iobuf.dmabuf_size);
-out:
-    return ret;
+    return 0;
 }
 
 aipu_status_t aipudrv::JobBase::config_mem_dump(uint64_t types, const aipu_job_config_dump_t* config)
@@ -521,6 +548,7 @@ aipu_status_t aipudrv::JobBase::config_mem_dump(uint64_t types, const aipu_job_c
     m_dump_tcb = types & AIPU_JOB_CONFIG_TYPE_DUMP_TCB_CHAIN;
     m_dump_emu = types & AIPU_JOB_CONFIG_TYPE_DUMP_EMULATION;
     m_dump_profile = types & AIPU_JOB_CONFIG_TYPE_DUMP_PROFILE;
+    m_recyclable = false;
 
 finish:
     return ret;
@@ -648,6 +676,25 @@ void aipudrv::JobBase::dump_job_shared_buffers_after_run()
     }
 }
 
+/**
+ * @brief copy the reuse sections this job gives back at its end, its reuse
+ *        dump is taken after they may run another job.
+ */
+void aipudrv::JobBase::copy_reuse_for_dump(const std::set<uint32_t> &reuse_idx)
+{
+    const std::vector<BufferDesc*> &reuses = get_reuse();
+
+    m_reuse_dump_copy.resize(reuses.size());
+    for (auto k : reuse_idx)
+    {
+        if (k >= reuses.size())
+            continue;
+
+        m_reuse_dump_copy[k].resize(reuses[k]->size);
+        m_mem->read(reuses[k]->pa, m_reuse_dump_copy[k].data(), reuses[k]->size);
+    }
+}
+
 void aipudrv::JobBase::dump_job_private_buffers_after_run(BufferDesc& rodata, BufferDesc* descriptor)
 {
     DEV_PA_64 dump_pa;
@@ -707,8 +754,17 @@ void aipudrv::JobBase::dump_job_private_buffers_after_run(BufferDesc& rodata, Bu
                 dump_pa   = m_job_reuses[i]->pa;
                 dump_size = m_job_reuses[i]->size;
                 snprintf(name, 32, "AfRun_Reuse%u", i);
-                if (dump_size != 0)
+                if ((i < m_reuse_dump_copy.size()) && !m_reuse_dump_copy[i].empty())
+                {
+                    char file_name[4096];
+
+                    snprintf(file_name, 4096, "%s/Graph_0x%lx_Job_0x%lx_%s_Dump_in_DRAM_PA_0x%lx_Size_0x%x.bin",
+                        m_dump_dir.c_str(), get_graph().m_id, m_id, name, dump_pa,
+                        (uint32_t)m_reuse_dump_copy[i].size());
+                    umd_dump_file_helper(file_name, m_reuse_dump_copy[i].data(), m_reuse_dump_copy[i].size());
+                } else if (dump_size != 0) {
                     dump_buffer(dump_pa, nullptr, dump_size, name);
+                }
             }
         }
     }
@@ -736,6 +792,46 @@ void aipudrv::JobBase::dump_job_private_buffers_after_run(BufferDesc& rodata, Bu
     }
 }
 
+/**
+ * @brief block until the status isn't 'status' any more.
+ *        time_out in ms, -1 blocks. false on timeout.
+ */
+bool aipudrv::JobBase::wait_status_change(uint32_t status, int32_t time_out)
+{
+    std::unique_lock<std::mutex> lock_(m_status_mtx);
+    auto changed = [this, status] { return m_status.load() != status; };
+    bool ret = true;
+
+    if (changed())
+        return true;
+
+    m_status_waiters++;
+    if (time_out < 0)
+        m_status_cond.wait(lock_, changed);
+    else
+        ret = m_status_cond.wait_for(lock_, std::chrono::milliseconds(time_out), changed);
+    m_status_waiters--;
+
+    return ret;
+}
+
+/**
+ * @brief the end of a job may be reported before its scheduling thread
+ *        publishes AIPU_JOB_STATUS_SCHED, the status must go
+ *        SCHED->DONE/EXCEPTION. jobs publish it before the schedule ioctl,
+ *        so this normally returns at once.
+ */
+void aipudrv::JobBase::wait_scheduled()
+{
+    uint32_t status = get_job_status();
+
+    while (status != AIPU_JOB_STATUS_SCHED)
+    {
+        wait_status_change(status);
+        status = get_job_status();
+    }
+}
+
 aipu_status_t aipudrv::JobBase::validate_schedule_status()
 {
     if ((m_status == AIPU_JOB_STATUS_INIT) ||
@@ -12,11 +12,16 @@
 #define _JOB_BASE_H_
 
 #include <vector>
+#include <set>
 #include <tuple>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
 #include <pthread.h>
 #include "standard_api.h"
 #include "context.h"
 #include "graph.h"
+#include "rodata_template.h"
 #include "device_base.h"
 #include "memory_base.h"
 #include "type.h"
@@ -111,6 +116,9 @@ protected:
     bool m_dump_text = false;
     bool m_dump_weight = false;
     bool m_dump_reuse = false;
+
+    /* reuse sections given back at the end of the run, copied for the reuse dump, by index */
+    std::vector<std::vector<char>> m_reuse_dump_copy;
     bool m_dump_rodata = false;
     bool m_dump_dcr = false;
     bool m_dump_input = false;
@@ -128,7 +136,17 @@ protected:
     int m_profile_fd = -1;
 
 protected:
-    uint32_t m_status = AIPU_JOB_STATUS_NO_STATUS;
+    /**
+     * written by the scheduling thread and by whichever thread delivers the
+     * end of the job. update_job_status wakes the waiters of wait_status_change.
+     */
+    std::atomic<uint32_t> m_status {AIPU_JOB_STATUS_NO_STATUS};
+    std::atomic<uint32_t> m_status_waiters {0};
+    std::mutex m_status_mtx;
+    std::condition_variable m_status_cond;
+
+    /* status before the last schedule published SCHED/BIND, restored if it fails */
+    uint32_t m_sched_prev_status = AIPU_JOB_STATUS_NO_STATUS;
 
     /* call back function for handling job self */
     aipu_job_callback_func_t m_callback_func = nullptr;
@@ -139,6 +157,13 @@ protected:
      */
     bool m_optimized_reuse_alloc = false;
 
+    /**
+     * set 'true' if the job may be reset and handed out again after
+     * it is cleaned, jobs with dump/IO buffer/core binding config are
+     * never recycled.
+     */
+    bool m_recyclable = false;
+
 protected:
     const aipu_global_config_simulation_t *m_cfg = nullptr;
     const aipu_global_config_hw_t *m_hw_cfg = nullptr;
@@ -161,6 +186,10 @@ protected:
         const std::vector<BufferDesc*>& static_buf,
         BufferDesc &rodata, BufferDesc *dcr,
         std::set<uint32_t> *dma_buf_idx = nullptr);
+    aipu_status_t setup_rodata(const RodataTemplate &tmpl,
+        const std::vector<BufferDesc*>& reuse_buf,
+        BufferDesc &rodata, BufferDesc *dcr,
+        std::set<uint32_t> *dma_buf_idx = nullptr);
     virtual Graph& get_graph()
     {
         return static_cast<Graph&>(m_graph);
@@ -183,6 +212,7 @@ protected:
     void dump_job_private_buffers(BufferDesc& rodata, BufferDesc* descriptor);
     void dump_job_shared_buffers_after_run();
     void dump_job_private_buffers_after_run(BufferDesc& rodata, BufferDesc* descriptor);
+    void copy_reuse_for_dump(const std::set<uint32_t> &reuse_idx);
     aipu_status_t validate_schedule_status();
     virtual aipu_status_t get_runtime_err_code() const
     {
@@ -193,6 +223,43 @@ public:
     virtual aipu_status_t init(const aipu_global_config_simulation_t* cfg,
        const aipu_global_config_hw_t* hw_cfg) = 0;
     virtual aipu_status_t schedule() = 0;
+
+    /**
+     * split schedule for batched flushing: prepare_schedule fills desc and
+     * publishes the scheduled status, the caller hands desc to the device and
+     * then calls end_schedule with the result. desc.jobbase is left null if
+     * there is nothing for the device to run. a job that is not batchable is
+     * scheduled by itself.
+     */
+    virtual bool batchable() const
+    {
+        return false;
+    }
+    virtual aipu_status_t prepare_schedule(JobDesc &desc)
+    {
+        return AIPU_STATUS_ERROR_OP_NOT_SUPPORTED;
+    }
+    virtual void end_schedule(const JobDesc &desc, aipu_status_t ret)
+    {
+        if (ret != AIPU_STATUS_SUCCESS)
+        {
+            release_run_resources();
+            update_job_status(m_sched_prev_status);
+        }
+    }
+
+    /**
+     * admission control for what a job shares with the other jobs of its
+     * graph while it runs. returns AIPU_STATUS_ERROR_TIMEOUT if wait is
+     * false and all of it is in use.
+     */
+    virtual aipu_status_t admit(bool wait)
+    {
+        return AIPU_STATUS_SUCCESS;
+    }
+
+    /* gives back what admit took, once the job ends or fails to be scheduled */
+    virtual void release_run_resources() {}
     virtual aipu_status_t destroy() = 0;
     aipu_status_t load_tensor(uint32_t tensor, const void* data);
     aipu_status_t load_output_tensor(uint32_t tensor, const void* data);
@@ -211,11 +278,29 @@ public:
         return AIPU_STATUS_SUCCESS;
     }
 
+    virtual aipu_status_t get_tensor_descriptor(aipu_tensor_type_t type, uint32_t tensor,
+        aipu_tensor_desc_t* desc)
+    {
+        return m_graph.get_tensor_descriptor(type, tensor, desc);
+    }
+
     virtual aipu_status_t config_simulation(uint64_t types, const aipu_job_config_simulation_t* config)
     {
         return AIPU_STATUS_SUCCESS;
     };
     virtual aipu_status_t bind_core(uint32_t core_id) = 0;
+    virtual bool match_config(const aipu_create_job_cfg_t *config)
+    {
+        return false;
+    }
+    virtual uint64_t get_buffer_bytes()
+    {
+        return 0;
+    }
+    virtual aipu_status_t reset()
+    {
+        return AIPU_STATUS_ERROR_OP_NOT_SUPPORTED;
+    }
     virtual aipu_status_t debugger_run()
     {
         return AIPU_STATUS_ERROR_OP_NOT_SUPPORTED;
@@ -236,19 +321,47 @@ public:
 
     void update_job_status(uint32_t status)
     {
-        m_status = status;
+        /**
+         * released before the end is visible, the owner may reschedule at once.
+         * a job dumping its reuse buffers dumps a copy of the released ones.
+         */
+        if ((status == AIPU_JOB_STATUS_DONE) || (status == AIPU_JOB_STATUS_EXCEPTION))
+            release_run_resources();
+
+        /* seq_cst pairs with the waiter registration, a waiter can't be missed */
+        m_status.store(status);
+        if (m_status_waiters.load() != 0)
+        {
+            m_status_mtx.lock();
+            m_status_mtx.unlock();
+            m_status_cond.notify_all();
+        }
     }
 
     uint32_t get_job_status()
     {
-        return m_status;
+        return m_status.load(std::memory_order_acquire);
     }
 
+    bool wait_status_change(uint32_t status, int32_t time_out = -1);
+    void wait_scheduled();
+
     Graph& get_base_graph()
     {
         return static_cast<Graph&>(m_graph);
     }
 
+    MainContext* get_ctx()
+    {
+        return m_ctx;
+    }
+
+    /* wait for the end of this job scheduled by any thread */
+    aipu_ll_status_t poll_device(int32_t time_out)
+    {
+        return m_dev->poll_status(1, time_out, false, this);
+    }
+
     void set_job_cb(aipu_job_callback_func_t _cb_wrap)
     {
         m_callback_func = _cb_wrap;
@@ -0,0 +1,344 @@
+// Copyright (C) 2023-2024 Arm Technology (China) Co. Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+/**
+ * @file  mem_tracer.cpp
+ * @brief AIPU User Mode Driver (UMD) binary memory operation tracer module implementation
+ */
+
+#include <algorithm>
+#include <cstring>
+#include "mem_tracer.h"
+#include "memory_base.h"
+
+/* names of the traced ops, in MemOperation order */
+static const char* const MemTraceOpStr[aipudrv::MemOperationCnt] = {
+    "alloc",
+    "free",
+    "read",
+    "write",
+    "bzero",
+    "dump",
+    "reload",
+};
+
+static std::atomic<uint64_t> g_tracer_id{0};
+
+thread_local aipudrv::MemTracer::RingHolder aipudrv::MemTracer::t_rings;
+thread_local std::vector<std::pair<uint64_t,
+    std::map<std::string, uint16_t, std::less<>>>> aipudrv::MemTracer::t_tags;
+
+aipudrv::MemTracer::MemTracer()
+{
+    m_id = ++g_tracer_id;
+}
+
+aipudrv::MemTracer::~MemTracer()
+{
+    stop();
+}
+
+aipu_status_t aipudrv::MemTracer::start(const std::string &file_name)
+{
+    m_file = fopen(file_name.c_str(), "wb");
+    if (m_file == nullptr)
+        return AIPU_STATUS_ERROR_OPEN_FILE_FAIL;
+
+    if (fwrite(MEM_TRACE_MAGIC, 1, MEM_TRACE_MAGIC_LEN, m_file) != MEM_TRACE_MAGIC_LEN)
+    {
+        fclose(m_file);
+        m_file = nullptr;
+        return AIPU_STATUS_ERROR_WRITE_FILE_FAIL;
+    }
+
+    m_writer = std::thread(&MemTracer::writer, this);
+    return AIPU_STATUS_SUCCESS;
+}
+
+/**
+ * @brief the records logged before are all written. no op may be logged
+ *        meanwhile or after.
+ */
+void aipudrv::MemTracer::stop()
+{
+    if (!m_writer.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock_(m_lock);
+        m_stop = true;
+    }
+    m_cond.notify_one();
+    m_writer.join();
+
+    fclose(m_file);
+    m_file = nullptr;
+}
+
+/**
+ * @brief a ring is shared by its thread and the tracer. the writer drops
+ *        it once its thread exited and its records are written, a tracer
+ *        stopped before leaves it to the thread.
+ */
+aipudrv::MemTracer::Ring *aipudrv::MemTracer::get_ring()
+{
+    std::shared_ptr<Ring> ring;
+
+    for (auto iter = t_rings.rings.rbegin(); iter != t_rings.rings.rend(); iter++)
+    {
+        if (iter->first == m_id)
+            return iter->second.get();
+    }
+
+    ring = std::make_shared<Ring>();
+    ring->tid = gettid();
+    {
+        std::lock_guard<std::mutex> lock_(m_lock);
+        m_rings.push_back(ring);
+    }
+    t_rings.rings.push_back({m_id, ring});
+    return ring.get();
+}
+
+/**
+ * @brief the buffer names are few, each one is written once. a thread
+ *        takes the lock only the first time it names a buffer.
+ */
+uint16_t aipudrv::MemTracer::get_tag(const char *name)
+{
+    std::map<std::string, uint16_t, std::less<>> *tags = nullptr;
+    uint16_t tag = MEM_TRACE_TAG_NONE;
+
+    for (auto iter = t_tags.rbegin(); iter != t_tags.rend(); iter++)
+    {
+        if (iter->first == m_id)
+        {
+            tags = &iter->second;
+            break;
+        }
+    }
+
+    if (tags == nullptr)
+    {
+        t_tags.emplace_back(m_id, std::map<std::string, uint16_t, std::less<>>());
+        tags = &t_tags.back().second;
+    }
+
+    auto iter = tags->find(name);
+    if (iter != tags->end())
+        return iter->second;
+
+    tag = new_tag(name);
+    tags->emplace(name, tag);
+    return tag;
+}
+
+uint16_t aipudrv::MemTracer::new_tag(const char *name)
+{
+    std::lock_guard<std::mutex> lock_(m_lock);
+    auto iter = m_tags.find(name);
+    uint16_t tag = MEM_TRACE_TAG_NONE;
+
+    if (iter != m_tags.end())
+        return iter->second;
+
+    if (m_tags.size() >= MEM_TRACE_TAG_MAX)
+        return MEM_TRACE_TAG_NONE;
+
+    tag = m_tags.size() + 1;
+    m_tags.emplace(name, tag);
+    m_new_tags.push_back({tag, name});
+    return tag;
+}
+
+void aipudrv::MemTracer::log(uint32_t op, uint64_t pa, uint64_t size, const char *tag,
+    bool is_32_op, uint32_t data)
+{
+    Ring *ring = get_ring();
+    uint16_t tag_id = (tag == nullptr) ? MEM_TRACE_TAG_NONE : get_tag(tag);
+    uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    MemTraceRecord *rec = nullptr;
+
+    while ((tail - ring->head.load(std::memory_order_acquire)) >= MEM_TRACE_RING_SIZE)
+    {
+        m_cond.notify_one();
+        std::this_thread::yield();
+    }
+
+    rec = &ring->recs[tail & (MEM_TRACE_RING_SIZE - 1)];
+    rec->ts = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    rec->pa = pa;
+    rec->size = size;
+    rec->tid = ring->tid;
+    rec->data = is_32_op ? data : 0;
+    rec->op = op;
+    rec->tag = tag_id;
+    rec->is_32_op = is_32_op;
+    ring->tail.store(tail + 1, std::memory_order_release);
+
+    /* wake the writer before the ring fills up */
+    if ((tail + 1 - ring->head.load(std::memory_order_relaxed)) == (MEM_TRACE_RING_SIZE / 2))
+        m_cond.notify_one();
+}
+
+void aipudrv::MemTracer::write_tag(uint16_t tag, const std::string &name)
+{
+    MemTraceRecord rec = {0};
+    std::string padded(name);
+
+    rec.op = MEM_TRACE_OP_TAG;
+    rec.tag = tag;
+    rec.size = name.size();
+    padded.resize((name.size() + 7) & ~7UL, '\0');
+    fwrite(&rec, sizeof(rec), 1, m_file);
+    fwrite(padded.data(), 1, padded.size(), m_file);
+}
+
+void aipudrv::MemTracer::drain(Ring *ring)
+{
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    uint64_t tail = ring->tail.load(std::memory_order_acquire);
+
+    while (head != tail)
+    {
+        uint64_t idx = head & (MEM_TRACE_RING_SIZE - 1);
+        uint64_t cnt = std::min(tail - head, MEM_TRACE_RING_SIZE - idx);
+
+        fwrite(&ring->recs[idx], sizeof(MemTraceRecord), cnt, m_file);
+        head += cnt;
+    }
+    ring->head.store(head, std::memory_order_release);
+}
+
+/**
+ * @brief the tags are written before the records of a round, so a
+ *        record follows the definition of its tag in the file.
+ */
+void aipudrv::MemTracer::writer()
+{
+    std::unique_lock<std::mutex> lock_(m_lock);
+    std::vector<std::pair<uint16_t, std::string>> tags;
+    std::vector<Ring*> rings;
+    bool stop = false;
+
+    while (!stop)
+    {
+        if (!m_stop)
+            m_cond.wait_for(lock_, std::chrono::milliseconds(MEM_TRACE_DRAIN_MS));
+
+        stop = m_stop;
+        tags.clear();
+        tags.swap(m_new_tags);
+        rings.clear();
+        for (auto &ring : m_rings)
+            rings.push_back(ring.get());
+        lock_.unlock();
+
+        for (auto &tag : tags)
+            write_tag(tag.first, tag.second);
+
+        for (auto ring : rings)
+            drain(ring);
+
+        fflush(m_file);
+        lock_.lock();
+
+        /* the rings of the exited threads, drained above */
+        for (auto iter = m_rings.begin(); iter != m_rings.end();)
+        {
+            Ring *ring = iter->get();
+
+            if (ring->closed.load(std::memory_order_acquire) &&
+                (ring->head.load(std::memory_order_relaxed) == ring->tail.load(std::memory_order_acquire)))
+                iter = m_rings.erase(iter);
+            else
+                iter++;
+        }
+    }
+}
+
+/**
+ * @brief render a trace file in the text format of the memory info dump.
+ *        an op without tag is on the last allocated buffer covering it.
+ */
+aipu_status_t aipudrv::MemTracer::decode(const char *file_name, FILE *out)
+{
+    aipu_status_t ret = AIPU_STATUS_SUCCESS;
+    FILE *in = fopen(file_name, "rb");
+    char magic[MEM_TRACE_MAGIC_LEN] = {0};
+    std::map<uint16_t, std::string> tags;
+    std::vector<MemTraceRecord> recs;
+    std::vector<const MemTraceRecord*> allocs;
+    MemTraceRecord rec;
+    std::string name;
+
+    if (in == nullptr)
+        return AIPU_STATUS_ERROR_OPEN_FILE_FAIL;
+
+    if ((fread(magic, 1, MEM_TRACE_MAGIC_LEN, in) != MEM_TRACE_MAGIC_LEN) ||
+        (memcmp(magic, MEM_TRACE_MAGIC, MEM_TRACE_MAGIC_LEN) != 0))
+    {
+        ret = AIPU_STATUS_ERROR_READ_FILE_FAIL;
+        goto finish;
+    }
+
+    while (fread(&rec, sizeof(rec), 1, in) == 1)
+    {
+        if (rec.op != MEM_TRACE_OP_TAG)
+        {
+            recs.push_back(rec);
+            continue;
+        }
+
+        name.assign((rec.size + 7) & ~7UL, '\0');
+        if (fread(&name[0], 1, name.size(), in) != name.size())
+        {
+            ret = AIPU_STATUS_ERROR_READ_FILE_FAIL;
+            goto finish;
+        }
+        name.resize(rec.size);
+        tags[rec.tag] = name;
+    }
+
+    /* the rings are written one after another, the ops are ordered by time */
+    std::stable_sort(recs.begin(), recs.end(),
+        [](const MemTraceRecord &a, const MemTraceRecord &b) { return a.ts < b.ts; });
+
+    fprintf(out, "===========================Memory Info Dump============================\n");
+    fprintf(out, "No.    Address            Type           OP        Size       Data   Tid\n");
+    fprintf(out, "------------------------------------------------------------------\n");
+
+    for (uint32_t i = 0; i < recs.size(); i++)
+    {
+        const MemTraceRecord &op = recs[i];
+        const char *op_str = (op.op < MemOperationCnt) ? MemTraceOpStr[op.op] : "unknown";
+        uint16_t tag = op.tag;
+
+        for (auto iter = allocs.rbegin(); (tag == MEM_TRACE_TAG_NONE) && (iter != allocs.rend()); iter++)
+        {
+            if ((op.pa >= (*iter)->pa) && (op.pa < ((*iter)->pa + (*iter)->size)))
+                tag = (*iter)->tag;
+        }
+
+        if (op.op == MemOperationAlloc)
+            allocs.push_back(&op);
+
+        if (op.is_32_op)
+        {
+            fprintf(out, "%-6u 0x%-16lx %-14s %-9s 0x%-8lx 0x%-8x\n",
+                i, op.pa, tags[tag].c_str(), op_str, op.size, op.data);
+        } else {
+            fprintf(out, "%-6u 0x%-16lx %-14s %-9s 0x%-8lx %s    %-8u\n",
+                i, op.pa, tags[tag].c_str(), op_str, op.size, "N/A", op.tid);
+        }
+    }
+
+    fprintf(out, "=======================================================================\n");
+
+finish:
+    fclose(in);
+    return ret;
+}
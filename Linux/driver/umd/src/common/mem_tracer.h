@@ -0,0 +1,128 @@
+// Copyright (C) 2023-2024 Arm Technology (China) Co. Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+/**
+ * @file  mem_tracer.h
+ * @brief AIPU User Mode Driver (UMD) binary memory operation tracer module header
+ */
+
+#ifndef _MEM_TRACER_H_
+#define _MEM_TRACER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "standard_api.h"
+
+namespace aipudrv
+{
+#define MEM_TRACE_MAGIC      "UMDMTRC1"
+#define MEM_TRACE_MAGIC_LEN  8
+
+/* records per thread ring, power of 2 */
+#define MEM_TRACE_RING_SIZE  1024
+
+/* ms the writer sleeps between two drains if no ring fills up */
+#define MEM_TRACE_DRAIN_MS   10
+
+/* op of a record defining a tag, its name follows in 8 bytes units */
+#define MEM_TRACE_OP_TAG     0xffff
+
+/* tag of an op on an allocated buffer, the decoder takes the tag of its alloc */
+#define MEM_TRACE_TAG_NONE   0
+#define MEM_TRACE_TAG_MAX    0xffff
+
+struct MemTraceRecord
+{
+    uint64_t ts;        /**< ns, monotonic clock */
+    uint64_t pa;
+    uint64_t size;      /**< name length of a tag record */
+    uint32_t tid;
+    uint32_t data;      /**< first word of a 32 bits op */
+    uint16_t op;        /**< MemOperation, or MEM_TRACE_OP_TAG */
+    uint16_t tag;
+    uint32_t is_32_op;
+};
+
+/**
+ * memory operation tracer. an op costs a record in the per-thread ring
+ * of the caller, no lock and no formatting. a writer thread drains the
+ * rings to a binary file, which decode() renders in the text format of
+ * the memory info dump. a producer only waits if its ring is full.
+ */
+class MemTracer
+{
+private:
+    /* single producer (its thread) and single consumer (the writer) */
+    struct Ring
+    {
+        MemTraceRecord recs[MEM_TRACE_RING_SIZE];
+        std::atomic<uint64_t> head{0};
+        char pad[56];                   /**< head and tail on their own cache lines */
+        std::atomic<uint64_t> tail{0};
+        std::atomic<bool> closed{false};    /**< its thread exited */
+        uint32_t tid = 0;
+    };
+
+    /* rings of a thread by tracer id, closed when the thread exits */
+    struct RingHolder
+    {
+        std::vector<std::pair<uint64_t, std::shared_ptr<Ring>>> rings;
+
+        ~RingHolder()
+        {
+            for (auto &ring : rings)
+                ring.second->closed.store(true, std::memory_order_release);
+        }
+    };
+
+    uint64_t m_id = 0;
+    FILE *m_file = nullptr;
+    std::vector<std::shared_ptr<Ring>> m_rings;
+    std::map<std::string, uint16_t, std::less<>> m_tags;
+    std::vector<std::pair<uint16_t, std::string>> m_new_tags;
+    bool m_stop = false;
+    std::thread m_writer;
+    std::mutex m_lock;
+    std::condition_variable m_cond;
+
+    /* rings of the calling thread */
+    static thread_local RingHolder t_rings;
+
+    /* tags the calling thread has looked up, by tracer id */
+    static thread_local std::vector<std::pair<uint64_t,
+        std::map<std::string, uint16_t, std::less<>>>> t_tags;
+
+private:
+    Ring *get_ring();
+    uint16_t get_tag(const char *name);
+    uint16_t new_tag(const char *name);
+    void write_tag(uint16_t tag, const std::string &name);
+    void drain(Ring *ring);
+    void writer();
+
+public:
+    aipu_status_t start(const std::string &file_name);
+    void stop();
+    void log(uint32_t op, uint64_t pa, uint64_t size, const char *tag,
+        bool is_32_op, uint32_t data);
+
+    static aipu_status_t decode(const char *file_name, FILE *out);
+
+public:
+    MemTracer();
+    ~MemTracer();
+    MemTracer(const MemTracer& tracer) = delete;
+    MemTracer& operator=(const MemTracer& tracer) = delete;
+};
+}
+
+#endif /* _MEM_TRACER_H_ */
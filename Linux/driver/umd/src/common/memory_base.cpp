@@ -38,10 +38,15 @@ aipudrv::MemoryBase::MemoryBase()
         if (mem_log_file != nullptr)
             m_file_name = mem_log_file;
 
-        LOG(LOG_ALERT, "memory log file: %s", m_file_name.c_str());
-        mem_dump.open(m_file_name.c_str(), std::ofstream::out | std::ofstream::trunc);
-        mem_dump.close();
-        mem_dump.open(m_file_name.c_str(), std::ofstream::out | std::ofstream::app);
+        m_tracer.reset(new MemTracer);
+        if (m_tracer->start(m_file_name) == AIPU_STATUS_SUCCESS)
+        {
+            LOG(LOG_ALERT, "memory trace file: %s", m_file_name.c_str());
+        } else {
+            LOG(LOG_ERR, "open memory trace file %s failed", m_file_name.c_str());
+            m_tracer.reset();
+            m_enable_mem_dump = 0;
+        }
     }
 
     if (gm_enable != nullptr)
@@ -57,113 +62,20 @@ aipudrv::MemoryBase::~MemoryBase()
 {
     pthread_rwlock_destroy(&m_lock);
     pthread_rwlock_destroy(&m_tlock);
-    mem_dump.close();
-}
-
-std::string aipudrv::MemoryBase::get_tracking_log(DEV_PA_64 pa) const
-{
-    std::string log;
-
-    for (uint32_t i = 0; i < m_tracking.size(); i++)
-    {
-        if ((pa >= m_tracking[i].pa) &&
-            (pa < (m_tracking[i].pa + m_tracking[i].size)))
-            log = m_tracking[i].log;
-    }
-
-    return log;
+    m_tracer.reset();
 }
 
+/**
+ * @brief the op costs a record in the tracer, the file is decoded offline
+ *        by aipu_mem_trace_decode
+ */
 void aipudrv::MemoryBase::add_tracking(DEV_PA_64 pa, uint64_t size, MemOperation op,
     const char* str, bool is_32_op, uint32_t data) const
 {
-    std::string log;
-    MemTracking tracking = {0};
-    char f_log[1024] = {0};
-
     if ((m_enable_mem_dump & (1 << op)) != (uint32_t)(1 << op))
         return;
 
-    pthread_rwlock_wrlock(&m_lock);
-    if (str == nullptr)
-        log = get_tracking_log(pa);
-    else
-        log = str;
-
-    tracking.init(pa, size, op, log);
-    if (is_32_op)
-    {
-        tracking.is_32_op = true;
-        tracking.data = data;
-    }
-
-    if (op == MemOperationAlloc)
-        m_tracking.push_back(tracking);
-
-    if (tracking.is_32_op)
-    {
-        snprintf(f_log, 1024, "%-6u 0x%-16lx %-14s %-9s 0x%-8lx 0x%-8x",
-            m_tracking_idx,
-            tracking.pa,
-            tracking.log.c_str(),
-            MemOperationStr[tracking.op],
-            tracking.size,
-            tracking.data
-        );
-    } else {
-        snprintf(f_log, 1024, "%-6u 0x%-16lx %-14s %-9s 0x%-8lx %s    %-8ld",
-            m_tracking_idx,
-            tracking.pa,
-            tracking.log.c_str(),
-            MemOperationStr[tracking.op],
-            tracking.size,
-            "N/A",
-            gettid()
-        );
-    }
-    write_line(f_log);
-    m_tracking_idx++;
-    pthread_rwlock_unlock(&m_lock);
-}
-
-void aipudrv::MemoryBase::dump_tracking_log_start() const
-{
-    static std::mutex mtex;
-    char log[1024];
-
-    std::lock_guard<std::mutex> lock_(mtex);
-    if ((m_enable_mem_dump == 0) || (start != 0))
-        return;
-
-    snprintf(log, 1024, "===========================Memory Info Dump============================");
-    write_line(log);
-    snprintf(log, 1024, "No.    Address            Type           OP        Size       Data   Tid");
-    write_line(log);
-    snprintf(log, 1024, "------------------------------------------------------------------");
-    write_line(log);
-    start = 1;
-}
-
-void aipudrv::MemoryBase::dump_tracking_log_end() const
-{
-    static std::mutex mtex;
-    char log[1024];
-
-    std::lock_guard<std::mutex> lock_(mtex);
-    if ((m_enable_mem_dump == 0) || (end != 0))
-        return;
-
-    snprintf(log, 1024, "=======================================================================");
-    write_line(log);
-    end = 1;
-}
-
-void aipudrv::MemoryBase::write_line(const char* log) const
-{
-    if (m_enable_mem_dump)
-    {
-        mem_dump << log << std::endl;
-    }
+    m_tracer->log(op, pa, size, str, is_32_op, data);
 }
 
 std::map<aipudrv::DEV_PA_64, aipudrv::Buffer>::iterator
@@ -171,12 +83,18 @@ aipudrv::MemoryBase::get_allocated_buffer(std::map<DEV_PA_64, Buffer> *buffer_po
 {
     std::map<aipudrv::DEV_PA_64, aipudrv::Buffer>::iterator iter;
 
-    for (iter = buffer_pool->begin(); iter != buffer_pool->end(); iter++)
-    {
-        if ((addr >= iter->second.desc->pa) &&
-            (addr < (iter->second.desc->pa + iter->second.desc->size)))
-            return iter;
-    }
+    /**
+     * buffers in one pool never overlap and are keyed by their base PA,
+     * so the only candidate is the last buffer whose base PA <= addr.
+     */
+    iter = buffer_pool->upper_bound(addr);
+    if (iter == buffer_pool->begin())
+        return buffer_pool->end();
+
+    iter--;
+    if (addr < (iter->second.desc->pa + iter->second.desc->size))
+        return iter;
+
     return buffer_pool->end();
 }
 
@@ -185,7 +103,7 @@ int aipudrv::MemoryBase::get_shared_buffer(uint64_t addr, uint64_t size, Buffer
     int ret = 0;
     auto iter = m_allocated.end();
 
-    pthread_rwlock_wrlock(&m_lock);
+    pthread_rwlock_rdlock(&m_lock);
     iter = get_allocated_buffer((std::map<DEV_PA_64, Buffer> *)&m_allocated, addr);
     if (iter == m_allocated.end())
     {
@@ -208,7 +126,8 @@ int aipudrv::MemoryBase::pa_to_va(uint64_t addr, uint64_t size, char** va) const
     bool found = true;
     auto iter = m_allocated.end();
 
-    pthread_rwlock_wrlock(&m_lock);
+    /* lookup only, concurrent tensor loads/gets can share the lock */
+    pthread_rwlock_rdlock(&m_lock);
     *va = nullptr;
 
     for (auto item : m_allocated_buf_map)
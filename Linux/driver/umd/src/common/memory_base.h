@@ -12,6 +12,7 @@
 #define _MEMORY_BASE_H_
 
 #include <map>
+#include <memory>
 #include <atomic>
 #include <pthread.h>
 #include <fstream>
@@ -22,6 +23,7 @@
 #include "standard_api.h"
 #include "kmd/armchina_aipu.h"
 #include "type.h"
+#include "mem_tracer.h"
 #include "utils/log.h"
 
 namespace aipudrv
@@ -135,56 +137,13 @@ enum MemOperation
     MemOperationCnt,
 };
 
-struct MemTracking
-{
-    DEV_PA_64    pa;
-    uint64_t     size;
-    MemOperation op;
-    std::string  log;
-    bool         is_32_op;
-    uint32_t     data;
-    void init(DEV_PA_64 _pa, uint64_t _size, MemOperation _op,
-        const char* str)
-    {
-        pa = _pa;
-        size = _size;
-        op = _op;
-        is_32_op = false;
-        log = std::string(str);
-    }
-    void init(DEV_PA_64 _pa, uint64_t _size, MemOperation _op,
-        const std::string &str)
-    {
-        pa = _pa;
-        size = _size;
-        op = _op;
-        is_32_op = false;
-        log = str;
-    }
-};
-
 class MemoryBase
 {
 private:
-    const char* MemOperationStr[MemOperationCnt] = {
-        "alloc",
-        "free",
-        "read",
-        "write",
-        "bzero",
-        "dump",
-        "reload",
-    };
-
-private:
-    mutable std::ofstream mem_dump;
-    mutable std::vector<MemTracking> m_tracking;
-    mutable uint32_t m_tracking_idx = 0;
+    std::unique_ptr<MemTracer> m_tracer;
     mutable pthread_rwlock_t m_tlock;
-    mutable uint32_t start = 0;
-    mutable uint32_t end = 0;
     uint32_t m_enable_mem_dump = DUMP_MEM_OP_MASK;
-    std::string m_file_name = "mem_info.log";
+    std::string m_file_name = "mem_info.trace";
     std::vector<DEV_PA_64> m_asid_base_vec;
     GMRegion m_gm_region[2] = {0};
     bool m_gm_enable = true;
@@ -202,9 +161,6 @@ protected:
     };
     mutable pthread_rwlock_t m_lock;
 
-private:
-    std::string get_tracking_log(DEV_PA_64 pa) const;
-
 protected:
     uint64_t get_page_cnt(uint64_t bytes) const
     {
@@ -224,9 +180,6 @@ protected:
 public:
     void add_tracking(DEV_PA_64 pa, uint64_t size, MemOperation op,
         const char* str, bool is_32_op, uint32_t data) const;
-    void dump_tracking_log_start() const;
-    void dump_tracking_log_end() const;
-    void write_line(const char* log) const;
     int mem_bzero(uint64_t addr, size_t size);
     void set_asid_base(int i, DEV_PA_64 base)
     {
@@ -304,6 +257,15 @@ public:
     virtual aipu_status_t dump_file(DEV_PA_64 src, const char* name, uint32_t size);
     virtual aipu_status_t load_file(DEV_PA_64 dest, const char* name, uint32_t size);
     virtual void gm_init(uint32_t gm_size_idx) {}
+    virtual aipu_status_t get_mem_stats(aipu_mem_stats_t *stats)
+    {
+        return AIPU_STATUS_ERROR_OP_NOT_SUPPORTED;
+    }
+    virtual aipu_status_t trim_cache(uint64_t *keep_bytes)
+    {
+        *keep_bytes = 0;
+        return AIPU_STATUS_SUCCESS;
+    }
 
     int write32(DEV_PA_64 dest, uint32_t src)
     {
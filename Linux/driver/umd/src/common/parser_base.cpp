@@ -355,7 +355,7 @@ aipu_status_t aipudrv::ParserBase::parse_remap_section(char* remap, Graph& gobj)
     return ret;
 }
 
-aipu_status_t aipudrv::ParserBase::parse_graph_header_top(std::istream& gbin, uint32_t size, Graph& gobj)
+aipu_status_t aipudrv::ParserBase::parse_graph_header_top(std::istream& gbin, uint64_t size, Graph& gobj)
 {
     aipu_status_t ret = AIPU_STATUS_SUCCESS;
     BinHeaderTop header = {0};
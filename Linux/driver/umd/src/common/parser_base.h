@@ -211,12 +211,12 @@ protected:
     aipu_status_t sort_io(struct GraphIOTensors &io);
 
 public:
-    virtual aipu_status_t parse_graph(std::istream& gbin, uint32_t size, Graph& gobj) = 0;
+    virtual aipu_status_t parse_graph(std::istream& gbin, uint64_t size, Graph& gobj) = 0;
 
 public:
     static uint32_t get_graph_bin_version(std::istream& gbin);
     static void print_graph_header_top(const BinHeaderTop& top);
-    static aipu_status_t parse_graph_header_top(std::istream& gbin, uint32_t size, Graph& gobj);
+    static aipu_status_t parse_graph_header_top(std::istream& gbin, uint64_t size, Graph& gobj);
 
 public:
     ParserBase(const ParserBase& parser) = delete;
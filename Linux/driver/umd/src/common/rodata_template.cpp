@@ -0,0 +1,176 @@
+// Copyright (C) 2023-2024 Arm Technology (China) Co. Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+/**
+ * @file  rodata_template.cpp
+ * @brief AIPU User Mode Driver (UMD) pre-relocated rodata template module implementation
+ */
+
+#include <string.h>
+#include <algorithm>
+#include "rodata_template.h"
+#include "utils/log.h"
+
+void aipudrv::RodataTemplate::reset()
+{
+    m_rodata.clear();
+    m_dcr.clear();
+    m_offset.clear();
+    m_sec_offset.clear();
+    m_mask.clear();
+    m_keep.clear();
+    m_ref_start.clear();
+    m_valid = false;
+}
+
+/**
+ * @brief copy the images, write the static entries and collect the reuse
+ *        entries. returns false if the parameter map can't be templated.
+ */
+bool aipudrv::RodataTemplate::build(const BinSection &rodata, const BinSection &dcr,
+    const std::vector<struct GraphParamMapLoadDesc> &param_map,
+    const std::vector<BufferDesc*> &static_buf, uint32_t reuse_cnt)
+{
+    std::vector<uint32_t> reuse_params, offsets;
+    uint32_t ref_cnt = 0, init_val = 0, finl_val = 0;
+    char *entry = nullptr;
+
+    reset();
+    if ((uint64_t)rodata.size + dcr.size > UINT32_MAX)
+        return false;
+
+    if (rodata.size != 0)
+        m_rodata.assign(rodata.va, rodata.va + rodata.size);
+    if (dcr.size != 0)
+        m_dcr.assign(dcr.va, dcr.va + dcr.size);
+
+    offsets.reserve(param_map.size());
+    for (uint32_t i = 0; i < param_map.size(); i++)
+    {
+        const struct GraphParamMapLoadDesc &param = param_map[i];
+        uint64_t offset = param.offset_in_map;
+
+        if (offset < m_rodata.size())
+        {
+            if (offset + 4 > m_rodata.size())
+                goto fail;
+            entry = &m_rodata[offset];
+        } else {
+            if (offset - m_rodata.size() + 4 > m_dcr.size())
+                goto fail;
+            entry = &m_dcr[offset - m_rodata.size()];
+        }
+        offsets.push_back(param.offset_in_map);
+
+        if (param.load_type == PARAM_MAP_LOAD_TYPE_REUSE)
+        {
+            if (param.ref_section_iter >= reuse_cnt)
+                goto fail;
+
+            reuse_params.push_back(i);
+            ref_cnt = std::max(ref_cnt, param.ref_section_iter + 1);
+        } else if (param.load_type == PARAM_MAP_LOAD_TYPE_STATIC) {
+            if (param.ref_section_iter >= static_buf.size())
+                goto fail;
+
+            memcpy(&init_val, entry, 4);
+            finl_val = (get_low_32(static_buf[param.ref_section_iter]->align_asid_pa +
+                param.sub_section_offset) & param.addr_mask) | (init_val & ~param.addr_mask);
+            memcpy(entry, &finl_val, 4);
+        } else {
+            goto fail;
+        }
+    }
+
+    /* entries sharing a word depend on their order */
+    std::sort(offsets.begin(), offsets.end());
+    for (uint32_t i = 1; i < offsets.size(); i++)
+    {
+        if (offsets[i] - offsets[i - 1] < 4)
+            goto fail;
+    }
+
+    /* group the reuse entries by section, in address order */
+    std::sort(reuse_params.begin(), reuse_params.end(), [&](uint32_t a, uint32_t b) {
+        if (param_map[a].ref_section_iter != param_map[b].ref_section_iter)
+            return param_map[a].ref_section_iter < param_map[b].ref_section_iter;
+        return param_map[a].offset_in_map < param_map[b].offset_in_map;
+    });
+
+    m_ref_start.assign(ref_cnt + 1, 0);
+    for (auto i : reuse_params)
+    {
+        const struct GraphParamMapLoadDesc &param = param_map[i];
+
+        if (param.offset_in_map < m_rodata.size())
+            memcpy(&init_val, &m_rodata[param.offset_in_map], 4);
+        else
+            memcpy(&init_val, &m_dcr[param.offset_in_map - m_rodata.size()], 4);
+
+        m_ref_start[param.ref_section_iter + 1]++;
+        m_offset.push_back(param.offset_in_map);
+        m_sec_offset.push_back(param.sub_section_offset);
+        m_mask.push_back(param.addr_mask);
+        m_keep.push_back(init_val & ~param.addr_mask);
+    }
+    for (uint32_t ref = 0; ref < ref_cnt; ref++)
+        m_ref_start[ref + 1] += m_ref_start[ref];
+
+    m_valid = true;
+    return true;
+
+fail:
+    LOG(LOG_DEBUG, "parameter map isn't templatable, relocate per entry");
+    reset();
+    return false;
+}
+
+/**
+ * @brief write the reuse entries of all sections, or only of the sections
+ *        in reuse_idx, into a job's copy of the images.
+ */
+aipu_status_t aipudrv::RodataTemplate::patch(char *ro_va, char *dcr_va,
+    const std::vector<BufferDesc*> &reuse_buf,
+    const std::set<uint32_t> *reuse_idx) const
+{
+    uint32_t ref_cnt = m_ref_start.empty() ? 0 : m_ref_start.size() - 1;
+    uint32_t ro_size = m_rodata.size();
+
+    auto patch_section = [&](uint32_t ref)
+    {
+        uint32_t pa_32 = get_low_32(reuse_buf[ref]->align_asid_pa);
+        uint32_t finl_val = 0, offset = 0;
+
+        for (uint32_t k = m_ref_start[ref]; k < m_ref_start[ref + 1]; k++)
+        {
+            finl_val = ((pa_32 + m_sec_offset[k]) & m_mask[k]) | m_keep[k];
+            offset = m_offset[k];
+            if (offset < ro_size)
+                memcpy(ro_va + offset, &finl_val, 4);
+            else
+                memcpy(dcr_va + offset - ro_size, &finl_val, 4);
+        }
+    };
+
+    if (!m_valid)
+        return AIPU_STATUS_ERROR_INVALID_OP;
+
+    if (ref_cnt > reuse_buf.size())
+        return AIPU_STATUS_ERROR_INVALID_SIZE;
+
+    if (reuse_idx == nullptr)
+    {
+        for (uint32_t ref = 0; ref < ref_cnt; ref++)
+            patch_section(ref);
+    } else {
+        for (auto ref : *reuse_idx)
+        {
+            if (ref < ref_cnt)
+                patch_section(ref);
+        }
+    }
+
+    return AIPU_STATUS_SUCCESS;
+}
@@ -0,0 +1,85 @@
+// Copyright (C) 2023-2024 Arm Technology (China) Co. Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+/**
+ * @file  rodata_template.h
+ * @brief AIPU User Mode Driver (UMD) pre-relocated rodata template module header
+ */
+
+#ifndef _RODATA_TEMPLATE_H_
+#define _RODATA_TEMPLATE_H_
+
+#include <set>
+#include <vector>
+#include "graph.h"
+
+namespace aipudrv
+{
+/**
+ * a graph's rodata and descriptor images with the static (weight) entries
+ * of its parameter map already written, built once at graph load.
+ *
+ * the addresses of the weights are the same for all jobs of a graph, only
+ * the reuse entries differ. they're kept in SoA form grouped by the reuse
+ * section they point to, so a job copies the images and then patches each
+ * section's entries with that section's address, without reading back
+ * device memory. re-pointing some sections (dma_buf) patches just theirs.
+ *
+ * a parameter map whose entries overlap can't be applied out of order,
+ * the template stays invalid then and jobs go the per-entry way.
+ */
+class RodataTemplate
+{
+private:
+    std::vector<char> m_rodata;
+    std::vector<char> m_dcr;
+
+    /* reuse entries: offset in rodata, or in dcr past the rodata size */
+    std::vector<uint32_t> m_offset;
+    std::vector<uint32_t> m_sec_offset;
+    std::vector<uint32_t> m_mask;
+    std::vector<uint32_t> m_keep;       /**< image bits outside of the mask */
+
+    /* entries of reuse section i are [m_ref_start[i], m_ref_start[i + 1]) */
+    std::vector<uint32_t> m_ref_start;
+    bool m_valid = false;
+
+public:
+    bool build(const BinSection &rodata, const BinSection &dcr,
+        const std::vector<struct GraphParamMapLoadDesc> &param_map,
+        const std::vector<BufferDesc*> &static_buf, uint32_t reuse_cnt);
+    aipu_status_t patch(char *ro_va, char *dcr_va,
+        const std::vector<BufferDesc*> &reuse_buf,
+        const std::set<uint32_t> *reuse_idx = nullptr) const;
+    void reset();
+
+    bool is_valid() const
+    {
+        return m_valid;
+    }
+
+    const char* get_rodata() const
+    {
+        return m_rodata.data();
+    }
+
+    const char* get_dcr() const
+    {
+        return m_dcr.data();
+    }
+
+    uint32_t get_reuse_entry_cnt() const
+    {
+        return m_offset.size();
+    }
+
+public:
+    RodataTemplate() {}
+    RodataTemplate(const RodataTemplate& tmpl) = delete;
+    RodataTemplate& operator=(const RodataTemplate& tmpl) = delete;
+};
+}
+
+#endif /* _RODATA_TEMPLATE_H_ */
@@ -0,0 +1,226 @@
+// Copyright (C) 2023-2024 Arm Technology (China) Co. Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+/**
+ * @file  slot_table.h
+ * @brief AIPU User Mode Driver (UMD) generation-tagged handle table header
+ */
+
+#ifndef _SLOT_TABLE_H_
+#define _SLOT_TABLE_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <utility>
+
+namespace aipudrv
+{
+/**
+ * maps 32-bit keys to objects, a key is (generation << SLOT_INDEX_BITS) | index.
+ *
+ * get() is lock-free: slots live in segments which are never moved or freed
+ * before the table, and a slot's generation is bumped when it's released, so
+ * a stale key stops resolving. writers (reserve/set/release) are serialized.
+ * the generation is never 0, so neither is a key.
+ *
+ * it only resolves handles, keeping a returned object alive is up to the
+ * caller as before.
+ */
+template <typename T>
+class SlotTable
+{
+public:
+    static const uint32_t SLOT_INDEX_BITS = 20;
+    static const uint32_t SLOT_GEN_MASK = (1U << (32 - SLOT_INDEX_BITS)) - 1;
+    static const uint32_t SLOT_SEG_SHIFT = 10;
+    static const uint32_t SLOT_SEG_SIZE = 1U << SLOT_SEG_SHIFT;
+    static const uint32_t SLOT_SEG_CNT = 1U << (SLOT_INDEX_BITS - SLOT_SEG_SHIFT);
+
+private:
+    struct Slot
+    {
+        std::atomic<uint32_t> gen {1};
+        std::atomic<T*> obj {nullptr};
+    };
+
+    std::atomic<Slot*> m_segs[SLOT_SEG_CNT];
+    std::mutex m_lock;
+    uint32_t m_slot_cnt = 0;
+    uint32_t m_used_cnt = 0;
+
+    /* FIFO, a released slot is reused last to make stale keys rarer */
+    std::deque<uint32_t> m_free;
+
+private:
+    Slot* get_slot(uint32_t index) const
+    {
+        Slot *seg = m_segs[index >> SLOT_SEG_SHIFT].load(std::memory_order_acquire);
+
+        if (seg == nullptr)
+            return nullptr;
+        return &seg[index & (SLOT_SEG_SIZE - 1)];
+    }
+
+    static uint32_t to_key(uint32_t gen, uint32_t index)
+    {
+        return (gen << SLOT_INDEX_BITS) | index;
+    }
+
+public:
+    static uint32_t key_index(uint32_t key)
+    {
+        return key & ((1U << SLOT_INDEX_BITS) - 1);
+    }
+
+    static uint32_t key_gen(uint32_t key)
+    {
+        return key >> SLOT_INDEX_BITS;
+    }
+
+    /**
+     * @brief take a slot with no object yet, get() returns null for it
+     *        until set(). returns 0 if the table is full.
+     */
+    uint32_t reserve()
+    {
+        std::lock_guard<std::mutex> lock_(m_lock);
+        uint32_t index = 0;
+        Slot *seg = nullptr;
+
+        if (!m_free.empty())
+        {
+            index = m_free.front();
+            m_free.pop_front();
+        } else {
+            if (m_slot_cnt >= SLOT_SEG_CNT * SLOT_SEG_SIZE)
+                return 0;
+
+            index = m_slot_cnt++;
+            if (m_segs[index >> SLOT_SEG_SHIFT].load(std::memory_order_relaxed) == nullptr)
+            {
+                seg = new Slot[SLOT_SEG_SIZE];
+                m_segs[index >> SLOT_SEG_SHIFT].store(seg, std::memory_order_release);
+            }
+        }
+
+        m_used_cnt++;
+        return to_key(get_slot(index)->gen.load(std::memory_order_relaxed), index);
+    }
+
+    void set(uint32_t key, T *obj)
+    {
+        std::lock_guard<std::mutex> lock_(m_lock);
+        Slot *slot = get_slot(key_index(key));
+
+        if ((slot != nullptr) && (slot->gen.load(std::memory_order_relaxed) == key_gen(key)))
+            slot->obj.store(obj, std::memory_order_release);
+    }
+
+    uint32_t insert(T *obj)
+    {
+        uint32_t key = reserve();
+
+        if (key != 0)
+            set(key, obj);
+        return key;
+    }
+
+    T* get(uint32_t key) const
+    {
+        Slot *slot = get_slot(key_index(key));
+        uint32_t gen = 0;
+        T *obj = nullptr;
+
+        if ((slot == nullptr) || (key_gen(key) == 0))
+            return nullptr;
+
+        /* the generation is bumped before the object is cleared */
+        gen = slot->gen.load(std::memory_order_acquire);
+        obj = slot->obj.load(std::memory_order_acquire);
+        if ((gen != key_gen(key)) || (slot->gen.load(std::memory_order_acquire) != gen))
+            return nullptr;
+
+        return obj;
+    }
+
+    bool release(uint32_t key)
+    {
+        std::lock_guard<std::mutex> lock_(m_lock);
+        Slot *slot = get_slot(key_index(key));
+        uint32_t gen = 0;
+
+        if ((slot == nullptr) || (slot->gen.load(std::memory_order_relaxed) != key_gen(key)))
+            return false;
+
+        gen = (key_gen(key) + 1) & SLOT_GEN_MASK;
+        slot->gen.store((gen == 0) ? 1 : gen, std::memory_order_release);
+        slot->obj.store(nullptr, std::memory_order_release);
+        m_free.push_back(key_index(key));
+        m_used_cnt--;
+        return true;
+    }
+
+    /* keys and objects set so far, in slot order */
+    std::vector<std::pair<uint32_t, T*>> snapshot()
+    {
+        std::lock_guard<std::mutex> lock_(m_lock);
+        std::vector<std::pair<uint32_t, T*>> items;
+        Slot *slot = nullptr;
+        T *obj = nullptr;
+
+        for (uint32_t i = 0; i < m_slot_cnt; i++)
+        {
+            slot = get_slot(i);
+            obj = slot->obj.load(std::memory_order_relaxed);
+            if (obj != nullptr)
+                items.push_back({to_key(slot->gen.load(std::memory_order_relaxed), i), obj});
+        }
+        return items;
+    }
+
+    uint32_t size()
+    {
+        std::lock_guard<std::mutex> lock_(m_lock);
+        return m_used_cnt;
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock_(m_lock);
+        Slot *slot = nullptr;
+        uint32_t gen = 0;
+
+        m_free.clear();
+        for (uint32_t i = 0; i < m_slot_cnt; i++)
+        {
+            slot = get_slot(i);
+            gen = (slot->gen.load(std::memory_order_relaxed) + 1) & SLOT_GEN_MASK;
+            slot->gen.store((gen == 0) ? 1 : gen, std::memory_order_release);
+            slot->obj.store(nullptr, std::memory_order_release);
+            m_free.push_back(i);
+        }
+        m_used_cnt = 0;
+    }
+
+public:
+    SlotTable()
+    {
+        for (uint32_t i = 0; i < SLOT_SEG_CNT; i++)
+            m_segs[i].store(nullptr, std::memory_order_relaxed);
+    }
+    ~SlotTable()
+    {
+        for (uint32_t i = 0; i < SLOT_SEG_CNT; i++)
+            delete[] m_segs[i].load(std::memory_order_relaxed);
+    }
+    SlotTable(const SlotTable& table) = delete;
+    SlotTable& operator=(const SlotTable& table) = delete;
+};
+}
+
+#endif /* _SLOT_TABLE_H_ */
@@ -193,6 +193,12 @@ finish:
 
 aipu_status_t aipu_load_graph_helper(const aipu_ctx_handle_t* ctx, const char* graph_buf,
     uint32_t graph_size, uint64_t* id, aipu_load_graph_cfg_t *config)
+{
+    return aipu_load_graph_helper_64(ctx, graph_buf, graph_size, id, config);
+}
+
+aipu_status_t aipu_load_graph_helper_64(const aipu_ctx_handle_t* ctx, const char* graph_buf,
+    uint64_t graph_size, uint64_t* id, aipu_load_graph_cfg_t *config)
 {
     aipu_status_t ret = AIPU_STATUS_SUCCESS;
     aipudrv::CtxRefMap& ctx_map = aipudrv::CtxRefMap::get_ctx_map();
@@ -300,6 +306,7 @@ aipu_status_t aipu_flush_job(const aipu_ctx_handle_t* ctx, uint64_t id,
 {
     aipu_status_t ret = AIPU_STATUS_SUCCESS;
     aipudrv::JobBase* job = nullptr;
+    aipudrv::CompletionReactor* reactor = nullptr;
 
     if (ctx == nullptr)
         return AIPU_STATUS_ERROR_NULL_PTR;
@@ -313,8 +320,38 @@ aipu_status_t aipu_flush_job(const aipu_ctx_handle_t* ctx, uint64_t id,
 
     job->set_job_cb(job_cb_func);
 
-    /* callback to be implemented */
-    return job->schedule();
+    ret = job->schedule();
+    if (ret != AIPU_STATUS_SUCCESS)
+        return ret;
+
+    /* callbacks are fired by the completion reactor if started */
+    reactor = job->get_ctx()->get_completion_reactor();
+    if (reactor != nullptr)
+        reactor->track(job);
+
+    return ret;
+}
+
+aipu_status_t aipu_flush_jobs(const aipu_ctx_handle_t* ctx, const uint64_t* jobs, uint32_t cnt,
+    aipu_job_callback_func_t job_cb_func)
+{
+    aipudrv::CtxRefMap& ctx_map = aipudrv::CtxRefMap::get_ctx_map();
+    aipudrv::MainContext* p_ctx = nullptr;
+
+    if ((ctx == nullptr) || (jobs == nullptr))
+        return AIPU_STATUS_ERROR_NULL_PTR;
+
+    p_ctx = ctx_map.get_ctx_ref(ctx->handle);
+    if (p_ctx == nullptr)
+        return AIPU_STATUS_ERROR_INVALID_CTX;
+
+    for (uint32_t i = 0; i < cnt; i++)
+    {
+        if (!aipudrv::valid_job_id(jobs[i]))
+            return AIPU_STATUS_ERROR_INVALID_JOB_ID;
+    }
+
+    return p_ctx->flush_jobs(jobs, cnt, job_cb_func);
 }
 
 aipu_status_t aipu_get_job_status(const aipu_ctx_handle_t* ctx, uint64_t id,
@@ -336,6 +373,36 @@ aipu_status_t aipu_get_job_status(const aipu_ctx_handle_t* ctx, uint64_t id,
     return job->get_status_blocking(status, time_out);
 }
 
+aipu_status_t aipu_get_completion_fd(const aipu_ctx_handle_t* ctx, int* fd)
+{
+    aipudrv::CtxRefMap& ctx_map = aipudrv::CtxRefMap::get_ctx_map();
+    aipudrv::MainContext* p_ctx = nullptr;
+
+    if ((ctx == nullptr) || (fd == nullptr))
+        return AIPU_STATUS_ERROR_NULL_PTR;
+
+    p_ctx = ctx_map.get_ctx_ref(ctx->handle);
+    if (p_ctx == nullptr)
+        return AIPU_STATUS_ERROR_INVALID_CTX;
+
+    return p_ctx->get_completion_fd(fd);
+}
+
+aipu_status_t aipu_process_completions(const aipu_ctx_handle_t* ctx, uint32_t* cnt)
+{
+    aipudrv::CtxRefMap& ctx_map = aipudrv::CtxRefMap::get_ctx_map();
+    aipudrv::MainContext* p_ctx = nullptr;
+
+    if ((ctx == nullptr) || (cnt == nullptr))
+        return AIPU_STATUS_ERROR_NULL_PTR;
+
+    p_ctx = ctx_map.get_ctx_ref(ctx->handle);
+    if (p_ctx == nullptr)
+        return AIPU_STATUS_ERROR_INVALID_CTX;
+
+    return p_ctx->process_completions(cnt);
+}
+
 aipu_status_t aipu_clean_job(const aipu_ctx_handle_t* ctx, uint64_t id)
 {
     aipu_status_t ret = AIPU_STATUS_SUCCESS;
@@ -379,12 +446,24 @@ aipu_status_t aipu_get_tensor_descriptor(const aipu_ctx_handle_t* ctx, uint64_t
     aipu_status_t ret = AIPU_STATUS_SUCCESS;
     aipudrv::GraphBase* graph = nullptr;
 
+    aipudrv::JobBase* job = nullptr;
+
     if (ctx == nullptr)
         return AIPU_STATUS_ERROR_NULL_PTR;
 
     if (!aipudrv::valid_graph_id(id))
         return AIPU_STATUS_ERROR_INVALID_GRAPH_ID;
 
+    /* a job reports its own dynamic shape sizes */
+    if (aipudrv::valid_job_id(id))
+    {
+        ret = api_get_job(ctx, id, &job);
+        if (ret != AIPU_STATUS_SUCCESS)
+            return ret;
+
+        return job->get_tensor_descriptor(type, tensor, desc);
+    }
+
     ret = api_get_graph(ctx, aipudrv::get_graph_id(id), &graph);
     if (ret != AIPU_STATUS_SUCCESS)
         return ret;
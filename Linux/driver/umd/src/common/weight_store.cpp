@@ -0,0 +1,121 @@
+// Copyright (C) 2023-2024 Arm Technology (China) Co. Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+/**
+ * @file  weight_store.cpp
+ * @brief AIPU User Mode Driver (UMD) shared weight store module implementation
+ */
+
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include "weight_store.h"
+
+/**
+ * @brief take a reference on an entry of the key whose data matches. the
+ *        candidates are referenced while they are compared out of the lock.
+ */
+bool aipudrv::WeightStore::get(const std::string &key, const Matcher &match,
+    BufferDesc **weight, BufferDesc **zerocpy_const)
+{
+    std::vector<std::multimap<std::string, Entry>::iterator> candidates;
+    bool found = false;
+
+    {
+        std::lock_guard<std::mutex> lock_(m_lock);
+        auto range = m_entries.equal_range(key);
+
+        for (auto iter = range.first; iter != range.second; iter++)
+        {
+            iter->second.refcnt++;
+            candidates.push_back(iter);
+        }
+    }
+
+    for (auto &iter : candidates)
+    {
+        if (!found && match(iter->second.weight, iter->second.zerocpy_const))
+        {
+            *weight = iter->second.weight;
+            *zerocpy_const = iter->second.zerocpy_const;
+            found = true;
+            continue;
+        }
+
+        release(key, iter->second.weight);
+    }
+
+    return found;
+}
+
+/**
+ * @brief add uploaded weight buffers with one reference held by the caller
+ */
+void aipudrv::WeightStore::publish(const std::string &key, MemoryBase *mem,
+    BufferDesc *weight, BufferDesc *zerocpy_const)
+{
+    std::lock_guard<std::mutex> lock_(m_lock);
+    Entry entry = {mem, weight, zerocpy_const, 1};
+
+    m_entries.emplace(key, entry);
+}
+
+void aipudrv::WeightStore::release(const std::string &key, const BufferDesc *weight)
+{
+    std::lock_guard<std::mutex> lock_(m_lock);
+    auto range = m_entries.equal_range(key);
+    auto iter = range.first;
+
+    while ((iter != range.second) && (iter->second.weight != weight))
+        iter++;
+
+    if ((iter == range.second) || (--iter->second.refcnt > 0))
+        return;
+
+    if (iter->second.zerocpy_const != nullptr)
+        iter->second.mem->free(&iter->second.zerocpy_const);
+    if (iter->second.weight != nullptr)
+        iter->second.mem->free(&iter->second.weight);
+    m_entries.erase(iter);
+}
+
+/**
+ * @brief 64-bit hash, four independent multiply-xorshift lanes over 8-byte
+ *        words so that it runs at memory bandwidth. not collision safe, a
+ *        key never stands for the data alone.
+ */
+uint64_t aipudrv::WeightStore::hash(const char *data, uint64_t size, uint64_t seed)
+{
+    constexpr uint64_t PRIME = 0x9E3779B97F4A7C15ULL;
+    uint64_t lane[4] = {seed, seed ^ PRIME, seed + PRIME, ~seed};
+    uint64_t word = 0, result = size * PRIME;
+    uint64_t off = 0;
+
+    for (; off + 4 * sizeof(uint64_t) <= size; off += 4 * sizeof(uint64_t))
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            memcpy(&word, data + off + i * sizeof(uint64_t), sizeof(word));
+            lane[i] = (lane[i] ^ word) * PRIME;
+            lane[i] ^= lane[i] >> 29;
+        }
+    }
+
+    for (; off < size; off += sizeof(uint64_t))
+    {
+        word = 0;
+        memcpy(&word, data + off, std::min((uint64_t)sizeof(word), size - off));
+        lane[0] = (lane[0] ^ word) * PRIME;
+        lane[0] ^= lane[0] >> 29;
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+        result = (result ^ lane[i]) * PRIME;
+        result ^= result >> 32;
+    }
+
+    return result;
+}
@@ -0,0 +1,69 @@
+// Copyright (C) 2023-2024 Arm Technology (China) Co. Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+/**
+ * @file  weight_store.h
+ * @brief AIPU User Mode Driver (UMD) shared weight store module header
+ */
+
+#ifndef _WEIGHT_STORE_H_
+#define _WEIGHT_STORE_H_
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <functional>
+#include "memory_base.h"
+
+namespace aipudrv
+{
+/**
+ * weight buffers of one BSS, keyed by their layout and shared by all
+ * graphs of the process that load the same weights, whichever context
+ * they belong to. graphs of the same layout may have other weights, so
+ * an entry is only taken if its data matches byte for byte. an entry is
+ * published only after its data is uploaded, and its buffers are freed
+ * when the last graph releases it.
+ */
+class WeightStore
+{
+private:
+    struct Entry {
+        MemoryBase *mem;
+        BufferDesc *weight;
+        BufferDesc *zerocpy_const;
+        uint32_t refcnt;
+    };
+    std::multimap<std::string, Entry> m_entries;
+    std::mutex m_lock;
+
+public:
+    /* tells if the data of the buffers is the one of the caller */
+    typedef std::function<bool(const BufferDesc *weight, const BufferDesc *zerocpy_const)> Matcher;
+
+    bool get(const std::string &key, const Matcher &match, BufferDesc **weight,
+        BufferDesc **zerocpy_const);
+    void publish(const std::string &key, MemoryBase *mem, BufferDesc *weight,
+        BufferDesc *zerocpy_const);
+    void release(const std::string &key, const BufferDesc *weight);
+
+public:
+    static uint64_t hash(const char *data, uint64_t size, uint64_t seed);
+    static WeightStore& get_weight_store()
+    {
+        /* never destroyed: graphs may release entries during static destruction */
+        static WeightStore *store = new WeightStore();
+        return *store;
+    }
+    WeightStore(const WeightStore& store) = delete;
+    WeightStore& operator=(const WeightStore& store) = delete;
+
+private:
+    WeightStore() {}
+    ~WeightStore() {}
+};
+}
+
+#endif /* _WEIGHT_STORE_H_ */
@@ -15,6 +15,7 @@
 #include <sys/ioctl.h>
 #include <sys/poll.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include "aipu.h"
 #include "ukmemory.h"
 #include "job_base.h"
@@ -26,11 +27,13 @@ std::mutex aipudrv::Aipu::m_tex;
 aipudrv::Aipu::Aipu()
 {
     m_dev_type = DEV_TYPE_AIPU;
+    pthread_rwlock_init(&m_dma_buf_lock, NULL);
 }
 
 aipudrv::Aipu::~Aipu()
 {
     deinit();
+    pthread_rwlock_destroy(&m_dma_buf_lock);
 }
 
 aipu_ll_status_t aipudrv::Aipu::init()
@@ -131,6 +134,19 @@ void aipudrv::Aipu::deinit()
     if (m_dram != nullptr)
         m_dram = nullptr;
 
+    pthread_rwlock_wrlock(&m_dma_buf_lock);
+    for (auto &iter : m_dma_buf_map)
+    {
+        if (iter.second.va != nullptr)
+            munmap(iter.second.va, iter.second.buf.bytes);
+    }
+    m_dma_buf_map.clear();
+
+    for (auto &iter : m_dma_buf_cache)
+        munmap(iter.second.va, iter.second.buf.bytes);
+    m_dma_buf_cache.clear();
+    pthread_rwlock_unlock(&m_dma_buf_lock);
+
     if (m_fd > 0)
     {
         ioctl_cmd(AIPU_IOCTL_DISABLE_TICK_COUNTER, nullptr);
@@ -210,6 +226,45 @@ aipu_status_t aipudrv::Aipu::schedule(const JobDesc& job)
     return AIPU_STATUS_SUCCESS;
 }
 
+aipu_status_t aipudrv::Aipu::schedule_batch(const std::vector<JobDesc*>& jobs,
+    uint32_t *scheduled_cnt)
+{
+    int kret = 0;
+    aipu_job_batch batch;
+    uint32_t cnt = 0;
+
+    /* reused by the flushes of this thread, it only grows */
+    thread_local std::vector<aipu_job_desc> kdescs;
+
+    *scheduled_cnt = 0;
+    while (*scheduled_cnt < jobs.size())
+    {
+        cnt = std::min((uint32_t)jobs.size() - *scheduled_cnt, (uint32_t)AIPU_JOB_BATCH_MAX_CNT);
+        kdescs.resize(cnt);
+        for (uint32_t i = 0; i < cnt; i++)
+            kdescs[i] = jobs[*scheduled_cnt + i]->kdesc;
+
+        batch.cnt = cnt;
+        batch.scheduled_cnt = 0;
+        batch.jobs = (uint64_t)(uintptr_t)kdescs.data();
+        kret = ioctl(m_fd, AIPU_IOCTL_SCHEDULE_JOB_BATCH, &batch);
+
+        /* KMD without batch support, schedule the rest one by one */
+        if (kret && (errno == ENOTTY) && (*scheduled_cnt == 0))
+            return DeviceBase::schedule_batch(jobs, scheduled_cnt);
+
+        *scheduled_cnt += batch.scheduled_cnt;
+        if (kret)
+        {
+            LOG(LOG_ERR, "schedule job batch [fail], scheduled %u/%u",
+                *scheduled_cnt, (uint32_t)jobs.size());
+            return AIPU_STATUS_ERROR_INVALID_OP;
+        }
+    }
+
+    return AIPU_STATUS_SUCCESS;
+}
+
 aipu_ll_status_t aipudrv::Aipu::get_status(uint32_t max_cnt, bool of_this_thread, void *jobbase)
 {
     aipu_ll_status_t ret = AIPU_LL_STATUS_JOB_NO_DONE;
@@ -219,29 +274,32 @@ aipu_ll_status_t aipudrv::Aipu::get_status(uint32_t max_cnt, bool of_this_thread
     JobBase *done_job = nullptr;
     aipu_job_callback_func_t job_callback_func = nullptr;
 
+    /* reused by the polls of this thread, it only grows */
+    thread_local std::vector<aipu_job_status_desc> status_buf;
+
+    if (status_buf.size() < max_cnt)
+        status_buf.resize(max_cnt);
+
     status_query.of_this_thread = of_this_thread;
     status_query.max_cnt = max_cnt;
-    status_query.status = new aipu_job_status_desc[max_cnt];
+    status_query.status = status_buf.data();
+    status_query.poll_cnt = 0;
     kret = ioctl(m_fd, AIPU_IOCTL_QUERY_STATUS, &status_query);
     if (kret)
     {
         LOG(LOG_ERR, "query job status [fail]");
-        ret = AIPU_LL_STATUS_ERROR_IOCTL_QUERY_STATUS_FAIL;
-        goto clean;
+        return AIPU_LL_STATUS_ERROR_IOCTL_QUERY_STATUS_FAIL;
     }
 
     for (uint32_t i = 0; i < status_query.poll_cnt; i++)
     {
+        /* with of_this_thread unset, the done job may belong to another graph */
         done_job = job->get_base_graph().get_job(status_query.status[i].job_id);
+        if ((done_job == nullptr) && (job->get_ctx() != nullptr))
+            done_job = job->get_ctx()->get_job_object(status_query.status[i].job_id);
         if (done_job != nullptr)
         {
-            /**
-             * it must ensure the job's status changing flow obeys
-             * AIPU_JOB_STATUS_SCHED->AIPU_JOB_STATUS_DONE/EXCEPTION
-             * in asyncronous IO. actually this only costs little time
-             * to toggle status. it's absolutely not a bottleneck.
-             */
-            while (done_job->get_job_status() != AIPU_JOB_STATUS_SCHED);
+            done_job->wait_scheduled();
             done_job->update_job_status(status_query.status[i].state);
             job_callback_func = done_job->get_job_cb();
 
@@ -257,9 +315,6 @@ aipu_ll_status_t aipudrv::Aipu::get_status(uint32_t max_cnt, bool of_this_thread
         }
     }
 
-clean:
-    delete[] status_query.status;
-    status_query.status = nullptr;
     return ret;
 }
 
@@ -276,6 +331,7 @@ aipu_ll_status_t aipudrv::Aipu::poll_status(uint32_t max_cnt, int32_t time_out,
     int kret = 0;
     struct pollfd poll_list;
     JobBase *job = (JobBase *)jobbase;
+    uint32_t status = 0;
 
     /**
      * the laterly committed job maybe finished firstly, but the current polling job
@@ -283,21 +339,32 @@ aipu_ll_status_t aipudrv::Aipu::poll_status(uint32_t max_cnt, int32_t time_out,
      * firstly finished job. so it's necesssary to check the cache queue containing
      * finished job firstly. if there's no target job, switch to poll NPU HW.
      */
-    if (job->get_job_status() == AIPU_JOB_STATUS_DONE)
+    if ((job->get_job_status() == AIPU_JOB_STATUS_DONE) ||
+        (job->get_job_status() == AIPU_JOB_STATUS_EXCEPTION))
         return ret;
 
     poll_list.fd = m_fd;
     poll_list.events = POLLIN | POLLPRI;
 
-    do
+    while (1)
     {
         /**
          * it has to ensure the job is in AIPU_JOB_STATUS_SCHED.
          * if lack the checking and when use specific polling thread which may
          * modify job's status as AIPU_JOB_STATUS_DONE before AIPU_JOB_STATUS_SCHED.
          */
-        if (job->get_job_status() != AIPU_JOB_STATUS_SCHED)
+        status = job->get_job_status();
+        if (status != AIPU_JOB_STATUS_SCHED)
+        {
+            /* ended meanwhile, delivered by another polling thread */
+            if ((status == AIPU_JOB_STATUS_DONE) || (status == AIPU_JOB_STATUS_EXCEPTION))
+                return AIPU_LL_STATUS_SUCCESS;
+
+            /* sleep instead of spinning until the scheduling thread publishes it */
+            if (!job->wait_status_change(status, time_out))
+                return AIPU_LL_STATUS_ERROR_POLL_TIMEOUT;
             continue;
+        }
 
         kret = poll(&poll_list, 1, time_out);
         if (kret < 0)
@@ -315,17 +382,259 @@ aipu_ll_status_t aipudrv::Aipu::poll_status(uint32_t max_cnt, int32_t time_out,
             if (ret == AIPU_LL_STATUS_SUCCESS)
                 return ret;
         }
-    } while (time_out == -1);
+
+        if (time_out != -1)
+            break;
+    }
 
     return ret;
 }
 
+aipu_ll_status_t aipudrv::Aipu::drain_status(std::vector<aipu_job_status_desc>& jobs_status,
+    uint32_t max_cnt)
+{
+    aipu_job_status_query status_query;
+
+    jobs_status.resize(max_cnt);
+    status_query.of_this_thread = 0;
+    status_query.max_cnt = max_cnt;
+    status_query.status = jobs_status.data();
+    status_query.poll_cnt = 0;
+    if (ioctl(m_fd, AIPU_IOCTL_QUERY_STATUS, &status_query))
+    {
+        LOG(LOG_ERR, "query job status [fail]");
+        jobs_status.clear();
+        return AIPU_LL_STATUS_ERROR_IOCTL_QUERY_STATUS_FAIL;
+    }
+
+    jobs_status.resize(status_query.poll_cnt);
+    return AIPU_LL_STATUS_SUCCESS;
+}
+
+static char *map_dma_buf(int fd, uint64_t bytes)
+{
+    char *va = (char *)mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if (va == MAP_FAILED)
+    {
+        LOG(LOG_WARN, "mmap dma_buf fd=%d [fail], map it per access\n", fd);
+        return nullptr;
+    }
+    return va;
+}
+
+void aipudrv::Aipu::track_dma_buf(const struct aipu_dma_buf &dma_buf)
+{
+    std::string name = "dmabuf_fd_" + std::to_string(dma_buf.fd);
+    DmaBufEntry entry;
+
+    entry.buf = dma_buf;
+    entry.va = map_dma_buf(dma_buf.fd, dma_buf.bytes);
+
+    pthread_rwlock_wrlock(&m_dma_buf_lock);
+    m_dma_buf_map[dma_buf.fd] = entry;
+    pthread_rwlock_unlock(&m_dma_buf_lock);
+
+    /* it may have been accessed as an IO buffer before */
+    release_dma_buf(dma_buf.fd);
+
+    m_dram->add_tracking(dma_buf.pa, dma_buf.bytes, MemOperationAlloc, name.c_str(), false, 0);
+}
+
+bool aipudrv::Aipu::untrack_dma_buf(int fd)
+{
+    std::string name = "dmabuf_fd_" + std::to_string(fd);
+    DmaBufEntry entry;
+
+    pthread_rwlock_wrlock(&m_dma_buf_lock);
+    if (m_dma_buf_map.count(fd) == 0)
+    {
+        pthread_rwlock_unlock(&m_dma_buf_lock);
+        return false;
+    }
+
+    entry = m_dma_buf_map[fd];
+    if (entry.va != nullptr)
+        munmap(entry.va, entry.buf.bytes);
+    m_dma_buf_map.erase(fd);
+    pthread_rwlock_unlock(&m_dma_buf_lock);
+
+    m_dram->add_tracking(entry.buf.pa, entry.buf.bytes, MemOperationFree, name.c_str(), false, 0);
+    return true;
+}
+
+/**
+ * @brief drop the mapping of a tracked dma_buf but keep tracking it, so
+ *        that it can be mapped again if the kernel doesn't free it
+ */
+bool aipudrv::Aipu::unmap_dma_buf(int fd)
+{
+    std::map<int, DmaBufEntry>::iterator iter;
+    bool tracked = false;
+
+    pthread_rwlock_wrlock(&m_dma_buf_lock);
+    iter = m_dma_buf_map.find(fd);
+    if (iter != m_dma_buf_map.end())
+    {
+        if (iter->second.va != nullptr)
+            munmap(iter->second.va, iter->second.buf.bytes);
+        iter->second.va = nullptr;
+        tracked = true;
+    }
+    pthread_rwlock_unlock(&m_dma_buf_lock);
+
+    return tracked;
+}
+
+void aipudrv::Aipu::remap_dma_buf(int fd)
+{
+    std::map<int, DmaBufEntry>::iterator iter;
+
+    pthread_rwlock_wrlock(&m_dma_buf_lock);
+    iter = m_dma_buf_map.find(fd);
+    if ((iter != m_dma_buf_map.end()) && (iter->second.va == nullptr))
+        iter->second.va = map_dma_buf(fd, iter->second.buf.bytes);
+    pthread_rwlock_unlock(&m_dma_buf_lock);
+}
+
+/**
+ * @brief map a whole dma_buf which UMD doesn't track. the fd is owned by
+ *        the application and its number may be reused for another dma_buf,
+ *        so an entry is only valid for the inode it was mapped for.
+ */
+bool aipudrv::Aipu::cache_dma_buf(int fd, uint64_t ino)
+{
+    std::map<int, DmaBufEntry>::iterator iter;
+    DmaBufEntry entry;
+    off_t bytes = lseek(fd, 0, SEEK_END);
+
+    /* the file size of a dma_buf is its size */
+    if (bytes <= 0)
+        return false;
+
+    entry.buf.fd = fd;
+    entry.buf.bytes = bytes;
+    entry.ino = ino;
+    entry.va = map_dma_buf(fd, bytes);
+    if (entry.va == nullptr)
+        return false;
+
+    pthread_rwlock_wrlock(&m_dma_buf_lock);
+    iter = m_dma_buf_cache.find(fd);
+    if (iter != m_dma_buf_cache.end())
+    {
+        munmap(iter->second.va, iter->second.buf.bytes);
+        m_dma_buf_cache.erase(iter);
+    }
+    m_dma_buf_cache[fd] = entry;
+    pthread_rwlock_unlock(&m_dma_buf_lock);
+
+    return true;
+}
+
+void aipudrv::Aipu::release_dma_buf(int fd)
+{
+    std::map<int, DmaBufEntry>::iterator iter;
+
+    pthread_rwlock_wrlock(&m_dma_buf_lock);
+    iter = m_dma_buf_cache.find(fd);
+    if (iter != m_dma_buf_cache.end())
+    {
+        munmap(iter->second.va, iter->second.buf.bytes);
+        m_dma_buf_cache.erase(iter);
+    }
+    pthread_rwlock_unlock(&m_dma_buf_lock);
+}
+
+aipu_ll_status_t aipudrv::Aipu::readwrite_cached_dma_buf(int fd, uint64_t offset, void *data,
+    uint64_t size, bool write)
+{
+    aipu_ll_status_t ret = AIPU_LL_STATUS_SUCCESS;
+    std::map<int, DmaBufEntry>::iterator iter;
+    struct stat finfo;
+    bool cached = false;
+
+    if (fstat(fd, &finfo) != 0)
+        return AIPU_LL_STATUS_ERROR_IOCTL_FAIL;
+
+    for (int i = 0; i < 2; i++)
+    {
+        pthread_rwlock_rdlock(&m_dma_buf_lock);
+        iter = m_dma_buf_cache.find(fd);
+        cached = (iter != m_dma_buf_cache.end()) && (iter->second.ino == (uint64_t)finfo.st_ino);
+        if (cached)
+            break;
+        pthread_rwlock_unlock(&m_dma_buf_lock);
+
+        if ((i > 0) || !cache_dma_buf(fd, finfo.st_ino))
+            return DeviceBase::readwrite_dma_buf(fd, offset, data, size, write);
+    }
+
+    if (offset + size > iter->second.buf.bytes)
+    {
+        LOG(LOG_ERR, "dma_buf fd=%d: access beyond dma_buf scope\n", fd);
+        ret = AIPU_LL_STATUS_ERROR_IOCTL_FAIL;
+        goto unlock;
+    }
+
+    dma_buf_sync(fd, true, write);
+    if (write)
+        memcpy(iter->second.va + offset, data, size);
+    else
+        memcpy(data, iter->second.va + offset, size);
+    dma_buf_sync(fd, false, write);
+
+unlock:
+    pthread_rwlock_unlock(&m_dma_buf_lock);
+    return ret;
+}
+
+aipu_ll_status_t aipudrv::Aipu::readwrite_dma_buf(int fd, uint64_t offset, void *data,
+    uint64_t size, bool write)
+{
+    aipu_ll_status_t ret = AIPU_LL_STATUS_SUCCESS;
+    std::map<int, DmaBufEntry>::iterator iter;
+
+    pthread_rwlock_rdlock(&m_dma_buf_lock);
+    iter = m_dma_buf_map.find(fd);
+    if (iter == m_dma_buf_map.end())
+    {
+        /* kept mapped until the jobs specifying it are destroyed */
+        pthread_rwlock_unlock(&m_dma_buf_lock);
+        return readwrite_cached_dma_buf(fd, offset, data, size, write);
+    }
+
+    if (iter->second.va == nullptr)
+    {
+        pthread_rwlock_unlock(&m_dma_buf_lock);
+        return DeviceBase::readwrite_dma_buf(fd, offset, data, size, write);
+    }
+
+    if (offset + size > iter->second.buf.bytes)
+    {
+        LOG(LOG_ERR, "dma_buf fd=%d: access beyond dma_buf scope\n", fd);
+        ret = AIPU_LL_STATUS_ERROR_IOCTL_FAIL;
+        goto unlock;
+    }
+
+    dma_buf_sync(fd, true, write);
+    if (write)
+        memcpy(iter->second.va + offset, data, size);
+    else
+        memcpy(data, iter->second.va + offset, size);
+    dma_buf_sync(fd, false, write);
+
+unlock:
+    pthread_rwlock_unlock(&m_dma_buf_lock);
+    return ret;
+}
+
 #define WRITE_DMABUF 1
-aipu_ll_status_t readwrite_dmabuf_helper(int devfd, aipu_dmabuf_op_t *dmabuf_op, bool write)
+aipu_ll_status_t aipudrv::Aipu::readwrite_dmabuf_helper(aipu_dmabuf_op_t *dmabuf_op, bool write)
 {
     aipu_ll_status_t ret = AIPU_LL_STATUS_ERROR_IOCTL_FAIL;
     struct aipu_dma_buf dma_buf = {0};
-    char *va = nullptr;
+    bool tracked = false;
     int kret = 0;
 
     dma_buf.fd = dmabuf_op->dmabuf_fd;
@@ -335,34 +644,31 @@ aipu_ll_status_t readwrite_dmabuf_helper(int devfd, aipu_dmabuf_op_t *dmabuf_op,
         goto out;
     }
 
-    kret = ioctl(devfd, AIPU_IOCTL_GET_DMA_BUF_INFO, &dma_buf);
-    if (kret < 0)
-    {
-        LOG(LOG_ERR, "dmabuf_op: query dma_buf [fail]");
-        goto out;
-    }
+    pthread_rwlock_rdlock(&m_dma_buf_lock);
+    tracked = (m_dma_buf_map.count(dma_buf.fd) != 0);
+    pthread_rwlock_unlock(&m_dma_buf_lock);
 
-    if (dmabuf_op->offset_in_dmabuf + dmabuf_op->size > dma_buf.bytes)
+    /* a tracked dma_buf is range checked against its cached info */
+    if (!tracked)
     {
-        LOG(LOG_ERR, "dmabuf_op: access beyond dma_buf scope");
-        goto out;
-    }
+        kret = ioctl(m_fd, AIPU_IOCTL_GET_DMA_BUF_INFO, &dma_buf);
+        if (kret < 0)
+        {
+            LOG(LOG_ERR, "dmabuf_op: query dma_buf [fail]");
+            goto out;
+        }
 
-    va = (char *)mmap(NULL, dma_buf.bytes, PROT_READ|PROT_WRITE, MAP_SHARED,
-        dmabuf_op->dmabuf_fd, 0);
-    if (va == MAP_FAILED)
-    {
-        LOG(LOG_ERR, "dmabuf_op: mmap dmabuf [fail]");
-        goto out;
+        if (dmabuf_op->offset_in_dmabuf + dmabuf_op->size > dma_buf.bytes)
+        {
+            LOG(LOG_ERR, "dmabuf_op: access beyond dma_buf scope");
+            goto out;
+        }
     }
 
-    if (write)
-        memcpy(va + dmabuf_op->offset_in_dmabuf, dmabuf_op->data, dmabuf_op->size);
-    else
-        memcpy(dmabuf_op->data, va + dmabuf_op->offset_in_dmabuf, dmabuf_op->size);
-
-    munmap(va, dma_buf.bytes);
-    ret = AIPU_LL_STATUS_SUCCESS;
+    ret = readwrite_dma_buf(dmabuf_op->dmabuf_fd, dmabuf_op->offset_in_dmabuf,
+        dmabuf_op->data, dmabuf_op->size, write);
+    if (ret != AIPU_LL_STATUS_SUCCESS)
+        LOG(LOG_ERR, "dmabuf_op: access dmabuf [fail]");
 
 out:
     return ret;
@@ -441,31 +747,30 @@ aipu_ll_status_t aipudrv::Aipu::ioctl_cmd(uint32_t cmd, void *arg)
                 ret = AIPU_LL_STATUS_ERROR_IOCTL_FAIL;
                 goto out;
             }
-            name = "dmabuf_fd_" + std::to_string(dma_buf.fd);
-            m_dma_buf_map[dma_buf.fd] = dma_buf;
-            m_dram->add_tracking(dma_buf.pa, dma_buf.bytes,
-                MemOperationAlloc, name.c_str(), false, 0);
+            track_dma_buf(dma_buf);
             }
             break;
 
         case AIPU_IOCTL_FREE_DMABUF:
             {
             int dma_buf_fd = *(int *)arg;
+            /* drop the mappings first, they hold a reference of the dma_buf */
+            bool tracked = unmap_dma_buf(dma_buf_fd);
+
+            release_dma_buf(dma_buf_fd);
             kret = ioctl(m_fd, AIPU_IOCTL_FREE_DMA_BUF, &dma_buf_fd);
             if (kret < 0)
             {
+                /* the dma_buf is still alive, keep tracking it */
                 LOG(LOG_ERR, "free dma_buf [fail], fd=%d", dma_buf_fd);
+                remap_dma_buf(dma_buf_fd);
                 ret = AIPU_LL_STATUS_ERROR_IOCTL_FAIL;
                 goto out;
             }
 
-            if (m_dma_buf_map.count(dma_buf_fd) == 1)
+            if (tracked)
             {
-                struct aipu_dma_buf dma_buf = m_dma_buf_map[dma_buf_fd];
-                std::string name = "dmabuf_fd_" + std::to_string(dma_buf.fd);
-                m_dram->add_tracking(dma_buf.pa, dma_buf.bytes,
-                    MemOperationFree, name.c_str(), false, 0);
-                m_dma_buf_map.erase(dma_buf_fd);
+                untrack_dma_buf(dma_buf_fd);
                 close(dma_buf_fd);
             }
             }
@@ -481,17 +786,16 @@ aipu_ll_status_t aipudrv::Aipu::ioctl_cmd(uint32_t cmd, void *arg)
             break;
 
         case AIPU_IOCTL_WRITE_DMABUF:
-            ret = readwrite_dmabuf_helper(m_fd, (aipu_dmabuf_op_t *)arg, WRITE_DMABUF);
+            ret = readwrite_dmabuf_helper((aipu_dmabuf_op_t *)arg, WRITE_DMABUF);
             break;
 
         case AIPU_IOCTL_READ_DMABUF:
-            ret = readwrite_dmabuf_helper(m_fd, (aipu_dmabuf_op_t *)arg, !WRITE_DMABUF);
+            ret = readwrite_dmabuf_helper((aipu_dmabuf_op_t *)arg, !WRITE_DMABUF);
             break;
 
         case AIPU_IOCTL_ATTACH_DMABUF:
             {
                 struct aipu_dma_buf *dma_buf = (struct aipu_dma_buf *)arg;
-                std::string name;
 
                 kret = ioctl(m_fd, AIPU_IOCTL_ATTACH_DMA_BUF, dma_buf);
                 if (kret < 0)
@@ -500,10 +804,7 @@ aipu_ll_status_t aipudrv::Aipu::ioctl_cmd(uint32_t cmd, void *arg)
                     ret = AIPU_LL_STATUS_ERROR_IOCTL_FAIL;
                     goto out;
                 }
-                name = "dmabuf_fd_" + std::to_string(dma_buf->fd);
-                m_dma_buf_map[dma_buf->fd] = *dma_buf;
-                m_dram->add_tracking(dma_buf->pa, dma_buf->bytes,
-                    MemOperationAlloc, name.c_str(), false, 0);
+                track_dma_buf(*dma_buf);
                 break;
             }
 
@@ -519,14 +820,7 @@ aipu_ll_status_t aipudrv::Aipu::ioctl_cmd(uint32_t cmd, void *arg)
                     goto out;
                 }
 
-                if (m_dma_buf_map.count(dmabuf_fd) == 1)
-                {
-                    struct aipu_dma_buf dma_buf = m_dma_buf_map[dmabuf_fd];
-                    std::string name = "dmabuf_fd_" + std::to_string(dma_buf.fd);
-                    m_dram->add_tracking(dma_buf.pa, dma_buf.bytes,
-                        MemOperationFree, name.c_str(), false, 0);
-                    m_dma_buf_map.erase(dmabuf_fd);
-                }
+                untrack_dma_buf(dmabuf_fd);
                 break;
             }
         case AIPU_IOCTL_GET_VERSION:
@@ -13,6 +13,7 @@
 
 #include <vector>
 #include <mutex>
+#include <pthread.h>
 #include "device_base.h"
 #include "type.h"
 #include "ukmemory.h"
@@ -24,14 +25,28 @@ class Aipu : public DeviceBase
 protected:
     int m_fd = 0;
     bool m_tick_counter = false;
+    pthread_rwlock_t m_dma_buf_lock;
+
+    /* mappings of dma_bufs specified as IO buffers without being attached */
+    std::map<int, DmaBufEntry> m_dma_buf_cache;
 
 private:
     aipu_ll_status_t init();
     void deinit();
+    void track_dma_buf(const struct aipu_dma_buf &dma_buf);
+    bool untrack_dma_buf(int fd);
+    bool unmap_dma_buf(int fd);
+    void remap_dma_buf(int fd);
+    bool cache_dma_buf(int fd, uint64_t ino);
+    aipu_ll_status_t readwrite_cached_dma_buf(int fd, uint64_t offset, void *data,
+        uint64_t size, bool write);
+    aipu_ll_status_t readwrite_dmabuf_helper(aipu_dmabuf_op_t *dmabuf_op, bool write);
 
 public:
     virtual bool has_target(uint32_t arch, uint32_t version, uint32_t config, uint32_t rev);
     virtual aipu_status_t schedule(const JobDesc& job);
+    virtual aipu_status_t schedule_batch(const std::vector<JobDesc*>& jobs,
+        uint32_t *scheduled_cnt);
     virtual aipu_ll_status_t read_reg(uint32_t core_id, uint32_t offset, uint32_t* value);
     virtual aipu_ll_status_t write_reg(uint32_t core_id, uint32_t offset, uint32_t value);
     aipu_ll_status_t get_status(uint32_t max_cnt, bool of_this_thread, void *jobbase = nullptr);
@@ -39,9 +54,18 @@ public:
         uint32_t max_cnt, void *jobbase = nullptr);
     virtual aipu_ll_status_t poll_status(uint32_t max_cnt, int32_t time_out,
         bool of_this_thread, void *jobbase = nullptr);
+    virtual aipu_ll_status_t drain_status(std::vector<aipu_job_status_desc>& jobs_status,
+        uint32_t max_cnt);
+    virtual int get_poll_fd()
+    {
+        return m_fd;
+    }
 
 public:
     virtual aipu_ll_status_t ioctl_cmd(uint32_t cmd, void *arg);
+    virtual aipu_ll_status_t readwrite_dma_buf(int fd, uint64_t offset, void *data,
+        uint64_t size, bool write);
+    virtual void release_dma_buf(int fd);
     virtual int get_grid_id(uint16_t &grid_id);
     virtual int get_start_group_id(int group_cnt, uint16_t &start_group_id);
 
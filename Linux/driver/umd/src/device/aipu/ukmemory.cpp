@@ -22,7 +22,14 @@
 
 aipudrv::UKMemory::UKMemory(int fd): MemoryBase()
 {
+    /**
+     * freed buffer cache size (MB), 0 (default): disable the cache
+     */
+    const char *cache_sz = getenv("UMD_BUF_CACHE_SZ");
+
     m_fd = fd;
+    if (cache_sz != nullptr)
+        m_buf_cache_hwm = strtoul(cache_sz, nullptr, 10) * MB_SIZE;
 }
 
 aipudrv::UKMemory::~UKMemory()
@@ -30,6 +37,75 @@ aipudrv::UKMemory::~UKMemory()
     free_all();
 }
 
+int aipudrv::UKMemory::release_buffer(char *va, aipu_buf_desc &kdesc)
+{
+    munmap(va, kdesc.bytes);
+    return ioctl(m_fd, AIPU_IOCTL_FREE_BUF, &kdesc);
+}
+
+bool aipudrv::UKMemory::cache_get(const BufCacheKey &key, CachedBuffer &cbuf)
+{
+    auto iter = m_buf_cache.find(key);
+
+    if (iter == m_buf_cache.end())
+        return false;
+
+    cbuf = iter->second.back();
+    iter->second.pop_back();
+    if (iter->second.empty())
+        m_buf_cache.erase(iter);
+    m_buf_cache_bytes -= cbuf.kdesc.bytes;
+
+    return true;
+}
+
+/**
+ * move a buffer whose last reference is gone to the cache,
+ * return false if the caller should give it back to KMD. the caller
+ * drops its m_buf_info entry once it is cached or given back.
+ */
+bool aipudrv::UKMemory::cache_put(DEV_PA_64 pa)
+{
+    auto iter = m_buf_info.find(pa);
+
+    if ((iter == m_buf_info.end()) ||
+        (m_buf_cache_bytes + iter->second.kdesc.bytes > m_buf_cache_hwm))
+        return false;
+
+    m_buf_cache[iter->second.key].push_back(iter->second);
+    m_buf_cache_bytes += iter->second.kdesc.bytes;
+
+    return true;
+}
+
+/* release the largest cached buffers first until at most 'keep_bytes' remain */
+void aipudrv::UKMemory::cache_trim(uint64_t keep_bytes)
+{
+    while ((m_buf_cache_bytes > keep_bytes) && !m_buf_cache.empty())
+    {
+        auto iter = std::prev(m_buf_cache.end());
+        CachedBuffer &cbuf = iter->second.back();
+
+        if (release_buffer(cbuf.va, cbuf.kdesc) != 0)
+            LOG(LOG_ERR, "free buffer 0x%llx [fail]", cbuf.kdesc.pa);
+
+        m_buf_cache_bytes -= cbuf.kdesc.bytes;
+        iter->second.pop_back();
+        if (iter->second.empty())
+            m_buf_cache.erase(iter);
+    }
+}
+
+aipu_status_t aipudrv::UKMemory::trim_cache(uint64_t *keep_bytes)
+{
+    pthread_rwlock_wrlock(&m_lock);
+    cache_trim(*keep_bytes);
+    *keep_bytes = m_buf_cache_bytes;
+    pthread_rwlock_unlock(&m_lock);
+
+    return AIPU_STATUS_SUCCESS;
+}
+
 aipu_status_t aipudrv::UKMemory::malloc(uint32_t size, uint32_t align, BufferDesc** desc,
     const char* str, uint32_t asid_mem_cfg)
 {
@@ -38,6 +114,9 @@ aipu_status_t aipudrv::UKMemory::malloc(uint32_t size, uint32_t align, BufferDes
     char* ptr = nullptr;
     unsigned long cmd = AIPU_IOCTL_REQ_BUF, free_cmd = AIPU_IOCTL_FREE_BUF;
     aipu_buf_request buf_req = {0};
+    CachedBuffer cbuf;
+    BufCacheKey key;
+    bool retry = false;
     DEV_PA_64 base = 0;
 
     buf_req.bytes = size;
@@ -60,19 +139,43 @@ aipu_status_t aipudrv::UKMemory::malloc(uint32_t size, uint32_t align, BufferDes
     if ((str != nullptr) && (!strncmp(str, "tcbs", 4)))
         buf_req.data_type = AIPU_MM_DATA_TYPE_TCB;
 
-    kret = ioctl(m_fd, cmd, &buf_req);
-    if (kret != 0)
+    key = std::make_tuple(get_page_cnt(size), buf_req.align_in_page,
+        asid_mem_cfg & 0xffff, buf_req.data_type);
+    pthread_rwlock_wrlock(&m_lock);
+    if (cache_get(key, cbuf))
     {
-        LOG(LOG_ALERT, "alloc buffer: size 0x%x [fail]", size);
-        return AIPU_STATUS_ERROR_BUF_ALLOC_FAIL;
+        buf_req.desc = cbuf.kdesc;
+        ptr = cbuf.va;
     }
+    pthread_rwlock_unlock(&m_lock);
 
-    ptr = (char*)mmap(NULL, buf_req.desc.bytes, PROT_READ | PROT_WRITE, MAP_SHARED,
-        m_fd, buf_req.desc.dev_offset);
-    if (ptr == MAP_FAILED)
+    if (ptr == nullptr)
     {
-        ioctl(m_fd, free_cmd, &buf_req.desc);
-        return AIPU_STATUS_ERROR_BUF_ALLOC_FAIL;
+        kret = ioctl(m_fd, cmd, &buf_req);
+        if (kret != 0)
+        {
+            /* cached buffers may hold the memory we need */
+            pthread_rwlock_wrlock(&m_lock);
+            retry = (m_buf_cache_bytes != 0);
+            cache_trim(0);
+            pthread_rwlock_unlock(&m_lock);
+            if (retry)
+                kret = ioctl(m_fd, cmd, &buf_req);
+        }
+
+        if (kret != 0)
+        {
+            LOG(LOG_ALERT, "alloc buffer: size 0x%x [fail]", size);
+            return AIPU_STATUS_ERROR_BUF_ALLOC_FAIL;
+        }
+
+        ptr = (char*)mmap(NULL, buf_req.desc.bytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+            m_fd, buf_req.desc.dev_offset);
+        if (ptr == MAP_FAILED)
+        {
+            ioctl(m_fd, free_cmd, &buf_req.desc);
+            return AIPU_STATUS_ERROR_BUF_ALLOC_FAIL;
+        }
     }
 
     /**
@@ -91,8 +194,12 @@ aipu_status_t aipudrv::UKMemory::malloc(uint32_t size, uint32_t align, BufferDes
         buf_req.desc.region);
 
     buf.init(ptr, *desc);
+    cbuf.key = key;
+    cbuf.kdesc = buf_req.desc;
+    cbuf.va = ptr;
     pthread_rwlock_wrlock(&m_lock);
     m_allocated[buf_req.desc.pa] = buf;
+    m_buf_info[buf_req.desc.pa] = cbuf;
     pthread_rwlock_unlock(&m_lock);
     add_tracking(buf_req.desc.pa, size, MemOperationAlloc, str, false, 0);
 
@@ -105,7 +212,6 @@ aipu_status_t aipudrv::UKMemory::free(BufferDesc** desc, const char* str)
     int kret = 0;
     aipu_buf_desc kdesc;
     auto iter = m_allocated.begin();
-    unsigned long free_cmd = AIPU_IOCTL_FREE_BUF;
     DEV_PA_64 pa = 0;
     uint64_t size = 0;
 
@@ -126,8 +232,8 @@ aipu_status_t aipudrv::UKMemory::free(BufferDesc** desc, const char* str)
     {
         kdesc.pa = (*desc)->pa;
         kdesc.bytes = (*desc)->size;
-        munmap(iter->second.va, kdesc.bytes);
-        kret = ioctl(m_fd, free_cmd, &kdesc);
+        if (!cache_put(kdesc.pa))
+            kret = release_buffer(iter->second.va, kdesc);
         if (kret != 0)
         {
             LOG(LOG_ERR, "free buffer 0x%lx [fail]", (*desc)->pa);
@@ -136,6 +242,7 @@ aipu_status_t aipudrv::UKMemory::free(BufferDesc** desc, const char* str)
         }
 
         LOG(LOG_INFO, "free buffer_pa=%lx\n", iter->second.desc->pa);
+        m_buf_info.erase((*desc)->pa);
         m_allocated.erase((*desc)->pa);
         pa = (*desc)->pa;
         size = (*desc)->size;
@@ -159,7 +266,6 @@ aipu_status_t aipudrv::UKMemory::free_phybuffer(BufferDesc* desc, const char* st
     int kret = 0;
     aipu_buf_desc kdesc;
     auto iter = m_allocated.begin();
-    unsigned long free_cmd = AIPU_IOCTL_FREE_BUF;
     DEV_PA_64 pa = 0;
     uint64_t size = 0;
 
@@ -180,8 +286,8 @@ aipu_status_t aipudrv::UKMemory::free_phybuffer(BufferDesc* desc, const char* st
     {
         kdesc.pa = desc->pa;
         kdesc.bytes = desc->size;
-        munmap(iter->second.va, kdesc.bytes);
-        kret = ioctl(m_fd, free_cmd, &kdesc);
+        if (!cache_put(kdesc.pa))
+            kret = release_buffer(iter->second.va, kdesc);
         if (kret != 0)
         {
             LOG(LOG_ERR, "free buffer 0x%lx [fail]", desc->pa);
@@ -190,6 +296,7 @@ aipu_status_t aipudrv::UKMemory::free_phybuffer(BufferDesc* desc, const char* st
         }
 
         LOG(LOG_INFO, "free buffer_pa=%lx\n", iter->second.desc->pa);
+        m_buf_info.erase(desc->pa);
         m_allocated.erase(desc->pa);
         pa = desc->pa;
         size = desc->size;
@@ -226,8 +333,7 @@ aipu_status_t aipudrv::UKMemory::free_all(void)
         pa = desc->pa;
         kdesc.bytes = desc->size;
         size = desc->size;
-        munmap(iter->second.va, kdesc.bytes);
-        kret = ioctl(m_fd, AIPU_IOCTL_FREE_BUF, &kdesc);
+        kret = release_buffer(iter->second.va, kdesc);
         if (kret != 0)
         {
             LOG(LOG_ERR, "free buffer 0x%lx [fail]", desc->pa);
@@ -242,6 +348,8 @@ aipu_status_t aipudrv::UKMemory::free_all(void)
     }
 
     m_allocated.clear();
+    m_buf_info.clear();
+    cache_trim(0);
     pthread_rwlock_unlock(&m_lock);
     return ret;
 }
\ No newline at end of file
@@ -12,17 +12,48 @@
 #define _UKMEMORY_H_
 
 #include <map>
+#include <tuple>
+#include <vector>
 #include <pthread.h>
 #include "memory_base.h"
 
 namespace aipudrv
 {
 
+/* default high-water mark of the freed buffer cache, env UMD_BUF_CACHE_SZ (MB), 0: disabled */
+#define BUF_CACHE_DEFAULT_SZ (0UL)
+
+/* page count, align in page, asid_mem_cfg, data type */
+typedef std::tuple<uint64_t, uint32_t, uint32_t, uint32_t> BufCacheKey;
+
+/**
+ * a buffer got from KMD, once freed it stays mapped in the cache and is
+ * handed out again for the next request with an identical key instead of
+ * REQ_BUF + mmap.
+ */
+struct CachedBuffer {
+    BufCacheKey key;
+    aipu_buf_desc kdesc;
+    char *va;
+};
+
 class UKMemory: public MemoryBase
 {
 private:
     int m_fd = 0;
 
+    /* buffers in use and freed buffers kept for reuse, protected by m_lock */
+    std::map<DEV_PA_64, CachedBuffer> m_buf_info;
+    std::map<BufCacheKey, std::vector<CachedBuffer>> m_buf_cache;
+    uint64_t m_buf_cache_bytes = 0;
+    uint64_t m_buf_cache_hwm = BUF_CACHE_DEFAULT_SZ;
+
+private:
+    bool cache_get(const BufCacheKey &key, CachedBuffer &cbuf);
+    bool cache_put(DEV_PA_64 pa);
+    void cache_trim(uint64_t keep_bytes);
+    int release_buffer(char *va, aipu_buf_desc &kdesc);
+
 public:
     virtual aipu_status_t malloc(uint32_t size, uint32_t align, BufferDesc** desc,
         const char* str = nullptr, uint32_t asid_mem_cfg = 0);
@@ -31,6 +62,7 @@ public:
     virtual aipu_status_t reserve_mem(DEV_PA_32 addr, uint32_t size, BufferDesc** desc,
         const char* str = nullptr);
     aipu_status_t free_all(void);
+    virtual aipu_status_t trim_cache(uint64_t *keep_bytes);
     virtual int64_t read(uint64_t addr, void *dest, size_t size) const
     {
         return mem_read(addr, dest, size);
@@ -8,9 +8,14 @@
  * @brief AIPU User Mode Driver (UMD) zhouyi z1/2/3 simulator module implementation
  */
 
+#include <cerrno>
 #include <cstring>
 #include <iomanip>
 #include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
 #include "simulator.h"
 #include "parser_base.h"
 #include "utils/helper.h"
@@ -20,13 +25,30 @@ aipudrv::Simulator::Simulator()
 {
     m_dev_type = DEV_TYPE_SIMULATOR_V1V2;
     m_dram = UMemory::get_memory();
+
+    /* UMemory only shares its memory if UMD_SIM_SERVER is set */
+    m_use_server = (get_umemory()->get_shm_fd() >= 0);
 }
 
 aipudrv::Simulator::~Simulator()
 {
+    stop_sim_server();
     m_dram = nullptr;
 }
 
+/**
+ * with a simulator server the data stays in shared memory, the entry
+ * carries its size instead of a file name
+ */
+static void put_data_entry(std::ostringstream& ofs, const char* key, uint32_t idx,
+    const std::string& fname, uint32_t size)
+{
+    if (fname.empty())
+        ofs << key << "_SIZE" << std::dec << idx << "=0x" << std::hex << size << "\n";
+    else
+        ofs << key << "_FILE" << std::dec << idx << "=" << fname << "\n";
+}
+
 bool aipudrv::Simulator::has_target(uint32_t arch, uint32_t version, uint32_t config, uint32_t rev)
 {
     aipu_partition_cap aipu_cap = {0};
@@ -49,22 +71,27 @@ bool aipudrv::Simulator::has_target(uint32_t arch, uint32_t version, uint32_t co
 aipu_status_t aipudrv::Simulator::create_simulation_input_file(char* fname, const char* interfix,
     JOB_ID id, DEV_PA_64 pa, uint32_t size, const JobDesc& job)
 {
+    if (m_use_server)
+    {
+        fname[0] = '\0';
+        return AIPU_STATUS_SUCCESS;
+    }
+
     snprintf(fname, FNAME_LEN, "%s/Simulation_JOB0x%lx_%s_Base0x%lx_Size0x%x.bin",
         job.output_dir.c_str(), id, interfix, pa, size);
     return m_dram->dump_file(pa, fname, size);
 }
 
-aipu_status_t aipudrv::Simulator::update_simulation_rtcfg(const JobDesc& job, SimulationJobCtx& ctx)
+aipu_status_t aipudrv::Simulator::update_simulation_rtcfg(const JobDesc& job, SimulationJobCtx& ctx,
+    std::ostringstream& ofs)
 {
     aipu_status_t ret = AIPU_STATUS_SUCCESS;
     char fname[FNAME_LEN];
-    std::string cfg_fname = job.output_dir + "/runtime.cfg";
     uint32_t input_data_cnt;
     uint32_t weight_cnt = 0, zerocpy_const_cnt = 0, dcr_cnt = 0;
     uint32_t input_file_idx = 0;
     uint32_t output_idx = 0;
     std::vector<std::string> reuse_outputs;
-    FileWrapper ofs(cfg_fname, std::ios::app);
 
     /* text */
     ret = create_simulation_input_file(fname, "Text", job.kdesc.job_id,
@@ -179,6 +206,9 @@ aipu_status_t aipudrv::Simulator::update_simulation_rtcfg(const JobDesc& job, Si
     /* misc output */
     for (auto item : job.misc_outputs)
     {
+        if (m_use_server)
+            break;
+
         auto &buf = item.second;
         ret = m_dram->dump_file(buf.pa, item.first.c_str(), buf.size);
         if (ret != AIPU_STATUS_SUCCESS)
@@ -251,7 +281,7 @@ aipu_status_t aipudrv::Simulator::update_simulation_rtcfg(const JobDesc& job, Si
 
     ofs << "\n";
     ofs << "INPUT_INST_CNT=1\n";
-    ofs << "INPUT_INST_FILE0=" << ctx.text << "\n";
+    put_data_entry(ofs, "INPUT_INST", 0, ctx.text, job.text_size);
     ofs << "INPUT_INST_BASE0=0x" << std::hex << job.instruction_base_pa << "\n";
     ofs << "INPUT_INST_STARTPC0=0x" << std::hex << job.kdesc.start_pc_addr << "\n";
     ofs << "INT_PC=0x" << std::hex << job.kdesc.intr_handler_addr << "\n";
@@ -260,17 +290,16 @@ aipu_status_t aipudrv::Simulator::update_simulation_rtcfg(const JobDesc& job, Si
 
     ofs << "\n";
     ofs << "INPUT_DATA_CNT=" << std::dec <<  input_data_cnt << "\n";
-    ofs << "INPUT_DATA_FILE0=" << ctx.rodata << "\n";
+    put_data_entry(ofs, "INPUT_DATA", 0, ctx.rodata, job.rodata_size);
     ofs << "INPUT_DATA_BASE0=0x" << std::hex << job.kdesc.data_0_addr << "\n";
 
-    ofs << "INPUT_DATA_FILE1=" << ctx.stack << "\n";
+    put_data_entry(ofs, "INPUT_DATA", 1, ctx.stack, job.stack_size);
     ofs << "INPUT_DATA_BASE1=0x" << std::hex << job.kdesc.data_1_addr << "\n";
 
     input_file_idx = 2;
     if (dcr_cnt == 1)
     {
-        ofs << "INPUT_DATA_FILE" << std::dec << input_file_idx
-            <<  "=" << ctx.dcr << "\n";
+        put_data_entry(ofs, "INPUT_DATA", input_file_idx, ctx.dcr, job.dcr_size);
         ofs << "INPUT_DATA_BASE" << std::dec << input_file_idx
             <<  "=0x" << std::hex <<job.dcr_pa << "\n";
         input_file_idx++;
@@ -278,8 +307,7 @@ aipu_status_t aipudrv::Simulator::update_simulation_rtcfg(const JobDesc& job, Si
 
     if (weight_cnt == 1)
     {
-        ofs << "INPUT_DATA_FILE" << std::dec << input_file_idx
-            <<  "=" << ctx.weight << "\n";
+        put_data_entry(ofs, "INPUT_DATA", input_file_idx, ctx.weight, job.weight_size);
         ofs << "INPUT_DATA_BASE" << std::dec << input_file_idx
             <<  "=0x" << std::hex << job.weight_pa << "\n";
         input_file_idx++;
@@ -288,8 +316,8 @@ aipu_status_t aipudrv::Simulator::update_simulation_rtcfg(const JobDesc& job, Si
         {
             for(uint32_t i = 0; i < job.weights->size(); i++)
             {
-                ofs << "INPUT_DATA_FILE" << std::dec << input_file_idx + i
-                    <<  "=" << ctx.weights[i] << "\n";
+                put_data_entry(ofs, "INPUT_DATA", input_file_idx + i, ctx.weights[i],
+                    (*job.weights)[i]->size);
                 ofs << "INPUT_DATA_BASE" << std::dec << input_file_idx + i
                     <<  "=0x" << std::hex << (*job.weights)[i]->pa << "\n";
             }
@@ -299,8 +327,8 @@ aipu_status_t aipudrv::Simulator::update_simulation_rtcfg(const JobDesc& job, Si
 
     if (zerocpy_const_cnt == 1)
     {
-        ofs << "INPUT_DATA_FILE" << std::dec << input_file_idx
-            <<  "=" << ctx.zerocpy_const << "\n";
+        put_data_entry(ofs, "INPUT_DATA", input_file_idx, ctx.zerocpy_const,
+            job.zerocpy_const_size);
         ofs << "INPUT_DATA_BASE" << std::dec << input_file_idx
             <<  "=0x" << std::hex << job.zerocpy_const_pa << "\n";
         input_file_idx++;
@@ -308,8 +336,8 @@ aipu_status_t aipudrv::Simulator::update_simulation_rtcfg(const JobDesc& job, Si
 
     for(uint32_t i = 0; i < job.reuses.size(); i++)
     {
-        ofs << "INPUT_DATA_FILE" << std::dec << input_file_idx + i
-            <<  "=" << ctx.reuses[i] << "\n";
+        put_data_entry(ofs, "INPUT_DATA", input_file_idx + i, ctx.reuses[i],
+            job.reuses[i]->size);
         ofs << "INPUT_DATA_BASE" << std::dec << input_file_idx + i
             <<  "=0x" << std::hex << job.reuses[i]->pa << "\n";
     }
@@ -326,7 +354,8 @@ aipu_status_t aipudrv::Simulator::update_simulation_rtcfg(const JobDesc& job, Si
 
     for (auto &buf : job.outputs)
     {
-        ofs << "OUTPUT_DATA_FILE" << std::dec << output_idx << "=" << ctx.outputs[output_idx] << "\n";
+        if (!m_use_server)
+            ofs << "OUTPUT_DATA_FILE" << std::dec << output_idx << "=" << ctx.outputs[output_idx] << "\n";
         ofs << "OUTPUT_DATA_BASE" << std::dec << output_idx << "=0x" << std::hex << buf.pa  << "\n";
         ofs << "OUTPUT_DATA_SIZE" << std::dec << output_idx << "=0x" << std::hex << buf.size << "\n";
         output_idx++;
@@ -335,7 +364,8 @@ aipu_status_t aipudrv::Simulator::update_simulation_rtcfg(const JobDesc& job, Si
     for (auto &item : job.misc_outputs)
     {
         auto &buf = item.second;
-        ofs << "OUTPUT_DATA_FILE" << std::dec << output_idx << "=" << item.first << "\n";
+        if (!m_use_server)
+            ofs << "OUTPUT_DATA_FILE" << std::dec << output_idx << "=" << item.first << "\n";
         ofs << "OUTPUT_DATA_BASE" << std::dec << output_idx << "=0x" << std::hex << buf.pa << "\n";
         ofs << "OUTPUT_DATA_SIZE" << std::dec << output_idx << "=0x" << std::hex << buf.size << "\n";
         output_idx++;
@@ -351,8 +381,9 @@ aipu_status_t aipudrv::Simulator::update_simulation_rtcfg(const JobDesc& job, Si
     {
         for (uint32_t i = 0; i < reuse_outputs.size(); i++)
         {
-            ofs << "OUTPUT_DATA_FILE" << std::dec << output_idx
-                << "=" << reuse_outputs[i] << "\n";
+            if (!m_use_server)
+                ofs << "OUTPUT_DATA_FILE" << std::dec << output_idx
+                    << "=" << reuse_outputs[i] << "\n";
             ofs << "OUTPUT_DATA_BASE" << std::dec << output_idx
                 << "=0x" << std::hex << job.reuses[i]->pa << "\n";
             ofs << "OUTPUT_DATA_SIZE" << std::dec << output_idx
@@ -363,22 +394,167 @@ aipu_status_t aipudrv::Simulator::update_simulation_rtcfg(const JobDesc& job, Si
 
     ofs << "RUN_DESCRIPTOR=BIN[0]" << "\n";
 
-    snprintf(ctx.simulation_cmd, sizeof(ctx.simulation_cmd),
-        "%s %s", job.simulator.c_str(), cfg_fname.c_str());
 finish:
     return ret;
 }
 
+/**
+ * transfer exactly len bytes over the server socket
+ */
+static bool sim_server_xfer(int fd, void *buf, size_t len, bool tx)
+{
+    char *p = (char *)buf;
+
+    while (len > 0)
+    {
+        ssize_t n = tx ? send(fd, p, len, MSG_NOSIGNAL) : recv(fd, p, len, 0);
+        if ((n < 0) && (errno == EINTR))
+            continue;
+        if (n <= 0)
+            return false;
+
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+aipu_status_t aipudrv::Simulator::start_sim_server(const std::string& path)
+{
+    int sv[2] = {-1, -1};
+    int shm_fd = get_umemory()->get_shm_fd();
+    std::string sock_arg, shm_arg;
+    std::vector<ShmRegion> regions;
+    std::ostringstream layout;
+    pid_t pid = -1;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) != 0)
+    {
+        LOG(LOG_ERR, "Create simulator server socket failed, errno %d", errno);
+        return AIPU_STATUS_ERROR_OPEN_DEV_FAIL;
+    }
+
+    sock_arg = std::to_string(sv[1]);
+    shm_arg = std::to_string(shm_fd);
+    pid = fork();
+    if (pid == 0)
+    {
+        /* only async-signal-safe calls until exec */
+        fcntl(sv[1], F_SETFD, 0);
+        fcntl(shm_fd, F_SETFD, 0);
+        execl(path.c_str(), path.c_str(), "--umd-server", sock_arg.c_str(), shm_arg.c_str(),
+            (char *)nullptr);
+        _exit(127);
+    }
+
+    close(sv[1]);
+    if (pid < 0)
+    {
+        LOG(LOG_ERR, "Launch simulator server %s failed, errno %d", path.c_str(), errno);
+        close(sv[0]);
+        return AIPU_STATUS_ERROR_OPEN_DEV_FAIL;
+    }
+
+    m_server.pid = pid;
+    m_server.fd = sv[0];
+    m_server.path = path;
+    LOG(LOG_DEFAULT, "[UMD SIMULATION] %s --umd-server (pid %d)", path.c_str(), pid);
+
+    get_umemory()->get_shm_regions(regions);
+    layout << "SHM_REGION_CNT=" << std::dec << regions.size() << "\n";
+    for (uint32_t i = 0; i < regions.size(); i++)
+    {
+        layout << "SHM_REGION_BASE" << std::dec << i << "=0x" << std::hex << regions[i].base << "\n";
+        layout << "SHM_REGION_SIZE" << std::dec << i << "=0x" << std::hex << regions[i].size << "\n";
+        layout << "SHM_REGION_OFFSET" << std::dec << i << "=0x" << std::hex << regions[i].offset << "\n";
+    }
+
+    return send_sim_server(layout.str());
+}
+
+void aipudrv::Simulator::stop_sim_server(void)
+{
+    int status = 0;
+
+    /* the server exits once it reads EOF, kill it if it doesn't within 1s */
+    if (m_server.fd >= 0)
+        close(m_server.fd);
+
+    if (m_server.pid > 0)
+    {
+        int i = 0;
+
+        for (; (i < 100) && (waitpid(m_server.pid, &status, WNOHANG) == 0); i++)
+            usleep(10000);
+
+        if (i == 100)
+        {
+            kill(m_server.pid, SIGKILL);
+            waitpid(m_server.pid, &status, 0);
+        }
+    }
+
+    m_server = SimServer();
+}
+
+aipu_status_t aipudrv::Simulator::send_sim_server(const std::string& msg)
+{
+    uint32_t len = msg.size();
+    int32_t sim_ret = 0;
+
+    if (!sim_server_xfer(m_server.fd, &len, sizeof(len), true) ||
+        !sim_server_xfer(m_server.fd, (void *)msg.data(), len, true) ||
+        !sim_server_xfer(m_server.fd, &sim_ret, sizeof(sim_ret), false))
+    {
+        LOG(LOG_ERR, "Simulator server %s is gone!", m_server.path.c_str());
+        stop_sim_server();
+        return AIPU_STATUS_ERROR_JOB_EXCEPTION;
+    }
+
+    if (sim_ret != 0)
+    {
+        LOG(LOG_ERR, "Simulation execution failed! (simulator ret = %d)", sim_ret);
+        return AIPU_STATUS_ERROR_JOB_EXCEPTION;
+    }
+
+    return AIPU_STATUS_SUCCESS;
+}
+
 aipu_status_t aipudrv::Simulator::schedule(const JobDesc& job)
 {
     aipu_status_t ret = AIPU_STATUS_SUCCESS;
     int sys_ret = 0;
     SimulationJobCtx ctx;
+    std::ostringstream cfg;
+    std::string cfg_fname = job.output_dir + "/runtime.cfg";
 
-    ret = update_simulation_rtcfg(job, ctx);
+    ret = update_simulation_rtcfg(job, ctx, cfg);
     if (ret != AIPU_STATUS_SUCCESS)
         goto error;
 
+    /* the server works on UMemory in place, nothing to reload */
+    if (m_use_server)
+    {
+        std::lock_guard<std::mutex> lock(m_server_lock);
+
+        if (m_server.path != job.simulator)
+        {
+            stop_sim_server();
+            ret = start_sim_server(job.simulator);
+            if (ret != AIPU_STATUS_SUCCESS)
+                goto error;
+        }
+
+        return send_sim_server(cfg.str());
+    }
+
+    {
+        FileWrapper ofs(cfg_fname, std::ios::app);
+        ofs << cfg.str();
+    }
+
+    snprintf(ctx.simulation_cmd, sizeof(ctx.simulation_cmd),
+        "%s %s", job.simulator.c_str(), cfg_fname.c_str());
     LOG(LOG_DEFAULT, "[UMD SIMULATION] %s", ctx.simulation_cmd);
     sys_ret = system(ctx.simulation_cmd);
     if (sys_ret == -1)
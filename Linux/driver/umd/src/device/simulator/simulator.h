@@ -14,6 +14,9 @@
 #include <map>
 #include <vector>
 #include <string>
+#include <mutex>
+#include <sstream>
+#include <sys/types.h>
 #include "standard_api.h"
 #include "device_base.h"
 #include "umemory.h"
@@ -47,12 +50,44 @@ struct SimulationJobCtx
     char simulation_cmd[CMD_MEN];
 };
 
+/**
+ * persistent simulator (UMD_SIM_SERVER=y)
+ *
+ * The simulator is spawned once as
+ *     <simulator> --umd-server <sock_fd> <shm_fd>
+ * and inherits a unix stream socket and the memfd which backs UMemory.
+ * Every message in both directions is a 32-bit length followed by that
+ * many bytes of runtime config text:
+ *   - the first message describes the memfd layout with
+ *     SHM_REGION_CNT and SHM_REGION_BASE<n>/SIZE<n>/OFFSET<n>;
+ *   - each job is the usual runtime.cfg, where INPUT_INST_FILE0,
+ *     INPUT_DATA_FILE<n> and OUTPUT_DATA_FILE<n> are replaced by
+ *     *_SIZE<n> entries: data lives in the memfd at the given base.
+ * The simulator answers each message with a 32-bit status, 0 on success.
+ * Outputs are written in place, so nothing is dumped or reloaded.
+ */
+struct SimServer
+{
+    pid_t pid = -1;
+    int fd = -1;
+    std::string path;
+};
+
 class Simulator : public DeviceBase
 {
+private:
+    bool m_use_server = false;
+    SimServer m_server;
+    std::mutex m_server_lock;
+
 private:
     aipu_status_t create_simulation_input_file(char* fname, const char* interfix,
         JOB_ID id, DEV_PA_64 pa, uint32_t size, const JobDesc& job);
-    aipu_status_t update_simulation_rtcfg(const JobDesc& job, SimulationJobCtx& ctx);
+    aipu_status_t update_simulation_rtcfg(const JobDesc& job, SimulationJobCtx& ctx,
+        std::ostringstream& ofs);
+    aipu_status_t start_sim_server(const std::string& path);
+    void stop_sim_server(void);
+    aipu_status_t send_sim_server(const std::string& msg);
 
 public:
     UMemory *get_umemory(void)
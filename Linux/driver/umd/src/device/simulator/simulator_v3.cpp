@@ -10,9 +10,13 @@
 
 #include <cstring>
 #include <unistd.h>
+#include <chrono>
 #include "simulator_v3.h"
 #include "helper.h"
 
+/* max interval to re-check cmdpool status if no simulator event wakes us up */
+#define CMDPOOL_POLL_MAX_NS (10 * 1000 * 1000UL)
+
 aipudrv::SimulatorV3::SimulatorV3(const aipu_global_config_simulation_t* cfg)
 {
     m_dev_type = DEV_TYPE_SIMULATOR_V3;
@@ -139,6 +143,7 @@ bool aipudrv::SimulatorV3::has_target(uint32_t arch, uint32_t version, uint32_t
         ret = false;
         goto unlock;
     }
+    m_aipu->set_event_handler(SimulatorV3::sim_event_handler, this);
 
     if (sim_code == sim_aipu::config_t::X2_1204 || sim_code == sim_aipu::config_t::X2_1204MP3)
         m_dram->gm_init(m_config.gm_size);
@@ -318,10 +323,10 @@ out:
     return ret;
 }
 
-aipu_status_t aipudrv::SimulatorV3::fill_commit_queue()
+aipu_status_t aipudrv::SimulatorV3::fill_commit_queue(uint32_t max_limit)
 {
     aipu_status_t ret = AIPU_STATUS_SUCCESS;
-    uint32_t max_limit = 3, max = 0;
+    uint32_t max = 0;
     job_queue_elem_t job_queue_item {0};
 
     LOG(LOG_INFO, "Enter %s...", __FUNCTION__);
@@ -387,12 +392,124 @@ out:
     LOG(LOG_INFO, "Exit %s...", __FUNCTION__);
     return ret;
 }
+
+/**
+ * queue the whole batch under one lock, an idle simulator chains all of
+ * them into one command pool instead of committing the first one alone.
+ */
+aipu_status_t aipudrv::SimulatorV3::schedule_batch(const std::vector<JobDesc*>& jobs,
+    uint32_t *scheduled_cnt)
+{
+    aipu_status_t ret = AIPU_STATUS_SUCCESS;
+    job_queue_elem_t job_queue_item;
+    JobV3 *job = nullptr;
+
+    *scheduled_cnt = 0;
+    if (m_aipu == nullptr)
+        return AIPU_STATUS_ERROR_NULL_PTR;
+
+    for (auto jobdesc : jobs)
+    {
+        if (static_cast<JobV3 *>(jobdesc->jobbase)->get_part_id() > m_partition_cnt)
+            return AIPU_STATUS_ERROR_INVALID_PARTITION_ID;
+    }
+
+    pthread_rwlock_wrlock(&m_lock);
+    for (auto jobdesc : jobs)
+    {
+        job = static_cast<JobV3 *>(jobdesc->jobbase);
+        if (job->m_bind_cmdpool_id == 0xffffffff)
+            job->m_bind_cmdpool_id = get_cmdpool_id(job->get_part_id());
+
+        job_queue_item.job = jobdesc->jobbase;
+        job_queue_item.jobdesc = *jobdesc;
+        m_buffer_queue.push(job_queue_item);
+    }
+
+    if (!m_cmdpool_busy)
+    {
+        m_cmdpool_busy = true;
+        ret = fill_commit_queue(jobs.size());
+    }
+    pthread_rwlock_unlock(&m_lock);
+
+    if (ret == AIPU_STATUS_SUCCESS)
+        *scheduled_cnt = jobs.size();
+    return ret;
+}
 #endif
 
+void aipudrv::SimulatorV3::notify_pollers(void)
+{
+    std::lock_guard<std::mutex> lock(m_event_mtx);
+    m_event_cnt++;
+    m_event_cv.notify_all();
+}
+
+void aipudrv::SimulatorV3::sim_event_handler(uint32_t event, uint64_t value, void *context)
+{
+    static_cast<SimulatorV3 *>(context)->notify_pollers();
+}
+
+/**
+ * sleep until a simulator event newer than seen_cnt arrives, wait_ns elapses
+ * or the deadline (0: none) is reached; return false once the deadline passed
+ */
+bool aipudrv::SimulatorV3::wait_sim_event(uint64_t seen_cnt, uint64_t deadline_ns, uint64_t wait_ns)
+{
+    uint64_t now = umd_monotonic_ns_helper();
+    std::unique_lock<std::mutex> lock(m_event_mtx);
+
+    if (deadline_ns != 0)
+    {
+        if (now >= deadline_ns)
+            return false;
+
+        wait_ns = std::min(wait_ns, deadline_ns - now);
+    }
+
+    m_event_cv.wait_for(lock, std::chrono::nanoseconds(wait_ns),
+        [&]() { return m_event_cnt != seen_cnt; });
+    return true;
+}
+
+/**
+ * wait for the cmdpool to be idle and destroy it. the status is re-checked on
+ * every simulator event and, in case the simulator raises none, with a
+ * backoff from 100us up to CMDPOOL_POLL_MAX_NS.
+ */
+bool aipudrv::SimulatorV3::wait_cmdpool_idle(uint32_t status_reg, uint64_t deadline_ns)
+{
+    uint32_t value = 0;
+    uint64_t seen_cnt = 0, wait_ns = 100 * 1000;
+
+    while (1)
+    {
+        m_event_mtx.lock();
+        seen_cnt = m_event_cnt;
+        m_event_mtx.unlock();
+
+        if (m_aipu->read_register(status_reg, value) <= 0)
+            return true;
+
+        LOG(LOG_INFO, "wait for simulation execution, cmdpool sts=%x", value);
+        if (value & CMD_POOL0_IDLE)
+        {
+            m_aipu->write_register(TSM_CMD_SCHED_CTRL, DESTROY_CMD_POOL);
+            LOG(LOG_INFO, "simulation done.");
+            return true;
+        }
+
+        if (!wait_sim_event(seen_cnt, deadline_ns, wait_ns))
+            return false;
+
+        wait_ns = std::min(wait_ns * 2, CMDPOOL_POLL_MAX_NS);
+    }
+}
+
 aipu_ll_status_t aipudrv::SimulatorV3::get_status(std::vector<aipu_job_status_desc>& jobs_status,
     uint32_t max_cnt, void *jobbase)
 {
-    uint32_t value = 0;
     aipu_job_status_desc desc;
     JobV3 *job = static_cast<JobV3 *>(jobbase);
     uint32_t cmd_pool_id = job->m_bind_cmdpool_id;
@@ -423,17 +540,7 @@ aipu_ll_status_t aipudrv::SimulatorV3::get_status(std::vector<aipu_job_status_de
         if (m_cmdpools[cmd_pool_id]->destroy_done() == false)
         {
             m_cmdpools[cmd_pool_id]->set_destroy_flag();
-            while (m_aipu->read_register(cmd_pool_status_reg, value) > 0)
-            {
-                LOG(LOG_INFO, "wait for simulation execution, cmdpool sts=%x", value);
-                if (value & CMD_POOL0_IDLE)
-                {
-                    m_aipu->write_register(TSM_CMD_SCHED_CTRL, DESTROY_CMD_POOL);
-                    LOG(LOG_INFO, "simulation done.");
-                    break;
-                }
-                sleep(1);
-            }
+            wait_cmdpool_idle(cmd_pool_status_reg, 0);
         }
 
         desc.state = AIPU_JOB_STATE_DONE;
@@ -495,10 +602,10 @@ aipu_ll_status_t aipudrv::SimulatorV3::poll_status(std::vector<aipu_job_status_d
 aipu_ll_status_t aipudrv::SimulatorV3::poll_status(uint32_t max_cnt, int32_t time_out,
     bool of_this_thread, void *jobbase)
 {
-    uint32_t value = 0;
     JobV3 *job = static_cast<JobV3 *>(jobbase);
     uint32_t cmd_pool_id = job->m_bind_cmdpool_id;
-    uint32_t cmd_pool_status_reg = CMD_POOL0_STATUS + 0x40 * cmd_pool_id;
+    uint32_t cmd_pool_status_reg = 0;
+    uint64_t deadline_ns = 0, seen_cnt = 0;
 
     LOG(LOG_INFO, "Enter %s...", __FUNCTION__);
 
@@ -508,8 +615,21 @@ aipu_ll_status_t aipudrv::SimulatorV3::poll_status(uint32_t max_cnt, int32_t tim
         return AIPU_LL_STATUS_SUCCESS;
     }
 
+    /* ended meanwhile, delivered by another polling thread */
+    if ((job->get_job_status() == AIPU_JOB_STATUS_DONE) ||
+        (job->get_job_status() == AIPU_JOB_STATUS_EXCEPTION))
+        return AIPU_LL_STATUS_SUCCESS;
+
+    /* time_out: -1 blocks, 0 checks once, otherwise in ms */
+    if (time_out >= 0)
+        deadline_ns = umd_monotonic_ns_helper() + (uint64_t)time_out * 1000000;
+
     while (1)
     {
+        m_event_mtx.lock();
+        seen_cnt = m_event_cnt;
+        m_event_mtx.unlock();
+
         pthread_rwlock_wrlock(&m_lock);
         if (m_done_queue.count(jobbase))
         {
@@ -521,19 +641,23 @@ aipu_ll_status_t aipudrv::SimulatorV3::poll_status(uint32_t max_cnt, int32_t tim
         }
         pthread_rwlock_unlock(&m_lock);
 
-        m_poll_mtex.lock();
-        if (m_commit_queue.count(jobbase))
+        if (!umd_lock_until_helper(m_poll_mtex, deadline_ns))
+            return AIPU_LL_STATUS_ERROR_POLL_TIMEOUT;
+
+        /**
+         * whoever polls drives the committed jobs, so a job waiting in the
+         * buffer queue doesn't depend on the owners of the committed ones.
+         */
+        if (!m_commit_queue.empty())
         {
-            while (m_aipu->read_register(cmd_pool_status_reg, value) > 0)
+            JobV3 *committed = m_commit_queue.count(jobbase) ? job :
+                static_cast<JobV3 *>(*m_commit_queue.begin());
+
+            cmd_pool_status_reg = CMD_POOL0_STATUS + 0x40 * committed->m_bind_cmdpool_id;
+            if (!wait_cmdpool_idle(cmd_pool_status_reg, deadline_ns))
             {
-                LOG(LOG_INFO, "wait for simulation execution, cmdpool sts=%x", value);
-                if (value & CMD_POOL0_IDLE)
-                {
-                    m_aipu->write_register(TSM_CMD_SCHED_CTRL, DESTROY_CMD_POOL);
-                    LOG(LOG_INFO, "simulation done.");
-                    break;
-                }
-                sleep(1);
+                m_poll_mtex.unlock();
+                return AIPU_LL_STATUS_ERROR_POLL_TIMEOUT;
             }
 
             pthread_rwlock_wrlock(&m_lock);
@@ -557,8 +681,17 @@ aipu_ll_status_t aipudrv::SimulatorV3::poll_status(uint32_t max_cnt, int32_t tim
                 job->dumpcfg_alljob();
             }
             pthread_rwlock_unlock(&m_lock);
+            m_poll_mtex.unlock();
+
+            /* wake up the pollers whose jobs were just harvested */
+            notify_pollers();
+            continue;
         }
         m_poll_mtex.unlock();
+
+        /* another poller is harvesting, don't spin on the locks meanwhile */
+        if (!wait_sim_event(seen_cnt, deadline_ns, 1000 * 1000))
+            return AIPU_LL_STATUS_ERROR_POLL_TIMEOUT;
     }
     LOG(LOG_INFO, "Exit %s...", __FUNCTION__);
 
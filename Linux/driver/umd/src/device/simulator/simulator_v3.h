@@ -15,6 +15,7 @@
 #include <set>
 #include <queue>
 #include <mutex>
+#include <condition_variable>
 #include <sstream>
 #include <pthread.h>
 #include "standard_api.h"
@@ -93,7 +94,12 @@ class SimulatorV3 : public DeviceBase
 {
 private:
     pthread_rwlock_t m_lock;
-    std::mutex m_poll_mtex;
+    std::timed_mutex m_poll_mtex;
+
+    /* counts simulator events and harvests, pollers sleep on m_event_cv until it changes */
+    std::mutex m_event_mtx;
+    std::condition_variable m_event_cv;
+    uint64_t m_event_cnt = 0;
     sim_aipu::config_t m_config;
     sim_aipu::Aipu *m_aipu = nullptr;
     uint32_t m_code = 0;
@@ -326,6 +332,11 @@ private:
         return AIPU_STATUS_SUCCESS;
     }
 
+    static void sim_event_handler(uint32_t event, uint64_t value, void *context);
+    void notify_pollers(void);
+    bool wait_sim_event(uint64_t seen_cnt, uint64_t deadline_ns, uint64_t wait_ns);
+    bool wait_cmdpool_idle(uint32_t status_reg, uint64_t deadline_ns);
+
     aipu_status_t set_cmdpool_to_partition(uint32_t partition_cnt, uint32_t cmdpool_cnt)
     {
         uint32_t cluster_cnt = 0;
@@ -369,7 +380,8 @@ public:
     bool has_target(uint32_t arch, uint32_t version, uint32_t config, uint32_t rev);
     aipu_status_t parse_config(uint32_t config, uint32_t &code);
     aipu_status_t schedule(const JobDesc& job);
-    aipu_status_t fill_commit_queue();
+    aipu_status_t schedule_batch(const std::vector<JobDesc*>& jobs, uint32_t *scheduled_cnt);
+    aipu_status_t fill_commit_queue(uint32_t max_limit = 3);
     aipu_ll_status_t get_status(std::vector<aipu_job_status_desc>& jobs_status,
         uint32_t max_cnt, void *jobbase = nullptr);
     aipu_ll_status_t poll_status(uint32_t max_cnt, int32_t time_out,
@@ -12,6 +12,7 @@
 #include <unistd.h>
 #include <thread>
 #include <mutex>
+#include <chrono>
 #include <condition_variable>
 #include "simulator_v3_1.h"
 #include "helper.h"
@@ -412,7 +413,7 @@ aipu_ll_status_t aipudrv::SimulatorV3_1::poll_status(uint32_t max_cnt, int32_t t
     bool of_this_thread, void *jobbase)
 {
     JobV3_1 *job = static_cast<JobV3_1 *>(jobbase);
-    uint16_t grid_id = job->get_grid_id();
+    uint64_t deadline_ns = 0, now = 0;
 
     LOG(LOG_INFO, "Enter %s...", __FUNCTION__);
 
@@ -422,6 +423,15 @@ aipu_ll_status_t aipudrv::SimulatorV3_1::poll_status(uint32_t max_cnt, int32_t t
         return AIPU_LL_STATUS_SUCCESS;
     }
 
+    /* ended meanwhile, delivered by another polling thread */
+    if ((job->get_job_status() == AIPU_JOB_STATUS_DONE) ||
+        (job->get_job_status() == AIPU_JOB_STATUS_EXCEPTION))
+        return AIPU_LL_STATUS_SUCCESS;
+
+    /* time_out: -1 blocks, 0 checks once, otherwise in ms */
+    if (time_out >= 0)
+        deadline_ns = umd_monotonic_ns_helper() + (uint64_t)time_out * 1000000;
+
     while (1)
     {
         pthread_rwlock_wrlock(&m_lock);
@@ -434,20 +444,54 @@ aipu_ll_status_t aipudrv::SimulatorV3_1::poll_status(uint32_t max_cnt, int32_t t
         }
         pthread_rwlock_unlock(&m_lock);
 
-        m_poll_mtex.lock();
-        if (m_commit_map.count(grid_id))
+        if (!umd_lock_until_helper(m_poll_mtex, deadline_ns))
+            return AIPU_LL_STATUS_ERROR_POLL_TIMEOUT;
+
+        /**
+         * whoever polls harvests the done grids, so a job waiting in the
+         * buffer queue doesn't depend on the owners of the committed ones.
+         */
+        if (!m_commit_map.empty())
         {
-            if (m_sim_done_grid_set.count(grid_id) == 0)
+            bool wait = true;
+
+            /* only a committed grid ends a job, the others are dropped below */
+            pthread_rwlock_rdlock(&m_lock);
+            m_sim_done_grid_mtx.lock();
+            for (const auto done_gridid : m_sim_done_grid_set)
+            {
+                if (m_commit_map.count(done_gridid))
+                {
+                    wait = false;
+                    break;
+                }
+            }
+            m_sim_done_grid_mtx.unlock();
+            pthread_rwlock_unlock(&m_lock);
+
+            if (wait)
             {
                 LOG(LOG_INFO, "wait, sim doing...\n");
                 std::unique_lock<std::mutex> lck(simv3_1_mtx);
-                simv3_1_cv.wait(lck, has_some_grid_done);
+                if (deadline_ns == 0)
+                {
+                    simv3_1_cv.wait(lck, has_some_grid_done);
+                } else {
+                    now = umd_monotonic_ns_helper();
+                    if ((now >= deadline_ns) || !simv3_1_cv.wait_for(lck,
+                        std::chrono::nanoseconds(deadline_ns - now), has_some_grid_done))
+                    {
+                        lck.unlock();
+                        m_poll_mtex.unlock();
+                        return AIPU_LL_STATUS_ERROR_POLL_TIMEOUT;
+                    }
+                }
                 simv3_1_has_grid_done = false;
                 LOG(LOG_INFO, "wakeup, sim done...\n");
             }
 
             pthread_rwlock_wrlock(&m_lock);
-            std::vector <uint16_t> sim_done_grid_vec;
+            m_sim_done_grid_mtx.lock();
             for (const auto done_gridid : m_sim_done_grid_set)
             {
                 if (m_commit_map.count(done_gridid))
@@ -455,14 +499,16 @@ aipu_ll_status_t aipudrv::SimulatorV3_1::poll_status(uint32_t max_cnt, int32_t t
                     m_done_set.insert(m_commit_map[done_gridid]);
                     m_commit_map.erase(done_gridid);
                     m_cant_add_job_flag = false;
-                    sim_done_grid_vec.push_back(done_gridid);
+                } else {
+                    LOG(LOG_INFO, "drop done grid %u, not committed\n", done_gridid);
                 }
             }
 
-            // clear done grid record from sim_done_grid set
-            m_sim_done_grid_mtx.lock();
-            for (auto sim_done_grid_id : sim_done_grid_vec)
-                m_sim_done_grid_set.erase(sim_done_grid_id);
+            /**
+             * grids are committed under m_lock, so a done grid not in the commit
+             * map now never will be. keeping it would stop the pollers waiting.
+             */
+            m_sim_done_grid_set.clear();
             m_sim_done_grid_mtx.unlock();
             LOG(LOG_INFO, "batch job done...\n");
 
@@ -477,8 +523,21 @@ aipu_ll_status_t aipudrv::SimulatorV3_1::poll_status(uint32_t max_cnt, int32_t t
                 // job->dumpcfg_alljob();
             }
             pthread_rwlock_unlock(&m_lock);
+            m_poll_mtex.unlock();
+
+            /* wake up the pollers whose jobs were just harvested */
+            simv3_1_cv.notify_all();
+            continue;
         }
         m_poll_mtex.unlock();
+
+        /* another poller is harvesting, don't spin on the locks meanwhile */
+        now = umd_monotonic_ns_helper();
+        if ((deadline_ns != 0) && (now >= deadline_ns))
+            return AIPU_LL_STATUS_ERROR_POLL_TIMEOUT;
+
+        std::unique_lock<std::mutex> lck(simv3_1_mtx);
+        simv3_1_cv.wait_for(lck, std::chrono::milliseconds(1));
     }
     LOG(LOG_INFO, "Exit %s...", __FUNCTION__);
 
@@ -495,7 +554,7 @@ void aipudrv::SimulatorV3_1::sim_cb_handler(uint32_t event, uint64_t value, void
         m_sim_done_grid_set.insert(value);
         std::unique_lock<std::mutex> lck(simv3_1_mtx);
         simv3_1_has_grid_done = true;
-        simv3_1_cv.notify_one();
+        simv3_1_cv.notify_all();
         m_sim_done_grid_mtx.unlock();
     } else {
         LOG(LOG_ALERT, "sim_cn_handler has no event: %d\n", event);
@@ -51,7 +51,7 @@ class SimulatorV3_1 : public DeviceBase
 {
 private:
     pthread_rwlock_t m_lock;
-    std::mutex m_poll_mtex;
+    std::timed_mutex m_poll_mtex;
     sim_aipu::config_t m_config;
     sim_aipu::Aipu *m_aipu = nullptr;
     uint32_t m_code = 0;
@@ -9,7 +9,10 @@
  */
 
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <cstring>
+#include <chrono>
 #include "umemory.h"
 #include "utils/log.h"
 #include "utils/helper.h"
@@ -62,6 +65,18 @@ aipudrv::UMemory::UMemory(): MemoryBase(), sim_aipu::IMemEngine()
         m_asid_max = num;
     }
 
+    /**
+     * UMD_SIM_SERVER=y: back all memory regions with one memfd so that a
+     * persistent simulator process can access the buffers in place
+     */
+    const char *sim_server = getenv("UMD_SIM_SERVER");
+    if ((sim_server != nullptr) && (sim_server[0] == 'y' || sim_server[0] == 'Y'))
+    {
+        m_shm_fd = memfd_create("aipu_sim_mem", MFD_CLOEXEC);
+        if (m_shm_fd < 0)
+            LOG(LOG_WARN, "create shared memory for simulator failed, use private memory\n");
+    }
+
     /**
      * default mem region config
      * aipu v3: default 4MB
@@ -70,11 +85,7 @@ aipudrv::UMemory::UMemory(): MemoryBase(), sim_aipu::IMemEngine()
     for (int i = 0; i < MEM_REGION_MAX; i++)
     {
         if (m_memblock[ASID_REGION_0][i].size >= AIPU_PAGE_SIZE)
-        {
-            m_memblock[ASID_REGION_0][i].bit_cnt = m_memblock[ASID_REGION_0][i].size / AIPU_PAGE_SIZE;
-            m_memblock[ASID_REGION_0][i].bitmap = new bool[m_memblock[ASID_REGION_0][i].bit_cnt];
-            memset(m_memblock[ASID_REGION_0][i].bitmap, true, m_memblock[ASID_REGION_0][i].bit_cnt);
-        }
+            memblock_init(m_memblock[ASID_REGION_0][i]);
     }
     set_asid_base(0, m_memblock[ASID_REGION_0][0].base);
 
@@ -91,9 +102,7 @@ aipudrv::UMemory::UMemory(): MemoryBase(), sim_aipu::IMemEngine()
     {
         m_memblock[region][0].base = static_cast<uint64_t>(region) << 32; // (region | 1ul) << 32;
         m_memblock[region][0].size = 3ul << 30; // 3GB
-        m_memblock[region][0].bit_cnt = m_memblock[region][0].size / AIPU_PAGE_SIZE;
-        m_memblock[region][0].bitmap = new bool[m_memblock[region][0].bit_cnt];
-        memset(m_memblock[region][0].bitmap, true, m_memblock[region][0].bit_cnt);
+        memblock_init(m_memblock[region][0]);
         set_asid_base(region, m_memblock[region][0].base);
 
         LOG(LOG_ALERT, "ASID %d: mem region [ 0]: base=0x%.12lx, size=0x%lx", region,
@@ -113,23 +122,294 @@ aipudrv::UMemory::~UMemory()
 {
     free_all();
     for (int i = 0; i < MEM_REGION_MAX; i++)
+        memblock_deinit(m_memblock[ASID_REGION_0][i]);
+
+    for (int region = ASID_REGION_1; region < m_asid_max; region++)
+        memblock_deinit(m_memblock[region][0]);
+
+    if (m_shm_fd >= 0)
     {
-        if (m_memblock[ASID_REGION_0][i].bitmap)
+        close(m_shm_fd);
+        m_shm_fd = -1;
+    }
+}
+
+void aipudrv::UMemory::memblock_init(MemBlock &block)
+{
+    uint64_t word_cnt = 0;
+
+    block.bit_cnt = block.size / AIPU_PAGE_SIZE;
+    word_cnt = (block.bit_cnt + 63) / 64;
+    block.bitmap = new uint64_t[word_cnt];
+    memset(block.bitmap, 0xff, word_cnt * sizeof(uint64_t));
+
+    /* keep the bits beyond bit_cnt cleared so that popcount stays exact */
+    if (block.bit_cnt % 64)
+        block.bitmap[word_cnt - 1] = (1UL << (block.bit_cnt % 64)) - 1;
+
+    block.free_cnt = block.bit_cnt;
+    block.free_by_start.clear();
+    block.free_by_size.clear();
+    extent_insert(block, 0, block.bit_cnt);
+
+    block.shm_off = SHM_OFF_NONE;
+    block.va = (char *)MAP_FAILED;
+    if (m_shm_fd >= 0)
+    {
+        /* the file is sparse, pages are only allocated once touched */
+        if (ftruncate(m_shm_fd, m_shm_size + block.bit_cnt * AIPU_PAGE_SIZE) == 0)
         {
-            delete[] m_memblock[ASID_REGION_0][i].bitmap;
-            m_memblock[ASID_REGION_0][i].bitmap = nullptr;
+            block.va = (char *)mmap(nullptr, block.bit_cnt * AIPU_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_NORESERVE, m_shm_fd, m_shm_size);
         }
 
+        if (block.va != MAP_FAILED)
+        {
+            block.shm_off = m_shm_size;
+            m_shm_size += block.bit_cnt * AIPU_PAGE_SIZE;
+        } else {
+            /* a server wouldn't see this region, jobs run one simulator each then */
+            LOG(LOG_WARN, "share host memory for region 0x%lx failed, use private memory\n",
+                block.base);
+            m_shm_partial = true;
+        }
     }
 
-    for (int region = ASID_REGION_1; region < m_asid_max; region++)
+    if (block.va == MAP_FAILED)
+        block.va = (char *)mmap(nullptr, block.bit_cnt * AIPU_PAGE_SIZE, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+    if (block.va == MAP_FAILED)
+    {
+        LOG(LOG_WARN, "reserve host memory for region 0x%lx failed, map per buffer\n", block.base);
+        block.va = nullptr;
+    }
+}
+
+void aipudrv::UMemory::memblock_deinit(MemBlock &block)
+{
+    if (block.bitmap)
+    {
+        delete[] block.bitmap;
+        block.bitmap = nullptr;
+    }
+    if (block.va)
+    {
+        munmap(block.va, block.bit_cnt * AIPU_PAGE_SIZE);
+        block.va = nullptr;
+    }
+    block.free_cnt = 0;
+    block.free_by_start.clear();
+    block.free_by_size.clear();
+}
+
+void aipudrv::UMemory::extent_insert(MemBlock &block, uint64_t start, uint64_t cnt)
+{
+    block.free_by_start[start] = cnt;
+    block.free_by_size.insert(std::make_pair(cnt, start));
+}
+
+void aipudrv::UMemory::extent_erase(MemBlock &block, std::map<uint64_t, uint64_t>::iterator iter)
+{
+    block.free_by_size.erase(std::make_pair(iter->second, iter->first));
+    block.free_by_start.erase(iter);
+}
+
+void aipudrv::UMemory::bitmap_update(MemBlock &block, uint64_t start, uint64_t cnt, bool free)
+{
+    while (cnt > 0)
+    {
+        uint64_t word = start / 64, lo = start % 64;
+        uint64_t n = std::min(cnt, 64 - lo);
+        uint64_t mask = (n == 64) ? ~0UL : (((1UL << n) - 1) << lo);
+
+        if (free)
+            block.bitmap[word] |= mask;
+        else
+            block.bitmap[word] &= ~mask;
+
+        start += n;
+        cnt -= n;
+    }
+}
+
+uint64_t aipudrv::UMemory::bitmap_free_cnt(const MemBlock &block, uint64_t start, uint64_t cnt) const
+{
+    uint64_t free_cnt = 0;
+
+    while (cnt > 0)
+    {
+        uint64_t word = start / 64, lo = start % 64;
+        uint64_t n = std::min(cnt, 64 - lo);
+        uint64_t mask = (n == 64) ? ~0UL : (((1UL << n) - 1) << lo);
+
+        free_cnt += __builtin_popcountll(block.bitmap[word] & mask);
+        start += n;
+        cnt -= n;
+    }
+
+    return free_cnt;
+}
+
+/**
+ * best fit: walk the extents from the smallest one which is big enough,
+ * and return the first whose aligned start still leaves 'cnt' pages.
+ * 'align' is in pages and applies to the physical address.
+ */
+bool aipudrv::UMemory::pages_find(const MemBlock &block, uint64_t cnt, uint32_t align,
+    uint64_t &start) const
+{
+    uint64_t base_page = block.base / AIPU_PAGE_SIZE;
+
+    if (align == 0)
+        align = 1;
+
+    for (auto iter = block.free_by_size.lower_bound(std::make_pair(cnt, 0UL));
+         iter != block.free_by_size.end(); iter++)
+    {
+        uint64_t ext_cnt = iter->first, ext_start = iter->second;
+        uint64_t aligned = (base_page + ext_start + align - 1) / align * align - base_page;
+
+        if (aligned + cnt <= ext_start + ext_cnt)
+        {
+            start = aligned;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * mark [start, start + cnt) as used, the range may cover several free
+ * extents or already used pages (reserved memory).
+ */
+void aipudrv::UMemory::pages_take(MemBlock &block, uint64_t start, uint64_t cnt)
+{
+    uint64_t end = start + cnt;
+    auto iter = block.free_by_start.upper_bound(start);
+
+    if (iter != block.free_by_start.begin())
+        iter--;
+
+    while ((iter != block.free_by_start.end()) && (iter->first < end))
+    {
+        uint64_t ext_start = iter->first, ext_end = iter->first + iter->second;
+        auto next = std::next(iter);
+
+        if (ext_end > start)
+        {
+            extent_erase(block, iter);
+            if (ext_start < start)
+                extent_insert(block, ext_start, start - ext_start);
+            if (ext_end > end)
+                extent_insert(block, end, ext_end - end);
+        }
+        iter = next;
+    }
+
+    block.free_cnt -= bitmap_free_cnt(block, start, cnt);
+    bitmap_update(block, start, cnt, false);
+}
+
+bool aipudrv::UMemory::pages_give(MemBlock &block, uint64_t start, uint64_t cnt)
+{
+    auto iter = block.free_by_start.end();
+
+    if ((start + cnt > block.bit_cnt) || (bitmap_free_cnt(block, start, cnt) != 0))
+    {
+        LOG(LOG_ERR, "free pages [%lx, %lx) which are not in use\n", start, start + cnt);
+        return false;
+    }
+
+    bitmap_update(block, start, cnt, true);
+    block.free_cnt += cnt;
+
+    /* coalesce with the neighbouring free extents */
+    iter = block.free_by_start.lower_bound(start);
+    if ((iter != block.free_by_start.end()) && (iter->first == start + cnt))
     {
-        if (m_memblock[region][0].bitmap)
+        cnt += iter->second;
+        extent_erase(block, iter);
+    }
+
+    iter = block.free_by_start.lower_bound(start);
+    if (iter != block.free_by_start.begin())
+    {
+        iter--;
+        if (iter->first + iter->second == start)
         {
-            delete[] m_memblock[region][0].bitmap;
-            m_memblock[region][0].bitmap = nullptr;
+            start = iter->first;
+            cnt += iter->second;
+            extent_erase(block, iter);
         }
     }
+
+    extent_insert(block, start, cnt);
+    return true;
+}
+
+char *aipudrv::UMemory::pages_map(MemBlock &block, uint64_t start, uint64_t size)
+{
+    void *va = nullptr;
+
+    if (block.va != nullptr)
+        return block.va + start * AIPU_PAGE_SIZE;
+
+    va = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return (va == MAP_FAILED) ? nullptr : (char *)va;
+}
+
+void aipudrv::UMemory::pages_unmap(MemBlock &block, uint64_t start, char *va, uint64_t size)
+{
+    if (va == nullptr)
+        return;
+
+    /* give the host pages back, the next touch reads zero again */
+    if ((block.va != nullptr) && (block.shm_off != SHM_OFF_NONE))
+        fallocate(m_shm_fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+            block.shm_off + start * AIPU_PAGE_SIZE, size);
+    else if (block.va != nullptr)
+        madvise(va, size, MADV_DONTNEED);
+    else
+        munmap(va, size);
+}
+
+void aipudrv::UMemory::update_alloc_stats(uint64_t ns, bool success)
+{
+    uint64_t max_ns = m_alloc_max_ns.load();
+
+    if (!success)
+    {
+        m_alloc_fail_cnt++;
+        return;
+    }
+
+    m_alloc_cnt++;
+    m_alloc_total_ns += ns;
+    while ((ns > max_ns) && !m_alloc_max_ns.compare_exchange_weak(max_ns, ns))
+        ;
+}
+
+void aipudrv::UMemory::get_shm_regions(std::vector<ShmRegion> &regions) const
+{
+    regions.clear();
+    if (get_shm_fd() < 0)
+        return;
+
+    for (int i = 0; i < MEM_REGION_MAX; i++)
+    {
+        const MemBlock &block = m_memblock[ASID_REGION_0][i];
+        if ((block.va != nullptr) && (block.shm_off != SHM_OFF_NONE))
+            regions.push_back({block.base, block.bit_cnt * AIPU_PAGE_SIZE, block.shm_off});
+    }
+
+    for (int region = ASID_REGION_1; region < m_asid_max; region++)
+    {
+        const MemBlock &block = m_memblock[region][0];
+        if ((block.va != nullptr) && (block.shm_off != SHM_OFF_NONE))
+            regions.push_back({block.base, block.bit_cnt * AIPU_PAGE_SIZE, block.shm_off});
+    }
 }
 
 void aipudrv::UMemory:: gm_init(uint32_t gm_size)
@@ -157,22 +437,6 @@ void aipudrv::UMemory:: gm_init(uint32_t gm_size)
     }
 }
 
-uint32_t aipudrv::UMemory::get_next_alinged_page_no(uint32_t start, uint32_t align, int asid_mem_region)
-{
-    uint32_t no = start;
-    uint32_t asid = (asid_mem_region >> 8) & 0xff;
-    uint32_t mem_region = asid_mem_region & 0xff;
-
-    while (no < m_memblock[asid][mem_region].bit_cnt)
-    {
-        uint64_t pa = m_memblock[asid][mem_region].base + no * AIPU_PAGE_SIZE;
-        if ((pa % (align * AIPU_PAGE_SIZE)) == 0)
-            return no;
-        no++;
-    }
-    return m_memblock[asid][mem_region].bit_cnt;
-}
-
 aipu_status_t aipudrv::UMemory::malloc_internal(uint32_t size, uint32_t align, BufferDesc* desc,
     const char* str, uint32_t asid_mem_region)
 {
@@ -180,6 +444,7 @@ aipu_status_t aipudrv::UMemory::malloc_internal(uint32_t size, uint32_t align, B
     uint64_t malloc_size, malloc_page = 0, i = 0;
     uint32_t asid = (asid_mem_region >> 8) & 0xff;
     uint32_t mem_region = asid_mem_region & 0xff;
+    char *va = nullptr;
     Buffer buf;
 
     if ((size > m_memblock[asid][mem_region].size) || (size == 0))
@@ -191,37 +456,21 @@ aipu_status_t aipudrv::UMemory::malloc_internal(uint32_t size, uint32_t align, B
     malloc_page = get_page_cnt(size);
     malloc_size = malloc_page * AIPU_PAGE_SIZE;
 
-    if (malloc_page > m_memblock[asid][mem_region].bit_cnt)
+    if ((m_memblock[asid][mem_region].bitmap == nullptr) ||
+        (malloc_page > m_memblock[asid][mem_region].bit_cnt))
         return AIPU_STATUS_ERROR_BUF_ALLOC_FAIL;
 
     pthread_rwlock_wrlock(&m_lock);
-    i = get_next_alinged_page_no(0, align, (asid << 8) | mem_region);
-    while ((i + malloc_page) < m_memblock[asid][mem_region].bit_cnt)
+    if (pages_find(m_memblock[asid][mem_region], malloc_page, align, i) &&
+        ((va = pages_map(m_memblock[asid][mem_region], i, malloc_size)) != nullptr))
     {
-        uint64_t j = i;
-        for (; j < (i + malloc_page); j++)
-        {
-            if (m_memblock[asid][mem_region].bitmap[j] == false)
-            {
-                i = get_next_alinged_page_no(j + 1, align, (asid << 8) | mem_region);
-                break;
-            }
-        }
-
-        if (j == i + malloc_page)
-        {
-            desc->init(get_asid_base(asid), m_memblock[asid][mem_region].base + i * AIPU_PAGE_SIZE,
-                malloc_size, size, 0, (asid << 8) | mem_region);
-            buf.init(new char[malloc_size], desc);
-            memset(buf.va, 0, malloc_size);
-            m_allocated[desc->pa] = buf;
-            LOG(LOG_INFO, "m_allocated.size=%ld, buffer_pa=%lx", m_allocated.size(), desc->pa);
-            for (uint32_t j = 0; j < malloc_page; j++)
-                m_memblock[asid][mem_region].bitmap[i + j] = false;
-
-            ret = AIPU_STATUS_SUCCESS;
-            break;
-        }
+        pages_take(m_memblock[asid][mem_region], i, malloc_page);
+        desc->init(get_asid_base(asid), m_memblock[asid][mem_region].base + i * AIPU_PAGE_SIZE,
+            malloc_size, size, 0, (asid << 8) | mem_region);
+        buf.init(va, desc);
+        m_allocated[desc->pa] = buf;
+        LOG(LOG_INFO, "m_allocated.size=%ld, buffer_pa=%lx", m_allocated.size(), desc->pa);
+        ret = AIPU_STATUS_SUCCESS;
     }
     pthread_rwlock_unlock(&m_lock);
 
@@ -237,6 +486,7 @@ aipu_status_t aipudrv::UMemory::malloc(uint32_t size, uint32_t align, BufferDesc
     aipu_status_t ret = AIPU_STATUS_ERROR_BUF_ALLOC_FAIL;
     uint32_t mem_region = asid_mem_cfg & 0xff;
     uint32_t asid = (asid_mem_cfg >> 8) & 0xff;
+    auto start = std::chrono::steady_clock::now();
 
     if (*desc == nullptr)
     {
@@ -266,13 +516,15 @@ aipu_status_t aipudrv::UMemory::malloc(uint32_t size, uint32_t align, BufferDesc
         }
     }
 
+    update_alloc_stats(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count(), ret == AIPU_STATUS_SUCCESS);
     return ret;
 }
 
 aipu_status_t aipudrv::UMemory::free(BufferDesc** desc, const char* str)
 {
     aipu_status_t ret = AIPU_STATUS_SUCCESS;
-    uint64_t b_start, b_end;
+    uint64_t b_start, b_cnt;
     bool reserve_mem_flag = false;
     auto iter = m_allocated.begin();
     DEV_PA_64 pa = 0;
@@ -303,12 +555,11 @@ aipu_status_t aipudrv::UMemory::free(BufferDesc** desc, const char* str)
         int mem_region = (*desc)->ram_region;
         int asid = (*desc)->asid;
         b_start = (iter->second.desc->pa - m_memblock[asid][mem_region].base) / AIPU_PAGE_SIZE;
-        b_end = b_start + iter->second.desc->size / AIPU_PAGE_SIZE;
-        for (uint64_t i = b_start; i < b_end; i++)
-            m_memblock[asid][mem_region].bitmap[i] = true;
+        b_cnt = iter->second.desc->size / AIPU_PAGE_SIZE;
+        pages_give(m_memblock[asid][mem_region], b_start, b_cnt);
 
         LOG(LOG_INFO, "free buffer_pa=%lx\n", iter->second.desc->pa);
-        delete[] iter->second.va;
+        pages_unmap(m_memblock[asid][mem_region], b_start, iter->second.va, iter->second.desc->size);
         iter->second.va = nullptr;
         if (!reserve_mem_flag)
         {
@@ -335,7 +586,7 @@ unlock:
 aipu_status_t aipudrv::UMemory::free_phybuffer(BufferDesc* desc, const char* str)
 {
     aipu_status_t ret = AIPU_STATUS_SUCCESS;
-    uint64_t b_start, b_end;
+    uint64_t b_start, b_cnt;
     bool reserve_mem_flag = false;
     auto iter = m_allocated.begin();
     DEV_PA_64 pa = 0;
@@ -366,12 +617,11 @@ aipu_status_t aipudrv::UMemory::free_phybuffer(BufferDesc* desc, const char* str
         int mem_region = desc->ram_region;
         int asid = desc->asid;
         b_start = (iter->second.desc->pa - m_memblock[asid][mem_region].base) / AIPU_PAGE_SIZE;
-        b_end = b_start + iter->second.desc->size / AIPU_PAGE_SIZE;
-        for (uint64_t i = b_start; i < b_end; i++)
-            m_memblock[asid][mem_region].bitmap[i] = true;
+        b_cnt = iter->second.desc->size / AIPU_PAGE_SIZE;
+        pages_give(m_memblock[asid][mem_region], b_start, b_cnt);
 
         LOG(LOG_INFO, "free buffer_pa=%lx\n", iter->second.desc->pa);
-        delete[] iter->second.va;
+        pages_unmap(m_memblock[asid][mem_region], b_start, iter->second.va, iter->second.desc->size);
         iter->second.va = nullptr;
         if (!reserve_mem_flag)
         {
@@ -421,19 +671,36 @@ aipu_status_t aipudrv::UMemory::reserve_mem(DEV_PA_32 addr, uint32_t size,
     /* clear bitmap for reserved memory page */
     malloc_page = get_page_cnt(size);
     malloc_size = malloc_page * AIPU_PAGE_SIZE;
-    if (malloc_page > m_memblock[asid][mem_region].bit_cnt)
+    i = (addr - m_memblock[asid][mem_region].base) / AIPU_PAGE_SIZE;
+    if ((m_memblock[asid][mem_region].bitmap == nullptr) ||
+        (addr < m_memblock[asid][mem_region].base) ||
+        (i + malloc_page > m_memblock[asid][mem_region].bit_cnt))
+    {
+        pthread_rwlock_unlock(&m_lock);
+        return AIPU_STATUS_ERROR_BUF_ALLOC_FAIL;
+    }
+
+    /* the pages must not belong to a buffer or another reservation */
+    if (bitmap_free_cnt(m_memblock[asid][mem_region], i, malloc_page) != malloc_page)
+    {
+        pthread_rwlock_unlock(&m_lock);
+        LOG(LOG_ERR, "reserve [0x%x, 0x%lx) overlaps a buffer in use\n", addr, addr + malloc_size);
+        return AIPU_STATUS_ERROR_BUF_ALLOC_FAIL;
+    }
+
+    buf.va = pages_map(m_memblock[asid][mem_region], i, malloc_size);
+    if (buf.va == nullptr)
+    {
+        pthread_rwlock_unlock(&m_lock);
         return AIPU_STATUS_ERROR_BUF_ALLOC_FAIL;
+    }
 
     (*desc)->init(get_asid_base(asid), addr, malloc_size, size, 0, (asid << 8) | mem_region);
     buf.desc = *desc;
-    buf.va = new char[size];
-    memset(buf.va, 0, size);
     buf.ref_get();
     m_reserved[(*desc)->pa] = buf;
 
-    i = get_next_alinged_page_no((addr - get_asid_base(asid)) >> 12, 1, (asid << 8) | mem_region);
-    for (uint32_t j = 0; j < malloc_page; j++)
-        m_memblock[asid][mem_region].bitmap[i + j] = false;
+    pages_take(m_memblock[asid][mem_region], i, malloc_page);
 
     pthread_rwlock_unlock(&m_lock);
 
@@ -448,6 +715,7 @@ bool aipudrv::UMemory::invalid(uint64_t addr) const
     bool found = true;
     auto iter = m_allocated.end();
 
+    pthread_rwlock_rdlock(&m_lock);
     for (auto item : m_allocated_buf_map)
     {
         iter = get_allocated_buffer(item, addr);
@@ -460,6 +728,7 @@ bool aipudrv::UMemory::invalid(uint64_t addr) const
             break;
         }
     }
+    pthread_rwlock_unlock(&m_lock);
 
     return (!found) ? true : false;
 }
@@ -469,6 +738,7 @@ bool aipudrv::UMemory::get_info(uint64_t addr, uint64_t &base, uint32_t &size) c
     bool found = true;
     auto iter = m_allocated.end();
 
+    pthread_rwlock_rdlock(&m_lock);
     for (auto item : m_allocated_buf_map)
     {
         iter = get_allocated_buffer(item, addr);
@@ -482,20 +752,20 @@ bool aipudrv::UMemory::get_info(uint64_t addr, uint64_t &base, uint32_t &size) c
         }
     }
 
-    if (!found)
+    if (found)
     {
-        return false;
-    } else {
         base = iter->second.desc->pa;
         size = iter->second.desc->size;
-        return true;
     }
+    pthread_rwlock_unlock(&m_lock);
+
+    return found;
 }
 
 aipu_status_t aipudrv::UMemory::free_all(void)
 {
     aipu_status_t ret = AIPU_STATUS_SUCCESS;
-    uint64_t b_start = 0, b_end = 0;
+    uint64_t b_start = 0, b_cnt = 0;
     const char *promt = nullptr;
     DEV_PA_64 pa = 0;
     uint64_t size = 0;
@@ -516,12 +786,11 @@ aipu_status_t aipudrv::UMemory::free_all(void)
             }
 
             b_start = (desc->pa - m_memblock[asid][mem_region].base) / AIPU_PAGE_SIZE;
-            b_end = b_start + desc->size / AIPU_PAGE_SIZE;
-            for (uint64_t i = b_start; i < b_end; i++)
-                m_memblock[asid][mem_region].bitmap[i] = true;
+            b_cnt = desc->size / AIPU_PAGE_SIZE;
+            pages_give(m_memblock[asid][mem_region], b_start, b_cnt);
 
             LOG(LOG_INFO, "free buffer_pa=%lx\n", desc->pa);
-            delete[] iter->second.va;
+            pages_unmap(m_memblock[asid][mem_region], b_start, iter->second.va, desc->size);
             iter->second.va = nullptr;
             pa = desc->pa;
             size = desc->size;
@@ -540,3 +809,37 @@ aipu_status_t aipudrv::UMemory::free_all(void)
     pthread_rwlock_unlock(&m_lock);
     return ret;
 }
+
+aipu_status_t aipudrv::UMemory::get_mem_stats(aipu_mem_stats_t *stats)
+{
+    MemBlock *block = nullptr;
+    uint64_t largest = 0, alloc_cnt = 0;
+
+    if (stats == nullptr)
+        return AIPU_STATUS_ERROR_NULL_PTR;
+
+    if ((stats->asid >= (uint32_t)m_asid_max) || (stats->asid >= ASID_MAX) ||
+        (stats->mem_type >= MEM_REGION_MAX))
+        return AIPU_STATUS_ERROR_INVALID_OP;
+
+    /* only asid0 has sram/dtcm */
+    block = &m_memblock[stats->asid][(stats->asid == ASID_REGION_0) ? stats->mem_type : MEM_REGION_DDR];
+
+    pthread_rwlock_rdlock(&m_lock);
+    if (!block->free_by_size.empty())
+        largest = block->free_by_size.rbegin()->first;
+    stats->total_bytes = block->bit_cnt * AIPU_PAGE_SIZE;
+    stats->free_bytes = block->free_cnt * AIPU_PAGE_SIZE;
+    stats->largest_free_bytes = largest * AIPU_PAGE_SIZE;
+    stats->free_extent_cnt = block->free_by_start.size();
+    stats->fragmentation = (block->free_cnt == 0) ? 0 : (100 - largest * 100 / block->free_cnt);
+    pthread_rwlock_unlock(&m_lock);
+
+    alloc_cnt = m_alloc_cnt.load();
+    stats->alloc_cnt = alloc_cnt;
+    stats->alloc_fail_cnt = m_alloc_fail_cnt.load();
+    stats->alloc_avg_ns = (alloc_cnt == 0) ? 0 : m_alloc_total_ns.load() / alloc_cnt;
+    stats->alloc_max_ns = m_alloc_max_ns.load();
+
+    return AIPU_STATUS_SUCCESS;
+}
@@ -11,6 +11,10 @@
 #ifndef _UMEMORY_H_
 #define _UMEMORY_H_
 
+#include <map>
+#include <set>
+#include <vector>
+#include <atomic>
 #include "memory_base.h"
 #include "simulator/mem_engine_base.h"
 
@@ -58,11 +62,39 @@ enum {
 #endif
 };
 
+/**
+ * page allocator of one memory region
+ *
+ * bitmap holds one bit per page (set: free) and is used for ownership checks,
+ * the free extents are indexed both by start page (for coalescing) and by
+ * page count (for best-fit search).
+ *
+ * va is a reserved anonymous mapping of the whole region, host pages are
+ * zero-filled on first touch and dropped again when buffers are freed.
+ * With a shared memory file (UMD_SIM_SERVER), the region is mapped from
+ * that file at shm_off instead, or privately if that fails (SHM_OFF_NONE).
+ */
+#define SHM_OFF_NONE (~0UL)
+
 struct MemBlock {
     uint64_t base;
     uint64_t size;
     uint64_t bit_cnt;
-    bool     *bitmap;
+    uint64_t *bitmap;
+    char     *va;
+    uint64_t shm_off;
+    uint64_t free_cnt;
+    std::map<uint64_t, uint64_t> free_by_start;
+    std::set<std::pair<uint64_t, uint64_t>> free_by_size;
+};
+
+/**
+ * placement of one memory region in the shared memory file
+ */
+struct ShmRegion {
+    uint64_t base;
+    uint64_t size;
+    uint64_t offset;
 };
 
 class UMemory: public MemoryBase, public sim_aipu::IMemEngine
@@ -86,8 +118,30 @@ private:
     bool m_gm_mean = false;
     int  m_asid_max = ASID_MAX;
 
+    /* memfd backing all regions, shared with an out-of-process simulator */
+    int  m_shm_fd = -1;
+    uint64_t m_shm_size = 0;
+    bool m_shm_partial = false;
+
+    /* allocation statistics */
+    std::atomic<uint64_t> m_alloc_cnt {0};
+    std::atomic<uint64_t> m_alloc_fail_cnt {0};
+    std::atomic<uint64_t> m_alloc_total_ns {0};
+    std::atomic<uint64_t> m_alloc_max_ns {0};
+
 private:
-    uint32_t get_next_alinged_page_no(uint32_t start, uint32_t align, int mem_region = 0);
+    void memblock_init(MemBlock &block);
+    void memblock_deinit(MemBlock &block);
+    void extent_insert(MemBlock &block, uint64_t start, uint64_t cnt);
+    void extent_erase(MemBlock &block, std::map<uint64_t, uint64_t>::iterator iter);
+    void bitmap_update(MemBlock &block, uint64_t start, uint64_t cnt, bool free);
+    uint64_t bitmap_free_cnt(const MemBlock &block, uint64_t start, uint64_t cnt) const;
+    bool pages_find(const MemBlock &block, uint64_t cnt, uint32_t align, uint64_t &start) const;
+    void pages_take(MemBlock &block, uint64_t start, uint64_t cnt);
+    bool pages_give(MemBlock &block, uint64_t start, uint64_t cnt);
+    char *pages_map(MemBlock &block, uint64_t start, uint64_t size);
+    void pages_unmap(MemBlock &block, uint64_t start, char *va, uint64_t size);
+    void update_alloc_stats(uint64_t ns, bool success);
 
 public:
     uint64_t get_memregion_base(int32_t asid, int32_t region)
@@ -109,6 +163,13 @@ public:
         return m_memblock[asid][region].size;
     }
 
+    /* -1 unless all regions are shared, a server wouldn't see every buffer */
+    int get_shm_fd(void) const
+    {
+        return m_shm_partial ? -1 : m_shm_fd;
+    }
+    void get_shm_regions(std::vector<ShmRegion> &regions) const;
+
 public:
     void gm_init(uint32_t gm_size_idx);
     aipu_status_t malloc_internal(uint32_t size, uint32_t align, BufferDesc* desc,
@@ -121,6 +182,7 @@ public:
     aipu_status_t free_all(void);
     virtual bool invalid(uint64_t addr) const;
     virtual bool get_info(uint64_t addr, uint64_t &base, uint32_t &size) const;
+    virtual aipu_status_t get_mem_stats(aipu_mem_stats_t *stats);
     virtual int64_t read(uint64_t addr, void *dest, size_t size) const
     {
         return mem_read(addr, dest, size);
@@ -0,0 +1,472 @@
+// Copyright (C) 2023-2024 Arm Technology (China) Co. Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+/**
+ * @file  async_log.cpp
+ * @brief UMD asynchronous logging backend implementation
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <ctime>
+#include <mutex>
+#include <pthread.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "standard_api.h"
+#include "log.h"
+
+extern volatile char UMD_LOG_TIMESTAMP;
+
+namespace
+{
+/* single producer (its thread) and single consumer (the writer) */
+struct LogRing
+{
+    LogRecord recs[LOG_ASYNC_RING_SIZE];
+    std::atomic<uint64_t> head{0};
+    char pad[56];                       /**< head and tail on their own cache lines */
+    std::atomic<uint64_t> tail{0};
+    std::atomic<bool> closed{false};    /**< its thread exited */
+    uint32_t tid = 0;
+};
+
+/**
+ * the writer formats the records of all the rings in time order. the
+ * producers read the monotonic clock only, the writer converts it to the
+ * wall clock with an offset and caches the date part per second.
+ */
+class AsyncLogger
+{
+private:
+    std::vector<LogRing*> m_rings;
+    uint64_t m_round = 0;
+    uint64_t m_flush_round = 0;
+    bool m_draining = false;
+    std::atomic<bool> m_wake{false};
+    std::mutex m_lock;
+    std::condition_variable m_cond;
+    std::condition_variable m_done_cond;
+
+    int64_t m_wall_offset = 0;
+    int64_t m_cached_sec = -1;
+    char m_cached_date[64] = {0};
+
+private:
+    void format_ts(uint64_t ts, std::string &line);
+    void format(const LogRecord *rec, std::string &line);
+    void writer();
+
+public:
+    LogRing *add_ring();
+    void flush();
+
+    void wake()
+    {
+        m_wake.store(true, std::memory_order_relaxed);
+        m_cond.notify_one();
+    }
+
+public:
+    AsyncLogger()
+    {
+        std::thread(&AsyncLogger::writer, this).detach();
+    }
+};
+
+/**
+ * created by the first async message, never destroyed since threads may log
+ * during exit. a forked child has no writer thread, it drops the logger of
+ * its parent and creates its own, the generation tells the rings apart.
+ */
+std::atomic<AsyncLogger*> g_logger{nullptr};
+std::atomic<uint32_t> g_generation{0};
+std::mutex g_logger_lock;
+
+/* rings of the exited threads are freed once drained */
+struct LogRingHolder
+{
+    LogRing *ring = nullptr;
+    uint32_t generation = 0;
+
+    ~LogRingHolder()
+    {
+        if (ring != nullptr)
+            ring->closed.store(true, std::memory_order_release);
+        ring = nullptr;
+    }
+};
+thread_local LogRingHolder t_ring;
+
+void fork_prepare()
+{
+    g_logger_lock.lock();
+}
+
+void fork_parent()
+{
+    g_logger_lock.unlock();
+}
+
+void fork_child()
+{
+    g_logger.store(nullptr);
+    g_generation++;
+    g_logger_lock.unlock();
+}
+
+AsyncLogger *get_logger()
+{
+    static bool registered = false;
+    AsyncLogger *logger = g_logger.load();
+
+    if (logger != nullptr)
+        return logger;
+
+    std::lock_guard<std::mutex> lock_(g_logger_lock);
+    if (g_logger.load() == nullptr)
+        g_logger.store(new AsyncLogger);
+
+    if (!registered)
+    {
+        atexit(umd_log_flush);
+        pthread_atfork(fork_prepare, fork_parent, fork_child);
+        registered = true;
+    }
+
+    return g_logger.load();
+}
+
+uint64_t monotonic_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief format one printf conversion of an arg, the length modifier of
+ *        the spec selects the width the arg is cut to like printf does
+ */
+void format_arg(const LogRecord *rec, const LogArg &arg, const char *spec, uint32_t prefix_len,
+    const char *mod, uint32_t mod_len, char conv, std::string &line)
+{
+    char fmt[32] = {0};
+    char buf[512] = {0};
+    int n = 0;
+    bool narrow = (mod_len == 0) || (mod[0] == 'h');
+
+    memcpy(fmt, spec, prefix_len);
+    switch (conv)
+    {
+        case 'd':
+        case 'i':
+            snprintf(fmt + prefix_len, sizeof(fmt) - prefix_len, "ll%c", conv);
+            if ((mod_len == 2) && (mod[0] == 'h'))
+                n = snprintf(buf, sizeof(buf), fmt, (long long)(signed char)arg.val.i);
+            else if (mod_len == 1 && (mod[0] == 'h'))
+                n = snprintf(buf, sizeof(buf), fmt, (long long)(short)arg.val.i);
+            else if (narrow)
+                n = snprintf(buf, sizeof(buf), fmt, (long long)(int)arg.val.i);
+            else
+                n = snprintf(buf, sizeof(buf), fmt, (long long)arg.val.i);
+            break;
+
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+            snprintf(fmt + prefix_len, sizeof(fmt) - prefix_len, "ll%c", conv);
+            if ((mod_len == 2) && (mod[0] == 'h'))
+                n = snprintf(buf, sizeof(buf), fmt, (unsigned long long)(unsigned char)arg.val.u);
+            else if (mod_len == 1 && (mod[0] == 'h'))
+                n = snprintf(buf, sizeof(buf), fmt, (unsigned long long)(unsigned short)arg.val.u);
+            else if (narrow)
+                n = snprintf(buf, sizeof(buf), fmt, (unsigned long long)(unsigned int)arg.val.u);
+            else
+                n = snprintf(buf, sizeof(buf), fmt, (unsigned long long)arg.val.u);
+            break;
+
+        case 'c':
+            fmt[prefix_len] = conv;
+            n = snprintf(buf, sizeof(buf), fmt, (int)arg.val.i);
+            break;
+
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            fmt[prefix_len] = conv;
+            n = snprintf(buf, sizeof(buf), fmt, arg.val.d);
+            break;
+
+        case 's':
+            fmt[prefix_len] = conv;
+            n = snprintf(buf, sizeof(buf), fmt,
+                (arg.type == LOG_ARG_STR) ? &rec->strs[arg.val.u] : "(null)");
+            break;
+
+        case 'p':
+            fmt[prefix_len] = conv;
+            n = snprintf(buf, sizeof(buf), fmt, arg.val.p);
+            break;
+
+        default:
+            line.append(spec, prefix_len + mod_len + 1);
+            return;
+    }
+
+    if (n > 0)
+        line.append(buf, std::min((size_t)n, sizeof(buf) - 1));
+}
+
+/**
+ * @brief format the message of a record, the '*' width and precision
+ *        are not supported
+ */
+void format_msg(const LogRecord *rec, std::string &line)
+{
+    const char *str = rec->fmt;
+    uint32_t idx = 0;
+
+    while (*str != '\0')
+    {
+        const char *pct = strchr(str, '%');
+        const char *end = nullptr;
+        const char *mod = nullptr;
+
+        if (pct == nullptr)
+        {
+            line.append(str);
+            break;
+        }
+
+        line.append(str, pct - str);
+        if (pct[1] == '%')
+        {
+            line += '%';
+            str = pct + 2;
+            continue;
+        }
+
+        /* flags, width, precision, length modifier and conversion */
+        end = pct + 1;
+        end += strspn(end, "-+ #0");
+        end += strspn(end, "0123456789");
+        if (*end == '.')
+        {
+            end++;
+            end += strspn(end, "0123456789");
+        }
+        mod = end;
+        end += strspn(end, "hljztL");
+
+        if ((*end == '\0') || (idx >= rec->argc) || ((end - pct) > 24))
+        {
+            line.append(pct);
+            break;
+        }
+
+        format_arg(rec, rec->args[idx++], pct, mod - pct, mod, end - mod, *end, line);
+        str = end + 1;
+    }
+}
+}
+
+LogRing *AsyncLogger::add_ring()
+{
+    LogRing *ring = new LogRing;
+    std::lock_guard<std::mutex> lock_(m_lock);
+
+    ring->tid = gettid();
+    m_rings.push_back(ring);
+    return ring;
+}
+
+/**
+ * @brief the same text as umd_timestamp_helper(4)
+ */
+void AsyncLogger::format_ts(uint64_t ts, std::string &line)
+{
+    int64_t wall_ns = (int64_t)ts + m_wall_offset;
+    int64_t sec = wall_ns / 1000000000;
+    char us[16] = {0};
+
+    if ((UMD_LOG_TIMESTAMP == 'n') || (UMD_LOG_TIMESTAMP == 'N'))
+        return;
+
+    if (sec != m_cached_sec)
+    {
+        time_t now = (time_t)sec;
+        struct tm now_tm;
+
+        localtime_r(&now, &now_tm);
+        strftime(m_cached_date, sizeof(m_cached_date), "%F %T", &now_tm);
+        m_cached_sec = sec;
+    }
+
+    snprintf(us, sizeof(us), ":%ld", (long)((wall_ns / 1000) % 1000000));
+    line.append(m_cached_date);
+    line.append(us);
+}
+
+void AsyncLogger::format(const LogRecord *rec, std::string &line)
+{
+    const char *flag = nullptr;
+    char tid[32] = {0};
+
+    if (rec->level == LOG_ALERT)
+        flag = " [UMD ALT] ";
+    else if (rec->level == LOG_INFO)
+        flag = " [UMD INF] ";
+    else if (rec->level == LOG_DEBUG)
+        flag = " [UMD DBG] ";
+
+    if (flag != nullptr)
+    {
+        format_ts(rec->ts, line);
+        snprintf(tid, sizeof(tid), "<%u> ", rec->tid);
+        line.append(flag);
+        line.append(tid);
+    }
+
+    format_msg(rec, line);
+    line += '\n';
+}
+
+void AsyncLogger::writer()
+{
+    std::unique_lock<std::mutex> lock_(m_lock);
+    std::vector<std::pair<LogRing*, uint64_t>> tails;
+    std::vector<const LogRecord*> recs;
+    std::string out;
+
+    while (true)
+    {
+        m_cond.wait_for(lock_, std::chrono::milliseconds(LOG_ASYNC_DRAIN_MS),
+            [this] { return m_wake.load(std::memory_order_relaxed) || (m_flush_round > m_round); });
+        m_wake.store(false, std::memory_order_relaxed);
+
+        tails.clear();
+        for (auto ring : m_rings)
+            tails.push_back({ring, ring->tail.load(std::memory_order_acquire)});
+        m_draining = true;
+        lock_.unlock();
+
+        recs.clear();
+        for (auto &iter : tails)
+        {
+            for (uint64_t i = iter.first->head.load(std::memory_order_relaxed); i != iter.second; i++)
+                recs.push_back(&iter.first->recs[i & (LOG_ASYNC_RING_SIZE - 1)]);
+        }
+
+        /* each ring is in order already */
+        std::stable_sort(recs.begin(), recs.end(),
+            [](const LogRecord *a, const LogRecord *b) { return a->ts < b->ts; });
+
+        m_wall_offset = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count() - monotonic_ns();
+        out.clear();
+        for (auto rec : recs)
+            format(rec, out);
+
+        if (!out.empty())
+        {
+            fwrite(out.data(), 1, out.size(), stdout);
+            fflush(stdout);
+        }
+
+        for (auto &iter : tails)
+            iter.first->head.store(iter.second, std::memory_order_release);
+
+        lock_.lock();
+        for (auto iter = m_rings.begin(); iter != m_rings.end();)
+        {
+            LogRing *ring = *iter;
+
+            if (ring->closed.load(std::memory_order_acquire) &&
+                (ring->head.load(std::memory_order_relaxed) == ring->tail.load(std::memory_order_acquire)))
+            {
+                iter = m_rings.erase(iter);
+                delete ring;
+            } else {
+                iter++;
+            }
+        }
+        m_draining = false;
+        m_round++;
+        m_done_cond.notify_all();
+    }
+}
+
+/**
+ * @brief a round draining already may have missed the messages of the
+ *        caller, the next one is waited for then
+ */
+void AsyncLogger::flush()
+{
+    std::unique_lock<std::mutex> lock_(m_lock);
+    uint64_t target = m_round + (m_draining ? 2 : 1);
+
+    m_flush_round = std::max(m_flush_round, target);
+    m_cond.notify_one();
+    m_done_cond.wait(lock_, [this, target] { return m_round >= target; });
+}
+
+LogRecord *umd_log_async_begin(int32_t level, const char *fmt)
+{
+    LogRing *ring = t_ring.ring;
+    LogRecord *rec = nullptr;
+    uint64_t tail = 0;
+
+    if ((ring == nullptr) || (t_ring.generation != g_generation.load(std::memory_order_relaxed)))
+    {
+        t_ring.generation = g_generation.load(std::memory_order_relaxed);
+        ring = get_logger()->add_ring();
+        t_ring.ring = ring;
+    }
+
+    tail = ring->tail.load(std::memory_order_relaxed);
+    while ((tail - ring->head.load(std::memory_order_acquire)) >= LOG_ASYNC_RING_SIZE)
+    {
+        g_logger.load()->wake();
+        std::this_thread::yield();
+    }
+
+    rec = &ring->recs[tail & (LOG_ASYNC_RING_SIZE - 1)];
+    rec->ts = monotonic_ns();
+    rec->fmt = fmt;
+    rec->level = level;
+    rec->tid = ring->tid;
+    rec->argc = 0;
+    rec->str_bytes = 0;
+    return rec;
+}
+
+void umd_log_async_end(LogRecord *rec)
+{
+    LogRing *ring = t_ring.ring;
+    uint64_t tail = ring->tail.load(std::memory_order_relaxed) + 1;
+
+    ring->tail.store(tail, std::memory_order_release);
+
+    /* wake the writer before the ring fills up */
+    if ((tail - ring->head.load(std::memory_order_relaxed)) == (LOG_ASYNC_RING_SIZE / 2))
+        g_logger.load()->wake();
+}
+
+void umd_log_flush(void)
+{
+    AsyncLogger *logger = g_logger.load();
+
+    if (logger != nullptr)
+        logger->flush();
+}
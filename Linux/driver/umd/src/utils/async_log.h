@@ -0,0 +1,172 @@
+// Copyright (C) 2023-2024 Arm Technology (China) Co. Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+/**
+ * @file  async_log.h
+ * @brief UMD asynchronous logging backend header
+ */
+
+#ifndef _ASYNC_LOG_H_
+#define _ASYNC_LOG_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/* records per thread ring, power of 2 */
+#define LOG_ASYNC_RING_SIZE  256
+
+/* args and string bytes of a record, a message with more args is printed at once */
+#define LOG_ASYNC_MAX_ARGS   8
+#define LOG_ASYNC_STR_BYTES  256
+
+/* ms the writer sleeps between two drains if nobody waits for it */
+#define LOG_ASYNC_DRAIN_MS   20
+
+enum LogArgType
+{
+    LOG_ARG_INT,
+    LOG_ARG_UINT,
+    LOG_ARG_DOUBLE,
+    LOG_ARG_PTR,
+    LOG_ARG_STR,    /**< copied to the record, val is the offset */
+};
+
+struct LogArg
+{
+    union
+    {
+        int64_t  i;
+        uint64_t u;
+        double   d;
+        const void *p;
+    } val;
+    uint32_t type;
+};
+
+/**
+ * a message as logged: the format string is a literal, kept by pointer,
+ * and the args are raw values. it is formatted by the writer thread.
+ */
+struct LogRecord
+{
+    uint64_t ts;        /**< ns, monotonic clock */
+    const char *fmt;
+    int32_t level;
+    uint32_t tid;
+    uint32_t argc;
+    uint32_t str_bytes;
+    LogArg args[LOG_ASYNC_MAX_ARGS];
+    char strs[LOG_ASYNC_STR_BYTES];
+};
+
+/**
+ * @brief This function is used to get the record of a message in the ring
+ *        of the calling thread, it waits if the ring is full
+ */
+LogRecord *umd_log_async_begin(int32_t level, const char *fmt);
+
+/**
+ * @brief This function is used to hand a record to the writer thread
+ */
+void umd_log_async_end(LogRecord *rec);
+
+/**
+ * @brief This function is used to print the pending messages, it returns
+ *        once the messages logged before by any thread are printed
+ */
+void umd_log_flush(void);
+
+static inline void umd_log_arg(LogRecord *rec, const char *str)
+{
+    LogArg &arg = rec->args[rec->argc++];
+    uint32_t len = 0;
+
+    arg.type = LOG_ARG_STR;
+    if (rec->str_bytes == LOG_ASYNC_STR_BYTES)
+    {
+        /* no room left, the end of the last string */
+        arg.val.u = LOG_ASYNC_STR_BYTES - 1;
+        return;
+    }
+
+    arg.val.u = rec->str_bytes;
+    if (str == nullptr)
+        str = "(null)";
+
+    /* a long string is cut, the record always ends it */
+    len = strnlen(str, LOG_ASYNC_STR_BYTES - 1 - rec->str_bytes);
+    memcpy(&rec->strs[rec->str_bytes], str, len);
+    rec->str_bytes += len;
+    rec->strs[rec->str_bytes++] = '\0';
+}
+
+static inline void umd_log_arg(LogRecord *rec, char *str)
+{
+    umd_log_arg(rec, (const char *)str);
+}
+
+static inline void umd_log_arg(LogRecord *rec, double val)
+{
+    LogArg &arg = rec->args[rec->argc++];
+
+    arg.type = LOG_ARG_DOUBLE;
+    arg.val.d = val;
+}
+
+template<typename T>
+static inline void umd_log_arg(LogRecord *rec, T *val)
+{
+    LogArg &arg = rec->args[rec->argc++];
+
+    arg.type = LOG_ARG_PTR;
+    arg.val.p = (const void *)val;
+}
+
+template<typename T>
+static inline typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+    umd_log_arg(LogRecord *rec, T val)
+{
+    LogArg &arg = rec->args[rec->argc++];
+
+    if (std::is_signed<T>::value)
+    {
+        arg.type = LOG_ARG_INT;
+        arg.val.i = (int64_t)val;
+    } else {
+        arg.type = LOG_ARG_UINT;
+        arg.val.u = (uint64_t)val;
+    }
+}
+
+static inline void umd_log_args(LogRecord *rec) {}
+
+template<typename T, typename... Args>
+static inline void umd_log_args(LogRecord *rec, T val, Args... args)
+{
+    umd_log_arg(rec, val);
+    umd_log_args(rec, args...);
+}
+
+/**
+ * @brief This function is used to log a message without formatting it,
+ *        false if it has too many args to be logged so
+ */
+template<typename... Args>
+static inline bool umd_log_async(int32_t level, const char *fmt, Args... args)
+{
+    LogRecord *rec = nullptr;
+
+    if (sizeof...(args) > LOG_ASYNC_MAX_ARGS)
+        return false;
+
+    rec = umd_log_async_begin(level, fmt);
+    umd_log_args(rec, args...);
+    umd_log_async_end(rec);
+    return true;
+}
+
+#endif /* _ASYNC_LOG_H_ */
@@ -113,7 +113,8 @@ finish:
     return ret;
 }
 
-aipu_status_t umd_mmap_file_helper(const char* fname, void** data, uint64_t* size)
+aipu_status_t umd_mmap_file_helper(const char* fname, void** data, uint64_t* size,
+    bool read_only)
 {
     aipu_status_t ret = AIPU_STATUS_SUCCESS;
     int fd = 0;
@@ -133,7 +134,7 @@ aipu_status_t umd_mmap_file_helper(const char* fname, void** data, uint64_t* siz
         goto finish;
     }
 
-    fd = open(fname, O_RDWR);
+    fd = open(fname, read_only ? O_RDONLY : O_RDWR);
     if (fd <= 0)
     {
         LOG(LOG_ERR, "open file failed: %s! (errno = %d)\n", fname, errno);
@@ -141,7 +142,10 @@ aipu_status_t umd_mmap_file_helper(const char* fname, void** data, uint64_t* siz
         goto finish;
     }
 
-    p_file = mmap(nullptr, finfo.st_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    if (read_only)
+        p_file = mmap(nullptr, finfo.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    else
+        p_file = mmap(nullptr, finfo.st_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
     if (p_file == MAP_FAILED)
     {
         ret = AIPU_STATUS_ERROR_MAP_FILE_FAIL;
@@ -330,4 +334,26 @@ std::string umd_timestamp_helper(int time_stamp_type)
 	}
 
 	return ss.str();
-}
\ No newline at end of file
+}
+uint64_t umd_monotonic_ns_helper(void)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool umd_lock_until_helper(std::timed_mutex &mtx, uint64_t deadline_ns)
+{
+    uint64_t now = 0;
+
+    if (deadline_ns == 0)
+    {
+        mtx.lock();
+        return true;
+    }
+
+    now = umd_monotonic_ns_helper();
+    if (now >= deadline_ns)
+        return mtx.try_lock();
+
+    return mtx.try_lock_for(std::chrono::nanoseconds(deadline_ns - now));
+}
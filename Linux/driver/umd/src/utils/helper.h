@@ -14,6 +14,7 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <mutex>
 
 /**
  * @brief Align buffer bytes per page_size (4KB)
@@ -55,13 +56,15 @@ aipu_status_t umd_load_file_helper(const char* fname, void* dest, unsigned int s
  * @param[in]  fname File full name
  * @param[out] data  Pointer to file mmap buffer
  * @param[out] size  File size
+ * @param[in]  read_only Map the file read-only and private instead of shared writable
  *
  * @retval AIPU_STATUS_SUCCESS
  * @retval AIPU_STATUS_ERROR_NULL_PTR
  * @retval AIPU_STATUS_ERROR_OPEN_FILE_FAIL
  * @retval AIPU_STATUS_ERROR_MAP_FILE_FAIL
  */
-aipu_status_t umd_mmap_file_helper(const char* fname, void** data, uint64_t* size);
+aipu_status_t umd_mmap_file_helper(const char* fname, void** data, uint64_t* size,
+    bool read_only = false);
 /**
  * @brief This function is used to draw a line composed of a character into an opened file
  *
@@ -96,6 +99,19 @@ void dump_stack(void);
  */
 std::string umd_timestamp_helper(int time_stamp_type = 0);
 
+/**
+ * @brief This function is used to get monotonic time in ns, for measuring elapsed time
+ */
+uint64_t umd_monotonic_ns_helper(void);
+
+/**
+ * @brief This function is used to lock a mutex before a deadline of
+ *        umd_monotonic_ns_helper, 0 waits forever
+ *
+ * @retval true if locked, false on timeout
+ */
+bool umd_lock_until_helper(std::timed_mutex &mtx, uint64_t deadline_ns);
+
 /**
  * @brief This class is for generating runtime.cfg for simulation.
  */
@@ -16,6 +16,7 @@
 #include <sys/syscall.h>
 #include "helper.h"
 #include "debug.h"
+#include "async_log.h"
 
 #define gettid() syscall(SYS_gettid)
 
@@ -34,6 +35,7 @@ enum LogLevel
 };
 
 extern volatile int32_t UMD_LOG_LEVEL;
+extern volatile bool UMD_LOG_ASYNC;
 #define LOG_DETAILED(flag, FMT, ARGS...) \
     printf("%s%s%s:%d:%s: " FMT "\n", umd_timestamp_helper(4).c_str(), \
         (flag), __FILE__, __LINE__, __PRETTY_FUNCTION__, ## ARGS);
@@ -63,9 +65,19 @@ extern volatile int32_t UMD_LOG_LEVEL;
         __android_log_print(ANDROID_LOG_INFO, "UMD", "[%ld]" FMT, gettid(), ## ARGS); \
     } while (0)
 #else
+/**
+ * with UMD_LOG_ASYNC, the messages are formatted by a writer thread. an
+ * error or warning is printed at once, after the pending messages.
+ */
 #define LOG(LogLevel, FMT, ARGS...) do { \
     if (LogLevel > UMD_LOG_LEVEL) \
         break; \
+    if (UMD_LOG_ASYNC) \
+    { \
+        if ((LogLevel > LOG_WARN) && umd_log_async(LogLevel, FMT, ## ARGS)) \
+            break; \
+        umd_log_flush(); \
+    } \
     if (LogLevel==LOG_ERR) \
         LOG_DETAILED("[UMD ERR] ", FMT, ## ARGS) \
     else if (LogLevel==LOG_WARN) \
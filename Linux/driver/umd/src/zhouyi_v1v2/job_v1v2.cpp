@@ -226,7 +226,7 @@ aipu_status_t aipudrv::JobV12::init(const aipu_global_config_simulation_t* cfg,
     m_intr_pc = get_graph().m_text->pa + 0x10;
 
     /* success */
-    m_status = AIPU_JOB_STATUS_INIT;
+    update_job_status(AIPU_JOB_STATUS_INIT);
 
 finish:
     if (ret)
@@ -523,19 +523,22 @@ aipu_status_t aipudrv::JobV12::schedule()
     if (get_graph().m_sram_flag)
         desc.kdesc.exec_flag |= AIPU_JOB_EXEC_FLAG_SRAM_MUTEX;
 
+#if (!defined SIMULATION)
+    /* publish first, the end of the job may be reported before schedule returns */
+    if ((m_is_defer_run == true) && (m_do_trigger == false))
+        update_job_status(AIPU_JOB_STATUS_BIND);
+    else
+        update_job_status(AIPU_JOB_STATUS_SCHED);
+#endif
+
     ret = m_dev->schedule(desc);
     if (ret == AIPU_STATUS_SUCCESS)
     {
 #if (defined SIMULATION)
-        m_status = AIPU_JOB_STATUS_DONE;
-#else
-    if ((m_is_defer_run == true) && (m_do_trigger == false))
-        m_status = AIPU_JOB_STATUS_BIND;
-    else
-        m_status = AIPU_JOB_STATUS_SCHED;
+        update_job_status(AIPU_JOB_STATUS_DONE);
 #endif
     } else {
-        m_status = AIPU_JOB_STATUS_EXCEPTION;
+        update_job_status(AIPU_JOB_STATUS_EXCEPTION);
     }
 
     return ret;
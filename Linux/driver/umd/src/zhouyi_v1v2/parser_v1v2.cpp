@@ -26,7 +26,7 @@ aipudrv::ParserV12::~ParserV12()
     }
 }
 
-aipu_status_t aipudrv::ParserV12::parse_graph_header_check(std::istream& gbin, uint32_t gbin_sz)
+aipu_status_t aipudrv::ParserV12::parse_graph_header_check(std::istream& gbin, uint64_t gbin_sz)
 {
     BinHeaderTop top_header;
     HeaderBottomV12 bot_header;
@@ -134,7 +134,7 @@ aipu_status_t aipudrv::ParserV12::parse_graph_header_bottom(std::istream& gbin,
     return AIPU_STATUS_SUCCESS;
 }
 
-aipu_status_t aipudrv::ParserV12::parse_graph(std::istream& gbin, uint32_t size, Graph& gobj)
+aipu_status_t aipudrv::ParserV12::parse_graph(std::istream& gbin, uint64_t size, Graph& gobj)
 {
     aipu_status_t ret = AIPU_STATUS_SUCCESS;
     BinSection section;
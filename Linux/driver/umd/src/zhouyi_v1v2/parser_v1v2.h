@@ -55,10 +55,10 @@ private:
 
 private:
     aipu_status_t parse_graph_header_bottom(std::istream& gbin, Graph& gobj);
-    aipu_status_t parse_graph_header_check(std::istream& gbin, uint32_t size);
+    aipu_status_t parse_graph_header_check(std::istream& gbin, uint64_t size);
 
 public:
-    aipu_status_t parse_graph(std::istream& gbin, uint32_t size, Graph& gobj);
+    aipu_status_t parse_graph(std::istream& gbin, uint64_t size, Graph& gobj);
     BinSection get_bin_section(SectionType type);
 
 public:
@@ -13,6 +13,7 @@
 #include "graph.h"
 #include "parser_base.h"
 #include "dynamic_shape.h"
+#include "job_base.h"
 #include "utils/helper.h"
 #include "utils/log.h"
 
@@ -27,21 +28,31 @@ aipudrv::DynamicShape::~DynamicShape()
 {
 }
 
+/**
+ * @brief apply the configured shape sizes to this job's IO buffers only,
+ *        the graph's tensor descriptors are shared by all of its jobs
+ *        and keep the sizes from the graph binary.
+ */
 aipu_status_t aipudrv::DynamicShape::update_dynamic_io_tensor_size(aipu_tensor_type_t type)
 {
     aipu_status_t ret = AIPU_STATUS_SUCCESS;
-    GraphV3X &graph_v3x = static_cast<GraphV3X &>(m_graph);
 
     if (type == AIPU_TENSOR_TYPE_INPUT)
     {
-        for (uint32_t i = 0; i < graph_v3x.get_bss(0).io.inputs.size(); i++)
+        std::vector<struct JobIOBuffer> &inputs = m_jobbase.get_inputs_ref();
+
+        for (uint32_t i = 0; i < inputs.size(); i++)
         {
-            graph_v3x.get_bss(0).io.inputs[i].size = get_config_in_tensor_size(i);
+            if (in_config_in_tensor_size(i))
+                inputs[i].size = get_config_in_tensor_size(i);
         }
     } else if (type == AIPU_TENSOR_TYPE_OUTPUT) {
-        for (uint32_t i = 0; i < graph_v3x.get_bss(0).io.outputs.size(); i++)
+        std::vector<struct JobIOBuffer> &outputs = m_jobbase.get_outputs_ref();
+
+        for (uint32_t i = 0; i < outputs.size(); i++)
         {
-            graph_v3x.get_bss(0).io.outputs[i].size = get_config_out_tensor_size(i);
+            if (in_config_out_tensor_size(i))
+                outputs[i].size = get_config_out_tensor_size(i);
         }
     } else {
         LOG(LOG_ERR, "Invalid io tensor type:%d\n", type);
@@ -51,6 +62,69 @@ aipu_status_t aipudrv::DynamicShape::update_dynamic_io_tensor_size(aipu_tensor_t
     return ret;
 }
 
+void aipudrv::DynamicShape::update_tensor_descriptor(aipu_tensor_type_t type, uint32_t tensor,
+    aipu_tensor_desc_t *desc)
+{
+    if ((type == AIPU_TENSOR_TYPE_INPUT) && in_config_in_tensor_size(tensor))
+        desc->size = get_config_in_tensor_size(tensor);
+    else if ((type == AIPU_TENSOR_TYPE_OUTPUT) && in_config_out_tensor_size(tensor))
+        desc->size = get_config_out_tensor_size(tensor);
+}
+
+/**
+ * @brief check whether shape_param resolves to the input shapes of this job,
+ *        inputs not provided take the minimum shape as in set_dynamic_shape_data.
+ */
+bool aipudrv::DynamicShape::match_shape(const aipu_dynshape_param_t *shape_param)
+{
+    const auto& shape_constraint = m_graph.m_input_shape_constraint;
+
+    if (!m_dynamic_shape_set_done || (shape_param == nullptr))
+        return false;
+
+    for (uint32_t idx = 0; idx < shape_constraint.size(); ++idx)
+    {
+        const uint32_t *shape = shape_constraint.at(idx)[0].data();
+        uint32_t rank = shape_constraint.at(idx)[0].size();
+
+        for (uint32_t item_idx = 0; item_idx < shape_param->input_shape_cnt; ++item_idx)
+        {
+            if (shape_param->shape_items[item_idx].ds_idx == idx)
+            {
+                shape = shape_param->shape_items[item_idx].ds_data;
+                break;
+            }
+        }
+
+        if ((shape == nullptr) || (get_config_shape_dim_sz(idx) != rank))
+            return false;
+
+        for (uint32_t dim = 0; dim < rank; dim++)
+        {
+            if (shape[dim] != m_config_in_tensor_shape[idx][dim])
+                return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief forget the output shapes of the last run before the job is reused,
+ *        they're parsed again when it's done.
+ */
+void aipudrv::DynamicShape::reset_out_shape()
+{
+    GraphV3X &graph_v3x = static_cast<GraphV3X &>(m_graph);
+    std::vector<struct JobIOBuffer> &outputs = m_jobbase.get_outputs_ref();
+
+    for (uint32_t i = 0; i < outputs.size(); i++)
+        outputs[i].size = graph_v3x.get_bss(0).io.outputs[i].size;
+
+    clear_config_out_tensor_size();
+    m_dynamic_out_shape_updated = false;
+}
+
 bool aipudrv::DynamicShape::set_dynamic_shape_data(aipu_dynshape_param_t *shape_param)
 {
     auto clear_dynamic_tensor_info = [this]() {
@@ -132,5 +206,5 @@ bool aipudrv::DynamicShape::set_dynamic_shape_data(aipu_dynshape_param_t *shape_
             m_config_in_tensor_size[idx] <<= 2;
     }
 
-    return update_dynamic_io_tensor_size(AIPU_TENSOR_TYPE_INPUT) == AIPU_STATUS_SUCCESS;
+    return true;
 }
\ No newline at end of file
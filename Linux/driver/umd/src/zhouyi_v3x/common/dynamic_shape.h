@@ -46,6 +46,10 @@ private:
 public:
     bool set_dynamic_shape_data(aipu_dynshape_param_t *shape_param);
     aipu_status_t update_dynamic_io_tensor_size(aipu_tensor_type_t type);
+    void update_tensor_descriptor(aipu_tensor_type_t type, uint32_t tensor,
+        aipu_tensor_desc_t *desc);
+    bool match_shape(const aipu_dynshape_param_t *shape_param);
+    void reset_out_shape();
 
 public:
     bool is_set_dyn_shape_true()
@@ -81,6 +85,11 @@ public:
         return m_config_in_tensor_size[input_idx];
     }
 
+    bool in_config_in_tensor_size(uint32_t input_idx)
+    {
+        return m_config_in_tensor_size.count(input_idx) == 1;
+    }
+
     void set_config_out_tensor_size(uint32_t output_idx, uint32_t size)
     {
         m_config_out_tensor_size[output_idx] = size;
@@ -91,6 +100,11 @@ public:
         return m_config_out_tensor_size[output_idx];
     }
 
+    bool in_config_out_tensor_size(uint32_t output_idx)
+    {
+        return m_config_out_tensor_size.count(output_idx) == 1;
+    }
+
     void clear_config_out_tensor_size()
     {
         m_config_out_tensor_size.clear();
@@ -26,7 +26,15 @@
 
 aipudrv::GraphV3X::GraphV3X(void* ctx, GRAPH_ID id, DeviceBase* dev): Graph(ctx, id, dev)
 {
+    const char *job_arena = getenv("UMD_JOB_ARENA");
+    const char *reuse_pool = getenv("UMD_REUSE_POOL");
+
     m_parser = new ParserELF();
+    if ((job_arena != nullptr) && (job_arena[0] == '1'))
+        m_job_arena = true;
+
+    if ((reuse_pool != nullptr) && (atoi(reuse_pool) > 0))
+        m_reuse_pool.configure(atoi(reuse_pool));
 }
 
 aipudrv::GraphV3X::~GraphV3X()
@@ -100,6 +108,80 @@ void aipudrv::GraphV3X::print_parse_info()
     LOG(LOG_DEFAULT, "============================================================");
 }
 
+aipu_status_t aipudrv::GraphV3X::load(std::istream& gbin, uint64_t size, bool ver_check,
+    aipu_load_graph_cfg_t *config)
+{
+    aipu_status_t ret = AIPU_STATUS_SUCCESS;
+    std::vector<BufferDesc*> no_weights;
+
+    ret = Graph::load(gbin, size, ver_check, config);
+    if ((ret != AIPU_STATUS_SUCCESS) || m_bss_vec.empty())
+        return ret;
+
+    /* weights are placed by now, their entries are the same for all jobs */
+    m_ro_tmpl.build(m_brodata, m_bdesc, m_bss_vec[0].param_map,
+        m_weight_buffers_vec.empty() ? no_weights : m_weight_buffers_vec[0].wb_weights,
+        m_bss_vec[0].reuse_sections.size());
+    LOG(LOG_DEBUG, "graph 0x%lx rodata template: %s, %u reuse entries", m_id,
+        m_ro_tmpl.is_valid() ? "valid" : "invalid", m_ro_tmpl.get_reuse_entry_cnt());
+
+    init_reuse_pool();
+    return ret;
+}
+
+aipu_status_t aipudrv::GraphV3X::unload()
+{
+    aipu_status_t ret = AIPU_STATUS_SUCCESS;
+
+    ret = Graph::unload();
+    if (ret != AIPU_STATUS_SUCCESS)
+        return ret;
+
+    /* no job holds a slot any more */
+    m_reuse_pool.free();
+    return ret;
+}
+
+/**
+ * @brief pool the reuse sections no tensor of the application refers to,
+ *        they only live while a job runs. the IO ones stay per job.
+ */
+void aipudrv::GraphV3X::init_reuse_pool()
+{
+    const BSS &bss = m_bss_vec[0];
+    const std::vector<GraphIOTensorDesc> *tensors[] = {
+        &bss.io.inputs, &bss.io.outputs, &bss.io.inter_dumps, &bss.io.profiler,
+        &bss.io.printf, &bss.io.layer_counter, &bss.io.err_code, &bss.io.segmmus,
+        &bss.io.outputs_shape
+    };
+    std::set<uint32_t> io_idx, reuse_idx;
+
+    /* dynamic shapes resize the sections per job */
+    if (is_dynamic_shape())
+        return;
+
+    for (auto desc : tensors)
+    {
+        for (auto &tensor : *desc)
+            io_idx.insert(tensor.ref_section_iter);
+    }
+
+    for (uint32_t k = 0; k < bss.reuse_sections.size(); k++)
+    {
+        /* jobs skip empty sections, their reuse indexes don't match any more */
+        if (bss.reuse_sections[k].size == 0)
+            return;
+
+        if (io_idx.count(k) == 0)
+            reuse_idx.insert(k);
+    }
+
+    m_reuse_pool.set_sections(m_mem, bss.reuse_sections, reuse_idx);
+    if (m_reuse_pool.is_enabled())
+        LOG(LOG_DEBUG, "graph 0x%lx reuse pool: %u of %u sections\n", m_id,
+            (uint32_t)reuse_idx.size(), (uint32_t)bss.reuse_sections.size());
+}
+
 aipu_status_t aipudrv::GraphV3X::extract_gm_info(int sg_id)
 {
     aipu_status_t ret = AIPU_STATUS_SUCCESS;
@@ -199,6 +281,7 @@ aipu_status_t aipudrv::GraphV3X::create_job(JOB_ID* id, const aipu_global_config
 #elif (defined ZHOUYI_V3_1)
     JobV3_1 *job = nullptr;
 #endif
+    JobBase *pooled_job = nullptr;
     uint32_t part_cnt = 0;
 
     if (job_config == nullptr)
@@ -227,12 +310,31 @@ aipu_status_t aipudrv::GraphV3X::create_job(JOB_ID* id, const aipu_global_config
     }
 #endif
 
+    /* a cleaned job with identical config still has its buffers and TCB chain */
+    pooled_job = get_pooled_job(job_config);
+    if (pooled_job != nullptr)
+    {
+        *id = add_job(pooled_job);
+        return AIPU_STATUS_SUCCESS;
+    }
+
+    for (uint32_t retry = 0; ; retry++)
+    {
 #if (defined ZHOUYI_V3)
-    job = new JobV3((MainContext*)m_ctx, *this, m_dev, job_config);
+        job = new JobV3((MainContext*)m_ctx, *this, m_dev, job_config);
 #elif (defined ZHOUYI_V3_1)
-    job = new JobV3_1((MainContext*)m_ctx, *this, m_dev, job_config);
+        job = new JobV3_1((MainContext*)m_ctx, *this, m_dev, job_config);
 #endif
-    ret = job->init(glb_sim_cfg, hw_cfg);
+        ret = job->init(glb_sim_cfg, hw_cfg);
+
+        /* the cleaned jobs may hold the memory this one misses, retry once without them */
+        if ((ret != AIPU_STATUS_ERROR_BUF_ALLOC_FAIL) || (retry > 0) || !drain_job_pool())
+            break;
+
+        LOG(LOG_DEBUG, "graph 0x%lx: job pool drained to retry job creation\n", m_id);
+        job->destroy();
+        delete job;
+    }
     *id = add_job(job);
     return ret;
 }
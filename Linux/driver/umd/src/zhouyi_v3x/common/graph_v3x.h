@@ -15,6 +15,9 @@
 #include <vector>
 #include <deque>
 #include "graph.h"
+#include "rodata_template.h"
+#include "job_arena.h"
+#include "reuse_pool.h"
 
 namespace aipudrv
 {
@@ -156,12 +159,25 @@ private:
     BinSection m_bsegmmu;
     bool m_fake_subgraph = false;
 
+    /* bss 0 rodata/dcr with the weight entries relocated, copied by each job */
+    RodataTemplate m_ro_tmpl;
+
+    /* jobs get their buffers from one arena, env UMD_JOB_ARENA=1 enables it */
+    bool m_job_arena = false;
+    JobArenaLayoutCache m_arena_layouts;
+    /* intermediate reuse sections shared by jobs, env UMD_REUSE_POOL=<slots> enables it */
+    ReusePool m_reuse_pool;
+
 public:
     std::map<uint32_t, GM_info_desc> m_gm_info[2];
     uint32_t m_segmmu_num = 0;
 
 public:
     void print_parse_info();
+    aipu_status_t load(std::istream& gbin, uint64_t size, bool ver_check = true,
+        aipu_load_graph_cfg_t *config = nullptr);
+    aipu_status_t unload();
+    void init_reuse_pool();
     aipu_status_t extract_gm_info(int sg_id);
     aipu_status_t create_job(JOB_ID* id, const aipu_global_config_simulation_t* cfg,
         aipu_global_config_hw_t* hw_cfg, aipu_create_job_cfg_t *config  = nullptr);
@@ -321,6 +337,26 @@ public:
         return m_bss_vec[bss_id].static_sections;
     }
 
+    const RodataTemplate &get_rodata_template() const
+    {
+        return m_ro_tmpl;
+    }
+
+    bool is_job_arena_enabled() const
+    {
+        return m_job_arena;
+    }
+
+    JobArenaLayoutCache &get_arena_layouts()
+    {
+        return m_arena_layouts;
+    }
+
+    ReusePool &get_reuse_pool()
+    {
+        return m_reuse_pool;
+    }
+
 public:
     GraphV3X(void* ctx, GRAPH_ID id, DeviceBase* dev);
     ~GraphV3X();
@@ -329,6 +365,7 @@ public:
 
     friend class JobV3;
     friend class JobV3_1;
+    friend struct JobArenaLayout;
 };
 }
 
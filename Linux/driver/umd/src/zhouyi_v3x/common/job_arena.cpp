@@ -0,0 +1,328 @@
+// Copyright (C) 2023-2024 Arm Technology (China) Co. Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+/**
+ * @file  job_arena.cpp
+ * @brief AIPU User Mode Driver (UMD) per-job buffer arena module implementation
+ */
+
+#include <algorithm>
+#include "job_arena.h"
+#include "graph_v3x.h"
+#include "parser_base.h"
+#include "utils/log.h"
+
+std::string aipudrv::JobArenaSpec::get_key() const
+{
+    std::string key = std::to_string(tcb_size) + "_" + std::to_string(task_per_sg) + "_" +
+        std::to_string(fm_mem_region);
+
+    if (modelparam)
+        key += "_mp";
+
+    for (auto k : gm_reuse_idx)
+        key += "_gm" + std::to_string(k);
+
+    for (auto k : fm_reuse_idx)
+        key += "_fm" + std::to_string(k);
+
+    if (!pool_reuse_idx.empty())
+        key += "_pool";
+
+    return key;
+}
+
+uint64_t aipudrv::JobArenaLayout::place(uint32_t arena, uint64_t bytes, uint32_t align)
+{
+    uint64_t align_bytes = 0, offset = 0;
+
+    if (align == 0)
+        align = 1;
+
+    align_bytes = (uint64_t)align * AIPU_PAGE_SIZE;
+    offset = (size[arena] + align_bytes - 1) / align_bytes * align_bytes;
+    size[arena] = offset + ALIGN_PAGE(bytes);
+    align_in_page[arena] = std::max(align_in_page[arena], align);
+    return offset;
+}
+
+/**
+ * @brief place the buffers as the scattered allocation of a job would
+ *        allocate them: the load buffers, the subgraph buffers and those of
+ *        init_per_task_data.
+ */
+void aipudrv::JobArenaLayout::plan(GraphV3X &graph, const JobArenaSpec &spec)
+{
+    const BSS &bss = graph.get_bss(0);
+    uint32_t private_size = 0, max_private_size = 0;
+    uint32_t allocated_cnt = 0, sg_idx = 0;
+    bool dep_all_flag = false;
+
+    if (spec.modelparam)
+        modelparam = place(ARENA_DEFAULT, graph.m_bglobalparam.size);
+
+    if (graph.m_brodata.size != 0)
+        rodata = place(ARENA_DEFAULT, graph.m_brodata.size);
+
+    if (graph.m_bdesc.size != 0)
+        dcr = place(ARENA_DEFAULT, graph.m_bdesc.size);
+
+    tcbs = place(ARENA_DEFAULT, spec.tcb_size);
+    if (spec.tcbs_bkup)
+        tcbs_bkup = place(ARENA_DEFAULT, spec.tcb_size);
+
+    if (graph.get_subgraph_cnt() > 0 && graph.get_subgraph(0).printfifo_size > 0)
+        printf_buf = place(ARENA_DEFAULT, graph.get_subgraph_cnt() * AIPU_PAGE_SIZE);
+
+    for (uint32_t i = 0; i < spec.sg_cnt; i++)
+    {
+        const auto& sg = graph.get_subgraph(i);
+
+        if (sg.precursor_cnt == SUBG_DEPEND_PREALL)
+            private_size = 0;
+
+        for (uint32_t pr_idx = 0; pr_idx < sg.private_buffers.size(); pr_idx++)
+            private_size += ALIGN_PAGE(sg.private_buffers[pr_idx].size);
+        max_private_size = std::max(max_private_size, private_size);
+    }
+
+    if (max_private_size > 0)
+        priv = place(ARENA_DEFAULT, max_private_size);
+
+    /* subgraphs depending on all the previous ones reuse their tasks' stack and dp */
+    for (uint32_t i = 0; i < spec.sg_cnt; i++)
+    {
+        if (i != 0)
+        {
+            if (graph.get_subgraph(i).precursor_cnt == SUBG_DEPEND_PREALL)
+            {
+                sg_idx = 0;
+                dep_all_flag = true;
+            }
+
+            if (dep_all_flag && sg_idx < allocated_cnt)
+            {
+                sg_idx++;
+                continue;
+            }
+            dep_all_flag = false;
+        }
+
+        for (uint32_t j = 0; j < spec.task_per_sg; j++)
+        {
+            stacks.push_back(place(ARENA_DEFAULT, bss.stack_size, bss.stack_align_in_page));
+            if (graph.get_subgraph(i).private_data_size != 0)
+                dps.push_back(place(ARENA_DEFAULT, graph.get_subgraph(i).private_data_size));
+            else
+                dps.push_back(ARENA_NONE);
+        }
+        allocated_cnt++;
+    }
+
+    if (spec.fm_mem_region != AIPU_MEM_REGION_DEFAULT)
+        reuse_arena = ARENA_REUSE;
+
+    for (uint32_t k = 0; k < bss.reuse_sections.size(); k++)
+    {
+        const GraphSectionDesc &section_desc = bss.reuse_sections[k];
+
+        if ((section_desc.size == 0) || (spec.gm_reuse_idx.count(k) == 1) ||
+            ((spec.fm_reuse_idx.count(k) == 1) && (spec.fm_mem_region == AIPU_MEM_REGION_DEFAULT)) ||
+            (spec.pool_reuse_idx.count(k) == 1))
+            reuses.push_back(ARENA_NONE);
+        else
+            reuses.push_back(place(reuse_arena, section_desc.size, section_desc.align_in_page));
+    }
+}
+
+/**
+ * @brief allocate the arena(s) of a job, the layout is planned by the first
+ *        job of the graph with this spec. on failure the job allocates its
+ *        buffers apart.
+ */
+aipu_status_t aipudrv::JobArena::alloc(GraphV3X &graph, const JobArenaSpec &spec)
+{
+    aipu_status_t ret = AIPU_STATUS_SUCCESS;
+    uint64_t asid_pa = 0;
+    std::string key;
+
+    if (!graph.is_job_arena_enabled())
+        return AIPU_STATUS_ERROR_OP_NOT_SUPPORTED;
+
+    key = spec.get_key();
+    m_layout = graph.get_arena_layouts().get(key);
+    if (m_layout == nullptr)
+    {
+        std::shared_ptr<JobArenaLayout> layout = std::make_shared<JobArenaLayout>();
+
+        layout->plan(graph, spec);
+        m_layout = graph.get_arena_layouts().put(key, layout);
+    }
+
+    ret = alloc_regions(*m_layout, spec.fm_mem_region);
+    if (ret != AIPU_STATUS_SUCCESS)
+        goto fail;
+
+    /* the scattered way handles TCBs at ASID offset 0 */
+    asid_pa = m_bufs[ARENA_DEFAULT]->align_asid_pa;
+    if (spec.tcbs_off_asid_base && ((asid_pa + m_layout->tcbs == 0) ||
+        ((m_layout->tcbs_bkup != ARENA_NONE) && (asid_pa + m_layout->tcbs_bkup == 0))))
+    {
+        ret = AIPU_STATUS_ERROR_BUF_ALLOC_FAIL;
+        goto fail;
+    }
+
+    return ret;
+
+fail:
+    free();
+    return ret;
+}
+
+aipu_status_t aipudrv::JobArena::alloc_regions(const JobArenaLayout &layout, uint32_t reuse_region)
+{
+    aipu_status_t ret = AIPU_STATUS_SUCCESS;
+    const char *name[ARENA_CNT] = {"job_arena", "job_arena_fm"};
+    uint32_t region[ARENA_CNT] = {AIPU_MEM_REGION_DEFAULT, reuse_region};
+
+    for (uint32_t i = 0; i < ARENA_CNT; i++)
+    {
+        if (layout.size[i] == 0)
+            continue;
+
+        /* the allocator takes 32-bit sizes */
+        if (layout.size[i] > UINT32_MAX)
+        {
+            ret = AIPU_STATUS_ERROR_BUF_ALLOC_FAIL;
+            break;
+        }
+
+        ret = m_mem->malloc(layout.size[i], layout.align_in_page[i], &m_bufs[i], name[i], region[i]);
+        if (ret != AIPU_STATUS_SUCCESS)
+            break;
+    }
+
+    if ((ret != AIPU_STATUS_SUCCESS) || (m_bufs[ARENA_DEFAULT] == nullptr))
+    {
+        LOG(LOG_DEBUG, "alloc job arena 0x%lx/0x%lx [fail], allocate buffers apart",
+            layout.size[ARENA_DEFAULT], layout.size[ARENA_REUSE]);
+        free();
+        if (ret == AIPU_STATUS_SUCCESS)
+            ret = AIPU_STATUS_ERROR_BUF_ALLOC_FAIL;
+    }
+
+    return ret;
+}
+
+aipudrv::BufferDesc* aipudrv::JobArena::carve(uint32_t arena, uint64_t offset,
+    uint64_t size, uint64_t req_size)
+{
+    BufferDesc *buf = new BufferDesc;
+
+    buf->reset();
+    buf->init(m_bufs[arena]->asid_base, m_bufs[arena]->pa + offset, size, req_size);
+    return buf;
+}
+
+/**
+ * @brief the private buffers of each subgraph, a subgraph depending on all
+ *        the previous ones reuses theirs
+ */
+void aipudrv::JobArena::carve_private(GraphV3X &graph, uint32_t sg_cnt, bool zero,
+    std::vector<std::vector<BufferDesc*>> &bufs)
+{
+    uint64_t priv_offset = 0;
+
+    bufs.resize(sg_cnt);
+    for (uint32_t sg_idx = 0; sg_idx < sg_cnt; sg_idx++)
+    {
+        const auto& sg = graph.get_subgraph(sg_idx);
+
+        if (sg.precursor_cnt == SUBG_DEPEND_PREALL)
+            priv_offset = 0;
+
+        for (uint32_t k = 0; k < sg.private_buffers.size(); k++)
+        {
+            const GraphSectionDesc &section_desc = sg.private_buffers[k];
+            BufferDesc *buf = nullptr;
+
+            if (section_desc.size == 0)
+                continue;
+
+            buf = carve(ARENA_DEFAULT, m_layout->priv + priv_offset, ALIGN_PAGE(section_desc.size),
+                section_desc.size);
+            priv_offset += ALIGN_PAGE(section_desc.size);
+            if (zero)
+                m_mem->mem_bzero(buf->pa, buf->size);
+            bufs[sg_idx].push_back(buf);
+        }
+    }
+}
+
+/* reuse section k if it's placed in the arena, the job allocates it otherwise */
+aipudrv::BufferDesc* aipudrv::JobArena::carve_reuse(uint32_t k, uint64_t size)
+{
+    if ((k >= get_layout().reuses.size()) || (m_layout->reuses[k] == ARENA_NONE))
+        return nullptr;
+
+    return carve(m_layout->reuse_arena, m_layout->reuses[k], ALIGN_PAGE(size), size);
+}
+
+/* a buffer from the arena if it's active and places it, apart otherwise */
+aipu_status_t aipudrv::JobArena::alloc_buf(uint64_t offset, uint32_t size, uint32_t align,
+    BufferDesc **buf, const char *name)
+{
+    if (is_active() && (offset != ARENA_NONE))
+    {
+        *buf = carve(ARENA_DEFAULT, offset, ALIGN_PAGE(size), size);
+        return AIPU_STATUS_SUCCESS;
+    }
+
+    return m_mem->malloc(size, align, buf, name);
+}
+
+void aipudrv::JobArena::free_buf(BufferDesc **buf, const char *name)
+{
+    if (owns(*buf))
+        m_mem->free_bufferdesc(buf);
+    else
+        m_mem->free(buf, name);
+}
+
+void aipudrv::JobArena::free()
+{
+    for (uint32_t i = 0; i < ARENA_CNT; i++)
+    {
+        if (m_bufs[i] != nullptr)
+            m_mem->free(&m_bufs[i], "job_arena");
+    }
+    m_layout = nullptr;
+}
+
+uint64_t aipudrv::JobArena::get_bytes() const
+{
+    uint64_t bytes = 0;
+
+    for (uint32_t i = 0; i < ARENA_CNT; i++)
+    {
+        if (m_bufs[i] != nullptr)
+            bytes += m_bufs[i]->size;
+    }
+    return bytes;
+}
+
+bool aipudrv::JobArena::owns(const BufferDesc *buf) const
+{
+    if (buf == nullptr)
+        return false;
+
+    for (uint32_t i = 0; i < ARENA_CNT; i++)
+    {
+        if ((m_bufs[i] != nullptr) && (buf->pa >= m_bufs[i]->pa) &&
+            (buf->pa < m_bufs[i]->pa + m_bufs[i]->size))
+            return true;
+    }
+    return false;
+}
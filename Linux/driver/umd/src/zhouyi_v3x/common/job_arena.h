@@ -0,0 +1,177 @@
+// Copyright (C) 2023-2024 Arm Technology (China) Co. Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+/**
+ * @file  job_arena.h
+ * @brief AIPU User Mode Driver (UMD) per-job buffer arena module header
+ */
+
+#ifndef _JOB_ARENA_H_
+#define _JOB_ARENA_H_
+
+#include <map>
+#include <mutex>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include "memory_base.h"
+
+namespace aipudrv
+{
+class GraphV3X;
+
+/* the buffer isn't placed in an arena */
+#define ARENA_NONE ((uint64_t)-1)
+
+enum
+{
+    ARENA_DEFAULT = 0,     /**< arena in the default region */
+    ARENA_REUSE,           /**< reuse buffers in the job's feature map region */
+    ARENA_CNT
+};
+
+/**
+ * what a job's config changes in its arena layout, filled by the job. the
+ * version hooks: aipu v3 keeps a backup of its TCBs and mustn't have them
+ * at ASID offset 0.
+ */
+struct JobArenaSpec
+{
+    uint32_t tcb_size = 0;
+    uint32_t task_per_sg = 0;
+    uint32_t sg_cnt = 0;
+    uint32_t fm_mem_region = AIPU_MEM_REGION_DEFAULT;
+    bool modelparam = false;
+    bool tcbs_bkup = false;
+    bool tcbs_off_asid_base = false;
+
+    /* reuse sections in GM, in the feature map region and in the reuse pool */
+    std::set<uint32_t> gm_reuse_idx;
+    std::set<uint32_t> fm_reuse_idx;
+    std::set<uint32_t> pool_reuse_idx;
+
+    std::string get_key() const;
+};
+
+/**
+ * offsets of a job's buffers in its arenas. all of them are in the
+ * default arena, except the reuse buffers if the job puts its feature
+ * maps in a specific region. page granularity like separate allocations.
+ */
+struct JobArenaLayout
+{
+    uint64_t modelparam = ARENA_NONE;
+    uint64_t rodata = ARENA_NONE;
+    uint64_t dcr = ARENA_NONE;
+    uint64_t tcbs = ARENA_NONE;
+    uint64_t tcbs_bkup = ARENA_NONE;
+    uint64_t printf_buf = ARENA_NONE;
+
+    /* private buffers of all subgraphs, like the top private buffer */
+    uint64_t priv = ARENA_NONE;
+
+    /* stack and dp of each allocated task, in init_per_task_data order */
+    std::vector<uint64_t> stacks;
+    std::vector<uint64_t> dps;
+
+    /* per reuse section, GM and specified ones are allocated apart */
+    std::vector<uint64_t> reuses;
+    uint32_t reuse_arena = ARENA_DEFAULT;
+
+    uint64_t size[ARENA_CNT] = {0};
+    uint32_t align_in_page[ARENA_CNT] = {1, 1};
+
+    /* layout helper, returns the offset of a new item */
+    uint64_t place(uint32_t arena, uint64_t bytes, uint32_t align = 1);
+    void plan(GraphV3X &graph, const JobArenaSpec &spec);
+};
+
+/**
+ * one allocation per region for all device buffers of a job, the buffer
+ * descriptors of the job point into it. a job in arena mode frees its
+ * descriptors only, then the arenas, by one allocator call each.
+ */
+class JobArena
+{
+private:
+    MemoryBase *m_mem = nullptr;
+    BufferDesc *m_bufs[ARENA_CNT] = {nullptr, nullptr};
+    std::shared_ptr<const JobArenaLayout> m_layout;
+
+private:
+    aipu_status_t alloc_regions(const JobArenaLayout &layout, uint32_t reuse_region);
+
+public:
+    aipu_status_t alloc(GraphV3X &graph, const JobArenaSpec &spec);
+    BufferDesc* carve(uint32_t arena, uint64_t offset, uint64_t size, uint64_t req_size);
+    void carve_private(GraphV3X &graph, uint32_t sg_cnt, bool zero,
+        std::vector<std::vector<BufferDesc*>> &bufs);
+    BufferDesc* carve_reuse(uint32_t k, uint64_t size);
+    aipu_status_t alloc_buf(uint64_t offset, uint32_t size, uint32_t align, BufferDesc **buf,
+        const char *name);
+    void free_buf(BufferDesc **buf, const char *name);
+    void free();
+    uint64_t get_bytes() const;
+    bool owns(const BufferDesc *buf) const;
+
+    /* the layout of an active arena, an empty one places nothing */
+    const JobArenaLayout &get_layout() const
+    {
+        static const JobArenaLayout none;
+
+        return (m_layout != nullptr) ? *m_layout : none;
+    }
+
+    const BufferDesc* get_buf(uint32_t arena) const
+    {
+        return m_bufs[arena];
+    }
+
+    bool is_active() const
+    {
+        return m_bufs[ARENA_DEFAULT] != nullptr;
+    }
+
+public:
+    JobArena(MemoryBase *mem): m_mem(mem) {}
+    ~JobArena()
+    {
+        free();
+    }
+    JobArena(const JobArena& arena) = delete;
+    JobArena& operator=(const JobArena& arena) = delete;
+};
+
+/**
+ * arena layouts of a graph's jobs, keyed by what a job config changes
+ * in them, so that the layout is computed once per graph and config.
+ */
+class JobArenaLayoutCache
+{
+private:
+    std::map<std::string, std::shared_ptr<const JobArenaLayout>> m_layouts;
+    std::mutex m_lock;
+
+public:
+    std::shared_ptr<const JobArenaLayout> get(const std::string &key)
+    {
+        std::lock_guard<std::mutex> lock_(m_lock);
+        auto iter = m_layouts.find(key);
+
+        return (iter == m_layouts.end()) ? nullptr : iter->second;
+    }
+
+    std::shared_ptr<const JobArenaLayout> put(const std::string &key,
+        std::shared_ptr<const JobArenaLayout> layout)
+    {
+        std::lock_guard<std::mutex> lock_(m_lock);
+
+        return m_layouts.emplace(key, layout).first->second;
+    }
+};
+}
+
+#endif /* _JOB_ARENA_H_ */
@@ -31,44 +31,105 @@ aipu_status_t aipudrv::ParserELF::parse_graph_header_bottom(std::istream& gbin)
 aipudrv::BinSection aipudrv::ParserELF::get_bin_note(const std::string& note_name)
 {
     aipudrv::BinSection ro = {nullptr, 0};
+    const char *note = m_note.va;
+    uint64_t left = m_note.size;
 
-    if (m_note)
+    /**
+     * note entry: namesz, descsz, type (4 bytes each), then name and desc,
+     * each padded to 4 bytes for both ELF classes
+     */
+    while ((note != nullptr) && (left >= 3 * sizeof(uint32_t)))
     {
-        ELFIO::note_section_accessor notes(m_elf, m_note);
-        ELFIO::Elf_Word no_notes = notes.get_notes_num();
-        for (ELFIO::Elf_Word j = 0; j < no_notes; ++j)
-        {
-            ELFIO::Elf_Word type;
-            std::string name;
-            void *desc;
-            ELFIO::Elf_Word size;
+        uint32_t namesz = *(const uint32_t *)note;
+        uint32_t descsz = *(const uint32_t *)(note + sizeof(uint32_t));
+        uint64_t name_len = ((uint64_t)namesz + 3) & ~(uint64_t)3;
+        uint64_t desc_len = ((uint64_t)descsz + 3) & ~(uint64_t)3;
+        const char *name = note + 3 * sizeof(uint32_t);
 
-            if (notes.get_note(j, type, name, desc, size))
-            {
-                if (name == note_name)
-                {
-                    ro.va = (char *)desc;
-                    ro.size = size;
-                    break;
-                }
-            }
+        left -= 3 * sizeof(uint32_t);
+        if ((name_len > left) || (descsz > left - name_len))
+            break;
+
+        if (note_name == std::string(name, strnlen(name, namesz)))
+        {
+            ro.va = name + name_len;
+            ro.size = descsz;
+            break;
         }
+
+        if (name_len + desc_len > left)
+            break;
+
+        note = name + name_len + desc_len;
+        left -= name_len + desc_len;
     }
     return ro;
 }
 
-ELFIO::section* aipudrv::ParserELF::get_elf_section(const std::string& section_name)
+/**
+ * @brief locate the sections UMD needs directly in the graph binary image,
+ *        without copying them; only the first section of a name is used.
+ */
+template <typename Ehdr, typename Shdr>
+aipu_status_t aipudrv::ParserELF::parse_elf_sections(const char* image, uint64_t size)
 {
-    ELFIO::Elf_Half no = m_elf.sections.size();
+    const Ehdr *ehdr = (const Ehdr *)image;
+    const Shdr *shdr = nullptr;
+    const char *shstrtab = nullptr;
+    uint64_t shstrtab_size = 0;
+
+    if (size < sizeof(Ehdr))
+        return AIPU_STATUS_ERROR_INVALID_GBIN;
+
+    if ((ehdr->e_shentsize != sizeof(Shdr)) || (ehdr->e_shoff > size)
+        || ((size - ehdr->e_shoff) / sizeof(Shdr) < ehdr->e_shnum)
+        || (ehdr->e_shstrndx >= ehdr->e_shnum))
+        return AIPU_STATUS_ERROR_INVALID_GBIN;
+
+    shdr = (const Shdr *)(image + ehdr->e_shoff);
+    if ((shdr[ehdr->e_shstrndx].sh_offset > size)
+        || (shdr[ehdr->e_shstrndx].sh_size > size - shdr[ehdr->e_shstrndx].sh_offset))
+        return AIPU_STATUS_ERROR_INVALID_GBIN;
 
-    for (ELFIO::Elf_Half i = 0; i < no; ++i)
+    shstrtab = image + shdr[ehdr->e_shstrndx].sh_offset;
+    shstrtab_size = shdr[ehdr->e_shstrndx].sh_size;
+
+    m_text.init(nullptr, 0);
+    m_crodata.init(nullptr, 0);
+    m_data.init(nullptr, 0);
+    m_note.init(nullptr, 0);
+    for (uint32_t i = 0; i < ehdr->e_shnum; i++)
     {
-        ELFIO::section *sec = m_elf.sections[i];
+        BinSection *sec = nullptr;
+        std::string name;
+
+        if (shdr[i].sh_name >= shstrtab_size)
+            continue;
+
+        name.assign(shstrtab + shdr[i].sh_name,
+            strnlen(shstrtab + shdr[i].sh_name, shstrtab_size - shdr[i].sh_name));
+        if (name == ".text")
+            sec = &m_text;
+        else if (name == ".rodata")
+            sec = &m_crodata;
+        else if (name == ".data")
+            sec = &m_data;
+        else if (name == ".note.aipu")
+            sec = &m_note;
+
+        if ((sec == nullptr) || (sec->va != nullptr))
+            continue;
 
-        if (section_name == sec->get_name())
-            return sec;
+        if (shdr[i].sh_type == SHT_NOBITS)
+            continue;
+
+        if ((shdr[i].sh_offset > size) || (shdr[i].sh_size > size - shdr[i].sh_offset))
+            return AIPU_STATUS_ERROR_INVALID_GBIN;
+
+        sec->init(image + shdr[i].sh_offset, shdr[i].sh_size);
     }
-    return nullptr;
+
+    return AIPU_STATUS_SUCCESS;
 }
 
 aipu_status_t aipudrv::ParserELF::parse_reuse_section(char* bss, uint32_t count, uint32_t id,
@@ -241,10 +302,10 @@ aipu_status_t aipudrv::ParserELF::parse_no_subgraph(char* start, uint32_t id, Gr
     return ret;
 }
 
-aipu_status_t aipudrv::ParserELF::parse_graph_header_check(std::istream& gbin, uint32_t gbin_sz)
+aipu_status_t aipudrv::ParserELF::parse_graph_header_check(std::istream& gbin, uint64_t gbin_sz)
 {
     ELFIO::Elf32_Ehdr header;
-    unsigned int cur_pos = gbin.tellg();
+    std::streampos cur_pos = gbin.tellg();
 
     if (gbin_sz < (sizeof(ELFIO::Elf32_Ehdr)))
         return AIPU_STATUS_ERROR_INVALID_GBIN;
@@ -279,11 +340,12 @@ finish:
     return AIPU_STATUS_ERROR_INVALID_GBIN;
 }
 
-aipu_status_t aipudrv::ParserELF::parse_graph(std::istream& gbin, uint32_t size, Graph& gobj)
+aipu_status_t aipudrv::ParserELF::parse_graph(std::istream& gbin, uint64_t size, Graph& gobj)
 {
     aipu_status_t ret = AIPU_STATUS_SUCCESS;
     struct ElfSubGraphList sg_desc_header = {0};
     FeatureMapList  fm_list = {0};
+    BinSection image = {nullptr, 0};
     char* start = nullptr;
     char* next = nullptr;
 
@@ -291,35 +353,46 @@ aipu_status_t aipudrv::ParserELF::parse_graph(std::istream& gbin, uint32_t size,
     if (ret != AIPU_STATUS_SUCCESS)
         goto finish;
 
-    /* real ELF parsing */
-    if (!m_elf.load(gbin))
+    /**
+     * the sections are parsed in place and referenced by the graph until
+     * it is destroyed; a graph without a file mapping keeps its own copy.
+     */
+    ret = gobj.read_gbin_image(gbin, size);
+    if (ret != AIPU_STATUS_SUCCESS)
+        goto finish;
+
+    image = gobj.get_gbin_image();
+    if ((unsigned char)image.va[EI_DATA] != ELFDATA2LSB)
     {
         ret = AIPU_STATUS_ERROR_INVALID_GBIN;
         goto finish;
     }
 
+    if ((unsigned char)image.va[EI_CLASS] == ELFCLASS64)
+        ret = parse_elf_sections<ELFIO::Elf64_Ehdr, ELFIO::Elf64_Shdr>(image.va, image.size);
+    else
+        ret = parse_elf_sections<ELFIO::Elf32_Ehdr, ELFIO::Elf32_Shdr>(image.va, image.size);
+    if (ret != AIPU_STATUS_SUCCESS)
+        goto finish;
+
     /* .text section parse */
-    m_text = get_elf_section(".text");
-    if (m_text == nullptr)
+    if (m_text.va == nullptr)
     {
         ret = AIPU_STATUS_ERROR_INVALID_GBIN;
         goto finish;
     }
-    gobj.set_graph_text(m_text->get_data(), m_text->get_size());
+    gobj.set_graph_text(m_text.va, m_text.size);
 
     /* .rodata section parse */
-    m_crodata = get_elf_section(".rodata");
-    if (nullptr != m_crodata)
-        gobj.set_graph_crodata(m_crodata->get_data(), m_crodata->get_size());
+    if (m_crodata.va != nullptr)
+        gobj.set_graph_crodata(m_crodata.va, m_crodata.size);
 
     /* .data section parse */
-    m_data = get_elf_section(".data");
-    if (nullptr != m_data)
-        gobj.set_graph_dp(m_data->get_data(), m_data->get_size());
+    if (m_data.va != nullptr)
+        gobj.set_graph_dp(m_data.va, m_data.size);
 
     /* .note section parse */
-    m_note = get_elf_section(".note.aipu");
-    if (m_note == nullptr)
+    if (m_note.va == nullptr)
     {
         ret = AIPU_STATUS_ERROR_INVALID_GBIN;
         goto finish;
@@ -12,7 +12,7 @@
 #define _PARSER_ELF_H_
 
 #include <fstream>
-#include "elfio/elfio.hpp"
+#include "elfio/elf_types.hpp"
 #include "parser_base.h"
 #include "graph_v3x.h"
 
@@ -138,14 +138,14 @@ class ParserELF : public ParserBase
 {
 private:
     ELFHeaderBottom m_header;
-    ELFIO::elfio m_elf;
     AIPUCompilerMsg m_aipu_compile_msg = {0};
 
 private:
-    ELFIO::section* m_text = nullptr;
-    ELFIO::section* m_crodata = nullptr;
-    ELFIO::section* m_data = nullptr;
-    ELFIO::section* m_note = nullptr;
+    /* ELF sections located in place within the graph binary image */
+    BinSection m_text = {nullptr, 0};
+    BinSection m_crodata = {nullptr, 0};
+    BinSection m_data = {nullptr, 0};
+    BinSection m_note = {nullptr, 0};
 
     BinSection sections[ELFSectionCnt];
     const char* ELFSectionName[ELFSectionCnt] = {
@@ -165,18 +165,19 @@ private:
 
 private:
     BinSection get_bin_note(const std::string& note_name);
-    ELFIO::section* get_elf_section(const std::string &section_name);
+    template <typename Ehdr, typename Shdr>
+    aipu_status_t parse_elf_sections(const char* image, uint64_t size);
     aipu_status_t parse_subgraph(char* start, uint32_t id, GraphV3X& gobj,
         uint64_t& sg_desc_size);
     aipu_status_t parse_no_subgraph(char* start, uint32_t id, GraphV3X& gobj,
         uint64_t& sg_desc_size);
-    aipu_status_t parse_graph_header_check(std::istream& gbin, uint32_t gbin_sz);
+    aipu_status_t parse_graph_header_check(std::istream& gbin, uint64_t gbin_sz);
 
 private:
     aipu_status_t parse_graph_header_bottom(std::istream& gbin);
 
 public:
-    virtual aipu_status_t parse_graph(std::istream& gbin, uint32_t size,
+    virtual aipu_status_t parse_graph(std::istream& gbin, uint64_t size,
         Graph& gobj);
 
 protected:
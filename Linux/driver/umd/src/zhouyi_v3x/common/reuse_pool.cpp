@@ -0,0 +1,240 @@
+// Copyright (C) 2023-2024 Arm Technology (China) Co. Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+/**
+ * @file  reuse_pool.cpp
+ * @brief AIPU User Mode Driver (UMD) shared reuse buffer pool module implementation
+ */
+
+#include "reuse_pool.h"
+#include "completion_reactor.h"
+#include "context.h"
+#include "job_arena.h"
+#include "job_base.h"
+#include "parser_base.h"
+#include "utils/log.h"
+
+void aipudrv::ReusePool::set_sections(MemoryBase *mem, const std::vector<GraphSectionDesc> &sections,
+    const std::set<uint32_t> &reuse_idx)
+{
+    std::lock_guard<std::mutex> lock_(m_lock);
+
+    m_mem = mem;
+    m_sections = sections;
+    m_reuse_idx = reuse_idx;
+}
+
+/**
+ * @brief one allocation per slot, the pooled sections are placed in it
+ *        like in a job arena. called with m_lock held.
+ */
+aipu_status_t aipudrv::ReusePool::alloc_slot()
+{
+    aipu_status_t ret = AIPU_STATUS_SUCCESS;
+    std::unique_ptr<Slot> slot(new Slot);
+    std::vector<uint64_t> offsets(m_sections.size(), ARENA_NONE);
+    JobArenaLayout layout;
+
+    for (auto k : m_reuse_idx)
+        offsets[k] = layout.place(ARENA_DEFAULT, m_sections[k].size, m_sections[k].align_in_page);
+
+    if (layout.size[ARENA_DEFAULT] > UINT32_MAX)
+        return AIPU_STATUS_ERROR_BUF_ALLOC_FAIL;
+
+    ret = m_mem->malloc(layout.size[ARENA_DEFAULT], layout.align_in_page[ARENA_DEFAULT],
+        &slot->buf, "reuse_pool");
+    if (ret != AIPU_STATUS_SUCCESS)
+        return ret;
+
+    slot->bufs.assign(m_sections.size(), nullptr);
+    for (auto k : m_reuse_idx)
+    {
+        slot->bufs[k] = new BufferDesc;
+        slot->bufs[k]->init(slot->buf->asid_base, slot->buf->pa + offsets[k],
+            ALIGN_PAGE(m_sections[k].size), m_sections[k].size);
+    }
+
+    m_slots.push_back(std::move(slot));
+    LOG(LOG_DEBUG, "reuse pool slot %u: 0x%lx bytes\n", (uint32_t)m_slots.size() - 1,
+        layout.size[ARENA_DEFAULT]);
+    return ret;
+}
+
+aipudrv::ReusePool::Slot *aipudrv::ReusePool::get_held_slot(const JobBase *job)
+{
+    for (auto &slot : m_slots)
+    {
+        if (slot->holder == job)
+            return slot.get();
+    }
+
+    return nullptr;
+}
+
+/**
+ * @brief admit a job: hand it a free slot, preferably the one its rodata
+ *        already points to. if all the slots are held, it returns
+ *        AIPU_STATUS_ERROR_TIMEOUT without wait, otherwise it waits for
+ *        the end of a holder. a holder bound for a deferred run only ends
+ *        once the caller runs it, so if all of them are bound it fails
+ *        with AIPU_STATUS_ERROR_INVALID_OP.
+ */
+aipu_status_t aipudrv::ReusePool::acquire(JobBase *job, bool wait, int32_t prefer, uint32_t *slot,
+    const std::vector<BufferDesc*> **bufs)
+{
+    std::unique_lock<std::mutex> lock_(m_lock);
+    bool waited = false;
+
+    while (true)
+    {
+        Slot *target = get_held_slot(job);
+        Slot *oldest = nullptr;
+        JobBase *holder = nullptr;
+        bool bound = true;
+        CompletionReactor *reactor = nullptr;
+        uint32_t idx = 0;
+
+        if ((target == nullptr) && (prefer >= 0) && ((uint32_t)prefer < m_slots.size()) &&
+            (m_slots[prefer]->holder == nullptr))
+            target = m_slots[prefer].get();
+
+        for (idx = 0; (target == nullptr) && (idx < m_slots.size()); idx++)
+        {
+            if (m_slots[idx]->holder == nullptr)
+                target = m_slots[idx].get();
+        }
+
+        if ((target == nullptr) && (m_slots.size() < m_max_slot_cnt))
+        {
+            if (alloc_slot() == AIPU_STATUS_SUCCESS)
+            {
+                target = m_slots.back().get();
+            } else if (m_slots.empty()) {
+                return AIPU_STATUS_ERROR_BUF_ALLOC_FAIL;
+            } else {
+                LOG(LOG_WARN, "reuse pool is limited to %u slots by memory\n", (uint32_t)m_slots.size());
+                m_max_slot_cnt = m_slots.size();
+            }
+        }
+
+        if (target != nullptr)
+        {
+            for (idx = 0; m_slots[idx].get() != target; idx++)
+                ;
+
+            if (target->holder == nullptr)
+            {
+                target->holder = job;
+                target->stamp = ++m_stamp;
+            }
+            *slot = idx;
+            *bufs = &target->bufs;
+            return AIPU_STATUS_SUCCESS;
+        }
+
+        if (!wait)
+            return AIPU_STATUS_ERROR_TIMEOUT;
+
+        if (!waited)
+        {
+            m_wait_cnt++;
+            waited = true;
+        }
+
+        /**
+         * only a submitted holder can end, and a reactor thread delivers the ends itself.
+         * a holder not yet submitted is on its way to be, unless it is bound.
+         */
+        for (auto &iter : m_slots)
+        {
+            uint32_t status = AIPU_JOB_STATUS_NO_STATUS;
+
+            if (iter->holder == nullptr)
+                continue;
+
+            status = iter->holder->get_job_status();
+            if (status != AIPU_JOB_STATUS_BIND)
+                bound = false;
+            if ((status == AIPU_JOB_STATUS_SCHED) && ((oldest == nullptr) || (iter->stamp < oldest->stamp)))
+                oldest = iter.get();
+        }
+
+        if (bound)
+        {
+            LOG(LOG_ERR, "reuse pool: all %u slots are held by jobs bound for a deferred run\n",
+                (uint32_t)m_slots.size());
+            return AIPU_STATUS_ERROR_INVALID_OP;
+        }
+
+        reactor = ((oldest != nullptr) && (oldest->holder->get_ctx() != nullptr)) ?
+            oldest->holder->get_ctx()->get_completion_reactor() : nullptr;
+        if ((oldest == nullptr) || ((reactor != nullptr) && reactor->is_threaded()))
+        {
+            m_cond.wait_for(lock_, std::chrono::milliseconds(REUSE_POOL_WAIT_SLICE));
+            continue;
+        }
+
+        /* without a reactor thread, the waiter drains the device as the app would */
+        holder = oldest->holder;
+        m_polled.insert(holder);
+        lock_.unlock();
+        if (reactor != nullptr)
+            reactor->wait_job(holder, REUSE_POOL_WAIT_SLICE);
+        else
+            holder->poll_device(REUSE_POOL_WAIT_SLICE);
+        lock_.lock();
+        m_polled.erase(m_polled.find(holder));
+        m_cond.notify_all();
+    }
+}
+
+bool aipudrv::ReusePool::holds(const JobBase *job)
+{
+    std::lock_guard<std::mutex> lock_(m_lock);
+    return get_held_slot(job) != nullptr;
+}
+
+void aipudrv::ReusePool::release(const JobBase *job)
+{
+    std::lock_guard<std::mutex> lock_(m_lock);
+    Slot *slot = get_held_slot(job);
+
+    if (slot == nullptr)
+        return;
+
+    slot->holder = nullptr;
+    m_cond.notify_all();
+}
+
+/**
+ * @brief called by a job going away, it may have ended already but still
+ *        be polled by a waiter. returns once nobody polls it.
+ */
+void aipudrv::ReusePool::detach(const JobBase *job)
+{
+    std::unique_lock<std::mutex> lock_(m_lock);
+    Slot *slot = nullptr;
+
+    m_cond.wait(lock_, [this, job] { return m_polled.count(job) == 0; });
+    slot = get_held_slot(job);
+    if (slot != nullptr)
+        slot->holder = nullptr;
+    m_cond.notify_all();
+}
+
+void aipudrv::ReusePool::free()
+{
+    std::lock_guard<std::mutex> lock_(m_lock);
+
+    for (auto &slot : m_slots)
+    {
+        for (auto &buf : slot->bufs)
+            m_mem->free_bufferdesc(&buf);
+
+        if (slot->buf != nullptr)
+            m_mem->free(&slot->buf, "reuse_pool");
+    }
+    m_slots.clear();
+}
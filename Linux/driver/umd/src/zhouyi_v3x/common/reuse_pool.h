@@ -0,0 +1,110 @@
+// Copyright (C) 2023-2024 Arm Technology (China) Co. Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+/**
+ * @file  reuse_pool.h
+ * @brief AIPU User Mode Driver (UMD) shared reuse buffer pool module header
+ */
+
+#ifndef _REUSE_POOL_H_
+#define _REUSE_POOL_H_
+
+#include <set>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <condition_variable>
+#include "memory_base.h"
+#include "graph.h"
+
+namespace aipudrv
+{
+class JobBase;
+
+/* ms a waiter polls the oldest holder for, before it checks the slots again */
+#define REUSE_POOL_WAIT_SLICE 100
+
+/**
+ * copies of a graph's intermediate reuse sections, shared by its jobs.
+ * a job holds a slot from its scheduling to its end, so the slots only
+ * need to cover the jobs running at once. they are allocated on demand,
+ * up to the configured count or what the memory fits. a job finding all
+ * of them in use waits, driving the end of the oldest holder meanwhile.
+ */
+class ReusePool
+{
+private:
+    struct Slot
+    {
+        BufferDesc *buf = nullptr;
+        std::vector<BufferDesc*> bufs;  /**< per reuse section, null if not pooled */
+        JobBase *holder = nullptr;
+        uint64_t stamp = 0;             /**< admission order of the holder */
+    };
+
+    MemoryBase *m_mem = nullptr;
+    uint32_t m_max_slot_cnt = 0;
+    std::set<uint32_t> m_reuse_idx;
+    std::vector<GraphSectionDesc> m_sections;
+    std::vector<std::unique_ptr<Slot>> m_slots;
+    std::multiset<const JobBase*> m_polled;     /**< holders polled by waiters */
+    uint64_t m_stamp = 0;
+    uint64_t m_wait_cnt = 0;
+    std::mutex m_lock;
+    std::condition_variable m_cond;
+
+private:
+    aipu_status_t alloc_slot();
+    Slot *get_held_slot(const JobBase *job);
+
+public:
+    void configure(uint32_t max_slot_cnt)
+    {
+        m_max_slot_cnt = max_slot_cnt;
+    }
+
+    void set_sections(MemoryBase *mem, const std::vector<GraphSectionDesc> &sections,
+        const std::set<uint32_t> &reuse_idx);
+    aipu_status_t acquire(JobBase *job, bool wait, int32_t prefer, uint32_t *slot,
+        const std::vector<BufferDesc*> **bufs);
+    void release(const JobBase *job);
+    bool holds(const JobBase *job);
+    void detach(const JobBase *job);
+    void free();
+
+    bool is_enabled() const
+    {
+        return (m_max_slot_cnt > 0) && !m_reuse_idx.empty();
+    }
+
+    const std::set<uint32_t> &get_reuse_idx() const
+    {
+        return m_reuse_idx;
+    }
+
+    uint32_t get_slot_cnt()
+    {
+        std::lock_guard<std::mutex> lock_(m_lock);
+        return m_slots.size();
+    }
+
+    uint64_t get_wait_cnt()
+    {
+        std::lock_guard<std::mutex> lock_(m_lock);
+        return m_wait_cnt;
+    }
+
+public:
+    ReusePool() {}
+    ~ReusePool()
+    {
+        free();
+    }
+    ReusePool(const ReusePool& pool) = delete;
+    ReusePool& operator=(const ReusePool& pool) = delete;
+};
+}
+
+#endif /* _REUSE_POOL_H_ */
@@ -200,8 +200,15 @@ void aipudrv::GM_V3::get_valid_sync_region(uint32_t sg_id, uint32_t idx, uint32_
     if (buf_type == GM_BUF_TYPE_REUSE)
     {
         // for (auto desc : m_graph.get_subgraph(sg_id).io.inputs)
-        for (auto desc : m_graph.get_bss(sg_id).io.inputs)
+        for (uint32_t i = 0; i < m_graph.get_bss(sg_id).io.inputs.size(); i++)
         {
+            GraphIOTensorDesc desc = m_graph.get_bss(sg_id).io.inputs[i];
+
+            /* dynamic shape inputs are sized per job */
+            if ((sg_id == 0) && (m_job.m_dyn_shape != nullptr)
+                && m_job.m_dyn_shape->in_config_in_tensor_size(i))
+                desc.size = m_job.m_dyn_shape->get_config_in_tensor_size(i);
+
             /**
              * it exist several input buffers exist in one large buffer
              */
@@ -24,7 +24,7 @@
 aipudrv::JobV3::JobV3(MainContext* ctx, GraphBase& graph, DeviceBase* dev, aipu_create_job_cfg_t *config):
     JobBase(ctx, graph, dev), m_partition_id(config->partition_id), m_qos(config->qos_level),
     m_fm_mem_region(config->fm_mem_region), m_dbg_dispatch(config->dbg_dispatch),
-    m_core_id(config->dbg_core_id)
+    m_core_id(config->dbg_core_id), m_arena(dev->get_mem())
 
 {
     m_init_tcb.init(0);
@@ -164,7 +164,7 @@ void aipudrv::JobV3::setup_gm_sync_from_ddr(tcb_t &tcb)
 void aipudrv::JobV3::setup_gm_sync_to_ddr(tcb_t &tcb)
 {
     uint32_t gm_region_idx = 0;
-    tcb_t pre_tcb = {0};
+    tcb_t *pre_tcb = nullptr;
 
     if (!m_mem->is_gm_enable())
         return;
@@ -182,21 +182,18 @@ void aipudrv::JobV3::setup_gm_sync_to_ddr(tcb_t &tcb)
     }
 
     /* modify the last task tcb and link to GM sync tcb */
-    m_mem->read(m_init_tcb.pa + sizeof(tcb_t) * (m_tot_tcb_cnt - 2),
-        &pre_tcb, sizeof(tcb_t));
-    pre_tcb.next = get_low_32(m_init_tcb.pa + sizeof(tcb_t) * (m_tot_tcb_cnt - 1));
-    pre_tcb.flag &= ~(TCB_FLAG_END_TYPE_GROUP_END
+    pre_tcb = staged_tcb(m_init_tcb.pa + sizeof(tcb_t) * (m_tot_tcb_cnt - 2));
+    pre_tcb->next = get_low_32(m_init_tcb.pa + sizeof(tcb_t) * (m_tot_tcb_cnt - 1));
+    pre_tcb->flag &= ~(TCB_FLAG_END_TYPE_GROUP_END
                     | TCB_FLAG_END_TYPE_GRID_END
                     | TCB_FLAG_END_TYPE_END_WITH_DESTROY);
-    m_mem->write(m_init_tcb.pa + sizeof(tcb_t) * (m_tot_tcb_cnt - 2),
-        (const char*)&pre_tcb, sizeof(tcb_t));
 
     /* config GM sync tcb: GM->DDR */
     tcb.next = 0;
     tcb.flag = TCB_FLAG_DEP_TYPE_PRE_ALL
                 | TCB_FLAG_END_TYPE_GROUP_END
                 | TCB_FLAG_END_TYPE_GRID_END;
-    tcb.igrid_id = pre_tcb.gridid;
+    tcb.igrid_id = pre_tcb->gridid;
     tcb.gm_rgnx_addr[0].v64 = 0;
     tcb.gm_rgnx_addr[1].v64 = 0;
     tcb.gm_rgnx_addr[gm_region_idx].v64 = m_gm->m_gm_base;
@@ -208,8 +205,7 @@ void aipudrv::JobV3::setup_gm_sync_to_ddr(tcb_t &tcb)
     tcb.gm_rgnx_ctrl[gm_region_idx] |= (m_gm->m_gm_buf_map_size[EM_GM_BUF_OUTPUT] >> 12) & 0xfff;
     tcb.gm_ctl = GM_CTRL_TSM_IGNORE_CFG;
 
-    m_mem->write(m_init_tcb.pa + sizeof(tcb_t) * (m_tot_tcb_cnt - 1),
-        (const char*)&tcb, sizeof(tcb_t));
+    *staged_tcb(m_init_tcb.pa + sizeof(tcb_t) * (m_tot_tcb_cnt - 1)) = tcb;
 }
 
 #define SEGMMU_MEM_CTRL_EN (1 << 0)
@@ -304,6 +300,21 @@ aipu_status_t aipudrv::JobV3::setup_rodata_sg(uint32_t sg_id,
     }
 }
 
+/**
+ * @brief relocate the BSS 0 entries of rodata & dcr, only the reuse ones
+ *        if the images were copied from the graph's template.
+ */
+aipu_status_t aipudrv::JobV3::setup_rodata_bss(std::set<uint32_t> *dma_buf_idx)
+{
+    const RodataTemplate &tmpl = get_graph().get_rodata_template();
+
+    if (!tmpl.is_valid())
+        return setup_rodata_sg(0, get_graph().get_bss(0).param_map,
+            m_bss_buffer_vec[0].reuses, *m_bss_buffer_vec[0].weights, dma_buf_idx);
+
+    return setup_rodata(tmpl, m_bss_buffer_vec[0].reuses, *m_rodata, m_descriptor, dma_buf_idx);
+}
+
 aipu_status_t aipudrv::JobV3::alloc_subgraph_buffers()
 {
     aipu_status_t ret = AIPU_STATUS_SUCCESS;
@@ -366,6 +377,8 @@ add_sg:
                         bufferDesc = new BufferDesc;
                         buf_name = "gm_" + buf_name;
                         ret = m_gm->gm_malloc(bss_id, k, GM_BUF_TYPE_REUSE, buf_name, bufferDesc);
+                    } else if (is_pool_reuse(k)) {
+                        bufferDesc = new_pool_reuse_desc(section_desc);
                     } else {
                         if ((m_fm_idxes.count(k) == 1) || (m_fm_mem_region != AIPU_MEM_REGION_DEFAULT))
                             ret = m_mem->malloc(section_desc.size, section_desc.align_in_page, &bufferDesc,
@@ -381,7 +394,7 @@ add_sg:
                         goto add_bss_buffer;
                     }
 
-                    if (m_dump_reuse)
+                    if (m_dump_reuse && !is_pool_reuse(k))
                         m_mem->mem_bzero(bufferDesc->pa, bufferDesc->size);
 
                     bssBuffer.reuses.push_back(bufferDesc);
@@ -455,7 +468,7 @@ int aipudrv::JobV3::alloc_subgraph_buffers_optimized()
         if (m_gm->gm_is_gm_buffer(k, GM_BUF_TYPE_REUSE))
             continue;
 
-        if (m_fm_idxes.count(k) == 1)
+        if ((m_fm_idxes.count(k) == 1) || is_pool_reuse(k))
             continue;
 
         const GraphSectionDesc &section_desc = get_graph().get_bss(0).reuse_sections[k];
@@ -476,7 +489,8 @@ int aipudrv::JobV3::alloc_subgraph_buffers_optimized()
         }
     }
 
-    ret = m_mem->malloc(reuse_buf_total_size, 0, &m_top_reuse_buf, "tot_reuse");
+    if (reuse_buf_total_size > 0)
+        ret = m_mem->malloc(reuse_buf_total_size, 0, &m_top_reuse_buf, "tot_reuse");
     if (ret != AIPU_STATUS_SUCCESS)
     {
         retval = -1;
@@ -549,6 +563,9 @@ int aipudrv::JobV3::alloc_subgraph_buffers_optimized()
                             LOG(LOG_ERR, "alloc GM reuse buffer %d [fail]", k);
                             goto add_bss_buffer;
                         }
+                    } else if (is_pool_reuse(k)) {
+                        /* pointed to a pool slot on admission */
+                        bufferDesc->init(0, 0, ALIGN_PAGE(section_desc.size), section_desc.size);
                     } else {
                         if (m_fm_idxes.count(k) == 1)
                         {
@@ -567,7 +584,7 @@ int aipudrv::JobV3::alloc_subgraph_buffers_optimized()
                         }
                     }
 
-                    if (m_dump_reuse)
+                    if (m_dump_reuse && !is_pool_reuse(k))
                         m_mem->mem_bzero(bufferDesc->pa, bufferDesc->size);
 
                     bssBuffer.reuses.push_back(bufferDesc);
@@ -613,9 +630,202 @@ out:
     return retval;
 }
 
+/**
+ * @brief allocate the job arena(s) for what this job's config changes in
+ *        the layout. aipu v3 keeps a TCB backup and mustn't have its TCBs
+ *        at ASID offset 0. without an arena, the buffers are allocated
+ *        apart as before.
+ */
+aipu_status_t aipudrv::JobV3::alloc_arena()
+{
+    const BSS &bss = get_graph().get_bss(0);
+    JobArenaSpec spec;
+
+    spec.tcb_size = m_tot_tcb_cnt * sizeof(tcb_t);
+    spec.task_per_sg = m_task_per_sg;
+    spec.sg_cnt = m_sg_cnt;
+    spec.fm_mem_region = m_fm_mem_region;
+    spec.modelparam = get_graph().is_dynamic_shape() && m_dyn_shape->is_set_dyn_shape_true()
+        && m_dyn_shape->get_config_shape_sz() > 0;
+    spec.tcbs_bkup = true;
+    spec.tcbs_off_asid_base = true;
+    spec.pool_reuse_idx = m_pool_reuse_idx;
+
+    for (uint32_t k = 0; k < bss.reuse_sections.size(); k++)
+    {
+        if (m_gm->gm_is_gm_buffer(k, GM_BUF_TYPE_REUSE))
+            spec.gm_reuse_idx.insert(k);
+        else if (m_fm_idxes.count(k) == 1)
+            spec.fm_reuse_idx.insert(k);
+    }
+
+    return m_arena.alloc(get_graph(), spec);
+}
+
+aipu_status_t aipudrv::JobV3::alloc_subgraph_buffers_arena()
+{
+    aipu_status_t ret = AIPU_STATUS_SUCCESS;
+    const JobArenaLayout &layout = m_arena.get_layout();
+    std::vector<std::vector<BufferDesc*>> priv_bufs;
+    SubGraphTask sg_task = {0};
+
+    m_arena.carve_private(get_graph(), m_sg_cnt, m_dump_reuse, priv_bufs);
+    for (uint32_t sg_idx = 0; sg_idx < m_sg_cnt; sg_idx++)
+    {
+        sg_task.reset(sg_idx, get_graph().get_subgraph(sg_idx).bss_idx);
+        sg_task.reuse_priv_buffers = priv_bufs[sg_idx];
+        m_sg_job.push_back(sg_task);
+    }
+
+    for (uint32_t bss_id = 0; bss_id < get_graph().get_bss_cnt(); bss_id++)
+    {
+        BSSBuffer bssBuffer;
+
+        for (uint32_t k = 0; (bss_id == 0) && (k < get_graph().get_bss(0).reuse_sections.size()); k++)
+        {
+            const GraphSectionDesc &section_desc = get_graph().get_bss(0).reuse_sections[k];
+            BufferDesc *bufferDesc = nullptr;
+            std::string buf_name = "reuse_" + std::to_string(k);
+
+            if (section_desc.size == 0)
+            {
+                LOG(LOG_WARN, "arena reuse %d: size == 0\n", k);
+                continue;
+            }
+
+            if (layout.reuses[k] != ARENA_NONE)
+            {
+                bufferDesc = m_arena.carve_reuse(k, section_desc.size);
+            } else if (m_gm->gm_is_gm_buffer(k, GM_BUF_TYPE_REUSE)) {
+                bufferDesc = new BufferDesc;
+                buf_name = "gm_" + buf_name;
+                ret = m_gm->gm_malloc(bss_id, k, GM_BUF_TYPE_REUSE, buf_name, bufferDesc);
+            } else if (is_pool_reuse(k)) {
+                bufferDesc = new_pool_reuse_desc(section_desc);
+            } else {
+                ret = m_mem->malloc(section_desc.size, section_desc.align_in_page, &bufferDesc,
+                    buf_name.c_str(), m_fm_mem_region);
+            }
+
+            if (ret != AIPU_STATUS_SUCCESS)
+            {
+                LOG(LOG_ERR, "alloc reuse buffer %d [fail]", k);
+                m_mem->free_bufferdesc(&bufferDesc);
+                break;
+            }
+
+            if (m_dump_reuse && !is_pool_reuse(k))
+                m_mem->mem_bzero(bufferDesc->pa, bufferDesc->size);
+
+            bssBuffer.reuses.push_back(bufferDesc);
+        }
+
+        /* init task weights address, share a common copy */
+        bssBuffer.weights = &get_graph().get_WeightBufferInfo(bss_id).wb_weights;
+        m_bss_buffer_vec.push_back(bssBuffer);
+        if (ret != AIPU_STATUS_SUCCESS)
+            goto out;
+    }
+
+    if (layout.printf_buf != ARENA_NONE)
+        m_pprint = m_arena.carve(ARENA_DEFAULT, layout.printf_buf, get_subgraph_cnt() * AIPU_PAGE_SIZE,
+            get_subgraph_cnt() * AIPU_PAGE_SIZE);
+
+out:
+    return ret;
+}
+
+/**
+ * @brief the pooled reuse sections of this job: the graph's ones but
+ *        those allocated from GM or a specified region.
+ */
+void aipudrv::JobV3::init_pool_reuse_idx()
+{
+    ReusePool &pool = get_graph().get_reuse_pool();
+
+    m_pool_reuse_idx.clear();
+    m_pool_slot = -1;
+    if (!pool.is_enabled() || (m_fm_mem_region != AIPU_MEM_REGION_DEFAULT))
+        return;
+
+    for (auto k : pool.get_reuse_idx())
+    {
+        if (!m_gm->gm_is_gm_buffer(k, GM_BUF_TYPE_REUSE) && (m_fm_idxes.count(k) == 0))
+            m_pool_reuse_idx.insert(k);
+    }
+}
+
+aipudrv::BufferDesc *aipudrv::JobV3::new_pool_reuse_desc(const GraphSectionDesc &section_desc)
+{
+    BufferDesc *bufferDesc = new BufferDesc;
+
+    /* pointed to a pool slot on admission */
+    bufferDesc->init(0, 0, ALIGN_PAGE(section_desc.size), section_desc.size);
+    return bufferDesc;
+}
+
+/**
+ * @brief take a slot of the graph's reuse pool for this run, the rodata
+ *        is relocated only if it isn't the slot of the last run.
+ */
+aipu_status_t aipudrv::JobV3::admit(bool wait)
+{
+    aipu_status_t ret = AIPU_STATUS_SUCCESS;
+    ReusePool &pool = get_graph().get_reuse_pool();
+    const std::vector<BufferDesc*> *bufs = nullptr;
+    uint32_t slot = 0;
+
+    /* prepare_schedule rejects it, or it runs already */
+    if (m_pool_reuse_idx.empty() || (validate_schedule_status() != AIPU_STATUS_SUCCESS))
+        return ret;
+
+    ret = pool.acquire(this, wait, m_pool_slot, &slot, &bufs);
+    if (ret != AIPU_STATUS_SUCCESS)
+        return ret;
+
+    /* like the private reuse buffers, a dumped slot starts from zero */
+    if (m_dump_reuse)
+    {
+        for (auto k : m_pool_reuse_idx)
+            m_mem->mem_bzero((*bufs)[k]->pa, (*bufs)[k]->size);
+    }
+
+    if ((int32_t)slot == m_pool_slot)
+        return ret;
+
+    for (auto k : m_pool_reuse_idx)
+        *m_bss_buffer_vec[0].reuses[k] = *(*bufs)[k];
+
+    ret = setup_rodata_bss(&m_pool_reuse_idx);
+    if (ret != AIPU_STATUS_SUCCESS)
+    {
+        pool.release(this);
+        m_pool_slot = -1;
+        return ret;
+    }
+
+    m_pool_slot = slot;
+    return ret;
+}
+
+void aipudrv::JobV3::release_run_resources()
+{
+    ReusePool &pool = get_graph().get_reuse_pool();
+
+    if (m_pool_reuse_idx.empty())
+        return;
+
+    /* the slot may run another job at once, the reuse dump takes a copy */
+    if (m_dump_reuse && pool.holds(this))
+        copy_reuse_for_dump(m_pool_reuse_idx);
+    pool.release(this);
+}
+
 aipu_status_t aipudrv::JobV3::init_per_task_data()
 {
     aipu_status_t ret = AIPU_STATUS_SUCCESS;
+    const JobArenaLayout &layout = m_arena.get_layout();
+    uint32_t task_idx = 0;
     uint32_t tmp_segmmu_tcb_skip = 0;
     uint32_t sg_idx = 0;
     bool dep_all_flag = false;
@@ -675,8 +885,8 @@ aipu_status_t aipudrv::JobV3::init_per_task_data()
 
                 /* 1.2. allocate task stack */
                 task.stack = nullptr;
-                ret = m_mem->malloc(get_graph().get_bss(0).stack_size,
-                    get_graph().get_bss(0).stack_align_in_page,
+                ret = m_arena.alloc_buf((task_idx < layout.stacks.size()) ? layout.stacks[task_idx] : ARENA_NONE,
+                    get_graph().get_bss(0).stack_size, get_graph().get_bss(0).stack_align_in_page,
                     &task.stack, "stack");
                 if (ret != AIPU_STATUS_SUCCESS)
                     goto out;
@@ -685,7 +895,8 @@ aipu_status_t aipudrv::JobV3::init_per_task_data()
                 if (get_graph().get_subgraph(i).private_data_size != 0)
                 {
                     task.private_data = nullptr;
-                    ret = m_mem->malloc(get_graph().get_subgraph(i).private_data_size, 0,
+                    ret = m_arena.alloc_buf((task_idx < layout.dps.size()) ? layout.dps[task_idx] : ARENA_NONE,
+                        get_graph().get_subgraph(i).private_data_size, 0,
                         &task.private_data, "dp_data");
                     if (ret != AIPU_STATUS_SUCCESS)
                         goto out;
@@ -693,6 +904,7 @@ aipu_status_t aipudrv::JobV3::init_per_task_data()
                     m_mem->mem_bzero(task.private_data->pa, task.private_data->size);
                 }
                 sg_task.tasks.push_back(task);
+                task_idx++;
             }
             m_sgt_allocated.push_back(&sg_task);
         }
@@ -708,6 +920,10 @@ aipu_status_t aipudrv::JobV3::alloc_load_job_buffers()
     SubGraphTask sg_task;
     int retval = 0;
 
+    /* one allocation for all buffers below if possible, or allocate them apart */
+    init_pool_reuse_idx();
+    alloc_arena();
+
     /* 0. allocate and set model global parameter if need */
     if (get_graph().is_dynamic_shape() && m_dyn_shape->is_set_dyn_shape_true()
         && m_dyn_shape->get_config_shape_sz() > 0)
@@ -715,7 +931,7 @@ aipu_status_t aipudrv::JobV3::alloc_load_job_buffers()
         DS_ModelGlobalParam *modelGlobalParam = (DS_ModelGlobalParam *)get_graph().m_bglobalparam.va;
         uint32_t input_shape_offset = modelGlobalParam->input_shape_offset;
 
-        ret = m_mem->malloc(get_graph().m_bglobalparam.size, 0,
+        ret = m_arena.alloc_buf(m_arena.get_layout().modelparam, get_graph().m_bglobalparam.size, 0,
             &m_model_global_param, "modelparam");
         if (ret != AIPU_STATUS_SUCCESS)
         {
@@ -753,25 +969,31 @@ aipu_status_t aipudrv::JobV3::alloc_load_job_buffers()
     /* 1. allocate and load job rodata */
     if (get_graph().m_brodata.size != 0)
     {
-        ret = m_mem->malloc(get_graph().m_brodata.size, 0, &m_rodata, "rodata");
+        ret = m_arena.alloc_buf(m_arena.get_layout().rodata, get_graph().m_brodata.size, 0,
+            &m_rodata, "rodata");
         if (ret != AIPU_STATUS_SUCCESS)
             goto finish;
 
-        m_mem->write(m_rodata->pa, get_graph().m_brodata.va, get_graph().m_brodata.size);
+        m_mem->write(m_rodata->pa, get_graph().get_rodata_template().is_valid() ?
+            get_graph().get_rodata_template().get_rodata() : get_graph().m_brodata.va,
+            get_graph().m_brodata.size);
     }
 
     /* 2. allocate and load job descriptor */
     if (get_graph().m_bdesc.size != 0)
     {
-        ret = m_mem->malloc(get_graph().m_bdesc.size, 0, &m_descriptor, "dcr");
+        ret = m_arena.alloc_buf(m_arena.get_layout().dcr, get_graph().m_bdesc.size, 0,
+            &m_descriptor, "dcr");
         if (ret != AIPU_STATUS_SUCCESS)
             goto finish;
 
-        m_mem->write(m_descriptor->pa, get_graph().m_bdesc.va, get_graph().m_bdesc.size);
+        m_mem->write(m_descriptor->pa, get_graph().get_rodata_template().is_valid() ?
+            get_graph().get_rodata_template().get_dcr() : get_graph().m_bdesc.va,
+            get_graph().m_bdesc.size);
     }
 
     /* 3. allocate and reset job TCBs */
-    ret = m_mem->malloc(m_tot_tcb_cnt * sizeof(tcb_t), 0, &m_tcbs, "tcbs");
+    ret = m_arena.alloc_buf(m_arena.get_layout().tcbs, m_tot_tcb_cnt * sizeof(tcb_t), 0, &m_tcbs, "tcbs");
     if (ret != AIPU_STATUS_SUCCESS)
         goto finish;
 
@@ -796,7 +1018,8 @@ aipu_status_t aipudrv::JobV3::alloc_load_job_buffers()
         m_mem->free(&tmp_holdDesc);
     }
 
-    ret = m_mem->malloc(m_tot_tcb_cnt * sizeof(tcb_t), 0, &m_tcbs_bkup, "tcbs");
+    ret = m_arena.alloc_buf(m_arena.get_layout().tcbs_bkup, m_tot_tcb_cnt * sizeof(tcb_t), 0,
+        &m_tcbs_bkup, "tcbs");
     if (ret != AIPU_STATUS_SUCCESS)
         goto finish;
 
@@ -826,7 +1049,16 @@ aipu_status_t aipudrv::JobV3::alloc_load_job_buffers()
     m_init_tcb.init(m_tcbs->pa);
 
     /* 4. allocate subgraph buffers */
-    retval = alloc_subgraph_buffers_optimized();
+    if (m_arena.is_active())
+    {
+        ret = alloc_subgraph_buffers_arena();
+        if (ret != AIPU_STATUS_SUCCESS)
+            goto finish;
+        retval = 0;
+    } else {
+        retval = alloc_subgraph_buffers_optimized();
+    }
+
     if (retval == -1)
     {
         ret = alloc_subgraph_buffers();
@@ -844,12 +1076,13 @@ aipu_status_t aipudrv::JobV3::alloc_load_job_buffers()
 
     /* 6. get IO buffer address, all subgraphs share the same copy of reuse buffers */
     create_io_buffers(get_graph().get_bss(0).io, m_bss_buffer_vec[0].reuses);
+    if (m_dyn_shape != nullptr)
+        m_dyn_shape->update_dynamic_io_tensor_size(AIPU_TENSOR_TYPE_INPUT);
     if (get_subgraph_cnt() == 0)
         goto finish;
 
     /* 7. setup rodata & dcr, update entry for all subgraphs in global RO/DCR section */
-    ret = setup_rodata_sg(0, get_graph().get_bss(0).param_map,
-        m_bss_buffer_vec[0].reuses, *m_bss_buffer_vec[0].weights);
+    ret = setup_rodata_bss();
     if (ret != AIPU_STATUS_SUCCESS)
         goto finish;
 
@@ -900,6 +1133,9 @@ aipu_status_t aipudrv::JobV3::specify_io_buffer(aipu_shared_tensor_info_t &tenso
     uint64_t buffer_pa = tensor_info.pa;
     struct aipu_dma_buf dma_buf{fd, 0, 0};
 
+    /* external IO buffers are bound to this job only, don't recycle it */
+    m_recyclable = false;
+
     switch (type)
     {
         case AIPU_TENSOR_TYPE_INPUT:
@@ -950,7 +1186,7 @@ aipu_status_t aipudrv::JobV3::specify_io_buffer(aipu_shared_tensor_info_t &tenso
     /* free io buffer allocated internally,replace it with new buffer */
     bufferDesc = m_bss_buffer_vec[0].reuses[reuse_index];
     m_bss_buffer_vec[0].dma_buf_idx.insert(reuse_index);
-    if (!m_optimized_reuse_alloc)
+    if (!m_optimized_reuse_alloc && !m_arena.owns(bufferDesc))
     {
         ret = m_mem->free_phybuffer(bufferDesc, str);
         if (ret != AIPU_STATUS_SUCCESS)
@@ -963,6 +1199,11 @@ aipu_status_t aipudrv::JobV3::specify_io_buffer(aipu_shared_tensor_info_t &tenso
             bufferDesc->init(m_mem->get_asid_base(0), buffer_pa,
                 bufferDesc->size, bufferDesc->req_size);
             update_io_buffers(get_graph().get_bss(0).io, m_bss_buffer_vec[0].reuses);
+            if (m_dyn_shape != nullptr)
+            {
+                m_dyn_shape->update_dynamic_io_tensor_size(AIPU_TENSOR_TYPE_INPUT);
+                m_dyn_shape->update_dynamic_io_tensor_size(AIPU_TENSOR_TYPE_OUTPUT);
+            }
             break;
         case AIPU_SHARE_BUF_CUSTOMED:
             bufferDesc->init(m_mem->get_asid_base(0), buffer_pa,
@@ -999,9 +1240,7 @@ aipu_status_t aipudrv::JobV3::specify_io_buffer(aipu_shared_tensor_info_t &tenso
 
     if (update_ro)
     {
-        ret = setup_rodata_sg(0, get_graph().get_bss(0).param_map,
-            m_bss_buffer_vec[0].reuses, *m_bss_buffer_vec[0].weights,
-            &m_bss_buffer_vec[0].dma_buf_idx);
+        ret = setup_rodata_bss(&m_bss_buffer_vec[0].dma_buf_idx);
         if (ret != AIPU_STATUS_SUCCESS)
             goto out;
     }
@@ -1024,7 +1263,7 @@ void aipudrv::JobV3::free_sg_buffers(SubGraphTask& sg_task)
              m_mem->free_bufferdesc(&sg_task.reuse_priv_buffers[i]);
     } else {
         for (uint32_t i = 0; i < sg_task.reuse_priv_buffers.size(); i++)
-            m_mem->free(&sg_task.reuse_priv_buffers[i]);
+            m_arena.free_buf(&sg_task.reuse_priv_buffers[i], "priv");
     }
     sg_task.reuse_priv_buffers.clear();
 
@@ -1034,8 +1273,8 @@ void aipudrv::JobV3::free_sg_buffers(SubGraphTask& sg_task)
         {
             Task *task;
             task = &m_sgt_allocated[i]->tasks[j];
-            m_mem->free(&task->stack);
-            m_mem->free(&task->private_data);
+            m_arena.free_buf(&task->stack, "stack");
+            m_arena.free_buf(&task->private_data, "dp_data");
         }
     }
     m_sgt_allocated.clear();
@@ -1046,19 +1285,19 @@ aipu_status_t aipudrv::JobV3::free_job_buffers()
     aipu_status_t ret = AIPU_STATUS_SUCCESS;
 
     if (m_model_global_param && m_model_global_param->size != 0)
-        m_mem->free(&m_model_global_param, "modelparam");
+        m_arena.free_buf(&m_model_global_param, "modelparam");
 
     if (m_rodata && m_rodata->size != 0)
-        m_mem->free(&m_rodata, "rodata");
+        m_arena.free_buf(&m_rodata, "rodata");
 
     if (m_descriptor && m_descriptor->size != 0)
-        m_mem->free(&m_descriptor, "dcr");
+        m_arena.free_buf(&m_descriptor, "dcr");
 
     if (m_tcbs && m_tcbs->size != 0)
-        m_mem->free(&m_tcbs, "tcbs");
+        m_arena.free_buf(&m_tcbs, "tcbs");
 
     if (m_tcbs_bkup && m_tcbs_bkup->size != 0)
-        m_mem->free(&m_tcbs_bkup, "tcbs");
+        m_arena.free_buf(&m_tcbs_bkup, "tcbs");
 
 #ifndef SIMULATION
     if (m_exit_inst_encode && m_exit_inst_encode->size > 0)
@@ -1066,10 +1305,23 @@ aipu_status_t aipudrv::JobV3::free_job_buffers()
 #endif
 
     if (m_pprint && m_pprint->size != 0)
-        m_mem->free(&m_pprint, "printf");
+        m_arena.free_buf(&m_pprint, "printf");
 
     m_init_tcb.init(0);
 
+    /* the pooled sections are descriptors only, a waiter may still poll the job */
+    if (!m_pool_reuse_idx.empty())
+    {
+        get_graph().get_reuse_pool().detach(this);
+        for (auto k : m_pool_reuse_idx)
+        {
+            if (!m_bss_buffer_vec.empty() && (k < m_bss_buffer_vec[0].reuses.size()))
+                m_mem->free_bufferdesc(&m_bss_buffer_vec[0].reuses[k]);
+        }
+        m_pool_reuse_idx.clear();
+        m_pool_slot = -1;
+    }
+
     for (uint32_t i = 0; i < m_sg_job.size(); i++)
     {
         free_sg_buffers(m_sg_job[i]);
@@ -1097,7 +1349,7 @@ aipu_status_t aipudrv::JobV3::free_job_buffers()
                     m_mem->free_bufferdesc(&m_bss_buffer_vec[bss_idx].reuses[i]);
                     continue;
                 }
-                m_mem->free(&m_bss_buffer_vec[bss_idx].reuses[i]);
+                m_arena.free_buf(&m_bss_buffer_vec[bss_idx].reuses[i], "reuse");
             }
         }
 
@@ -1108,6 +1360,9 @@ aipu_status_t aipudrv::JobV3::free_job_buffers()
     m_sg_job.clear();
     m_bss_buffer_vec.clear();
 
+    /* all descriptors into the arena are gone, release it at once */
+    m_arena.free();
+
     m_inputs.clear();
     m_outputs.clear();
     m_inter_dumps.clear();
@@ -1123,7 +1378,7 @@ aipu_status_t aipudrv::JobV3::setup_task_tcb(uint32_t sg_id, uint32_t grid_id,
 {
     GraphV3X& graph = get_graph();
     Task& task = m_sg_job[sg_id].tasks[task_id];
-    tcb_t tcb;
+    tcb_t &tcb = *staged_tcb(task.tcb.pa);
     TCB* next_tcb = nullptr;
 
     if (task_id != (m_task_per_sg - 1))
@@ -1228,9 +1483,6 @@ aipu_status_t aipudrv::JobV3::setup_task_tcb(uint32_t sg_id, uint32_t grid_id,
         && m_dyn_shape->get_config_shape_sz() > 0)
         tcb.global_param = get_low_32(m_model_global_param->align_asid_pa);
 
-    /* flush TCB to AIPU mem */
-    m_mem->write(task.tcb.pa, (const char*)&tcb, sizeof(tcb_t));
-
     return AIPU_STATUS_SUCCESS;
 }
 
@@ -1275,8 +1527,7 @@ aipu_status_t aipudrv::JobV3::config_smmu_tcb(DEV_PA_64 init_tcb_pa)
                 /* handle the last one segmmu config */
                 if (i == m_segmmu_tcb_num - 1)
                 {
-                    m_mem->write(init_tcb_pa + (1 + i/2) * sizeof(tcb_t),
-                        (const char*)&tcb, sizeof(tcb_t));
+                    *staged_tcb(init_tcb_pa + (1 + i/2) * sizeof(tcb_t)) = tcb;
                     break;
                 }
             } else {
@@ -1289,8 +1540,7 @@ aipu_status_t aipudrv::JobV3::config_smmu_tcb(DEV_PA_64 init_tcb_pa)
                     tcb.next_core_smmu.segs[j].ctrl1 = segmmu.seg[j].control[1];
                 }
 
-                m_mem->write(init_tcb_pa + (1 + i/2) * sizeof(tcb_t),
-                    (const char*)&tcb, sizeof(tcb_t));
+                *staged_tcb(init_tcb_pa + (1 + i/2) * sizeof(tcb_t)) = tcb;
             }
         }
     } else if ((m_segmmu_num == 0) && !m_same_asid) {
@@ -1304,14 +1554,12 @@ aipu_status_t aipudrv::JobV3::config_smmu_tcb(DEV_PA_64 init_tcb_pa)
                 /* handle the last one segmmu config */
                 if (i == m_segmmu_tcb_num - 1)
                 {
-                    m_mem->write(init_tcb_pa + (1 + i/2) * sizeof(tcb_t),
-                        (const char*)&tcb, sizeof(tcb_t));
+                    *staged_tcb(init_tcb_pa + (1 + i/2) * sizeof(tcb_t)) = tcb;
                     break;
                 }
             } else {
                 tcb.next_core_smmu.ctrl = SEGMMU_REMAP_SHARE_EN | SEGMMU_REMAP_EN | SEGMMU_MEM_CTRL_EN;
-                m_mem->write(init_tcb_pa + (1 + i/2) * sizeof(tcb_t),
-                    (const char*)&tcb, sizeof(tcb_t));
+                *staged_tcb(init_tcb_pa + (1 + i/2) * sizeof(tcb_t)) = tcb;
             }
         }
     }
@@ -1330,6 +1578,9 @@ aipu_status_t aipudrv::JobV3::setup_tcb_chain()
     bool is_new_grid = false;
     uint32_t tmp_segmmu_tcb_skip = 0;
 
+    /* compose the chain in host memory, init() publishes it in one write */
+    memset(m_backup_tcb.get(), 0, m_tot_tcb_cnt * sizeof(tcb_t));
+
     for (uint32_t i = 0; i < get_graph().get_subgraph_cnt(); i++)
     {
         /**
@@ -1404,7 +1655,7 @@ aipu_status_t aipudrv::JobV3::setup_tcb_chain()
                 tcb.asids[j].v32.lo = 0;
                 tcb.asids[j].v32.hi = 0;
             }
-            m_mem->write(next_init_tcb_pa, (const char*)&tcb, sizeof(tcb_t));
+            *staged_tcb(next_init_tcb_pa) = tcb;
 
             /* 1.3 config SegMMU if need */
             config_smmu_tcb(next_init_tcb_pa);
@@ -1432,7 +1683,7 @@ aipu_status_t aipudrv::JobV3::setup_tcb_chain()
         &m_rodata->align_asid_pa, 4);
 
     // setup_gm_sync_to_ddr(tcb);
-    m_status = AIPU_JOB_STATUS_INIT;
+    update_job_status(AIPU_JOB_STATUS_INIT);
 
     return AIPU_STATUS_SUCCESS;
 }
@@ -1441,6 +1692,8 @@ aipu_status_t aipudrv::JobV3::init(const aipu_global_config_simulation_t* cfg,
     const aipu_global_config_hw_t* hw_cfg)
 {
     aipu_status_t ret = AIPU_STATUS_SUCCESS;
+    uint64_t t_start = umd_monotonic_ns_helper();
+    uint64_t t_buf = t_start, t_tcb = t_start, t_flush = t_start;
 
     if (get_graph().is_dynamic_shape())
     {
@@ -1469,6 +1722,7 @@ aipu_status_t aipudrv::JobV3::init(const aipu_global_config_simulation_t* cfg,
 
     /* allocate and load job buffers */
     ret = alloc_load_job_buffers();
+    t_buf = t_tcb = t_flush = umd_monotonic_ns_helper();
     if (ret != AIPU_STATUS_SUCCESS)
         goto finish;
 
@@ -1478,39 +1732,49 @@ aipu_status_t aipudrv::JobV3::init(const aipu_global_config_simulation_t* cfg,
      */
     if (get_subgraph_cnt() == 0)
     {
-        m_status = AIPU_JOB_STATUS_INIT;
+        update_job_status(AIPU_JOB_STATUS_INIT);
         goto finish;
     }
 
     ret = setup_tcb_chain();
+    t_tcb = t_flush = umd_monotonic_ns_helper();
     if (ret != AIPU_STATUS_SUCCESS)
         goto finish;
 
-    if (m_backup_tcb != nullptr)
-        m_mem->read(m_init_tcb.pa, m_backup_tcb.get(), m_tot_tcb_cnt * sizeof(tcb_t));
+    /* publish the composed TCB chain */
+    m_mem->write(m_init_tcb.pa, m_backup_tcb.get(), m_tot_tcb_cnt * sizeof(tcb_t));
+    t_flush = umd_monotonic_ns_helper();
 
 finish:
+    LOG(LOG_DEBUG, "job init: buffers %lu us, tcb %lu us (%u tcbs), flush %lu us\n",
+        (t_buf - t_start) / 1000, (t_tcb - t_buf) / 1000, m_tot_tcb_cnt,
+        (t_flush - t_tcb) / 1000);
+    m_recyclable = (ret == AIPU_STATUS_SUCCESS);
     return ret;
 }
 
-aipu_status_t aipudrv::JobV3::schedule()
+aipu_status_t aipudrv::JobV3::prepare_schedule(JobDesc &desc)
 {
     aipu_status_t ret = AIPU_STATUS_SUCCESS;
-    JobDesc desc;
 
     ret = validate_schedule_status();
     if (ret != AIPU_STATUS_SUCCESS)
     {
-        LOG(LOG_ERR, "Job state %d is invalid", m_status);
+        LOG(LOG_ERR, "Job state %d is invalid", get_job_status());
         return ret;
     }
 
     if (m_err_code.size() == 1)
         m_mem->zeroize(m_err_code[0].pa, m_err_code[0].size);
 
+    desc.jobbase = nullptr;
     if (get_subgraph_cnt() == 0)
         return ret;
 
+    ret = admit(true);
+    if (ret != AIPU_STATUS_SUCCESS)
+        return ret;
+
     /* with the backup tcbchain if run the job again */
     if (m_backup_tcb != nullptr && m_backup_tcb_used == true)
         m_mem->write(m_init_tcb.pa, m_backup_tcb.get(), m_tot_tcb_cnt * sizeof(tcb_t));
@@ -1518,7 +1782,10 @@ aipu_status_t aipudrv::JobV3::schedule()
 
     ret = dump_for_emulation();
     if (ret != AIPU_STATUS_SUCCESS)
+    {
+        release_run_resources();
         return ret;
+    }
 
     dump_job_shared_buffers();
     dump_job_private_buffers(*m_rodata, m_descriptor);
@@ -1574,19 +1841,34 @@ aipu_status_t aipudrv::JobV3::schedule()
     desc.kdesc.is_defer_run = m_is_defer_run;
     desc.kdesc.do_trigger = m_do_trigger;
 
+    /* publish first, the end of the job may be reported before schedule returns */
+    m_sched_prev_status = get_job_status();
+    if ((m_is_defer_run == true) && (m_do_trigger == false))
+        update_job_status(AIPU_JOB_STATUS_BIND);
+    else
+        update_job_status(AIPU_JOB_STATUS_SCHED);
+
     if (get_graph().m_text->size == 0)
+    {
         LOG(LOG_WARN, "Graph text size is 0\n");
-    else {
-        ret = m_dev->schedule(desc);
-        if (ret != AIPU_STATUS_SUCCESS)
-            return ret;
+        desc.jobbase = nullptr;
+        release_run_resources();
     }
 
-    if ((m_is_defer_run == true) && (m_do_trigger == false))
-        m_status = AIPU_JOB_STATUS_BIND;
-    else
-        m_status = AIPU_JOB_STATUS_SCHED;
+    return ret;
+}
 
+aipu_status_t aipudrv::JobV3::schedule()
+{
+    aipu_status_t ret = AIPU_STATUS_SUCCESS;
+    JobDesc desc;
+
+    ret = prepare_schedule(desc);
+    if ((ret != AIPU_STATUS_SUCCESS) || (desc.jobbase == nullptr))
+        return ret;
+
+    ret = m_dev->schedule(desc);
+    end_schedule(desc, ret);
     return ret;
 }
 
@@ -1595,6 +1877,107 @@ aipu_status_t aipudrv::JobV3::destroy()
     return free_job_buffers();
 }
 
+bool aipudrv::JobV3::match_config(const aipu_create_job_cfg_t *config)
+{
+    std::set<uint32_t> fm_idxes;
+
+    if ((config->partition_id != m_partition_id) || (config->qos_level != m_qos) ||
+        (config->fm_mem_region != m_fm_mem_region) || (config->dbg_dispatch != m_dbg_dispatch) ||
+        (config->dbg_core_id != m_core_id) || ((config->dynshape != nullptr) != (m_dyn_shape != nullptr)))
+        return false;
+
+    /* dynamic shape jobs are reused for the same input shapes only */
+    if ((m_dyn_shape != nullptr) && !m_dyn_shape->match_shape(config->dynshape))
+        return false;
+
+    if (config->fm_idxes)
+    {
+        for (int i = 0; i < config->fm_idxes_cnt; i++)
+            fm_idxes.insert(config->fm_idxes[i]);
+    }
+
+    return fm_idxes == m_fm_idxes;
+}
+
+/**
+ * bring a finished job back to the state right after init() so that
+ * it can be handed out by the graph's job pool.
+ */
+aipu_status_t aipudrv::JobV3::reset()
+{
+    if (!m_recyclable)
+        return AIPU_STATUS_ERROR_INVALID_OP;
+
+    if ((m_status != AIPU_JOB_STATUS_INIT) && (m_status != AIPU_JOB_STATUS_DONE))
+        return AIPU_STATUS_ERROR_INVALID_OP;
+
+    /* the previous run patched the TCB chain, restore it from the snapshot */
+    if (m_backup_tcb != nullptr && m_backup_tcb_used == true)
+        m_mem->write(m_init_tcb.pa, m_backup_tcb.get(), m_tot_tcb_cnt * sizeof(tcb_t));
+    m_backup_tcb_used = false;
+
+    if (m_dyn_shape != nullptr)
+        m_dyn_shape->reset_out_shape();
+
+    update_job_status(AIPU_JOB_STATUS_INIT);
+    m_callback_func = nullptr;
+
+    return AIPU_STATUS_SUCCESS;
+}
+
+/**
+ * @brief device memory held by this job, which the graph's job pool
+ *        counts against its budget.
+ */
+uint64_t aipudrv::JobV3::get_buffer_bytes()
+{
+    uint64_t bytes = 0;
+    auto add = [&bytes](const BufferDesc *buf) {
+        if (buf != nullptr)
+            bytes += buf->size;
+    };
+
+    add(m_model_global_param);
+    add(m_rodata);
+    add(m_descriptor);
+    add(m_tcbs);
+    add(m_tcbs_bkup);
+    add(m_pprint);
+
+    if (m_top_reuse_buf != nullptr)
+    {
+        add(m_top_reuse_buf);
+    } else if (m_bss_buffer_vec.size() > 0) {
+        for (uint32_t k = 0; k < m_bss_buffer_vec[0].reuses.size(); k++)
+        {
+            if (!is_pool_reuse(k))
+                add(m_bss_buffer_vec[0].reuses[k]);
+        }
+    }
+
+    if (m_top_priv_buf != nullptr)
+    {
+        add(m_top_priv_buf);
+    } else {
+        for (auto &sg_job : m_sg_job)
+        {
+            for (auto buf : sg_job.reuse_priv_buffers)
+                add(buf);
+        }
+    }
+
+    for (auto sgt : m_sgt_allocated)
+    {
+        for (uint32_t i = 0; i < m_task_per_sg; i++)
+        {
+            add(sgt->tasks[i].stack);
+            add(sgt->tasks[i].private_data);
+        }
+    }
+
+    return bytes;
+}
+
 void aipudrv::JobV3::dump_specific_buffers()
 {
     DEV_PA_64 dump_pa;
@@ -2032,7 +2415,7 @@ void aipudrv::JobV3::dumpcfg_alljob()
     std::vector<uint32_t> cluster_id[4];
     uint32_t count = 0, cmdpool_mask = 0;
     MainContext *ctx = static_cast<MainContext *>(get_graph().m_ctx);
-    GraphTable &graphs = ctx->get_graphtable();
+    auto graphs = ctx->get_graphs();
     GraphV3X *graph = nullptr;
     std::ostringstream oss;
     SimulatorV3 *sim = static_cast<SimulatorV3 *>(m_dev);
@@ -2070,8 +2453,9 @@ void aipudrv::JobV3::dumpcfg_alljob()
     {
         graph_iter++;
         graph = static_cast<GraphV3X *>(g.second);
-        auto job_iter = graph->m_jobs.begin();
-        for (auto item: graph->m_jobs)
+        auto jobs = graph->m_jobs.snapshot();
+        auto job_iter = jobs.begin();
+        for (auto item: jobs)
         {
             job_iter++;
             job = static_cast<JobV3 *>(item.second);
@@ -2092,7 +2476,7 @@ void aipudrv::JobV3::dumpcfg_alljob()
                         std::get<2>(job->m_dump_tcb_info[i]));
                 } else {
                     if ((graph_iter != graphs.end()) ||
-                        (graph_iter == graphs.end() && job_iter != graph->m_jobs.end()))
+                        (graph_iter == graphs.end() && job_iter != jobs.end()))
                     {
                         void *addr = nullptr;
                         uint64_t size = 0;
@@ -2127,7 +2511,7 @@ void aipudrv::JobV3::dumpcfg_alljob()
     for (auto g : graphs)
     {
         graph = static_cast<GraphV3X *>(g.second);
-        for (auto item: graph->m_jobs)
+        for (auto item: graph->m_jobs.snapshot())
         {
             job = static_cast<JobV3 *>(item.second);
             if (cmdpool_mask & (1 << job->m_bind_cmdpool_id))
@@ -2168,7 +2552,7 @@ void aipudrv::JobV3::dumpcfg_alljob()
     for (auto g : graphs)
     {
         graph = static_cast<GraphV3X *>(g.second);
-        for (auto item: graph->m_jobs)
+        for (auto item: graph->m_jobs.snapshot())
         {
             job = static_cast<JobV3 *>(item.second);
             for (uint32_t i = 0; i < job->m_dumpcfg_output.size(); i++)
@@ -2192,7 +2576,7 @@ void aipudrv::JobV3::dumpcfg_alljob()
     for (auto g : graphs)
     {
         graph = static_cast<GraphV3X *>(g.second);
-        for (auto item: graph->m_jobs)
+        for (auto item: graph->m_jobs.snapshot())
         {
             job = static_cast<JobV3 *>(item.second);
             ofsmt << job->m_dumpcfg_meta;
@@ -2223,6 +2607,7 @@ aipu_status_t aipudrv::JobV3::bind_core(uint32_t partition_id)
     m_is_defer_run = true;
     m_do_trigger = false;
     m_partition_id = partition_id;
+    m_recyclable = false;
     ret = schedule();
 
     return ret;
@@ -2296,11 +2681,20 @@ aipu_status_t aipudrv::JobV3::parse_dynamic_out_shape()
             }
 
             m_dyn_shape->update_dynamic_io_tensor_size(AIPU_TENSOR_TYPE_OUTPUT);
-            update_single_io_buffers(get_graph().get_bss(0).io.outputs,
-                m_outputs, m_bss_buffer_vec[0].reuses);
         }
     }
 
 out:
     return ret;
 }
+
+aipu_status_t aipudrv::JobV3::get_tensor_descriptor(aipu_tensor_type_t type, uint32_t tensor,
+    aipu_tensor_desc_t* desc)
+{
+    aipu_status_t ret = get_graph().get_tensor_descriptor(type, tensor, desc);
+
+    if ((ret == AIPU_STATUS_SUCCESS) && (m_dyn_shape != nullptr))
+        m_dyn_shape->update_tensor_descriptor(type, tensor, desc);
+
+    return ret;
+}
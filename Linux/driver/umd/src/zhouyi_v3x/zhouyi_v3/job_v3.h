@@ -120,6 +120,11 @@ private:
     BufferDesc *m_tcbs = nullptr;
     BufferDesc *m_tcbs_bkup = nullptr;
     TCB m_init_tcb;
+    /**
+     * host copy of the whole TCB chain: the chain is composed here during
+     * init and published to m_tcbs by one write, then kept as the backup
+     * restored before a rescheduling.
+     */
     std::unique_ptr<char []> m_backup_tcb;
     bool m_backup_tcb_used = false;
     std::vector<SubGraphTask> m_sg_job;
@@ -157,6 +162,20 @@ private:
     std::set<uint32_t> m_top_reuse_idx;
     bool m_top_priv_buf_freed = false;
 
+    /**
+     * arena mode: all buffers above but the GM and specified reuse ones
+     * come from m_arena, placed by a layout shared by the graph's jobs.
+     */
+    JobArena m_arena;
+
+    /**
+     * reuse pool mode: the sections in m_pool_reuse_idx point into the
+     * graph's pool slot held while the job runs, m_pool_slot is the slot
+     * the rodata is relocated for.
+     */
+    std::set<uint32_t> m_pool_reuse_idx;
+    int32_t m_pool_slot = -1;
+
     /**
      * the buffer for storing exit instruction machine code.
      * this exit instruction is run as a standalone task TCB
@@ -199,30 +218,56 @@ private:
     aipu_status_t setup_rodata_sg(uint32_t sg_id, const std::vector<struct GraphParamMapLoadDesc>& param_map,
         std::vector<BufferDesc*>& reuse_buf, std::vector<BufferDesc*>& static_buf,
         std::set<uint32_t> *dma_buf_idx = nullptr);
+    aipu_status_t setup_rodata_bss(std::set<uint32_t> *dma_buf_idx = nullptr);
     aipu_status_t setup_task_tcb(uint32_t sg_id, uint32_t grid_id, uint32_t core_id, uint32_t task_id, bool is_new_grid);
     aipu_status_t setup_tcb_group(uint32_t sg_id, uint32_t grid_id, uint32_t core_id, bool is_new_grid);
     void set_job_params(uint32_t sg_cnt, uint32_t task_per_sg, uint32_t remap, uint32_t core_cnt, uint32_t bss_cnt);
     aipu_status_t alloc_load_job_buffers();
     aipu_status_t free_job_buffers();
     int alloc_subgraph_buffers_optimized();
+    aipu_status_t alloc_arena();
+    aipu_status_t alloc_subgraph_buffers_arena();
+    void init_pool_reuse_idx();
+    BufferDesc *new_pool_reuse_desc(const GraphSectionDesc &section_desc);
+    bool is_pool_reuse(uint32_t k) const
+    {
+        return m_pool_reuse_idx.count(k) == 1;
+    }
     aipu_status_t alloc_subgraph_buffers();
     aipu_status_t init_per_task_data();
     aipu_status_t setup_tcb_chain();
     aipu_status_t config_smmu_tcb(DEV_PA_64 init_tcb_pa);
     void setup_gm_sync_from_ddr(tcb_t &tcb);
     void setup_gm_sync_to_ddr(tcb_t &tcb);
+    tcb_t *staged_tcb(DEV_PA_64 tcb_pa)
+    {
+        return reinterpret_cast<tcb_t *>(m_backup_tcb.get() + (tcb_pa - m_init_tcb.pa));
+    }
     aipu_status_t setup_segmmu(SubGraphTask &sg_task);
     void free_sg_buffers(SubGraphTask& sg_task);
     aipu_status_t dump_for_emulation();
     aipu_status_t specify_io_buffer(aipu_shared_tensor_info_t &tensor_info);
     aipu_status_t parse_dynamic_out_shape();
+    aipu_status_t get_tensor_descriptor(aipu_tensor_type_t type, uint32_t tensor,
+        aipu_tensor_desc_t* desc);
 
 public:
     aipu_status_t init(const aipu_global_config_simulation_t* cfg,
         const aipu_global_config_hw_t* hw_cfg);
     aipu_status_t schedule();
+    bool batchable() const
+    {
+        /* deferred runs and jobs bound to a core are scheduled one by one */
+        return !m_is_defer_run && !m_dbg_dispatch;
+    }
+    aipu_status_t prepare_schedule(JobDesc &desc);
     aipu_status_t destroy();
     aipu_status_t bind_core(uint32_t core_id);
+    bool match_config(const aipu_create_job_cfg_t *config);
+    aipu_status_t admit(bool wait);
+    void release_run_resources();
+    aipu_status_t reset();
+    uint64_t get_buffer_bytes();
     aipu_status_t debugger_run();
 
     #if defined(SIMULATION)
@@ -0,0 +1,31 @@
+// Copyright (C) 2023-2024 Arm Technology (China) Co. Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+/**
+ * @file  mem_trace_decode.cpp
+ * @brief decoder of the memory trace file written by UMD if UMD_MEM_OP is set
+ */
+
+#include "mem_tracer.h"
+
+int main(int argc, char *argv[])
+{
+    aipu_status_t ret = AIPU_STATUS_SUCCESS;
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "usage: %s <memory trace file>\n", argv[0]);
+        return -1;
+    }
+
+    ret = aipudrv::MemTracer::decode(argv[1], stdout);
+    if (ret != AIPU_STATUS_SUCCESS)
+    {
+        fprintf(stderr, "decode %s failed: 0x%x\n", argv[1], ret);
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,174 @@
+// Copyright (C) 2023-2024 Arm Technology (China) Co. Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+/**
+ * @file  sim_server_stub.cpp
+ * @brief stand-in of the simulator in --umd-server mode (UMD_SIM_SERVER=y)
+ *
+ * It speaks the protocol described at SimServer in simulator.h, but runs
+ * no instructions: each job checks that all its buffers lie in the shared
+ * memory and then copies INPUT_DATA0 (rodata) into every output, so that
+ * the plumbing can be tested without a simulator.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+struct Region
+{
+    uint64_t base;
+    uint64_t size;
+    char *va;
+};
+
+static std::vector<Region> g_regions;
+
+static bool xfer(int fd, void *buf, size_t len, bool tx)
+{
+    char *p = (char *)buf;
+
+    while (len > 0)
+    {
+        ssize_t n = tx ? send(fd, p, len, MSG_NOSIGNAL) : recv(fd, p, len, 0);
+        if ((n < 0) && (errno == EINTR))
+            continue;
+        if (n <= 0)
+            return false;
+
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+static std::map<std::string, std::string> parse(const std::string &msg)
+{
+    std::map<std::string, std::string> cfg;
+    std::istringstream iss(msg);
+    std::string line;
+
+    while (std::getline(iss, line))
+    {
+        size_t pos = line.find('=');
+        if (pos != std::string::npos)
+            cfg[line.substr(0, pos)] = line.substr(pos + 1);
+    }
+    return cfg;
+}
+
+static uint64_t get_num(std::map<std::string, std::string> &cfg, const std::string &key)
+{
+    auto iter = cfg.find(key);
+    return (iter == cfg.end()) ? 0 : strtoull(iter->second.c_str(), nullptr, 0);
+}
+
+static char *to_va(uint64_t pa, uint64_t size)
+{
+    for (auto &region : g_regions)
+    {
+        if ((pa >= region.base) && (pa + size <= region.base + region.size))
+            return region.va + (pa - region.base);
+    }
+    return nullptr;
+}
+
+static int32_t map_layout(std::map<std::string, std::string> &cfg, int shm_fd)
+{
+    uint32_t cnt = get_num(cfg, "SHM_REGION_CNT");
+
+    for (uint32_t i = 0; i < cnt; i++)
+    {
+        std::string idx = std::to_string(i);
+        Region region;
+        void *va = nullptr;
+
+        region.base = get_num(cfg, "SHM_REGION_BASE" + idx);
+        region.size = get_num(cfg, "SHM_REGION_SIZE" + idx);
+        va = mmap(nullptr, region.size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE,
+            shm_fd, get_num(cfg, "SHM_REGION_OFFSET" + idx));
+        if (va == MAP_FAILED)
+            return -1;
+
+        region.va = (char *)va;
+        g_regions.push_back(region);
+    }
+    return 0;
+}
+
+static int32_t run_job(std::map<std::string, std::string> &cfg)
+{
+    uint32_t input_cnt = get_num(cfg, "INPUT_DATA_CNT");
+    uint32_t output_cnt = get_num(cfg, "OUTPUT_DATA_CNT");
+    uint64_t rodata_size = get_num(cfg, "INPUT_DATA_SIZE0");
+    char *rodata = to_va(get_num(cfg, "INPUT_DATA_BASE0"), rodata_size);
+
+    if ((rodata == nullptr) || (to_va(get_num(cfg, "INPUT_INST_BASE0"),
+        get_num(cfg, "INPUT_INST_SIZE0")) == nullptr))
+        return 1;
+
+    for (uint32_t i = 1; i < input_cnt; i++)
+    {
+        std::string idx = std::to_string(i);
+        if (to_va(get_num(cfg, "INPUT_DATA_BASE" + idx), get_num(cfg, "INPUT_DATA_SIZE" + idx)) == nullptr)
+            return 1;
+    }
+
+    for (uint32_t i = 0; i < output_cnt; i++)
+    {
+        std::string idx = std::to_string(i);
+        uint64_t size = get_num(cfg, "OUTPUT_DATA_SIZE" + idx);
+        char *va = to_va(get_num(cfg, "OUTPUT_DATA_BASE" + idx), size);
+
+        if (va == nullptr)
+            return 1;
+        memcpy(va, rodata, (size < rodata_size) ? size : rodata_size);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int sock_fd = -1, shm_fd = -1;
+    bool layout = true;
+    std::string msg;
+    uint32_t len = 0;
+
+    if ((argc != 4) || (strcmp(argv[1], "--umd-server") != 0))
+    {
+        fprintf(stderr, "usage: %s --umd-server <sock_fd> <shm_fd>\n", argv[0]);
+        return -1;
+    }
+
+    sock_fd = atoi(argv[2]);
+    shm_fd = atoi(argv[3]);
+
+    /* serve until UMD closes the socket */
+    while (xfer(sock_fd, &len, sizeof(len), false))
+    {
+        std::map<std::string, std::string> cfg;
+        int32_t ret = 0;
+
+        msg.resize(len);
+        if ((len > 0) && !xfer(sock_fd, &msg[0], len, false))
+            break;
+
+        cfg = parse(msg);
+        ret = layout ? map_layout(cfg, shm_fd) : run_job(cfg);
+        layout = false;
+        if (!xfer(sock_fd, &ret, sizeof(ret), true))
+            break;
+    }
+
+    return 0;
+}
@@ -3,9 +3,16 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include <stdlib.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <functional>
 #include "context_test.h"
 #include "standard_api.h"
 #include "aipu.h"
+#include "log.h"
 
 TEST_CASE_FIXTURE(ContextTest, "init")
 {
@@ -205,7 +212,89 @@ TEST_CASE_FIXTURE(ContextTest, "ioctl_cmd")
     CHECK(ret == AIPU_STATUS_SUCCESS);
 }
 
+TEST_CASE_FIXTURE(ContextTest, "completion_reactor")
+{
+    uint32_t cnt = 1;
+    int fd = -1;
+    aipu_status_t ret;
+
+    p_ctx->init();
+
+    ret = p_ctx->process_completions(&cnt);
+    CHECK(ret == AIPU_STATUS_ERROR_INVALID_OP);
+
+    ret = p_ctx->get_completion_fd(nullptr);
+    CHECK(ret == AIPU_STATUS_ERROR_NULL_PTR);
+
+    ret = p_ctx->get_completion_fd(&fd);
+    CHECK(ret == AIPU_STATUS_SUCCESS);
+    CHECK(fd >= 0);
+    close(fd);
+
+    /* nothing flushed, nothing delivered */
+    ret = p_ctx->process_completions(&cnt);
+    CHECK(ret == AIPU_STATUS_SUCCESS);
+    CHECK(cnt == 0);
+
+    p_ctx->force_deinit();
+}
+
 #ifndef SIMULATION
+static std::atomic<uint32_t> g_handed_back_status {AIPU_JOB_STATUS_NO_STATUS};
+
+static int record_handed_back(uint64_t job_id, aipu_job_status_t job_state)
+{
+    g_handed_back_status = job_state;
+    return 0;
+}
+
+TEST_CASE("completion_reactor_two_contexts")
+{
+    string graph_file = "./benchmark/aipu.bin";
+    aipu_ctx_handle_t *ctx[2] = {nullptr, nullptr};
+    uint64_t graph_id[2] = {0}, job_id[2] = {0};
+    aipu_job_status_t status = AIPU_JOB_STATUS_NO_STATUS;
+    uint32_t cnt = 0;
+    int fd = -1;
+
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        REQUIRE(aipu_init_context(&ctx[i]) == AIPU_STATUS_SUCCESS);
+        REQUIRE(aipu_load_graph(ctx[i], graph_file.c_str(), &graph_id[i]) == AIPU_STATUS_SUCCESS);
+        REQUIRE(aipu_create_job(ctx[i], graph_id[i], &job_id[i]) == AIPU_STATUS_SUCCESS);
+    }
+
+    /* IDs are unique in the process, a context doesn't resolve those of another */
+    CHECK(graph_id[0] != graph_id[1]);
+    CHECK(job_id[0] != job_id[1]);
+    CHECK(aipu_get_job_status(ctx[0], job_id[1], &status) == AIPU_STATUS_ERROR_INVALID_JOB_ID);
+
+    /* context 0 drains the completions of the process, context 1 has no reactor */
+    REQUIRE(aipu_get_completion_fd(ctx[0], &fd) == AIPU_STATUS_SUCCESS);
+    g_handed_back_status = AIPU_JOB_STATUS_NO_STATUS;
+    REQUIRE(aipu_flush_job(ctx[1], job_id[1], record_handed_back) == AIPU_STATUS_SUCCESS);
+
+    for (uint32_t i = 0; (i < 100) && (g_handed_back_status == AIPU_JOB_STATUS_NO_STATUS); i++)
+    {
+        CHECK(aipu_process_completions(ctx[0], &cnt) == AIPU_STATUS_SUCCESS);
+        CHECK(cnt == 0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    /* the end of the job of context 1 is handed back to it, not dropped */
+    CHECK(g_handed_back_status == AIPU_JOB_STATUS_DONE);
+    CHECK(aipu_get_job_status(ctx[1], job_id[1], &status) == AIPU_STATUS_SUCCESS);
+    CHECK(status == AIPU_JOB_STATUS_DONE);
+
+    close(fd);
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        aipu_clean_job(ctx[i], job_id[i]);
+        aipu_unload_graph(ctx[i], graph_id[i]);
+        aipu_deinit_context(ctx[i]);
+    }
+}
+
 TEST_CASE_FIXTURE(ContextTest, "get_core_count")
 {
     uint32_t cluster = 0;
@@ -260,3 +349,148 @@ TEST_CASE_FIXTURE(ContextTest, "get_core_info")
 }
 
 #endif
+
+extern volatile char UMD_LOG_TIMESTAMP;
+
+/* a null string arg, not known to be null where it is logged */
+const char *ut_log_null_str = nullptr;
+
+/* runs the logging function with stdout in a file, returns the lines */
+static std::vector<std::string> run_with_stdout_file(std::function<void()> func)
+{
+    const char *file_name = "async_log_test.txt";
+    std::vector<std::string> lines;
+    char line[512] = {0};
+    FILE *file = nullptr;
+    int saved = dup(STDOUT_FILENO);
+    int fd = open(file_name, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+
+    fflush(stdout);
+    dup2(fd, STDOUT_FILENO);
+    close(fd);
+    func();
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+
+    file = fopen(file_name, "r");
+    while ((file != nullptr) && (fgets(line, sizeof(line), file) != nullptr))
+        lines.push_back(line);
+    if (file != nullptr)
+        fclose(file);
+    remove(file_name);
+    return lines;
+}
+
+TEST_CASE("async_log")
+{
+    int32_t level = UMD_LOG_LEVEL;
+    char name[] = "resnet";
+    std::string long_str(1000, 'a');
+    std::vector<std::string> lines;
+
+    UMD_LOG_LEVEL = LOG_DEFAULT;
+    UMD_LOG_ASYNC = true;
+    lines = run_with_stdout_file([&]() {
+        LOG(LOG_INFO, "job %d: pa 0x%lx %s %8x %c %u%%", -3, 0x12345678abUL, name, 0xabcU, 'z', 7U);
+        LOG(LOG_DEFAULT, "short %hd, long %ld, %.2f, %s", (short)-2, -5L, 1.5, ut_log_null_str);
+        LOG(LOG_DEFAULT, "%s|%s", long_str.c_str(), "cut");
+
+        /* the error comes after the messages before it */
+        LOG(LOG_ERR, "error %d", 1);
+        std::thread([]() {
+            for (uint32_t i = 0; i < 4 * LOG_ASYNC_RING_SIZE; i++)
+                LOG(LOG_DEFAULT, "thread %u", i);
+        }).join();
+        umd_log_flush();
+    });
+    UMD_LOG_ASYNC = false;
+    UMD_LOG_LEVEL = level;
+
+    REQUIRE(lines.size() == 4 + 4 * LOG_ASYNC_RING_SIZE);
+    CHECK(lines[0].find("[UMD INF]") != std::string::npos);
+    CHECK(lines[0].find("job -3: pa 0x12345678ab resnet      abc z 7%\n") != std::string::npos);
+    CHECK(lines[1] == "short -2, long -5, 1.50, (null)\n");
+    CHECK(lines[2].size() == LOG_ASYNC_STR_BYTES - 1 + 2);
+    CHECK(lines[2].find("|\n") == LOG_ASYNC_STR_BYTES - 1);
+    CHECK(lines[3].find("error 1") != std::string::npos);
+    CHECK(lines[4] == "thread 0\n");
+    CHECK(lines.back() == "thread " + std::to_string(4 * LOG_ASYNC_RING_SIZE - 1) + "\n");
+}
+
+TEST_CASE("async_log_benchmark")
+{
+    int32_t level = UMD_LOG_LEVEL;
+    char timestamp = UMD_LOG_TIMESTAMP;
+    uint32_t burst = LOG_ASYNC_RING_SIZE / 2;
+    uint32_t rounds = 100;
+    double ns[2] = {0};
+
+    UMD_LOG_LEVEL = LOG_INFO;
+    UMD_LOG_TIMESTAMP = 'y';
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        UMD_LOG_ASYNC = (i == 1);
+        run_with_stdout_file([&]() {
+            std::chrono::steady_clock::duration elapsed{0};
+
+            /* bursts the ring holds, the writer drains it in between */
+            for (uint32_t j = 0; j < rounds; j++)
+            {
+                auto start = std::chrono::steady_clock::now();
+
+                for (uint32_t k = 0; k < burst; k++)
+                    LOG(LOG_INFO, "rodata reloc %u: 0x%lx -> 0x%x", k, 0x80000000UL + k, k * 4);
+                elapsed += std::chrono::steady_clock::now() - start;
+                umd_log_flush();
+            }
+            ns[i] = std::chrono::duration<double, std::nano>(elapsed).count() / (burst * rounds);
+        });
+    }
+    UMD_LOG_ASYNC = false;
+    UMD_LOG_TIMESTAMP = timestamp;
+    UMD_LOG_LEVEL = level;
+
+    MESSAGE("LOG_INFO with timestamp, printf: " << ns[0] << " ns, async: " << ns[1] << " ns per message");
+}
+
+TEST_CASE("async_log_fork")
+{
+    int32_t level = UMD_LOG_LEVEL;
+    std::vector<std::string> lines;
+    int status = -1;
+
+    UMD_LOG_LEVEL = LOG_DEFAULT;
+    UMD_LOG_ASYNC = true;
+    lines = run_with_stdout_file([&]() {
+        pid_t pid = 0;
+
+        LOG(LOG_DEFAULT, "parent %d", 1);
+        umd_log_flush();
+
+        /* the child has no writer of its parent, its exit flushes its own */
+        pid = fork();
+        if (pid == 0)
+        {
+            LOG(LOG_DEFAULT, "child %d", 2);
+            LOG(LOG_ERR, "child %d", 3);
+            exit(0);
+        }
+
+        for (uint32_t i = 0; (i < 500) && (waitpid(pid, &status, WNOHANG) == 0); i++)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        if (!WIFEXITED(status))
+        {
+            kill(pid, SIGKILL);
+            waitpid(pid, &status, 0);
+        }
+    });
+    UMD_LOG_ASYNC = false;
+    UMD_LOG_LEVEL = level;
+
+    CHECK(WIFEXITED(status));
+    REQUIRE(lines.size() == 3);
+    CHECK(lines[0] == "parent 1\n");
+    CHECK(lines[1] == "child 2\n");
+    CHECK(lines[2].find("child 3") != std::string::npos);
+}
@@ -5,6 +5,8 @@
 #include <stdlib.h>
 #include "graph_test.h"
 #include "aipu.h"
+#include "weight_store.h"
+#include "memory/memory_test.h"
 
 TEST_CASE_FIXTURE(GraphTest, "load")
 {
@@ -223,4 +225,51 @@ TEST_CASE_FIXTURE(GraphTest, "get_batch_queue_size")
 
     batch_queue_size = p_gobj->get_batch_queue_size(queue_id);
     CHECK(batch_queue_size != 0);
-}
\ No newline at end of file
+}
+
+TEST_CASE("weight_store")
+{
+    WeightStore &store = WeightStore::get_weight_store();
+    HostMemory mem;
+    BufferDesc *weight = nullptr, *zerocpy_const = nullptr;
+    BufferDesc *weight_a = nullptr, *weight_b = nullptr;
+    const char data[] = "0123456789abcdef0123456789abcdefxyz";
+    const char data_a[] = "weights of graph a";
+    const char data_b[] = "weights of graph b";
+    auto matcher = [&](const char *expect) {
+        return [&mem, expect](const BufferDesc *buf, const BufferDesc *) {
+            char read_back[sizeof(data_a)] = {0};
+
+            mem.read(buf->pa, read_back, sizeof(read_back));
+            return memcmp(read_back, expect, sizeof(read_back)) == 0;
+        };
+    };
+
+    CHECK(WeightStore::hash(data, sizeof(data), 0) == WeightStore::hash(data, sizeof(data), 0));
+    CHECK(WeightStore::hash(data, sizeof(data), 0) != WeightStore::hash(data, sizeof(data), 1));
+    CHECK(WeightStore::hash(data, sizeof(data), 0) != WeightStore::hash(data, sizeof(data) - 1, 0));
+
+    mem.malloc(sizeof(data_a), 0, &weight_a, "weight_a");
+    mem.write(weight_a->pa, data_a, sizeof(data_a));
+    mem.malloc(sizeof(data_b), 0, &weight_b, "weight_b");
+    mem.write(weight_b->pa, data_b, sizeof(data_b));
+
+    /* graphs of one layout with other weights get their own entries */
+    CHECK(store.get("ut_key", matcher(data_a), &weight, &zerocpy_const) == false);
+    store.publish("ut_key", &mem, weight_a, nullptr);
+    CHECK(store.get("ut_key", matcher(data_b), &weight, &zerocpy_const) == false);
+    store.publish("ut_key", &mem, weight_b, nullptr);
+
+    CHECK(store.get("ut_key", matcher(data_b), &weight, &zerocpy_const) == true);
+    CHECK(weight == weight_b);
+    CHECK(store.get("ut_key", matcher(data_a), &weight, &zerocpy_const) == true);
+    CHECK(weight == weight_a);
+
+    /* an entry is freed once its last graph releases it */
+    store.release("ut_key", weight_a);
+    store.release("ut_key", weight_a);
+    CHECK(store.get("ut_key", matcher(data_a), &weight, &zerocpy_const) == false);
+    store.release("ut_key", weight_b);
+    store.release("ut_key", weight_b);
+    CHECK(store.get("ut_key", matcher(data_b), &weight, &zerocpy_const) == false);
+}
@@ -3,7 +3,20 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include <stdlib.h>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <sys/resource.h>
+#include <map>
+#include <set>
+#include <cstring>
+#include <pthread.h>
 #include "job_test.h"
+#include "slot_table.h"
+#include "rodata_template.h"
+#include "job_arena.h"
+#include "reuse_pool.h"
+#include "memory/memory_test.h"
 #include "standard_api.h"
 #include "aipu.h"
 
@@ -100,6 +113,41 @@ TEST_CASE_FIXTURE(JobTest, "destroy")
     CHECK(ret == AIPU_STATUS_SUCCESS);
 }
 
+#if (defined ZHOUYI_V3)
+TEST_CASE_FIXTURE(JobTest, "reset")
+{
+    aipu_status_t ret;
+    aipu_job_status_t status;
+
+    p_job->init(&m_sim_cfg, &m_hw_cfg);
+    CHECK(p_job->match_config(&create_job_cfg) == true);
+
+    ret = p_job->reset();
+    CHECK(ret == AIPU_STATUS_SUCCESS);
+
+    p_job->load_tensor(0, input_file.c_str());
+#if (defined SIMULATION)
+    p_job->config_simulation(AIPU_CONFIG_TYPE_SIMULATION, &sim_job_config);
+#endif
+    p_job->schedule();
+    p_job->get_status_blocking(&status, -1);
+    ret = p_job->reset();
+    CHECK(ret == AIPU_STATUS_SUCCESS);
+    CHECK(p_job->get_job_status() == AIPU_JOB_STATUS_INIT);
+
+    /* a recycled job runs again with the restored TCB chain */
+    p_job->load_tensor(0, input_file.c_str());
+    ret = p_job->schedule();
+    CHECK(ret == AIPU_STATUS_SUCCESS);
+    ret = p_job->get_status_blocking(&status, -1);
+    CHECK(ret == AIPU_STATUS_SUCCESS);
+
+    p_job->config_mem_dump(AIPU_JOB_CONFIG_TYPE_DUMP_OUTPUT, nullptr);
+    ret = p_job->reset();
+    CHECK(ret == AIPU_STATUS_ERROR_INVALID_OP);
+}
+#endif
+
 TEST_CASE_FIXTURE(JobTest, "get_tensor")
 {
     aipu_status_t ret;
@@ -211,3 +259,776 @@ TEST_CASE_FIXTURE(JobTest, "specify_io_buffer")
     CHECK(ret == AIPU_STATUS_SUCCESS);
 }
 
+
+/**
+ * jobs of one dynamic shape graph, each with its own input shape, are created,
+ * queried and run from several threads at once; every job must keep reporting
+ * its own sizes and the graph's descriptors must stay as loaded.
+ */
+TEST_CASE("dynamic_shape_concurrent_jobs")
+{
+    const char *ds_graph_file = "./benchmark/aipu_ds.bin";
+    const uint32_t thread_cnt = 8, round_cnt = 16;
+    aipu_ctx_handle_t *ctx = nullptr;
+    uint64_t graph_id = 0;
+    uint32_t ds_num = 0, in_cnt = 0;
+    aipu_dynshape_num_t ds_num_arg = {0};
+    std::vector<std::vector<uint32_t>> shapes[2];
+    std::vector<aipu_tensor_desc_t> graph_descs;
+    std::vector<std::thread> threads;
+    std::atomic_int errors{0};
+    struct stat finfo;
+
+    if (stat(ds_graph_file, &finfo) != 0)
+    {
+        MESSAGE("no dynamic shape graph ", ds_graph_file, ", skipped");
+        return;
+    }
+
+    REQUIRE(aipu_init_context(&ctx) == AIPU_STATUS_SUCCESS);
+    REQUIRE(aipu_load_graph(ctx, ds_graph_file, &graph_id) == AIPU_STATUS_SUCCESS);
+
+    ds_num_arg.graph_id = graph_id;
+    ds_num_arg.ds_num = &ds_num;
+    CHECK(aipu_ioctl(ctx, AIPU_IOCTL_GET_DS_NUM, &ds_num_arg) == AIPU_STATUS_SUCCESS);
+    aipu_get_tensor_count(ctx, graph_id, AIPU_TENSOR_TYPE_INPUT, &in_cnt);
+
+    /* shapes[0]: minimum shapes, shapes[1]: maximum shapes */
+    for (uint32_t i = 0; (ds_num > 0) && (i < in_cnt); i++)
+    {
+        aipu_tensor_desc_t desc;
+
+        for (uint32_t m = 0; m < 2; m++)
+        {
+            uint32_t dim_num = 0;
+            aipu_dynshape_dim_num_t dim_arg = {graph_id, i, m == 1, &dim_num};
+
+            CHECK(aipu_ioctl(ctx, AIPU_IOCTL_GET_DS_DIM_NUM, &dim_arg) == AIPU_STATUS_SUCCESS);
+            shapes[m].push_back(std::vector<uint32_t>(dim_num));
+
+            aipu_dynshape_info_t info_arg = {graph_id, i, m == 1, shapes[m][i].data()};
+            CHECK(aipu_ioctl(ctx, AIPU_IOCTL_GET_DS_INFO, &info_arg) == AIPU_STATUS_SUCCESS);
+        }
+
+        aipu_get_tensor_descriptor(ctx, graph_id, AIPU_TENSOR_TYPE_INPUT, i, &desc);
+        graph_descs.push_back(desc);
+    }
+
+    for (uint32_t t = 0; (ds_num > 0) && (t < thread_cnt); t++)
+    {
+        threads.push_back(std::thread([&, t]() {
+            std::vector<std::vector<uint32_t>> &shape = shapes[t % 2];
+            std::vector<aipu_dynshape_item_t> items(in_cnt);
+            aipu_dynshape_param_t param = {in_cnt, items.data()};
+            aipu_create_job_cfg_t cfg = {0};
+            std::vector<char> input;
+
+            for (uint32_t i = 0; i < in_cnt; i++)
+                items[i] = {i, shape[i].data()};
+            cfg.dynshape = &param;
+
+            for (uint32_t r = 0; r < round_cnt; r++)
+            {
+                uint64_t job_id = 0;
+
+                if (aipu_create_job(ctx, graph_id, &job_id, &cfg) != AIPU_STATUS_SUCCESS)
+                {
+                    errors++;
+                    continue;
+                }
+
+                for (uint32_t i = 0; i < in_cnt; i++)
+                {
+                    aipu_tensor_desc_t desc;
+                    uint32_t size = 1;
+
+                    for (auto dim : shape[i])
+                        size *= dim;
+                    if ((graph_descs[i].data_type == AIPU_DATA_TYPE_U16) ||
+                        (graph_descs[i].data_type == AIPU_DATA_TYPE_S16) ||
+                        (graph_descs[i].data_type == AIPU_DATA_TYPE_F16) ||
+                        (graph_descs[i].data_type == AIPU_DATA_TYPE_BF16))
+                        size <<= 1;
+                    else if ((graph_descs[i].data_type == AIPU_DATA_TYPE_U32) ||
+                        (graph_descs[i].data_type == AIPU_DATA_TYPE_S32) ||
+                        (graph_descs[i].data_type == AIPU_DATA_TYPE_F32))
+                        size <<= 2;
+
+                    if ((aipu_get_tensor_descriptor(ctx, job_id, AIPU_TENSOR_TYPE_INPUT,
+                        i, &desc) != AIPU_STATUS_SUCCESS) || (desc.size != size))
+                    {
+                        errors++;
+                        continue;
+                    }
+
+                    input.assign(size, (char)t);
+                    if (aipu_load_tensor(ctx, job_id, i, input.data()) != AIPU_STATUS_SUCCESS)
+                        errors++;
+                }
+
+                /* the threads' jobs run side by side, each one on its own shape */
+                if (aipu_finish_job(ctx, job_id, -1) != AIPU_STATUS_SUCCESS)
+                    errors++;
+
+                if (aipu_clean_job(ctx, job_id) != AIPU_STATUS_SUCCESS)
+                    errors++;
+            }
+        }));
+    }
+
+    for (auto &th : threads)
+        th.join();
+    CHECK(errors == 0);
+
+    for (uint32_t i = 0; i < graph_descs.size(); i++)
+    {
+        aipu_tensor_desc_t desc;
+
+        aipu_get_tensor_descriptor(ctx, graph_id, AIPU_TENSOR_TYPE_INPUT, i, &desc);
+        CHECK(desc.size == graph_descs[i].size);
+    }
+
+    aipu_unload_graph(ctx, graph_id);
+    aipu_deinit_context(ctx);
+}
+
+#if (defined ZHOUYI_V3)
+TEST_CASE_FIXTURE(JobTest, "job_cache")
+{
+    aipu_job_cache_stats_t stats = {0};
+    GraphV3X *graph = nullptr;
+    JOB_ID id0 = 0, id1 = 0;
+
+    /* off by default */
+    REQUIRE(p_gobj->create_job(&id0, &m_sim_cfg, &m_hw_cfg, &create_job_cfg) == AIPU_STATUS_SUCCESS);
+    CHECK(p_gobj->destroy_job(id0) == AIPU_STATUS_SUCCESS);
+    p_gobj->get_job_cache_stats(&stats);
+    CHECK(stats.cached_jobs == 0);
+
+    /* a graph reads the cache size when it is created */
+    setenv("UMD_JOB_POOL_SZ", "8", 1);
+    graph = new GraphV3X(p_ctx, _id + 1, m_dev);
+    unsetenv("UMD_JOB_POOL_SZ");
+    gbin.clear();
+    gbin.seekg(0, gbin.beg);
+    REQUIRE(graph->load(gbin, fsize, m_do_vcheck) == AIPU_STATUS_SUCCESS);
+
+    REQUIRE(graph->create_job(&id0, &m_sim_cfg, &m_hw_cfg, &create_job_cfg) == AIPU_STATUS_SUCCESS);
+    CHECK(graph->destroy_job(id0) == AIPU_STATUS_SUCCESS);
+    graph->get_job_cache_stats(&stats);
+    CHECK(stats.misses == 1);
+    CHECK(stats.cached_jobs == 1);
+    CHECK(stats.cached_bytes > 0);
+
+    /* an identical config gets the cleaned job back */
+    REQUIRE(graph->create_job(&id1, &m_sim_cfg, &m_hw_cfg, &create_job_cfg) == AIPU_STATUS_SUCCESS);
+    graph->get_job_cache_stats(&stats);
+    CHECK(stats.hits == 1);
+    CHECK(stats.cached_jobs == 0);
+    CHECK(stats.cached_bytes == 0);
+    CHECK(graph->destroy_job(id1) == AIPU_STATUS_SUCCESS);
+    delete graph;
+}
+#endif
+
+static uint64_t cpu_time_us()
+{
+    struct rusage usage;
+
+    getrusage(RUSAGE_SELF, &usage);
+    return (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 +
+        usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+/**
+ * several threads flush their jobs back to back and block on their status;
+ * reports the process cpu time per completed job. pollers sleep on the job
+ * status instead of spinning, so it should stay far below the wall time
+ * times the thread count.
+ */
+TEST_CASE("job_status_mt_benchmark")
+{
+    const char *graph_file = "./benchmark/aipu.bin";
+    const uint32_t thread_cnt = 8, round_cnt = 64;
+    aipu_ctx_handle_t *ctx = nullptr;
+    uint64_t graph_id = 0, cpu_us = 0, wall_us = 0;
+    std::vector<std::thread> threads;
+    std::atomic_int errors{0};
+    std::atomic_uint done{0};
+    struct stat finfo;
+
+    if (stat(graph_file, &finfo) != 0)
+    {
+        MESSAGE("no graph ", graph_file, ", skipped");
+        return;
+    }
+
+    REQUIRE(aipu_init_context(&ctx) == AIPU_STATUS_SUCCESS);
+    REQUIRE(aipu_load_graph(ctx, graph_file, &graph_id) == AIPU_STATUS_SUCCESS);
+
+    auto wall_start = std::chrono::steady_clock::now();
+    cpu_us = cpu_time_us();
+    for (uint32_t t = 0; t < thread_cnt; t++)
+    {
+        threads.push_back(std::thread([&]() {
+            aipu_create_job_cfg_t cfg = {0};
+            uint64_t job_id = 0;
+
+            if (aipu_create_job(ctx, graph_id, &job_id, &cfg) != AIPU_STATUS_SUCCESS)
+            {
+                errors++;
+                return;
+            }
+
+            for (uint32_t r = 0; r < round_cnt; r++)
+            {
+                aipu_job_status_t status = AIPU_JOB_STATUS_NO_STATUS;
+
+                if ((aipu_flush_job(ctx, job_id, nullptr) != AIPU_STATUS_SUCCESS) ||
+                    (aipu_get_job_status(ctx, job_id, &status, -1) != AIPU_STATUS_SUCCESS) ||
+                    (status != AIPU_JOB_STATUS_DONE))
+                {
+                    errors++;
+                    break;
+                }
+                done++;
+            }
+            aipu_clean_job(ctx, job_id);
+        }));
+    }
+
+    for (auto &th : threads)
+        th.join();
+    cpu_us = cpu_time_us() - cpu_us;
+    wall_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - wall_start).count();
+
+    CHECK(errors == 0);
+    if (done > 0)
+    {
+        MESSAGE(done.load(), " jobs by ", thread_cnt, " threads: ",
+            done.load() * 1000000.0 / wall_us, " jobs/s, ",
+            (double)cpu_us / done.load(), " us cpu per job, ",
+            (double)cpu_us / wall_us, " cores busy");
+    }
+
+    aipu_unload_graph(ctx, graph_id);
+    aipu_deinit_context(ctx);
+}
+
+/**
+ * flush several jobs of one graph by one call, then each of them should
+ * end as a singly flushed job does.
+ */
+TEST_CASE("flush_jobs")
+{
+    const char *graph_file = "./benchmark/aipu.bin";
+    const uint32_t job_cnt = 4;
+    aipu_ctx_handle_t *ctx = nullptr;
+    aipu_create_job_cfg_t cfg = {0};
+    aipu_job_status_t status = AIPU_JOB_STATUS_NO_STATUS;
+    uint64_t graph_id = 0, bad_id = 0;
+    std::vector<uint64_t> job_ids(job_cnt, 0);
+    struct stat finfo;
+
+    if (stat(graph_file, &finfo) != 0)
+    {
+        MESSAGE("no graph ", graph_file, ", skipped");
+        return;
+    }
+
+    REQUIRE(aipu_init_context(&ctx) == AIPU_STATUS_SUCCESS);
+    REQUIRE(aipu_load_graph(ctx, graph_file, &graph_id) == AIPU_STATUS_SUCCESS);
+    for (auto &job_id : job_ids)
+        REQUIRE(aipu_create_job(ctx, graph_id, &job_id, &cfg) == AIPU_STATUS_SUCCESS);
+
+    CHECK(aipu_flush_jobs(ctx, nullptr, job_cnt) == AIPU_STATUS_ERROR_NULL_PTR);
+    CHECK(aipu_flush_jobs(ctx, job_ids.data(), 0) == AIPU_STATUS_ERROR_INVALID_SIZE);
+    CHECK(aipu_flush_jobs(ctx, &bad_id, 1) == AIPU_STATUS_ERROR_INVALID_JOB_ID);
+
+    CHECK(aipu_flush_jobs(ctx, job_ids.data(), job_cnt) == AIPU_STATUS_SUCCESS);
+    for (auto job_id : job_ids)
+    {
+        CHECK(aipu_get_job_status(ctx, job_id, &status, -1) == AIPU_STATUS_SUCCESS);
+        CHECK(status == AIPU_JOB_STATUS_DONE);
+        aipu_clean_job(ctx, job_id);
+    }
+
+    aipu_unload_graph(ctx, graph_id);
+    aipu_deinit_context(ctx);
+}
+
+TEST_CASE("job_slot_table")
+{
+    SlotTable<JobBase> table;
+    JobBase *job = reinterpret_cast<JobBase *>(0x1000);
+    uint32_t key = 0, new_key = 0;
+
+    key = table.reserve();
+    CHECK(key != 0);
+    CHECK(table.get(key) == nullptr);
+    table.set(key, job);
+    CHECK(table.get(key) == job);
+    CHECK(table.size() == 1);
+
+    /* a released key stops resolving even if its slot is taken again */
+    CHECK(table.release(key) == true);
+    CHECK(table.get(key) == nullptr);
+    CHECK(table.release(key) == false);
+    new_key = table.insert(job);
+    CHECK(SlotTable<JobBase>::key_index(new_key) == SlotTable<JobBase>::key_index(key));
+    CHECK(new_key != key);
+    CHECK(table.get(key) == nullptr);
+    CHECK(table.get(new_key) == job);
+    CHECK(table.snapshot().size() == 1);
+
+    table.clear();
+    CHECK(table.get(new_key) == nullptr);
+    CHECK(table.size() == 0);
+}
+
+/**
+ * job ID lookups from 1 to 64 threads, by the slot table and by the
+ * std::map plus rwlock it replaces. reports lookups per second for each.
+ */
+TEST_CASE("job_lookup_contention_benchmark")
+{
+    const uint32_t job_cnt = 256, lookup_cnt = 1 << 21;
+    SlotTable<JobBase> table;
+    std::map<JOB_ID, JobBase *> legacy;
+    pthread_rwlock_t legacy_lock;
+    std::vector<uint32_t> keys;
+    std::atomic_int errors{0};
+
+    pthread_rwlock_init(&legacy_lock, NULL);
+    for (uint32_t i = 0; i < job_cnt; i++)
+    {
+        JobBase *job = reinterpret_cast<JobBase *>((uintptr_t)(i + 1) << 4);
+
+        keys.push_back(table.insert(job));
+        legacy[keys.back()] = job;
+    }
+
+    for (uint32_t thread_cnt = 1; thread_cnt <= 64; thread_cnt *= 2)
+    {
+        double rate[2] = {0};
+
+        for (int mode = 0; mode < 2; mode++)
+        {
+            std::vector<std::thread> threads;
+            auto start = std::chrono::steady_clock::now();
+
+            for (uint32_t t = 0; t < thread_cnt; t++)
+            {
+                threads.push_back(std::thread([&, t, mode]() {
+                    JobBase *job = nullptr;
+
+                    for (uint32_t i = 0; i < lookup_cnt / thread_cnt; i++)
+                    {
+                        uint32_t key = keys[(i + t * 7) % job_cnt];
+
+                        if (mode == 0)
+                        {
+                            job = table.get(key);
+                        } else {
+                            pthread_rwlock_rdlock(&legacy_lock);
+                            job = (legacy.count(key) ? legacy[key] : nullptr);
+                            pthread_rwlock_unlock(&legacy_lock);
+                        }
+
+                        if (job != reinterpret_cast<JobBase *>((uintptr_t)(((i + t * 7) % job_cnt) + 1) << 4))
+                            errors++;
+                    }
+                }));
+            }
+
+            for (auto &th : threads)
+                th.join();
+            rate[mode] = (double)(lookup_cnt / thread_cnt * thread_cnt) /
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        MESSAGE(thread_cnt, " threads: slot table ", rate[0] / 1000000, " Mops/s, map+rwlock ",
+            rate[1] / 1000000, " Mops/s");
+    }
+
+    CHECK(errors == 0);
+    pthread_rwlock_destroy(&legacy_lock);
+}
+
+/* a device over host memory, for the jobs which only relocate */
+class HostDevice : public DeviceBase
+{
+public:
+    HostDevice(MemoryBase *mem)
+    {
+        m_dram = mem;
+    }
+
+    bool has_target(uint32_t arch, uint32_t version, uint32_t config, uint32_t rev)
+    {
+        return true;
+    }
+
+    aipu_status_t schedule(const JobDesc& job)
+    {
+        return AIPU_STATUS_SUCCESS;
+    }
+};
+
+/* a job owning rodata + dcr buffers, it relocates them by JobBase::setup_rodata */
+class RodataJob : public JobBase
+{
+private:
+    std::vector<BufferDesc*> m_no_reuse;
+
+public:
+    BufferDesc *m_ro = nullptr;
+    BufferDesc *m_dcr = nullptr;
+
+    using JobBase::setup_rodata;
+
+    /* the images are copied in, relocated per entry and copied back */
+    aipu_status_t relocate(std::vector<char> &ro, std::vector<char> &dcr,
+        const std::vector<struct GraphParamMapLoadDesc> &param_map,
+        const std::vector<BufferDesc *> &reuse_buf, const std::vector<BufferDesc *> &static_buf,
+        std::set<uint32_t> *dma_buf_idx = nullptr)
+    {
+        aipu_status_t ret = AIPU_STATUS_SUCCESS;
+
+        m_mem->write(m_ro->pa, ro.data(), ro.size());
+        m_mem->write(m_dcr->pa, dcr.data(), dcr.size());
+        ret = setup_rodata(param_map, reuse_buf, static_buf, *m_ro, m_dcr, dma_buf_idx);
+        m_mem->read(m_ro->pa, ro.data(), ro.size());
+        m_mem->read(m_dcr->pa, dcr.data(), dcr.size());
+        return ret;
+    }
+
+    uint32_t get_subgraph_cnt()
+    {
+        return 0;
+    }
+
+    const std::vector<BufferDesc*> & get_reuse()
+    {
+        return m_no_reuse;
+    }
+
+    aipu_status_t init(const aipu_global_config_simulation_t* cfg,
+       const aipu_global_config_hw_t* hw_cfg)
+    {
+        return AIPU_STATUS_SUCCESS;
+    }
+
+    aipu_status_t schedule()
+    {
+        return AIPU_STATUS_SUCCESS;
+    }
+
+    aipu_status_t destroy()
+    {
+        return AIPU_STATUS_SUCCESS;
+    }
+
+    aipu_status_t bind_core(uint32_t core_id)
+    {
+        return AIPU_STATUS_SUCCESS;
+    }
+
+    RodataJob(GraphBase &graph, DeviceBase *dev, uint32_t ro_size, uint32_t dcr_size):
+        JobBase(nullptr, graph, dev)
+    {
+        m_mem->malloc(ro_size, 0, &m_ro, "rodata");
+        m_mem->malloc(dcr_size, 0, &m_dcr, "dcr");
+    }
+
+    ~RodataJob()
+    {
+        m_mem->free(&m_ro);
+        m_mem->free(&m_dcr);
+    }
+};
+
+/* a shuffled map over rodata + dcr, every third entry points to a weight section */
+static void make_param_map(uint32_t entry_cnt, uint32_t reuse_cnt, uint32_t static_cnt,
+    std::vector<char> &rodata, std::vector<char> &dcr,
+    std::vector<struct GraphParamMapLoadDesc> &param_map)
+{
+    rodata.resize((uint64_t)entry_cnt * 8 / 2);
+    dcr.resize((uint64_t)entry_cnt * 8 - rodata.size());
+    for (uint64_t i = 0; i < rodata.size(); i++)
+        rodata[i] = (char)(i * 31);
+    for (uint64_t i = 0; i < dcr.size(); i++)
+        dcr[i] = (char)(i * 17);
+
+    param_map.clear();
+    for (uint32_t i = 0; i < entry_cnt; i++)
+    {
+        struct GraphParamMapLoadDesc param;
+        uint32_t slot = (i * 2654435761U) % entry_cnt;
+
+        if (i % 3 == 0)
+            param.init(slot * 8, PARAM_MAP_LOAD_TYPE_STATIC, 0, i % static_cnt, 0, i * 64,
+                0xffffffff);
+        else
+            param.init(slot * 8, PARAM_MAP_LOAD_TYPE_REUSE, 0, i % reuse_cnt, 0, i * 16,
+                (i % 5 == 0) ? 0xfffff000 : 0xffffffff);
+        param_map.push_back(param);
+    }
+}
+
+TEST_CASE("rodata_template")
+{
+    const uint32_t entry_cnt = 4096, reuse_cnt = 37, static_cnt = 5;
+    std::vector<char> rodata, dcr, ro_ref, dcr_ref, ro_tmpl, dcr_tmpl;
+    std::vector<struct GraphParamMapLoadDesc> param_map;
+    std::vector<BufferDesc> reuses(reuse_cnt), weights(static_cnt);
+    std::vector<BufferDesc *> reuse_buf, static_buf;
+    std::set<uint32_t> dma_buf_idx = {3, 20};
+    RodataTemplate tmpl;
+    BinSection ro_sec, dcr_sec;
+    HostMemory mem;
+    HostDevice dev(&mem);
+    GraphV12 graph(nullptr, 0, &dev);
+
+    make_param_map(entry_cnt, reuse_cnt, static_cnt, rodata, dcr, param_map);
+    RodataJob job(graph, &dev, rodata.size(), dcr.size());
+    for (uint32_t i = 0; i < reuse_cnt; i++)
+    {
+        reuses[i].init(0x100000000UL, 0x100000000UL + 0x2000000 + i * 0x10000, 0x10000, 0x10000);
+        reuse_buf.push_back(&reuses[i]);
+    }
+    for (uint32_t i = 0; i < static_cnt; i++)
+    {
+        weights[i].init(0, 0x80000000UL + i * 0x400000, 0x400000, 0x400000);
+        static_buf.push_back(&weights[i]);
+    }
+
+    ro_sec.init(rodata.data(), rodata.size());
+    dcr_sec.init(dcr.data(), dcr.size());
+    REQUIRE(tmpl.build(ro_sec, dcr_sec, param_map, static_buf, reuse_cnt));
+    CHECK(tmpl.get_reuse_entry_cnt() == entry_cnt - (entry_cnt + 2) / 3);
+
+    ro_ref = rodata;
+    dcr_ref = dcr;
+    CHECK(job.relocate(ro_ref, dcr_ref, param_map, reuse_buf, static_buf) == AIPU_STATUS_SUCCESS);
+    ro_tmpl.assign(tmpl.get_rodata(), tmpl.get_rodata() + rodata.size());
+    dcr_tmpl.assign(tmpl.get_dcr(), tmpl.get_dcr() + dcr.size());
+    CHECK(tmpl.patch(ro_tmpl.data(), dcr_tmpl.data(), reuse_buf) == AIPU_STATUS_SUCCESS);
+    CHECK(ro_tmpl == ro_ref);
+    CHECK(dcr_tmpl == dcr_ref);
+
+    /* re-point two sections as specify_io_buffer does */
+    for (auto idx : dma_buf_idx)
+        reuses[idx].init(0, 0x7ff00000UL + idx * 0x1000, 0x1000, 0x1000);
+    CHECK(job.relocate(ro_ref, dcr_ref, param_map, reuse_buf, static_buf, &dma_buf_idx) ==
+        AIPU_STATUS_SUCCESS);
+    CHECK(tmpl.patch(ro_tmpl.data(), dcr_tmpl.data(), reuse_buf, &dma_buf_idx) == AIPU_STATUS_SUCCESS);
+    CHECK(ro_tmpl == ro_ref);
+    CHECK(dcr_tmpl == dcr_ref);
+
+    /* too few reuse buffers for the map */
+    reuse_buf.pop_back();
+    CHECK(tmpl.patch(ro_tmpl.data(), dcr_tmpl.data(), reuse_buf) == AIPU_STATUS_ERROR_INVALID_SIZE);
+
+    /* overlapping entries fall back to per-entry relocation */
+    param_map.push_back(param_map[0]);
+    param_map.back().offset_in_map += 2;
+    CHECK(!tmpl.build(ro_sec, dcr_sec, param_map, static_buf, reuse_cnt));
+    CHECK(!tmpl.is_valid());
+}
+
+TEST_CASE("rodata_relocation_benchmark")
+{
+    const uint32_t reuse_cnt = 64, static_cnt = 16, round_cnt = 64;
+    std::vector<BufferDesc> reuses(reuse_cnt), weights(static_cnt);
+    std::vector<BufferDesc *> reuse_buf, static_buf;
+    HostMemory mem;
+    HostDevice dev(&mem);
+    GraphV12 graph(nullptr, 0, &dev);
+
+    for (uint32_t i = 0; i < reuse_cnt; i++)
+    {
+        reuses[i].init(0, 0x10000000UL + i * 0x100000, 0x100000, 0x100000);
+        reuse_buf.push_back(&reuses[i]);
+    }
+    for (uint32_t i = 0; i < static_cnt; i++)
+    {
+        weights[i].init(0, 0x80000000UL + i * 0x1000000, 0x1000000, 0x1000000);
+        static_buf.push_back(&weights[i]);
+    }
+
+    for (uint32_t entry_cnt = 1024; entry_cnt <= (1 << 18); entry_cnt *= 4)
+    {
+        std::vector<char> rodata, dcr, ro_job, dcr_job;
+        std::vector<struct GraphParamMapLoadDesc> param_map;
+        RodataTemplate tmpl;
+        BinSection ro_sec, dcr_sec;
+        double ns[2] = {0};
+
+        make_param_map(entry_cnt, reuse_cnt, static_cnt, rodata, dcr, param_map);
+        ro_sec.init(rodata.data(), rodata.size());
+        dcr_sec.init(dcr.data(), dcr.size());
+        REQUIRE(tmpl.build(ro_sec, dcr_sec, param_map, static_buf, reuse_cnt));
+        ro_job.resize(rodata.size());
+        dcr_job.resize(dcr.size());
+        RodataJob job(graph, &dev, rodata.size(), dcr.size());
+
+        for (int mode = 0; mode < 2; mode++)
+        {
+            auto start = std::chrono::steady_clock::now();
+
+            for (uint32_t round = 0; round < round_cnt; round++)
+            {
+                if (mode == 0)
+                {
+                    mem.write(job.m_ro->pa, rodata.data(), rodata.size());
+                    mem.write(job.m_dcr->pa, dcr.data(), dcr.size());
+                    job.setup_rodata(param_map, reuse_buf, static_buf, *job.m_ro, job.m_dcr);
+                } else {
+                    memcpy(ro_job.data(), tmpl.get_rodata(), rodata.size());
+                    memcpy(dcr_job.data(), tmpl.get_dcr(), dcr.size());
+                    tmpl.patch(ro_job.data(), dcr_job.data(), reuse_buf);
+                }
+            }
+            ns[mode] = std::chrono::duration<double, std::nano>(
+                std::chrono::steady_clock::now() - start).count() / round_cnt;
+        }
+
+        MESSAGE(entry_cnt, " entries: per-entry ", ns[0] / 1000, " us/job, template ",
+            ns[1] / 1000, " us/job");
+    }
+}
+
+TEST_CASE("job_arena_layout")
+{
+    JobArenaLayout layout;
+    uint64_t offset = 0;
+
+    /* items take whole pages, in placement order */
+    CHECK(layout.place(ARENA_DEFAULT, 1) == 0);
+    CHECK(layout.place(ARENA_DEFAULT, AIPU_PAGE_SIZE + 1) == AIPU_PAGE_SIZE);
+    CHECK(layout.size[ARENA_DEFAULT] == 3 * AIPU_PAGE_SIZE);
+
+    /* aligned items pad the arena and raise its alignment */
+    offset = layout.place(ARENA_DEFAULT, 0x100, 4);
+    CHECK(offset == 4 * AIPU_PAGE_SIZE);
+    CHECK(layout.size[ARENA_DEFAULT] == 5 * AIPU_PAGE_SIZE);
+    CHECK(layout.align_in_page[ARENA_DEFAULT] == 4);
+
+    /* the arenas are independent */
+    CHECK(layout.place(ARENA_REUSE, 0x100) == 0);
+    CHECK(layout.size[ARENA_REUSE] == AIPU_PAGE_SIZE);
+    CHECK(layout.align_in_page[ARENA_REUSE] == 1);
+
+    /* layouts are shared by the jobs whose config changes nothing in them */
+    JobArenaSpec spec[2];
+    spec[0].tcb_size = spec[1].tcb_size = 0x400;
+    CHECK(spec[0].get_key() == spec[1].get_key());
+    spec[1].fm_reuse_idx.insert(2);
+    CHECK(spec[0].get_key() != spec[1].get_key());
+    spec[0].gm_reuse_idx.insert(2);
+    CHECK(spec[0].get_key() != spec[1].get_key());
+}
+
+TEST_CASE("reuse_pool")
+{
+    HostMemory mem;
+    ReusePool pool;
+    std::vector<GraphSectionDesc> sections(4);
+    const std::vector<BufferDesc*> *bufs = nullptr;
+    JobBase *job[3] = {(JobBase *)0x1000, (JobBase *)0x2000, (JobBase *)0x3000};
+    uint32_t slot[3] = {0};
+
+    for (uint32_t i = 0; i < sections.size(); i++)
+    {
+        sections[i].init();
+        sections[i].size = (i + 1) * 0x1800;
+    }
+    sections[3].align_in_page = 4;
+
+    pool.configure(2);
+    pool.set_sections(&mem, sections, {1, 3});
+    REQUIRE(pool.is_enabled());
+
+    /* slots are allocated on demand, only the pooled sections are in them */
+    CHECK(pool.get_slot_cnt() == 0);
+    REQUIRE(pool.acquire(job[0], false, -1, &slot[0], &bufs) == AIPU_STATUS_SUCCESS);
+    CHECK(pool.get_slot_cnt() == 1);
+    CHECK((*bufs)[0] == nullptr);
+    CHECK((*bufs)[1]->req_size == 0x3000);
+    CHECK(((*bufs)[3]->pa - (*bufs)[1]->pa) % (4 * AIPU_PAGE_SIZE) == 0);
+
+    /* a job keeps its slot until released */
+    CHECK(pool.acquire(job[0], false, -1, &slot[1], &bufs) == AIPU_STATUS_SUCCESS);
+    CHECK(slot[1] == slot[0]);
+    CHECK(pool.acquire(job[1], false, -1, &slot[1], &bufs) == AIPU_STATUS_SUCCESS);
+    CHECK(slot[1] != slot[0]);
+    CHECK(pool.get_slot_cnt() == 2);
+
+    /* all the slots are held */
+    CHECK(pool.acquire(job[2], false, -1, &slot[2], &bufs) == AIPU_STATUS_ERROR_TIMEOUT);
+
+    /* the preferred slot is taken if it is free */
+    pool.release(job[0]);
+    pool.release(job[1]);
+    CHECK(pool.acquire(job[2], false, slot[1], &slot[2], &bufs) == AIPU_STATUS_SUCCESS);
+    CHECK(slot[2] == slot[1]);
+    CHECK(pool.acquire(job[0], false, slot[1], &slot[0], &bufs) == AIPU_STATUS_SUCCESS);
+    CHECK(slot[0] != slot[1]);
+    CHECK(pool.get_slot_cnt() == 2);
+
+    pool.detach(job[0]);
+    pool.detach(job[2]);
+    pool.free();
+    CHECK(pool.get_slot_cnt() == 0);
+}
+
+TEST_CASE("reuse_pool_wait")
+{
+    HostMemory mem;
+    HostDevice dev(&mem);
+    GraphV12 graph(nullptr, 0, &dev);
+    RodataJob holder(graph, &dev, 0x100, 0x100), waiter(graph, &dev, 0x100, 0x100);
+    ReusePool pool;
+    std::vector<GraphSectionDesc> sections(2);
+    const std::vector<BufferDesc*> *bufs = nullptr;
+    std::atomic<bool> admitted(false);
+    aipu_status_t ret = AIPU_STATUS_SUCCESS;
+    uint32_t slot[2] = {0};
+
+    for (uint32_t i = 0; i < sections.size(); i++)
+    {
+        sections[i].init();
+        sections[i].size = 0x1000;
+    }
+
+    pool.configure(1);
+    pool.set_sections(&mem, sections, {1});
+    REQUIRE(pool.acquire(&holder, false, -1, &slot[0], &bufs) == AIPU_STATUS_SUCCESS);
+
+    /* a holder bound for a deferred run can't end while the caller waits */
+    holder.update_job_status(AIPU_JOB_STATUS_BIND);
+    CHECK(pool.acquire(&waiter, true, -1, &slot[1], &bufs) == AIPU_STATUS_ERROR_INVALID_OP);
+
+    /* a submitted holder is waited for, the waiter is admitted once it is released */
+    holder.update_job_status(AIPU_JOB_STATUS_SCHED);
+    std::thread th([&] {
+        ret = pool.acquire(&waiter, true, -1, &slot[1], &bufs);
+        admitted = true;
+    });
+
+    while (pool.get_wait_cnt() < 2)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    CHECK(!admitted);
+
+    pool.release(&holder);
+    th.join();
+    CHECK(ret == AIPU_STATUS_SUCCESS);
+    CHECK(slot[1] == slot[0]);
+
+    pool.detach(&holder);
+    pool.detach(&waiter);
+    pool.free();
+}
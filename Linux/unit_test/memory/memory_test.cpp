@@ -0,0 +1,379 @@
+// Copyright (C) 2023-2024 Arm Technology (China) Co. Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <thread>
+#include <atomic>
+#include "memory_test.h"
+#include "mem_tracer.h"
+#if (defined SIMULATION)
+#include <sys/wait.h>
+#include <unistd.h>
+#include "simulator.h"
+#endif
+
+TEST_CASE_FIXTURE(MemoryTest, "pa_to_va")
+{
+    char *va = nullptr;
+
+    alloc_buffers(64);
+
+    /* base, last byte and one byte over the end of each buffer */
+    for (auto desc : m_bufs)
+    {
+        CHECK(m_mem.pa_to_va(desc->pa, desc->size, &va) == 0);
+        CHECK(va != nullptr);
+        CHECK(m_mem.pa_to_va(desc->pa + desc->size - 1, 1, &va) == 0);
+        CHECK(m_mem.pa_to_va(desc->pa + desc->size - 1, 2, &va) == -2);
+        CHECK(m_mem.pa_to_va(desc->pa + desc->size, 1, &va) == -1);
+    }
+
+    /* below the lowest buffer */
+    CHECK(m_mem.pa_to_va(m_bufs[0]->pa - 1, 1, &va) == -1);
+    CHECK(va == nullptr);
+}
+
+TEST_CASE_FIXTURE(MemoryTest, "read_write")
+{
+    uint32_t data = 0;
+
+    alloc_buffers(16);
+    for (uint32_t i = 0; i < m_bufs.size(); i++)
+        CHECK(m_mem.write32(m_bufs[i]->pa + 8, i + 0x100) == 4);
+
+    for (uint32_t i = 0; i < m_bufs.size(); i++)
+    {
+        CHECK(m_mem.read32(&data, m_bufs[i]->pa + 8) == 4);
+        CHECK(data == i + 0x100);
+    }
+}
+
+TEST_CASE_FIXTURE(MemoryTest, "concurrent_read")
+{
+    const uint32_t thread_cnt = 8;
+    std::vector<std::thread> threads;
+    std::atomic_int errors{0};
+
+    alloc_buffers(256);
+    for (uint32_t i = 0; i < m_bufs.size(); i++)
+        m_mem.write32(m_bufs[i]->pa, i);
+
+    for (uint32_t t = 0; t < thread_cnt; t++)
+    {
+        threads.push_back(std::thread([&]() {
+            uint32_t data = 0;
+
+            for (uint32_t r = 0; r < 200; r++)
+            {
+                for (uint32_t i = 0; i < m_bufs.size(); i++)
+                {
+                    if ((m_mem.read32(&data, m_bufs[i]->pa) != 4) || (data != i))
+                        errors++;
+                }
+            }
+        }));
+    }
+
+    for (auto &th : threads)
+        th.join();
+
+    CHECK(errors.load() == 0);
+}
+
+TEST_CASE_FIXTURE(MemoryTest, "lookup_benchmark")
+{
+    uint32_t live_cnt[] = {16, 128, 1024, 8192};
+    double ns[4] = {0};
+
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        alloc_buffers(live_cnt[i] - m_bufs.size());
+        ns[i] = time_lookup(8192 * 16 / live_cnt[i]);
+        MESSAGE("live buffers: " << live_cnt[i] << ", read32: " << ns[i] << " ns");
+    }
+
+    /* logarithmic, a linear scan would grow ~512x from 16 to 8192 buffers */
+    CHECK(ns[3] < ns[0] * 64);
+}
+
+TEST_CASE("mem_tracer")
+{
+    const char *trace_file = "mem_tracer_test.trace";
+    std::vector<std::thread> threads;
+    std::vector<std::string> lines;
+    char line[256] = {0};
+    FILE *text = tmpfile();
+
+    {
+        MemTracer tracer;
+
+        REQUIRE(tracer.start(trace_file) == AIPU_STATUS_SUCCESS);
+        tracer.log(MemOperationAlloc, 0x10000, 0x4000, "weight", false, 0);
+        tracer.log(MemOperationAlloc, 0x20000, 0x1000, "rodata", false, 0);
+
+        /* more ops than a ring holds, from several threads */
+        for (uint32_t t = 0; t < 4; t++)
+        {
+            threads.push_back(std::thread([&tracer, t]() {
+                for (uint32_t i = 0; i < 2 * MEM_TRACE_RING_SIZE; i++)
+                    tracer.log(MemOperationWrite, 0x10000 + t * 0x1000 + (i & 0xff) * 4, 4, nullptr, true, i);
+            }));
+        }
+
+        for (auto &th : threads)
+            th.join();
+
+        tracer.log(MemOperationBzero, 0x20010, 0x10, nullptr, false, 0);
+        tracer.log(MemOperationFree, 0x10000, 0x4000, "weight", false, 0);
+    }
+
+    REQUIRE(MemTracer::decode(trace_file, text) == AIPU_STATUS_SUCCESS);
+    rewind(text);
+    while (fgets(line, sizeof(line), text) != nullptr)
+        lines.push_back(line);
+    fclose(text);
+    remove(trace_file);
+
+    /* header, ops, footer. the ops without name take the one of their buffer */
+    REQUIRE(lines.size() == 3 + 2 + 4 * 2 * MEM_TRACE_RING_SIZE + 2 + 1);
+    CHECK(lines[3].find("weight") != std::string::npos);
+    CHECK(lines[3].find("alloc") != std::string::npos);
+    CHECK(lines[5].find("weight") != std::string::npos);
+    CHECK(lines[5].find("write") != std::string::npos);
+    CHECK(lines[lines.size() - 3].find("rodata") != std::string::npos);
+    CHECK(lines[lines.size() - 3].find("bzero") != std::string::npos);
+    CHECK(lines[lines.size() - 2].find("free") != std::string::npos);
+    CHECK(lines[lines.size() - 2].find("weight") != std::string::npos);
+    CHECK(lines[lines.size() - 1].find("=====") == 0);
+    CHECK(lines[lines.size() - 2].find(std::to_string(lines.size() - 5) + " ") == 0);
+}
+
+#if (defined SIMULATION)
+TEST_CASE("reserve_mem_overlap")
+{
+    UMemory *mem = UMemory::get_memory();
+    BufferDesc *buf = nullptr, *rsv = nullptr, *rsv2 = nullptr;
+    DEV_PA_32 addr = 0;
+
+    REQUIRE(mem->malloc(2 * AIPU_PAGE_SIZE, 0, &buf, "buf") == AIPU_STATUS_SUCCESS);
+
+    /* a page of a buffer in use can't be reserved */
+    CHECK(mem->reserve_mem(buf->pa + AIPU_PAGE_SIZE, AIPU_PAGE_SIZE, &rsv, "rsv") ==
+        AIPU_STATUS_ERROR_BUF_ALLOC_FAIL);
+
+    /* its pages once freed can, but only once */
+    addr = buf->pa;
+    mem->free(&buf);
+    REQUIRE(mem->reserve_mem(addr, AIPU_PAGE_SIZE, &rsv, "rsv") == AIPU_STATUS_SUCCESS);
+    CHECK(mem->reserve_mem(addr, AIPU_PAGE_SIZE, &rsv2, "rsv") == AIPU_STATUS_ERROR_BUF_ALLOC_FAIL);
+
+    /* and the allocator doesn't hand them out meanwhile */
+    REQUIRE(mem->malloc(AIPU_PAGE_SIZE, 0, &buf, "buf") == AIPU_STATUS_SUCCESS);
+    CHECK(buf->pa != addr);
+
+    mem->free(&buf);
+    mem->free(&rsv);
+    delete rsv2;
+}
+
+/* the DTCM region is small and no other case allocates from it */
+static aipu_mem_stats_t dtcm_stats(UMemory *mem)
+{
+    aipu_mem_stats_t stats = {0};
+
+    stats.asid = ASID_REGION_0;
+    stats.mem_type = MEM_REGION_DTCM;
+    mem->get_mem_stats(&stats);
+    return stats;
+}
+
+TEST_CASE("umemory_alloc_align")
+{
+    UMemory *mem = UMemory::get_memory();
+    const uint32_t dtcm = (ASID_REGION_0 << 8) | MEM_REGION_DTCM;
+    BufferDesc pad, buf[3];
+    BufferDesc *ddr = nullptr;
+
+    REQUIRE(dtcm_stats(mem).free_bytes == dtcm_stats(mem).total_bytes);
+
+    /* the pages skipped to align stay free */
+    REQUIRE(mem->malloc_internal(AIPU_PAGE_SIZE, 0, &pad, "pad", dtcm) == AIPU_STATUS_SUCCESS);
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        uint32_t align = 4 << i;
+
+        REQUIRE(mem->malloc_internal(AIPU_PAGE_SIZE + 1, align, &buf[i], "buf", dtcm) ==
+            AIPU_STATUS_SUCCESS);
+        CHECK(buf[i].pa % ((uint64_t)align * AIPU_PAGE_SIZE) == 0);
+        CHECK(buf[i].size == 2 * AIPU_PAGE_SIZE);
+    }
+    CHECK(dtcm_stats(mem).free_bytes == dtcm_stats(mem).total_bytes - 7 * AIPU_PAGE_SIZE);
+    CHECK(dtcm_stats(mem).free_extent_cnt > 1);
+
+    /* the alignment is honoured in the default region too */
+    REQUIRE(mem->malloc(AIPU_PAGE_SIZE, 64, &ddr, "ddr") == AIPU_STATUS_SUCCESS);
+    CHECK(ddr->pa % (64 * AIPU_PAGE_SIZE) == 0);
+
+    mem->free(&ddr);
+    mem->free_phybuffer(&pad);
+    for (uint32_t i = 0; i < 3; i++)
+        mem->free_phybuffer(&buf[i]);
+    CHECK(dtcm_stats(mem).free_bytes == dtcm_stats(mem).total_bytes);
+}
+
+TEST_CASE("umemory_free_coalesce")
+{
+    UMemory *mem = UMemory::get_memory();
+    const uint32_t dtcm = (ASID_REGION_0 << 8) | MEM_REGION_DTCM;
+    aipu_mem_stats_t stats = dtcm_stats(mem);
+    BufferDesc buf[4];
+
+    REQUIRE(stats.free_bytes == stats.total_bytes);
+    for (uint32_t i = 0; i < 4; i++)
+        REQUIRE(mem->malloc_internal(2 * AIPU_PAGE_SIZE, 0, &buf[i], "buf", dtcm) == AIPU_STATUS_SUCCESS);
+
+    /* holes apart from each other and the tail stay apart */
+    mem->free_phybuffer(&buf[0]);
+    mem->free_phybuffer(&buf[2]);
+    stats = dtcm_stats(mem);
+    CHECK(stats.free_extent_cnt == 3);
+    CHECK(stats.fragmentation > 0);
+
+    /* a best fit hole is taken before the tail */
+    REQUIRE(mem->malloc_internal(2 * AIPU_PAGE_SIZE, 0, &buf[0], "buf", dtcm) == AIPU_STATUS_SUCCESS);
+    CHECK(dtcm_stats(mem).free_extent_cnt == 2);
+
+    /* freed neighbours merge, with the extents before and after them */
+    mem->free_phybuffer(&buf[1]);
+    CHECK(dtcm_stats(mem).free_extent_cnt == 2);
+    mem->free_phybuffer(&buf[3]);
+    stats = dtcm_stats(mem);
+    CHECK(stats.free_extent_cnt == 1);
+    CHECK(stats.largest_free_bytes == stats.total_bytes - 2 * AIPU_PAGE_SIZE);
+
+    mem->free_phybuffer(&buf[0]);
+    stats = dtcm_stats(mem);
+    CHECK(stats.free_extent_cnt == 1);
+    CHECK(stats.largest_free_bytes == stats.total_bytes);
+    CHECK(stats.fragmentation == 0);
+}
+
+TEST_CASE("umemory_exhaustion")
+{
+    UMemory *mem = UMemory::get_memory();
+    const uint32_t dtcm = (ASID_REGION_0 << 8) | MEM_REGION_DTCM;
+    aipu_mem_stats_t stats = dtcm_stats(mem);
+    BufferDesc all, page, half[2];
+
+    REQUIRE(stats.free_bytes == stats.total_bytes);
+
+    /* larger than the region is a size error, a full region a failed alloc */
+    CHECK(mem->malloc_internal(stats.total_bytes + 1, 0, &all, "all", dtcm) ==
+        AIPU_STATUS_ERROR_INVALID_SIZE);
+    REQUIRE(mem->malloc_internal(stats.total_bytes, 0, &all, "all", dtcm) == AIPU_STATUS_SUCCESS);
+    CHECK(dtcm_stats(mem).free_bytes == 0);
+    CHECK(dtcm_stats(mem).free_extent_cnt == 0);
+    CHECK(mem->malloc_internal(AIPU_PAGE_SIZE, 0, &page, "page", dtcm) ==
+        AIPU_STATUS_ERROR_BUF_ALLOC_FAIL);
+    mem->free_phybuffer(&all);
+
+    /* enough free pages in total but not in one extent */
+    REQUIRE(mem->malloc_internal(stats.total_bytes / 2, 0, &half[0], "half", dtcm) == AIPU_STATUS_SUCCESS);
+    REQUIRE(mem->malloc_internal(AIPU_PAGE_SIZE, 0, &page, "page", dtcm) == AIPU_STATUS_SUCCESS);
+    REQUIRE(mem->malloc_internal(stats.total_bytes / 2 - AIPU_PAGE_SIZE, 0, &half[1], "half", dtcm) ==
+        AIPU_STATUS_SUCCESS);
+    mem->free_phybuffer(&half[0]);
+    mem->free_phybuffer(&half[1]);
+    CHECK(dtcm_stats(mem).free_bytes == stats.total_bytes - AIPU_PAGE_SIZE);
+    CHECK(mem->malloc_internal(stats.total_bytes / 2 + AIPU_PAGE_SIZE, 0, &all, "all", dtcm) ==
+        AIPU_STATUS_ERROR_BUF_ALLOC_FAIL);
+
+    mem->free_phybuffer(&page);
+    CHECK(dtcm_stats(mem).free_bytes == stats.total_bytes);
+
+    /* free pages but no aligned ones, the region base is aligned to its size */
+    REQUIRE(mem->malloc_internal(AIPU_PAGE_SIZE, 0, &page, "page", dtcm) == AIPU_STATUS_SUCCESS);
+    CHECK(mem->malloc_internal(AIPU_PAGE_SIZE, stats.total_bytes / AIPU_PAGE_SIZE, &all, "all",
+        dtcm) == AIPU_STATUS_ERROR_BUF_ALLOC_FAIL);
+    REQUIRE(mem->malloc_internal(AIPU_PAGE_SIZE, stats.total_bytes / AIPU_PAGE_SIZE / 2, &all, "all",
+        dtcm) == AIPU_STATUS_SUCCESS);
+    CHECK(all.pa == page.pa + stats.total_bytes / 2);
+
+    mem->free_phybuffer(&all);
+    mem->free_phybuffer(&page);
+    CHECK(dtcm_stats(mem).free_bytes == stats.total_bytes);
+}
+
+/**
+ * one job through the simulator server protocol against the stub server
+ * (tools/sim_server_stub.cpp), which copies the rodata into the outputs. the
+ * memory has to be shared from its start on, so the case runs itself once
+ * more with UMD_SIM_SERVER=y if this process has private memory.
+ */
+TEST_CASE("sim_server_round_trip")
+{
+    Simulator *sim = Simulator::get_simulator();
+    UMemory *mem = sim->get_umemory();
+    BufferDesc *text = nullptr, *rodata = nullptr, *stack = nullptr, *output = nullptr;
+    JobDesc job = {};
+    char pattern[256], data[256];
+    int status = -1;
+    pid_t pid = -1;
+
+    if (mem->get_shm_fd() < 0)
+    {
+        sim->dec_ref_cnt();
+        pid = fork();
+        if (pid == 0)
+        {
+            setenv("UMD_SIM_SERVER", "y", 1);
+            execl("/proc/self/exe", "runtime_unit_test", "-tc=sim_server_round_trip", (char *)nullptr);
+            _exit(127);
+        }
+        REQUIRE(pid > 0);
+        REQUIRE(waitpid(pid, &status, 0) == pid);
+        CHECK(WIFEXITED(status));
+        CHECK(WEXITSTATUS(status) == 0);
+        return;
+    }
+
+    REQUIRE(mem->malloc(0x1000, 0, &text, "text") == AIPU_STATUS_SUCCESS);
+    REQUIRE(mem->malloc(sizeof(pattern), 0, &rodata, "rodata") == AIPU_STATUS_SUCCESS);
+    REQUIRE(mem->malloc(0x1000, 0, &stack, "stack") == AIPU_STATUS_SUCCESS);
+    REQUIRE(mem->malloc(sizeof(data), 0, &output, "output") == AIPU_STATUS_SUCCESS);
+
+    for (uint32_t i = 0; i < sizeof(pattern); i++)
+        pattern[i] = i ^ 0x5a;
+    mem->write(rodata->pa, pattern, sizeof(pattern));
+
+    job.kdesc.job_id = 1;
+    job.kdesc.aipu_version = AIPU_ISA_VERSION_ZHOUYI_V2_0;
+    job.kdesc.data_0_addr = rodata->pa;
+    job.kdesc.data_1_addr = stack->pa;
+    job.instruction_base_pa = text->pa;
+    job.text_size = text->size;
+    job.rodata_size = sizeof(pattern);
+    job.stack_size = stack->size;
+    job.outputs.push_back(*output);
+    job.output_dir = ".";
+    job.log_path = ".";
+    job.simulator = "./sim_server_stub";
+
+    /* the output is written in place, nothing is reloaded */
+    CHECK(sim->schedule(job) == AIPU_STATUS_SUCCESS);
+    mem->read(output->pa, data, sizeof(data));
+    CHECK(memcmp(data, pattern, sizeof(pattern)) == 0);
+
+    /* a buffer out of the shared memory fails the job, the server lives on */
+    job.outputs[0].pa = 0xF0000000;
+    CHECK(sim->schedule(job) == AIPU_STATUS_ERROR_JOB_EXCEPTION);
+    job.outputs[0].pa = output->pa;
+    CHECK(sim->schedule(job) == AIPU_STATUS_SUCCESS);
+
+    mem->free(&text);
+    mem->free(&rodata);
+    mem->free(&stack);
+    mem->free(&output);
+    sim->dec_ref_cnt();
+}
+#endif
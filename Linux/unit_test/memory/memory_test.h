@@ -0,0 +1,151 @@
+// Copyright (C) 2023-2024 Arm Technology (China) Co. Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <cstring>
+#include <vector>
+#include <chrono>
+#include "doctest.h"
+#include "memory_base.h"
+
+using namespace aipudrv;
+using namespace std;
+
+/**
+ * host-only memory backend, so that MemoryBase's PA lookup path can be
+ * exercised and timed without a device or simulator.
+ */
+class HostMemory: public MemoryBase
+{
+private:
+    DEV_PA_64 m_next_pa = 0x10000000;
+
+public:
+    virtual aipu_status_t malloc(uint32_t size, uint32_t align, BufferDesc** desc,
+        const char* str = nullptr, uint32_t asid_mem_cfg = 0)
+    {
+        Buffer buf;
+        uint64_t malloc_size = ALIGN_PAGE(size);
+
+        if (size == 0)
+            return AIPU_STATUS_ERROR_INVALID_SIZE;
+
+        if (*desc == nullptr)
+            *desc = new BufferDesc;
+
+        (*desc)->init(0, m_next_pa, malloc_size, size);
+        buf.init(new char[malloc_size], *desc);
+        memset(buf.va, 0, malloc_size);
+
+        pthread_rwlock_wrlock(&m_lock);
+        m_allocated[(*desc)->pa] = buf;
+        pthread_rwlock_unlock(&m_lock);
+
+        /* leave one page hole between buffers */
+        m_next_pa += malloc_size + AIPU_PAGE_SIZE;
+        return AIPU_STATUS_SUCCESS;
+    }
+
+    virtual aipu_status_t free(BufferDesc** desc, const char* str = nullptr)
+    {
+        aipu_status_t ret = free_phybuffer(*desc, str);
+
+        if (ret == AIPU_STATUS_SUCCESS)
+            free_bufferdesc(desc);
+        return ret;
+    }
+
+    virtual aipu_status_t free_phybuffer(BufferDesc* desc, const char* str = nullptr)
+    {
+        pthread_rwlock_wrlock(&m_lock);
+        auto iter = m_allocated.find(desc->pa);
+        if (iter == m_allocated.end())
+        {
+            pthread_rwlock_unlock(&m_lock);
+            return AIPU_STATUS_ERROR_BUF_FREE_FAIL;
+        }
+
+        delete[] iter->second.va;
+        m_allocated.erase(iter);
+        pthread_rwlock_unlock(&m_lock);
+        return AIPU_STATUS_SUCCESS;
+    }
+
+    virtual aipu_status_t reserve_mem(DEV_PA_32 addr, uint32_t size, BufferDesc** desc,
+        const char* str = nullptr)
+    {
+        return AIPU_STATUS_ERROR_OP_NOT_SUPPORTED;
+    }
+
+    virtual int64_t read(uint64_t addr, void *dest, size_t size) const
+    {
+        return mem_read(addr, dest, size);
+    }
+
+    virtual int64_t write(uint64_t addr, const void *src, size_t size)
+    {
+        return mem_write(addr, src, size);
+    }
+
+    virtual int64_t zeroize(uint64_t addr, size_t size)
+    {
+        return mem_bzero(addr, size);
+    }
+
+    virtual ~HostMemory()
+    {
+        for (auto &item : m_allocated)
+        {
+            delete[] item.second.va;
+            delete item.second.desc;
+        }
+        m_allocated.clear();
+    }
+};
+
+class MemoryTest
+{
+public:
+    HostMemory m_mem;
+    std::vector<BufferDesc*> m_bufs;
+
+    void alloc_buffers(uint32_t cnt, uint32_t size = AIPU_PAGE_SIZE)
+    {
+        for (uint32_t i = 0; i < cnt; i++)
+        {
+            BufferDesc *desc = nullptr;
+
+            m_mem.malloc(size, 1, &desc);
+            m_bufs.push_back(desc);
+        }
+    }
+
+    void free_buffers()
+    {
+        for (auto desc : m_bufs)
+            m_mem.free(&desc);
+        m_bufs.clear();
+    }
+
+    /* average nanoseconds per read32 over all live buffers */
+    double time_lookup(uint32_t rounds)
+    {
+        uint32_t data = 0;
+        auto start = std::chrono::steady_clock::now();
+
+        for (uint32_t r = 0; r < rounds; r++)
+        {
+            for (auto desc : m_bufs)
+                m_mem.read32(&data, desc->pa + (r % (desc->size / 4)) * 4);
+        }
+
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::nano>(end - start).count() /
+            ((double)rounds * m_bufs.size());
+    }
+
+    ~MemoryTest()
+    {
+        free_buffers();
+    }
+};